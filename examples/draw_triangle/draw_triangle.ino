@@ -189,12 +189,19 @@ void loop() {
     unsigned long currTime = millis();
     if( (stepper_cycle_running() && (currTime - prevTime) >= 1000) || (currTime - prevTime) >= 10000 ) {
         prevTime = currTime;
+        
+        // моторы вращаются - current_pos меняется в обработчике таймера,
+        // читаем согласованный снимок
+        stepper* smotors[] = {&sm_x, &sm_y, &sm_z};
+        stepper_snapshot_t snapshots[3];
+        stepper_snapshot(smotors, 3, snapshots);
+        
         Serial.print("X.pos=");
-        Serial.print(sm_x.current_pos, DEC);
+        Serial.print(snapshots[0].current_pos, DEC);
         Serial.print(", Y.pos=");
-        Serial.print(sm_y.current_pos, DEC);
+        Serial.print(snapshots[1].current_pos, DEC);
         Serial.print(", Z.pos=");
-        Serial.print(sm_z.current_pos, DEC);
+        Serial.print(snapshots[2].current_pos, DEC);
         Serial.println();
     }
     
@@ -0,0 +1,47 @@
+#include "stepper.h"
+#include "stepper_gcode.h"
+
+// Stepper motors
+static stepper sm_x, sm_y, sm_z;
+
+// G-code comes from Serial line by line (see stepper_gcode.h for
+// the supported commands), program ends with M2 or M30
+static int read_serial(void* source) {
+    return Serial.read();
+}
+
+void setup() {
+    Serial.begin(115200);
+    
+    // X
+    init_stepper(&sm_x, 'x', 2, 5, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, CONST, CONST, 0, 300000000);
+    // Y
+    init_stepper(&sm_y, 'y', 3, 6, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, CONST, CONST, 0, 216000000);
+    // Z
+    init_stepper(&sm_z, 'z', 4, 7, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_z, NO_PIN, NO_PIN, CONST, CONST, 0, 100000000);
+    
+    // axes X, Y, Z - by motor names
+    stepper* axes[] = {&sm_x, &sm_y, &sm_z};
+    stepper_gcode_start(axes, 3, read_serial, NULL);
+}
+
+void loop() {
+    static bool running = true;
+    
+    // parse next line while current segment is running,
+    // start next segment when current one is finished
+    if(running && !stepper_gcode_handle()) {
+        running = false;
+        if(stepper_gcode_status() == GCODE_FINISHED) {
+            Serial.print("G-code finished, lines: ");
+        } else {
+            Serial.print("G-code failed, line: ");
+        }
+        Serial.println(stepper_gcode_lines(), DEC);
+    }
+    
+    // put any code here, it would run while the motors are rotating
+}
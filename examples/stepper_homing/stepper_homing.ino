@@ -0,0 +1,64 @@
+#include "stepper.h"
+#include "stepper_homing.h"
+
+// Stepper motors
+static stepper sm_x, sm_y, sm_z;
+
+// Homing settings
+static stepper_homing homing_x, homing_y, homing_z;
+
+void setup() {
+    Serial.begin(9600);
+    Serial.println("Starting stepper_h homing...");
+    
+    // Pinout for CNC-shield: X-, Y- and Z+ end switches
+    
+    // X
+    init_stepper(&sm_x, 'x', 2, 5, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_x, 9, NO_PIN, CONST, CONST, 0, 300000000);
+    // Y
+    init_stepper(&sm_y, 'y', 3, 6, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_y, 10, NO_PIN, CONST, CONST, 0, 216000000);
+    // Z
+    init_stepper(&sm_z, 'z', 4, 7, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_z, NO_PIN, 11, CONST, CONST, 0, 100000000);
+    
+    // init_stepper_homing(stepper_homing* homing, stepper* smotor, int dir,
+    //     unsigned long fast_step_delay, unsigned long slow_step_delay,
+    //     unsigned long back_off_steps, unsigned long max_steps)
+    
+    // X, Y: to min switch at full speed (up to 40000 steps = 300mm),
+    // back off 200 steps (1.5mm), slow approach 10 times slower
+    init_stepper_homing(&homing_x, &sm_x, -1, 1000, 10000, 200, 40000);
+    init_stepper_homing(&homing_y, &sm_y, -1, 1000, 10000, 200, 40000);
+    // Z: to max switch
+    init_stepper_homing(&homing_z, &sm_z, 1, 1000, 10000, 200, 14000);
+    
+    // all axes at once, non-blocking
+    stepper_homing* homings[] = {&homing_x, &homing_y, &homing_z};
+    if(!stepper_homing_start(homings, 3)) {
+        Serial.println("Can't start homing");
+    }
+}
+
+void loop() {
+    static bool homing = true;
+    
+    // next homing phase when current one is finished
+    if(homing && !stepper_homing_handle()) {
+        homing = false;
+        if(stepper_homing_phase() == HOMING_DONE) {
+            Serial.print("Homed: X.pos=");
+            Serial.print(sm_x.current_pos, DEC);
+            Serial.print(", Y.pos=");
+            Serial.print(sm_y.current_pos, DEC);
+            Serial.print(", Z.pos=");
+            Serial.print(sm_z.current_pos, DEC);
+            Serial.println();
+        } else {
+            Serial.println("Homing failed");
+        }
+    }
+    
+    // put any code here, it would run while the motors are rotating
+}
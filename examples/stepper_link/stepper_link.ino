@@ -0,0 +1,46 @@
+#include "stepper.h"
+#include "stepper_link.h"
+
+// Stepper motors
+static stepper sm_x, sm_y, sm_z;
+
+// Segments come from the host over Serial in binary frames
+// (see stepper_link.h for the protocol)
+static int read_serial(void* source) {
+    return Serial.read();
+}
+
+static void write_serial(unsigned char b, void* source) {
+    Serial.write(b);
+}
+
+void setup() {
+    Serial.begin(115200);
+    
+    // X
+    init_stepper(&sm_x, 'x', 2, 5, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, CONST, CONST, 0, 300000000);
+    // Y
+    init_stepper(&sm_y, 'y', 3, 6, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, CONST, CONST, 0, 216000000);
+    // Z
+    init_stepper(&sm_z, 'z', 4, 7, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_z, NO_PIN, NO_PIN, CONST, CONST, 0, 100000000);
+    
+    // program axes 0, 1, 2
+    stepper* axes[] = {&sm_x, &sm_y, &sm_z};
+    stepper_link_start(axes, 3, read_serial, write_serial, NULL);
+}
+
+void loop() {
+    // receive frames and answer the host while current segment is running,
+    // start next segment from the queue when current one is finished;
+    // Serial is used by the protocol, so nothing else is printed there
+    if(!stepper_link_handle() && stepper_link_status() != LINK_RUNNING) {
+        // finished or failed: wait for the next program
+        stepper* axes[] = {&sm_x, &sm_y, &sm_z};
+        stepper_link_start(axes, 3, read_serial, write_serial, NULL);
+    }
+    
+    // put any code here, it would run while the motors are rotating
+}
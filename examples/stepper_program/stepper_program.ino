@@ -0,0 +1,47 @@
+#include "stepper.h"
+#include "stepper_program.h"
+
+// Stepper motors
+static stepper sm_x, sm_y, sm_z;
+
+// Binary motion program comes from Serial (see stepper_program.h for
+// the format, sim/stepper_prog writes it from a text description)
+static int read_serial(void* source) {
+    return Serial.read();
+}
+
+void setup() {
+    Serial.begin(115200);
+    
+    // X
+    init_stepper(&sm_x, 'x', 2, 5, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, CONST, CONST, 0, 300000000);
+    // Y
+    init_stepper(&sm_y, 'y', 3, 6, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, CONST, CONST, 0, 216000000);
+    // Z
+    init_stepper(&sm_z, 'z', 4, 7, 8, false, 1000, 7500);
+    init_stepper_ends(&sm_z, NO_PIN, NO_PIN, CONST, CONST, 0, 100000000);
+    
+    // program axes 0, 1, 2
+    stepper* axes[] = {&sm_x, &sm_y, &sm_z};
+    stepper_program_start(axes, 3, read_serial, NULL);
+}
+
+void loop() {
+    static bool running = true;
+    
+    // read next segment while current one is running,
+    // start it when current one is finished
+    if(running && !stepper_program_handle()) {
+        running = false;
+        if(stepper_program_status() == PROGRAM_FINISHED) {
+            Serial.print("Program finished, segments: ");
+            Serial.println(stepper_program_segments(), DEC);
+        } else {
+            Serial.println("Program failed");
+        }
+    }
+    
+    // put any code here, it would run while the motors are rotating
+}
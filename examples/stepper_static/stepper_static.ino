@@ -0,0 +1,37 @@
+#include "stepper_static.h"
+
+// Моторы и период таймера известны на этапе компиляции:
+// stepper_static_motor<pin_step, pin_dir, pin_en, invert_dir,
+//     min_step_delay, distance_per_step, pin_min, pin_max>
+typedef stepper_static_motor<8, 9, 10, false, 1000, 7500> motor_x;
+typedef stepper_static_motor<5, 6, 7, false, 1000, 7500, 3, NO_PIN> motor_y;
+
+// период таймера 200 мкс: минимальные задержки моторов должны вмещать
+// 3 периода и быть кратны периоду, иначе скетч не скомпилируется
+typedef stepper_static<200, motor_x, motor_y> engine;
+
+// обработчик таймера - статический движок
+STEPPER_STATIC_ISR(engine)
+
+void setup() {
+    Serial.begin(9600);
+    
+    engine::init();
+}
+
+void loop() {
+    if(!engine::cycle_running()) {
+        Serial.print("x=");
+        Serial.print((long)engine::current_pos<0>());
+        Serial.print(", y=");
+        Serial.println((long)engine::current_pos<1>());
+        
+        // X - 1000 шагов вперед с максимальной скоростью,
+        // Y - 500 шагов назад в 2 раза медленнее (до концевика)
+        engine::prepare_steps<0>(1000, 1, 1000);
+        engine::prepare_steps<1>(500, -1, 2000);
+        engine::start_cycle();
+    }
+    
+    delay(100);
+}
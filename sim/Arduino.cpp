@@ -0,0 +1,88 @@
+#include "Arduino.h"
+#include "sim_board.h"
+
+#include "string.h"
+
+// виртуальное время
+unsigned long long sim_time_us = 0;
+
+// текущие значения пинов
+static int _pin_values[SIM_MAX_PINS];
+// счетчики фронтов HIGH>LOW
+static unsigned long long _pin_falls[SIM_MAX_PINS];
+// счетчики фронтов LOW>HIGH
+static unsigned long long _pin_rises[SIM_MAX_PINS];
+// счетчик обращений к пинам
+static unsigned long long _pin_ops = 0;
+
+unsigned long micros() {
+    return (unsigned long)sim_time_us;
+}
+
+void pinMode(int pin, int mode) {
+}
+
+/**
+ * Сохранить значение пина, посчитать фронты HIGH>LOW и LOW>HIGH
+ */
+void digitalWrite(int pin, int val) {
+    _pin_ops++;
+
+    // NO_PIN и прочие несуществующие пины
+    if(pin < 0 || pin >= SIM_MAX_PINS) {
+        return;
+    }
+    
+    if(_pin_values[pin] == HIGH && val == LOW) {
+        _pin_falls[pin]++;
+    } else if(_pin_values[pin] == LOW && val == HIGH) {
+        _pin_rises[pin]++;
+    }
+    _pin_values[pin] = val;
+}
+
+/**
+ * Сохраненное значение пина
+ */
+int digitalRead(int pin) {
+    _pin_ops++;
+
+    if(pin < 0 || pin >= SIM_MAX_PINS) {
+        return LOW;
+    }
+    return _pin_values[pin];
+}
+
+void sim_board_reset() {
+    memset(_pin_values, 0, sizeof(_pin_values));
+    memset(_pin_falls, 0, sizeof(_pin_falls));
+    memset(_pin_rises, 0, sizeof(_pin_rises));
+    _pin_ops = 0;
+    sim_time_us = 0;
+}
+
+void sim_board_set_input(int pin, int val) {
+    if(pin < 0 || pin >= SIM_MAX_PINS) {
+        return;
+    }
+    _pin_values[pin] = val;
+}
+
+unsigned long long sim_board_pin_falls(int pin) {
+    if(pin < 0 || pin >= SIM_MAX_PINS) {
+        return 0;
+    }
+    return _pin_falls[pin];
+}
+
+unsigned long long sim_board_pin_rises(int pin) {
+    if(pin < 0 || pin >= SIM_MAX_PINS) {
+        return 0;
+    }
+    return _pin_rises[pin];
+}
+
+
+unsigned long long sim_board_pin_ops() {
+    return _pin_ops;
+}
@@ -0,0 +1,78 @@
+#!/bin/sh
+# Время работы обработчика таймера на один импульс (нс) в зависимости
+# от количества моторов: обычный цикл по моторам и колесо времени
+# (STEPPER_TIMING_WHEEL), оба варианта собираются с MAX_STEPPERS=32.
+#
+# Симулятор замеряет процессорное время всех импульсов цикла одним
+# замером и вычитает время такого же цикла с пустым обработчиком
+# (isr_avg_ns); каждое задание запускается 3 раза, берем минимум.
+#
+# Запуск:
+#   ./bench.sh
+
+build() {
+    name=$1
+    shift
+    mkdir -p bench/$name
+    cd bench/$name
+    gcc -c ../../../test/timer_setup_stub.c
+    g++ -std=c++11 -O2 -c -DMAX_STEPPERS=32 "$@" \
+        -I../.. -I../../../src/ \
+        ../../Arduino.cpp \
+        ../../../src/stepper.cpp \
+        ../../../src/stepper_timer.cpp \
+        ../../../src/stepper_program.cpp \
+        ../../../src/stepper_gcode.cpp \
+        ../../../test/stepper_configure_timer_stub.cpp \
+        ../../stepper_job.cpp \
+        ../../stepper_sim.cpp
+    g++ *.o -o ../stepper_sim_$name
+    cd ../..
+}
+
+# задание: n моторов, задержки 1000-4000 мкс, каждый мотор вращается 4 секунды
+job() {
+    n=$1
+    names="abcdefghijklmnopqrstuvwxyzABCDEF"
+    echo "timer 10"
+    i=0
+    while [ $i -lt $n ]; do
+        name=$(echo $names | cut -c $((i + 1)))
+        echo "motor $name $((10 + 2*i)) $((11 + 2*i)) -1 1 1000 7500"
+        i=$((i + 1))
+    done
+    i=0
+    while [ $i -lt $n ]; do
+        name=$(echo $names | cut -c $((i + 1)))
+        k=$((1 + i % 4))
+        echo "steps $name $((4000 / k)) 1 $((1000 * k))"
+        i=$((i + 1))
+    done
+    echo "cycle"
+}
+
+build list
+build wheel -DSTEPPER_TIMING_WHEEL
+
+MOTORS="1 2 4 8 12 16 24 32"
+
+for n in $MOTORS; do
+    job $n > bench/motors_$n.job
+done
+
+# минимальное среднее время на импульс из 3 запусков
+avg_ns() {
+    best=
+    for r in 1 2 3; do
+        ns=$(./bench/stepper_sim_$1 -j 1 bench/motors_$2.job | grep -o "isr_avg_ns=[0-9]*" | cut -d= -f2)
+        if [ -z "$best" ] || [ "$ns" -lt "$best" ]; then
+            best=$ns
+        fi
+    done
+    echo $best
+}
+
+echo "# motors list_ns_per_tick wheel_ns_per_tick"
+for n in $MOTORS; do
+    echo "$n $(avg_ns list $n) $(avg_ns wheel $n)"
+done
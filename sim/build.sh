@@ -0,0 +1,21 @@
+#!/bin/sh
+gcc -c ../test/timer_setup_stub.c
+g++ -std=c++11 -O2 -c \
+    -I. -I../src/ \
+    Arduino.cpp \
+    ../src/stepper.cpp \
+    ../src/stepper_timer.cpp \
+    ../src/stepper_program.cpp \
+    ../src/stepper_gcode.cpp \
+    ../test/stepper_configure_timer_stub.cpp \
+    stepper_job.cpp \
+    stepper_sim.cpp \
+    stepper_prog.cpp
+LIB="timer_setup_stub.o Arduino.o stepper.o stepper_timer.o stepper_program.o stepper_gcode.o stepper_configure_timer_stub.o"
+g++ $LIB stepper_job.o stepper_sim.o -o stepper_sim
+g++ $LIB stepper_prog.o -o stepper_prog
+
+# двоичные программы для заданий
+for prog in jobs/*.prog; do
+    ./stepper_prog $prog ${prog%.prog}.sprg
+done
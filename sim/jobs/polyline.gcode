@@ -0,0 +1,1005 @@
+; Многоугольник из 1000 отрезков G1 по 0.1 мм - поток коротких сегментов CAM
+; (100 мм/с: 1000 сегментов в секунду)
+G21 G90
+G0 X35.9155 Y20
+G1 X35.9152 Y20.1000 F6000
+G1 X35.9142 Y20.2000
+G1 X35.9127 Y20.3000
+G1 X35.9105 Y20.4000
+G1 X35.9076 Y20.4999
+G1 X35.9042 Y20.5999
+G1 X35.9001 Y20.6998
+G1 X35.8954 Y20.7997
+G1 X35.8901 Y20.8995
+G1 X35.8841 Y20.9993
+G1 X35.8775 Y21.0991
+G1 X35.8703 Y21.1989
+G1 X35.8624 Y21.2986
+G1 X35.8540 Y21.3982
+G1 X35.8449 Y21.4978
+G1 X35.8351 Y21.5973
+G1 X35.8248 Y21.6968
+G1 X35.8138 Y21.7962
+G1 X35.8022 Y21.8955
+G1 X35.7900 Y21.9947
+G1 X35.7772 Y22.0939
+G1 X35.7637 Y22.1930
+G1 X35.7496 Y22.2920
+G1 X35.7349 Y22.3909
+G1 X35.7195 Y22.4897
+G1 X35.7036 Y22.5885
+G1 X35.6870 Y22.6871
+G1 X35.6698 Y22.7856
+G1 X35.6520 Y22.8840
+G1 X35.6336 Y22.9823
+G1 X35.6145 Y23.0804
+G1 X35.5949 Y23.1785
+G1 X35.5746 Y23.2764
+G1 X35.5537 Y23.3742
+G1 X35.5322 Y23.4719
+G1 X35.5101 Y23.5694
+G1 X35.4873 Y23.6668
+G1 X35.4640 Y23.7640
+G1 X35.4400 Y23.8611
+G1 X35.4155 Y23.9580
+G1 X35.3903 Y24.0548
+G1 X35.3645 Y24.1514
+G1 X35.3381 Y24.2479
+G1 X35.3111 Y24.3442
+G1 X35.2835 Y24.4403
+G1 X35.2553 Y24.5362
+G1 X35.2265 Y24.6320
+G1 X35.1971 Y24.7276
+G1 X35.1671 Y24.8230
+G1 X35.1365 Y24.9182
+G1 X35.1053 Y25.0132
+G1 X35.0735 Y25.1080
+G1 X35.0411 Y25.2026
+G1 X35.0082 Y25.2970
+G1 X34.9746 Y25.3912
+G1 X34.9404 Y25.4852
+G1 X34.9057 Y25.5789
+G1 X34.8703 Y25.6725
+G1 X34.8344 Y25.7658
+G1 X34.7979 Y25.8589
+G1 X34.7607 Y25.9517
+G1 X34.7231 Y26.0444
+G1 X34.6848 Y26.1368
+G1 X34.6459 Y26.2289
+G1 X34.6065 Y26.3208
+G1 X34.5665 Y26.4125
+G1 X34.5259 Y26.5039
+G1 X34.4848 Y26.5950
+G1 X34.4431 Y26.6859
+G1 X34.4008 Y26.7765
+G1 X34.3579 Y26.8668
+G1 X34.3145 Y26.9569
+G1 X34.2705 Y27.0467
+G1 X34.2259 Y27.1362
+G1 X34.1808 Y27.2255
+G1 X34.1351 Y27.3144
+G1 X34.0889 Y27.4031
+G1 X34.0421 Y27.4915
+G1 X33.9948 Y27.5796
+G1 X33.9469 Y27.6673
+G1 X33.8984 Y27.7548
+G1 X33.8494 Y27.8420
+G1 X33.7999 Y27.9289
+G1 X33.7498 Y28.0154
+G1 X33.6991 Y28.1016
+G1 X33.6480 Y28.1876
+G1 X33.5962 Y28.2731
+G1 X33.5440 Y28.3584
+G1 X33.4912 Y28.4433
+G1 X33.4379 Y28.5279
+G1 X33.3840 Y28.6122
+G1 X33.3297 Y28.6961
+G1 X33.2748 Y28.7797
+G1 X33.2193 Y28.8630
+G1 X33.1634 Y28.9458
+G1 X33.1069 Y29.0284
+G1 X33.0499 Y29.1105
+G1 X32.9924 Y29.1924
+G1 X32.9344 Y29.2738
+G1 X32.8759 Y29.3549
+G1 X32.8169 Y29.4356
+G1 X32.7573 Y29.5160
+G1 X32.6973 Y29.5959
+G1 X32.6367 Y29.6755
+G1 X32.5757 Y29.7547
+G1 X32.5142 Y29.8335
+G1 X32.4521 Y29.9120
+G1 X32.3896 Y29.9900
+G1 X32.3266 Y30.0677
+G1 X32.2631 Y30.1449
+G1 X32.1991 Y30.2218
+G1 X32.1346 Y30.2982
+G1 X32.0697 Y30.3743
+G1 X32.0043 Y30.4499
+G1 X31.9384 Y30.5251
+G1 X31.8720 Y30.5999
+G1 X31.8052 Y30.6743
+G1 X31.7379 Y30.7483
+G1 X31.6701 Y30.8218
+G1 X31.6019 Y30.8949
+G1 X31.5332 Y30.9676
+G1 X31.4641 Y31.0398
+G1 X31.3945 Y31.1116
+G1 X31.3244 Y31.1830
+G1 X31.2540 Y31.2540
+G1 X31.1830 Y31.3244
+G1 X31.1116 Y31.3945
+G1 X31.0398 Y31.4641
+G1 X30.9676 Y31.5332
+G1 X30.8949 Y31.6019
+G1 X30.8218 Y31.6701
+G1 X30.7483 Y31.7379
+G1 X30.6743 Y31.8052
+G1 X30.5999 Y31.8720
+G1 X30.5251 Y31.9384
+G1 X30.4499 Y32.0043
+G1 X30.3743 Y32.0697
+G1 X30.2982 Y32.1346
+G1 X30.2218 Y32.1991
+G1 X30.1449 Y32.2631
+G1 X30.0677 Y32.3266
+G1 X29.9900 Y32.3896
+G1 X29.9120 Y32.4521
+G1 X29.8335 Y32.5142
+G1 X29.7547 Y32.5757
+G1 X29.6755 Y32.6367
+G1 X29.5959 Y32.6973
+G1 X29.5160 Y32.7573
+G1 X29.4356 Y32.8169
+G1 X29.3549 Y32.8759
+G1 X29.2738 Y32.9344
+G1 X29.1924 Y32.9924
+G1 X29.1105 Y33.0499
+G1 X29.0284 Y33.1069
+G1 X28.9458 Y33.1634
+G1 X28.8630 Y33.2193
+G1 X28.7797 Y33.2748
+G1 X28.6961 Y33.3297
+G1 X28.6122 Y33.3840
+G1 X28.5279 Y33.4379
+G1 X28.4433 Y33.4912
+G1 X28.3584 Y33.5440
+G1 X28.2731 Y33.5962
+G1 X28.1876 Y33.6480
+G1 X28.1016 Y33.6991
+G1 X28.0154 Y33.7498
+G1 X27.9289 Y33.7999
+G1 X27.8420 Y33.8494
+G1 X27.7548 Y33.8984
+G1 X27.6673 Y33.9469
+G1 X27.5796 Y33.9948
+G1 X27.4915 Y34.0421
+G1 X27.4031 Y34.0889
+G1 X27.3144 Y34.1351
+G1 X27.2255 Y34.1808
+G1 X27.1362 Y34.2259
+G1 X27.0467 Y34.2705
+G1 X26.9569 Y34.3145
+G1 X26.8668 Y34.3579
+G1 X26.7765 Y34.4008
+G1 X26.6859 Y34.4431
+G1 X26.5950 Y34.4848
+G1 X26.5039 Y34.5259
+G1 X26.4125 Y34.5665
+G1 X26.3208 Y34.6065
+G1 X26.2289 Y34.6459
+G1 X26.1368 Y34.6848
+G1 X26.0444 Y34.7231
+G1 X25.9517 Y34.7607
+G1 X25.8589 Y34.7979
+G1 X25.7658 Y34.8344
+G1 X25.6725 Y34.8703
+G1 X25.5789 Y34.9057
+G1 X25.4852 Y34.9404
+G1 X25.3912 Y34.9746
+G1 X25.2970 Y35.0082
+G1 X25.2026 Y35.0411
+G1 X25.1080 Y35.0735
+G1 X25.0132 Y35.1053
+G1 X24.9182 Y35.1365
+G1 X24.8230 Y35.1671
+G1 X24.7276 Y35.1971
+G1 X24.6320 Y35.2265
+G1 X24.5362 Y35.2553
+G1 X24.4403 Y35.2835
+G1 X24.3442 Y35.3111
+G1 X24.2479 Y35.3381
+G1 X24.1514 Y35.3645
+G1 X24.0548 Y35.3903
+G1 X23.9580 Y35.4155
+G1 X23.8611 Y35.4400
+G1 X23.7640 Y35.4640
+G1 X23.6668 Y35.4873
+G1 X23.5694 Y35.5101
+G1 X23.4719 Y35.5322
+G1 X23.3742 Y35.5537
+G1 X23.2764 Y35.5746
+G1 X23.1785 Y35.5949
+G1 X23.0804 Y35.6145
+G1 X22.9823 Y35.6336
+G1 X22.8840 Y35.6520
+G1 X22.7856 Y35.6698
+G1 X22.6871 Y35.6870
+G1 X22.5885 Y35.7036
+G1 X22.4897 Y35.7195
+G1 X22.3909 Y35.7349
+G1 X22.2920 Y35.7496
+G1 X22.1930 Y35.7637
+G1 X22.0939 Y35.7772
+G1 X21.9947 Y35.7900
+G1 X21.8955 Y35.8022
+G1 X21.7962 Y35.8138
+G1 X21.6968 Y35.8248
+G1 X21.5973 Y35.8351
+G1 X21.4978 Y35.8449
+G1 X21.3982 Y35.8540
+G1 X21.2986 Y35.8624
+G1 X21.1989 Y35.8703
+G1 X21.0991 Y35.8775
+G1 X20.9993 Y35.8841
+G1 X20.8995 Y35.8901
+G1 X20.7997 Y35.8954
+G1 X20.6998 Y35.9001
+G1 X20.5999 Y35.9042
+G1 X20.4999 Y35.9076
+G1 X20.4000 Y35.9105
+G1 X20.3000 Y35.9127
+G1 X20.2000 Y35.9142
+G1 X20.1000 Y35.9152
+G1 X20.0000 Y35.9155
+G1 X19.9000 Y35.9152
+G1 X19.8000 Y35.9142
+G1 X19.7000 Y35.9127
+G1 X19.6000 Y35.9105
+G1 X19.5001 Y35.9076
+G1 X19.4001 Y35.9042
+G1 X19.3002 Y35.9001
+G1 X19.2003 Y35.8954
+G1 X19.1005 Y35.8901
+G1 X19.0007 Y35.8841
+G1 X18.9009 Y35.8775
+G1 X18.8011 Y35.8703
+G1 X18.7014 Y35.8624
+G1 X18.6018 Y35.8540
+G1 X18.5022 Y35.8449
+G1 X18.4027 Y35.8351
+G1 X18.3032 Y35.8248
+G1 X18.2038 Y35.8138
+G1 X18.1045 Y35.8022
+G1 X18.0053 Y35.7900
+G1 X17.9061 Y35.7772
+G1 X17.8070 Y35.7637
+G1 X17.7080 Y35.7496
+G1 X17.6091 Y35.7349
+G1 X17.5103 Y35.7195
+G1 X17.4115 Y35.7036
+G1 X17.3129 Y35.6870
+G1 X17.2144 Y35.6698
+G1 X17.1160 Y35.6520
+G1 X17.0177 Y35.6336
+G1 X16.9196 Y35.6145
+G1 X16.8215 Y35.5949
+G1 X16.7236 Y35.5746
+G1 X16.6258 Y35.5537
+G1 X16.5281 Y35.5322
+G1 X16.4306 Y35.5101
+G1 X16.3332 Y35.4873
+G1 X16.2360 Y35.4640
+G1 X16.1389 Y35.4400
+G1 X16.0420 Y35.4155
+G1 X15.9452 Y35.3903
+G1 X15.8486 Y35.3645
+G1 X15.7521 Y35.3381
+G1 X15.6558 Y35.3111
+G1 X15.5597 Y35.2835
+G1 X15.4638 Y35.2553
+G1 X15.3680 Y35.2265
+G1 X15.2724 Y35.1971
+G1 X15.1770 Y35.1671
+G1 X15.0818 Y35.1365
+G1 X14.9868 Y35.1053
+G1 X14.8920 Y35.0735
+G1 X14.7974 Y35.0411
+G1 X14.7030 Y35.0082
+G1 X14.6088 Y34.9746
+G1 X14.5148 Y34.9404
+G1 X14.4211 Y34.9057
+G1 X14.3275 Y34.8703
+G1 X14.2342 Y34.8344
+G1 X14.1411 Y34.7979
+G1 X14.0483 Y34.7607
+G1 X13.9556 Y34.7231
+G1 X13.8632 Y34.6848
+G1 X13.7711 Y34.6459
+G1 X13.6792 Y34.6065
+G1 X13.5875 Y34.5665
+G1 X13.4961 Y34.5259
+G1 X13.4050 Y34.4848
+G1 X13.3141 Y34.4431
+G1 X13.2235 Y34.4008
+G1 X13.1332 Y34.3579
+G1 X13.0431 Y34.3145
+G1 X12.9533 Y34.2705
+G1 X12.8638 Y34.2259
+G1 X12.7745 Y34.1808
+G1 X12.6856 Y34.1351
+G1 X12.5969 Y34.0889
+G1 X12.5085 Y34.0421
+G1 X12.4204 Y33.9948
+G1 X12.3327 Y33.9469
+G1 X12.2452 Y33.8984
+G1 X12.1580 Y33.8494
+G1 X12.0711 Y33.7999
+G1 X11.9846 Y33.7498
+G1 X11.8984 Y33.6991
+G1 X11.8124 Y33.6480
+G1 X11.7269 Y33.5962
+G1 X11.6416 Y33.5440
+G1 X11.5567 Y33.4912
+G1 X11.4721 Y33.4379
+G1 X11.3878 Y33.3840
+G1 X11.3039 Y33.3297
+G1 X11.2203 Y33.2748
+G1 X11.1370 Y33.2193
+G1 X11.0542 Y33.1634
+G1 X10.9716 Y33.1069
+G1 X10.8895 Y33.0499
+G1 X10.8076 Y32.9924
+G1 X10.7262 Y32.9344
+G1 X10.6451 Y32.8759
+G1 X10.5644 Y32.8169
+G1 X10.4840 Y32.7573
+G1 X10.4041 Y32.6973
+G1 X10.3245 Y32.6367
+G1 X10.2453 Y32.5757
+G1 X10.1665 Y32.5142
+G1 X10.0880 Y32.4521
+G1 X10.0100 Y32.3896
+G1 X9.9323 Y32.3266
+G1 X9.8551 Y32.2631
+G1 X9.7782 Y32.1991
+G1 X9.7018 Y32.1346
+G1 X9.6257 Y32.0697
+G1 X9.5501 Y32.0043
+G1 X9.4749 Y31.9384
+G1 X9.4001 Y31.8720
+G1 X9.3257 Y31.8052
+G1 X9.2517 Y31.7379
+G1 X9.1782 Y31.6701
+G1 X9.1051 Y31.6019
+G1 X9.0324 Y31.5332
+G1 X8.9602 Y31.4641
+G1 X8.8884 Y31.3945
+G1 X8.8170 Y31.3244
+G1 X8.7460 Y31.2540
+G1 X8.6756 Y31.1830
+G1 X8.6055 Y31.1116
+G1 X8.5359 Y31.0398
+G1 X8.4668 Y30.9676
+G1 X8.3981 Y30.8949
+G1 X8.3299 Y30.8218
+G1 X8.2621 Y30.7483
+G1 X8.1948 Y30.6743
+G1 X8.1280 Y30.5999
+G1 X8.0616 Y30.5251
+G1 X7.9957 Y30.4499
+G1 X7.9303 Y30.3743
+G1 X7.8654 Y30.2982
+G1 X7.8009 Y30.2218
+G1 X7.7369 Y30.1449
+G1 X7.6734 Y30.0677
+G1 X7.6104 Y29.9900
+G1 X7.5479 Y29.9120
+G1 X7.4858 Y29.8335
+G1 X7.4243 Y29.7547
+G1 X7.3633 Y29.6755
+G1 X7.3027 Y29.5959
+G1 X7.2427 Y29.5160
+G1 X7.1831 Y29.4356
+G1 X7.1241 Y29.3549
+G1 X7.0656 Y29.2738
+G1 X7.0076 Y29.1924
+G1 X6.9501 Y29.1105
+G1 X6.8931 Y29.0284
+G1 X6.8366 Y28.9458
+G1 X6.7807 Y28.8630
+G1 X6.7252 Y28.7797
+G1 X6.6703 Y28.6961
+G1 X6.6160 Y28.6122
+G1 X6.5621 Y28.5279
+G1 X6.5088 Y28.4433
+G1 X6.4560 Y28.3584
+G1 X6.4038 Y28.2731
+G1 X6.3520 Y28.1876
+G1 X6.3009 Y28.1016
+G1 X6.2502 Y28.0154
+G1 X6.2001 Y27.9289
+G1 X6.1506 Y27.8420
+G1 X6.1016 Y27.7548
+G1 X6.0531 Y27.6673
+G1 X6.0052 Y27.5796
+G1 X5.9579 Y27.4915
+G1 X5.9111 Y27.4031
+G1 X5.8649 Y27.3144
+G1 X5.8192 Y27.2255
+G1 X5.7741 Y27.1362
+G1 X5.7295 Y27.0467
+G1 X5.6855 Y26.9569
+G1 X5.6421 Y26.8668
+G1 X5.5992 Y26.7765
+G1 X5.5569 Y26.6859
+G1 X5.5152 Y26.5950
+G1 X5.4741 Y26.5039
+G1 X5.4335 Y26.4125
+G1 X5.3935 Y26.3208
+G1 X5.3541 Y26.2289
+G1 X5.3152 Y26.1368
+G1 X5.2769 Y26.0444
+G1 X5.2393 Y25.9517
+G1 X5.2021 Y25.8589
+G1 X5.1656 Y25.7658
+G1 X5.1297 Y25.6725
+G1 X5.0943 Y25.5789
+G1 X5.0596 Y25.4852
+G1 X5.0254 Y25.3912
+G1 X4.9918 Y25.2970
+G1 X4.9589 Y25.2026
+G1 X4.9265 Y25.1080
+G1 X4.8947 Y25.0132
+G1 X4.8635 Y24.9182
+G1 X4.8329 Y24.8230
+G1 X4.8029 Y24.7276
+G1 X4.7735 Y24.6320
+G1 X4.7447 Y24.5362
+G1 X4.7165 Y24.4403
+G1 X4.6889 Y24.3442
+G1 X4.6619 Y24.2479
+G1 X4.6355 Y24.1514
+G1 X4.6097 Y24.0548
+G1 X4.5845 Y23.9580
+G1 X4.5600 Y23.8611
+G1 X4.5360 Y23.7640
+G1 X4.5127 Y23.6668
+G1 X4.4899 Y23.5694
+G1 X4.4678 Y23.4719
+G1 X4.4463 Y23.3742
+G1 X4.4254 Y23.2764
+G1 X4.4051 Y23.1785
+G1 X4.3855 Y23.0804
+G1 X4.3664 Y22.9823
+G1 X4.3480 Y22.8840
+G1 X4.3302 Y22.7856
+G1 X4.3130 Y22.6871
+G1 X4.2964 Y22.5885
+G1 X4.2805 Y22.4897
+G1 X4.2651 Y22.3909
+G1 X4.2504 Y22.2920
+G1 X4.2363 Y22.1930
+G1 X4.2228 Y22.0939
+G1 X4.2100 Y21.9947
+G1 X4.1978 Y21.8955
+G1 X4.1862 Y21.7962
+G1 X4.1752 Y21.6968
+G1 X4.1649 Y21.5973
+G1 X4.1551 Y21.4978
+G1 X4.1460 Y21.3982
+G1 X4.1376 Y21.2986
+G1 X4.1297 Y21.1989
+G1 X4.1225 Y21.0991
+G1 X4.1159 Y20.9993
+G1 X4.1099 Y20.8995
+G1 X4.1046 Y20.7997
+G1 X4.0999 Y20.6998
+G1 X4.0958 Y20.5999
+G1 X4.0924 Y20.4999
+G1 X4.0895 Y20.4000
+G1 X4.0873 Y20.3000
+G1 X4.0858 Y20.2000
+G1 X4.0848 Y20.1000
+G1 X4.0845 Y20.0000
+G1 X4.0848 Y19.9000
+G1 X4.0858 Y19.8000
+G1 X4.0873 Y19.7000
+G1 X4.0895 Y19.6000
+G1 X4.0924 Y19.5001
+G1 X4.0958 Y19.4001
+G1 X4.0999 Y19.3002
+G1 X4.1046 Y19.2003
+G1 X4.1099 Y19.1005
+G1 X4.1159 Y19.0007
+G1 X4.1225 Y18.9009
+G1 X4.1297 Y18.8011
+G1 X4.1376 Y18.7014
+G1 X4.1460 Y18.6018
+G1 X4.1551 Y18.5022
+G1 X4.1649 Y18.4027
+G1 X4.1752 Y18.3032
+G1 X4.1862 Y18.2038
+G1 X4.1978 Y18.1045
+G1 X4.2100 Y18.0053
+G1 X4.2228 Y17.9061
+G1 X4.2363 Y17.8070
+G1 X4.2504 Y17.7080
+G1 X4.2651 Y17.6091
+G1 X4.2805 Y17.5103
+G1 X4.2964 Y17.4115
+G1 X4.3130 Y17.3129
+G1 X4.3302 Y17.2144
+G1 X4.3480 Y17.1160
+G1 X4.3664 Y17.0177
+G1 X4.3855 Y16.9196
+G1 X4.4051 Y16.8215
+G1 X4.4254 Y16.7236
+G1 X4.4463 Y16.6258
+G1 X4.4678 Y16.5281
+G1 X4.4899 Y16.4306
+G1 X4.5127 Y16.3332
+G1 X4.5360 Y16.2360
+G1 X4.5600 Y16.1389
+G1 X4.5845 Y16.0420
+G1 X4.6097 Y15.9452
+G1 X4.6355 Y15.8486
+G1 X4.6619 Y15.7521
+G1 X4.6889 Y15.6558
+G1 X4.7165 Y15.5597
+G1 X4.7447 Y15.4638
+G1 X4.7735 Y15.3680
+G1 X4.8029 Y15.2724
+G1 X4.8329 Y15.1770
+G1 X4.8635 Y15.0818
+G1 X4.8947 Y14.9868
+G1 X4.9265 Y14.8920
+G1 X4.9589 Y14.7974
+G1 X4.9918 Y14.7030
+G1 X5.0254 Y14.6088
+G1 X5.0596 Y14.5148
+G1 X5.0943 Y14.4211
+G1 X5.1297 Y14.3275
+G1 X5.1656 Y14.2342
+G1 X5.2021 Y14.1411
+G1 X5.2393 Y14.0483
+G1 X5.2769 Y13.9556
+G1 X5.3152 Y13.8632
+G1 X5.3541 Y13.7711
+G1 X5.3935 Y13.6792
+G1 X5.4335 Y13.5875
+G1 X5.4741 Y13.4961
+G1 X5.5152 Y13.4050
+G1 X5.5569 Y13.3141
+G1 X5.5992 Y13.2235
+G1 X5.6421 Y13.1332
+G1 X5.6855 Y13.0431
+G1 X5.7295 Y12.9533
+G1 X5.7741 Y12.8638
+G1 X5.8192 Y12.7745
+G1 X5.8649 Y12.6856
+G1 X5.9111 Y12.5969
+G1 X5.9579 Y12.5085
+G1 X6.0052 Y12.4204
+G1 X6.0531 Y12.3327
+G1 X6.1016 Y12.2452
+G1 X6.1506 Y12.1580
+G1 X6.2001 Y12.0711
+G1 X6.2502 Y11.9846
+G1 X6.3009 Y11.8984
+G1 X6.3520 Y11.8124
+G1 X6.4038 Y11.7269
+G1 X6.4560 Y11.6416
+G1 X6.5088 Y11.5567
+G1 X6.5621 Y11.4721
+G1 X6.6160 Y11.3878
+G1 X6.6703 Y11.3039
+G1 X6.7252 Y11.2203
+G1 X6.7807 Y11.1370
+G1 X6.8366 Y11.0542
+G1 X6.8931 Y10.9716
+G1 X6.9501 Y10.8895
+G1 X7.0076 Y10.8076
+G1 X7.0656 Y10.7262
+G1 X7.1241 Y10.6451
+G1 X7.1831 Y10.5644
+G1 X7.2427 Y10.4840
+G1 X7.3027 Y10.4041
+G1 X7.3633 Y10.3245
+G1 X7.4243 Y10.2453
+G1 X7.4858 Y10.1665
+G1 X7.5479 Y10.0880
+G1 X7.6104 Y10.0100
+G1 X7.6734 Y9.9323
+G1 X7.7369 Y9.8551
+G1 X7.8009 Y9.7782
+G1 X7.8654 Y9.7018
+G1 X7.9303 Y9.6257
+G1 X7.9957 Y9.5501
+G1 X8.0616 Y9.4749
+G1 X8.1280 Y9.4001
+G1 X8.1948 Y9.3257
+G1 X8.2621 Y9.2517
+G1 X8.3299 Y9.1782
+G1 X8.3981 Y9.1051
+G1 X8.4668 Y9.0324
+G1 X8.5359 Y8.9602
+G1 X8.6055 Y8.8884
+G1 X8.6756 Y8.8170
+G1 X8.7460 Y8.7460
+G1 X8.8170 Y8.6756
+G1 X8.8884 Y8.6055
+G1 X8.9602 Y8.5359
+G1 X9.0324 Y8.4668
+G1 X9.1051 Y8.3981
+G1 X9.1782 Y8.3299
+G1 X9.2517 Y8.2621
+G1 X9.3257 Y8.1948
+G1 X9.4001 Y8.1280
+G1 X9.4749 Y8.0616
+G1 X9.5501 Y7.9957
+G1 X9.6257 Y7.9303
+G1 X9.7018 Y7.8654
+G1 X9.7782 Y7.8009
+G1 X9.8551 Y7.7369
+G1 X9.9323 Y7.6734
+G1 X10.0100 Y7.6104
+G1 X10.0880 Y7.5479
+G1 X10.1665 Y7.4858
+G1 X10.2453 Y7.4243
+G1 X10.3245 Y7.3633
+G1 X10.4041 Y7.3027
+G1 X10.4840 Y7.2427
+G1 X10.5644 Y7.1831
+G1 X10.6451 Y7.1241
+G1 X10.7262 Y7.0656
+G1 X10.8076 Y7.0076
+G1 X10.8895 Y6.9501
+G1 X10.9716 Y6.8931
+G1 X11.0542 Y6.8366
+G1 X11.1370 Y6.7807
+G1 X11.2203 Y6.7252
+G1 X11.3039 Y6.6703
+G1 X11.3878 Y6.6160
+G1 X11.4721 Y6.5621
+G1 X11.5567 Y6.5088
+G1 X11.6416 Y6.4560
+G1 X11.7269 Y6.4038
+G1 X11.8124 Y6.3520
+G1 X11.8984 Y6.3009
+G1 X11.9846 Y6.2502
+G1 X12.0711 Y6.2001
+G1 X12.1580 Y6.1506
+G1 X12.2452 Y6.1016
+G1 X12.3327 Y6.0531
+G1 X12.4204 Y6.0052
+G1 X12.5085 Y5.9579
+G1 X12.5969 Y5.9111
+G1 X12.6856 Y5.8649
+G1 X12.7745 Y5.8192
+G1 X12.8638 Y5.7741
+G1 X12.9533 Y5.7295
+G1 X13.0431 Y5.6855
+G1 X13.1332 Y5.6421
+G1 X13.2235 Y5.5992
+G1 X13.3141 Y5.5569
+G1 X13.4050 Y5.5152
+G1 X13.4961 Y5.4741
+G1 X13.5875 Y5.4335
+G1 X13.6792 Y5.3935
+G1 X13.7711 Y5.3541
+G1 X13.8632 Y5.3152
+G1 X13.9556 Y5.2769
+G1 X14.0483 Y5.2393
+G1 X14.1411 Y5.2021
+G1 X14.2342 Y5.1656
+G1 X14.3275 Y5.1297
+G1 X14.4211 Y5.0943
+G1 X14.5148 Y5.0596
+G1 X14.6088 Y5.0254
+G1 X14.7030 Y4.9918
+G1 X14.7974 Y4.9589
+G1 X14.8920 Y4.9265
+G1 X14.9868 Y4.8947
+G1 X15.0818 Y4.8635
+G1 X15.1770 Y4.8329
+G1 X15.2724 Y4.8029
+G1 X15.3680 Y4.7735
+G1 X15.4638 Y4.7447
+G1 X15.5597 Y4.7165
+G1 X15.6558 Y4.6889
+G1 X15.7521 Y4.6619
+G1 X15.8486 Y4.6355
+G1 X15.9452 Y4.6097
+G1 X16.0420 Y4.5845
+G1 X16.1389 Y4.5600
+G1 X16.2360 Y4.5360
+G1 X16.3332 Y4.5127
+G1 X16.4306 Y4.4899
+G1 X16.5281 Y4.4678
+G1 X16.6258 Y4.4463
+G1 X16.7236 Y4.4254
+G1 X16.8215 Y4.4051
+G1 X16.9196 Y4.3855
+G1 X17.0177 Y4.3664
+G1 X17.1160 Y4.3480
+G1 X17.2144 Y4.3302
+G1 X17.3129 Y4.3130
+G1 X17.4115 Y4.2964
+G1 X17.5103 Y4.2805
+G1 X17.6091 Y4.2651
+G1 X17.7080 Y4.2504
+G1 X17.8070 Y4.2363
+G1 X17.9061 Y4.2228
+G1 X18.0053 Y4.2100
+G1 X18.1045 Y4.1978
+G1 X18.2038 Y4.1862
+G1 X18.3032 Y4.1752
+G1 X18.4027 Y4.1649
+G1 X18.5022 Y4.1551
+G1 X18.6018 Y4.1460
+G1 X18.7014 Y4.1376
+G1 X18.8011 Y4.1297
+G1 X18.9009 Y4.1225
+G1 X19.0007 Y4.1159
+G1 X19.1005 Y4.1099
+G1 X19.2003 Y4.1046
+G1 X19.3002 Y4.0999
+G1 X19.4001 Y4.0958
+G1 X19.5001 Y4.0924
+G1 X19.6000 Y4.0895
+G1 X19.7000 Y4.0873
+G1 X19.8000 Y4.0858
+G1 X19.9000 Y4.0848
+G1 X20.0000 Y4.0845
+G1 X20.1000 Y4.0848
+G1 X20.2000 Y4.0858
+G1 X20.3000 Y4.0873
+G1 X20.4000 Y4.0895
+G1 X20.4999 Y4.0924
+G1 X20.5999 Y4.0958
+G1 X20.6998 Y4.0999
+G1 X20.7997 Y4.1046
+G1 X20.8995 Y4.1099
+G1 X20.9993 Y4.1159
+G1 X21.0991 Y4.1225
+G1 X21.1989 Y4.1297
+G1 X21.2986 Y4.1376
+G1 X21.3982 Y4.1460
+G1 X21.4978 Y4.1551
+G1 X21.5973 Y4.1649
+G1 X21.6968 Y4.1752
+G1 X21.7962 Y4.1862
+G1 X21.8955 Y4.1978
+G1 X21.9947 Y4.2100
+G1 X22.0939 Y4.2228
+G1 X22.1930 Y4.2363
+G1 X22.2920 Y4.2504
+G1 X22.3909 Y4.2651
+G1 X22.4897 Y4.2805
+G1 X22.5885 Y4.2964
+G1 X22.6871 Y4.3130
+G1 X22.7856 Y4.3302
+G1 X22.8840 Y4.3480
+G1 X22.9823 Y4.3664
+G1 X23.0804 Y4.3855
+G1 X23.1785 Y4.4051
+G1 X23.2764 Y4.4254
+G1 X23.3742 Y4.4463
+G1 X23.4719 Y4.4678
+G1 X23.5694 Y4.4899
+G1 X23.6668 Y4.5127
+G1 X23.7640 Y4.5360
+G1 X23.8611 Y4.5600
+G1 X23.9580 Y4.5845
+G1 X24.0548 Y4.6097
+G1 X24.1514 Y4.6355
+G1 X24.2479 Y4.6619
+G1 X24.3442 Y4.6889
+G1 X24.4403 Y4.7165
+G1 X24.5362 Y4.7447
+G1 X24.6320 Y4.7735
+G1 X24.7276 Y4.8029
+G1 X24.8230 Y4.8329
+G1 X24.9182 Y4.8635
+G1 X25.0132 Y4.8947
+G1 X25.1080 Y4.9265
+G1 X25.2026 Y4.9589
+G1 X25.2970 Y4.9918
+G1 X25.3912 Y5.0254
+G1 X25.4852 Y5.0596
+G1 X25.5789 Y5.0943
+G1 X25.6725 Y5.1297
+G1 X25.7658 Y5.1656
+G1 X25.8589 Y5.2021
+G1 X25.9517 Y5.2393
+G1 X26.0444 Y5.2769
+G1 X26.1368 Y5.3152
+G1 X26.2289 Y5.3541
+G1 X26.3208 Y5.3935
+G1 X26.4125 Y5.4335
+G1 X26.5039 Y5.4741
+G1 X26.5950 Y5.5152
+G1 X26.6859 Y5.5569
+G1 X26.7765 Y5.5992
+G1 X26.8668 Y5.6421
+G1 X26.9569 Y5.6855
+G1 X27.0467 Y5.7295
+G1 X27.1362 Y5.7741
+G1 X27.2255 Y5.8192
+G1 X27.3144 Y5.8649
+G1 X27.4031 Y5.9111
+G1 X27.4915 Y5.9579
+G1 X27.5796 Y6.0052
+G1 X27.6673 Y6.0531
+G1 X27.7548 Y6.1016
+G1 X27.8420 Y6.1506
+G1 X27.9289 Y6.2001
+G1 X28.0154 Y6.2502
+G1 X28.1016 Y6.3009
+G1 X28.1876 Y6.3520
+G1 X28.2731 Y6.4038
+G1 X28.3584 Y6.4560
+G1 X28.4433 Y6.5088
+G1 X28.5279 Y6.5621
+G1 X28.6122 Y6.6160
+G1 X28.6961 Y6.6703
+G1 X28.7797 Y6.7252
+G1 X28.8630 Y6.7807
+G1 X28.9458 Y6.8366
+G1 X29.0284 Y6.8931
+G1 X29.1105 Y6.9501
+G1 X29.1924 Y7.0076
+G1 X29.2738 Y7.0656
+G1 X29.3549 Y7.1241
+G1 X29.4356 Y7.1831
+G1 X29.5160 Y7.2427
+G1 X29.5959 Y7.3027
+G1 X29.6755 Y7.3633
+G1 X29.7547 Y7.4243
+G1 X29.8335 Y7.4858
+G1 X29.9120 Y7.5479
+G1 X29.9900 Y7.6104
+G1 X30.0677 Y7.6734
+G1 X30.1449 Y7.7369
+G1 X30.2218 Y7.8009
+G1 X30.2982 Y7.8654
+G1 X30.3743 Y7.9303
+G1 X30.4499 Y7.9957
+G1 X30.5251 Y8.0616
+G1 X30.5999 Y8.1280
+G1 X30.6743 Y8.1948
+G1 X30.7483 Y8.2621
+G1 X30.8218 Y8.3299
+G1 X30.8949 Y8.3981
+G1 X30.9676 Y8.4668
+G1 X31.0398 Y8.5359
+G1 X31.1116 Y8.6055
+G1 X31.1830 Y8.6756
+G1 X31.2540 Y8.7460
+G1 X31.3244 Y8.8170
+G1 X31.3945 Y8.8884
+G1 X31.4641 Y8.9602
+G1 X31.5332 Y9.0324
+G1 X31.6019 Y9.1051
+G1 X31.6701 Y9.1782
+G1 X31.7379 Y9.2517
+G1 X31.8052 Y9.3257
+G1 X31.8720 Y9.4001
+G1 X31.9384 Y9.4749
+G1 X32.0043 Y9.5501
+G1 X32.0697 Y9.6257
+G1 X32.1346 Y9.7018
+G1 X32.1991 Y9.7782
+G1 X32.2631 Y9.8551
+G1 X32.3266 Y9.9323
+G1 X32.3896 Y10.0100
+G1 X32.4521 Y10.0880
+G1 X32.5142 Y10.1665
+G1 X32.5757 Y10.2453
+G1 X32.6367 Y10.3245
+G1 X32.6973 Y10.4041
+G1 X32.7573 Y10.4840
+G1 X32.8169 Y10.5644
+G1 X32.8759 Y10.6451
+G1 X32.9344 Y10.7262
+G1 X32.9924 Y10.8076
+G1 X33.0499 Y10.8895
+G1 X33.1069 Y10.9716
+G1 X33.1634 Y11.0542
+G1 X33.2193 Y11.1370
+G1 X33.2748 Y11.2203
+G1 X33.3297 Y11.3039
+G1 X33.3840 Y11.3878
+G1 X33.4379 Y11.4721
+G1 X33.4912 Y11.5567
+G1 X33.5440 Y11.6416
+G1 X33.5962 Y11.7269
+G1 X33.6480 Y11.8124
+G1 X33.6991 Y11.8984
+G1 X33.7498 Y11.9846
+G1 X33.7999 Y12.0711
+G1 X33.8494 Y12.1580
+G1 X33.8984 Y12.2452
+G1 X33.9469 Y12.3327
+G1 X33.9948 Y12.4204
+G1 X34.0421 Y12.5085
+G1 X34.0889 Y12.5969
+G1 X34.1351 Y12.6856
+G1 X34.1808 Y12.7745
+G1 X34.2259 Y12.8638
+G1 X34.2705 Y12.9533
+G1 X34.3145 Y13.0431
+G1 X34.3579 Y13.1332
+G1 X34.4008 Y13.2235
+G1 X34.4431 Y13.3141
+G1 X34.4848 Y13.4050
+G1 X34.5259 Y13.4961
+G1 X34.5665 Y13.5875
+G1 X34.6065 Y13.6792
+G1 X34.6459 Y13.7711
+G1 X34.6848 Y13.8632
+G1 X34.7231 Y13.9556
+G1 X34.7607 Y14.0483
+G1 X34.7979 Y14.1411
+G1 X34.8344 Y14.2342
+G1 X34.8703 Y14.3275
+G1 X34.9057 Y14.4211
+G1 X34.9404 Y14.5148
+G1 X34.9746 Y14.6088
+G1 X35.0082 Y14.7030
+G1 X35.0411 Y14.7974
+G1 X35.0735 Y14.8920
+G1 X35.1053 Y14.9868
+G1 X35.1365 Y15.0818
+G1 X35.1671 Y15.1770
+G1 X35.1971 Y15.2724
+G1 X35.2265 Y15.3680
+G1 X35.2553 Y15.4638
+G1 X35.2835 Y15.5597
+G1 X35.3111 Y15.6558
+G1 X35.3381 Y15.7521
+G1 X35.3645 Y15.8486
+G1 X35.3903 Y15.9452
+G1 X35.4155 Y16.0420
+G1 X35.4400 Y16.1389
+G1 X35.4640 Y16.2360
+G1 X35.4873 Y16.3332
+G1 X35.5101 Y16.4306
+G1 X35.5322 Y16.5281
+G1 X35.5537 Y16.6258
+G1 X35.5746 Y16.7236
+G1 X35.5949 Y16.8215
+G1 X35.6145 Y16.9196
+G1 X35.6336 Y17.0177
+G1 X35.6520 Y17.1160
+G1 X35.6698 Y17.2144
+G1 X35.6870 Y17.3129
+G1 X35.7036 Y17.4115
+G1 X35.7195 Y17.5103
+G1 X35.7349 Y17.6091
+G1 X35.7496 Y17.7080
+G1 X35.7637 Y17.8070
+G1 X35.7772 Y17.9061
+G1 X35.7900 Y18.0053
+G1 X35.8022 Y18.1045
+G1 X35.8138 Y18.2038
+G1 X35.8248 Y18.3032
+G1 X35.8351 Y18.4027
+G1 X35.8449 Y18.5022
+G1 X35.8540 Y18.6018
+G1 X35.8624 Y18.7014
+G1 X35.8703 Y18.8011
+G1 X35.8775 Y18.9009
+G1 X35.8841 Y19.0007
+G1 X35.8901 Y19.1005
+G1 X35.8954 Y19.2003
+G1 X35.9001 Y19.3002
+G1 X35.9042 Y19.4001
+G1 X35.9076 Y19.5001
+G1 X35.9105 Y19.6000
+G1 X35.9127 Y19.7000
+G1 X35.9142 Y19.8000
+G1 X35.9152 Y19.9000
+G1 X35.9155 Y20.0000
+M2
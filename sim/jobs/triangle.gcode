@@ -0,0 +1,10 @@
+; Треугольник и полукруг (distance_per_step 7500 нм, мм)
+G21 G90
+G0 X10 Y10
+G1 X60 Y10 F600
+G1 X35 Y50
+G1 X10 Y10
+G4 P100
+G2 X60 Y10 I25 J0 F300
+G28
+M2
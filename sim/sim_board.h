@@ -0,0 +1,47 @@
+/**
+ * sim_board.h
+ *
+ * Виртуальная плата для симулятора: время в микросекундах идет
+ * только тогда, когда его двигает симулятор, значения пинов
+ * хранятся в памяти, на выходах считаются фронты (шаги).
+ */
+
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+// Максимальное количество пинов виртуальной платы
+#define SIM_MAX_PINS 256
+
+/**
+ * Виртуальное время, микросекунды (его же возвращает micros())
+ */
+extern unsigned long long sim_time_us;
+
+/**
+ * Сбросить значения всех пинов, счетчики фронтов и виртуальное время.
+ */
+void sim_board_reset();
+
+/**
+ * Выставить значение на входе (например, концевой датчик),
+ * фронт при этом не считается.
+ */
+void sim_board_set_input(int pin, int val);
+
+/**
+ * Количество фронтов HIGH>LOW на пине с момента сброса.
+ */
+unsigned long long sim_board_pin_falls(int pin);
+
+/**
+ * Количество фронтов LOW>HIGH на пине с момента сброса.
+ */
+unsigned long long sim_board_pin_rises(int pin);
+
+/**
+ * Количество обращений к пинам (digitalWrite и digitalRead) с момента сброса.
+ */
+unsigned long long sim_board_pin_ops();
+
+#endif // SIM_BOARD_H
+
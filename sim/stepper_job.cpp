@@ -0,0 +1,696 @@
+/**
+ * stepper_job.cpp
+ *
+ * Загрузка и выполнение задания для симулятора.
+ *
+ * LGPLv3, 2014-2024
+ */
+
+#include "Arduino.h"
+#include "sim_board.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+extern "C"{
+    #include "timer_setup.h"
+}
+
+#include "stepper.h"
+#include "stepper_configure_timer.h"
+#include "stepper_program.h"
+#include "stepper_gcode.h"
+#include "stepper_job.h"
+
+// Максимальная длина строки в файле задания
+#define SIM_JOB_LINE_MAX 512
+
+// Сколько символов пути к файлу помещать в сообщение об ошибке
+// (result->error короче строки задания)
+#define SIM_JOB_ERROR_PATH_MAX 96
+
+// Ограничение на количество импульсов таймера в одном цикле по умолчанию
+#define SIM_JOB_DEFAULT_MAX_TICKS 100000000ULL
+
+// Период таймера по умолчанию, микросекунды
+#define SIM_JOB_DEFAULT_TIMER_PERIOD_US 10
+
+// Сколько импульсов с пустым обработчиком замерять для вычета цены
+// цикла симулятора
+#define SIM_JOB_BASELINE_TICKS 100000ULL
+
+/**
+ * Мотор в задании
+ */
+typedef struct {
+    stepper smotor;
+
+    // виртуальные концевые датчики
+    bool switch_min;
+    long long switch_min_pos;
+    bool switch_max;
+    long long switch_max_pos;
+
+    // шаги с постоянной скоростью для следующего цикла
+    bool has_steps;
+    unsigned long step_count;
+    int dir;
+    unsigned long step_delay;
+
+    // серии для следующего цикла
+    std::vector<unsigned long> step_buffer;
+    std::vector<int> dir_buffer;
+    std::vector<unsigned long> delay_buffer;
+} sim_motor_t;
+
+/**
+ * Состояние выполняемого задания
+ */
+typedef struct {
+    sim_motor_t motors[MAX_STEPPERS];
+    int motor_count;
+
+    unsigned long timer_period_us;
+    // подбирать период таймера перед каждым циклом
+    bool timer_auto;
+
+    // путь к файлу задания
+    const char* path;
+} sim_job_t;
+
+static sim_motor_t* _find_motor(sim_job_t* job, const char* name) {
+    for(int i = 0; i < job->motor_count; i++) {
+        if(job->motors[i].smotor.name == name[0] && name[1] == '\0') {
+            return &job->motors[i];
+        }
+    }
+    return NULL;
+}
+
+static bool _parse_end_strategy(const char* str, end_strategy_t* strategy) {
+    if(strcmp(str, "CONST") == 0) {
+        *strategy = CONST;
+    } else if(strcmp(str, "INF") == 0) {
+        *strategy = INF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool _parse_handle_strategy(const char* str, error_handle_strategy_t* strategy) {
+    if(strcmp(str, "IGNORE") == 0) {
+        *strategy = IGNORE;
+    } else if(strcmp(str, "FIX") == 0) {
+        *strategy = FIX;
+    } else if(strcmp(str, "STOP_MOTOR") == 0) {
+        *strategy = STOP_MOTOR;
+    } else if(strcmp(str, "CANCEL_CYCLE") == 0) {
+        *strategy = CANCEL_CYCLE;
+    } else if(strcmp(str, "DONT_CHANGE") == 0) {
+        *strategy = DONT_CHANGE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Обновить значения на входах виртуальных концевых датчиков
+ * в соответствии с текущим положением моторов.
+ */
+static void _update_switches(sim_job_t* job) {
+    for(int i = 0; i < job->motor_count; i++) {
+        sim_motor_t* m = &job->motors[i];
+        if(m->switch_min) {
+            sim_board_set_input(m->smotor.pin_min,
+                m->smotor.current_pos <= m->switch_min_pos ? HIGH : LOW);
+        }
+        if(m->switch_max) {
+            sim_board_set_input(m->smotor.pin_max,
+                m->smotor.current_pos >= m->switch_max_pos ? HIGH : LOW);
+        }
+    }
+}
+
+/**
+ * Счетчик тактов процессора (TSC на x86), на других архитектурах -
+ * монотонное время в наносекундах. Чтение счетчика занимает единицы
+ * наносекунд, поэтому он годится для замера одного вызова обработчика
+ * (clock_gettime стоит столько же, сколько сам обработчик).
+ */
+static inline unsigned long long _cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// Тактов счетчика на микросекунду
+static unsigned long long _cycles_per_us = 0;
+// Тактов счетчика на пару чтений без работы между ними
+static unsigned long long _cycles_overhead = 0;
+
+/**
+ * Откалибровать счетчик тактов: частота по монотонному времени
+ * (около 10 мс), цена пары чтений - минимум по пустым замерам.
+ */
+static void _calibrate_cycles() {
+    if(_cycles_per_us != 0) {
+        return;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    unsigned long long t0 = (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    unsigned long long c0 = _cycles();
+    unsigned long long t1;
+    do {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        t1 = (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    } while(t1 - t0 < 10000);
+    _cycles_per_us = (_cycles() - c0) / (t1 - t0);
+    if(_cycles_per_us == 0) {
+        _cycles_per_us = 1;
+    }
+
+    _cycles_overhead = ~0ULL;
+    for(int i = 0; i < 1000; i++) {
+        unsigned long long c = _cycles();
+        c = _cycles() - c;
+        if(c < _cycles_overhead) {
+            _cycles_overhead = c;
+        }
+    }
+}
+
+/**
+ * Такты счетчика в наносекунды.
+ */
+static unsigned long long _cycles_to_ns(unsigned long long cycles) {
+    return cycles * 1000 / _cycles_per_us;
+}
+
+/**
+ * Процессорное время текущего процесса, наносекунды (не зависит от того,
+ * сколько исполнителей делят между собой ядра).
+ */
+static unsigned long long _cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Обработчик для замера цены цикла симулятора без обработчика таймера.
+ */
+static void __attribute__((noinline)) _empty_handler(int timer) {
+    (void)timer;
+    __asm__ __volatile__("" ::: "memory");
+}
+
+/**
+ * Один импульс таймера: концевики, вызов обработчика (через volatile-указатель,
+ * чтобы пустой обработчик вызывался так же, как настоящий) с замером его
+ * работы в result и виртуальное время следующего импульса.
+ */
+static inline void _tick(sim_job_t* job, void (* volatile handler)(int),
+        sim_job_result_t* result, unsigned long long* time_us) {
+    _update_switches(job);
+
+    unsigned long long pin_ops = sim_board_pin_ops();
+    unsigned long long c0 = _cycles();
+    handler(TIMER_DEFAULT);
+    unsigned long long isr_cycles = _cycles() - c0;
+    pin_ops = sim_board_pin_ops() - pin_ops;
+    if(pin_ops > result->isr_max_pin_ops) {
+        result->isr_max_pin_ops = pin_ops;
+    }
+    isr_cycles = isr_cycles > _cycles_overhead ? isr_cycles - _cycles_overhead : 0;
+
+    unsigned long long isr_ns = _cycles_to_ns(isr_cycles);
+    if(isr_ns > result->isr_max_ns) {
+        result->isr_max_ns = isr_ns;
+    }
+
+    // адаптивный период: следующий импульс - через текущий период
+    *time_us += stepper_cycle_timer_period();
+}
+
+/**
+ * Процессорное время n импульсов с пустым обработчиком (после цикла),
+ * наносекунды: эту цену цикла симулятора вычитаем из времени импульсов
+ * с настоящим обработчиком.
+ */
+static unsigned long long _baseline_ns(sim_job_t* job, unsigned long long n) {
+    sim_job_result_t scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    unsigned long long time_us = 0;
+
+    unsigned long long start_ns = _cpu_ns();
+    for(unsigned long long k = 0; !stepper_cycle_running() && k < n; k++) {
+        _tick(job, _empty_handler, &scratch, &time_us);
+    }
+    return _cpu_ns() - start_ns;
+}
+
+/**
+ * Выполнить цикл для уже подготовленных моторов.
+ */
+static bool _run_prepared_cycle(sim_job_t* job, stepper** prepared, int prepared_count,
+        unsigned long long max_ticks, sim_job_result_t* result, int line) {
+    if(job->timer_auto) {
+        unsigned long period_us = stepper_configure_timer_auto(TIMER_DEFAULT);
+        if(period_us == 0) {
+            stepper_finish_cycle();
+            snprintf(result->error, sizeof(result->error), "line %d: can't choose timer period", line);
+            return false;
+        }
+        job->timer_period_us = period_us;
+    }
+
+    _update_switches(job);
+    stepper_start_cycle();
+
+    unsigned long long cycle_start_us = sim_time_us;
+    unsigned long long ticks = 0;
+    unsigned long long cycle_start_ns = _cpu_ns();
+    while(stepper_cycle_running() && ticks < max_ticks) {
+        _tick(job, _timer_handle_interrupts, result, &sim_time_us);
+        ticks++;
+    }
+    unsigned long long cycle_ns = _cpu_ns() - cycle_start_ns;
+
+    // цена самого цикла симулятора - по пустому обработчику
+    if(ticks > 0) {
+        unsigned long long n = ticks < SIM_JOB_BASELINE_TICKS ? ticks : SIM_JOB_BASELINE_TICKS;
+        unsigned long long baseline_ns = _baseline_ns(job, n) * ticks / n;
+        result->isr_total_ns += cycle_ns > baseline_ns ? cycle_ns - baseline_ns : 0;
+    }
+
+    bool timeout = stepper_cycle_running();
+    if(timeout) {
+        stepper_finish_cycle();
+    }
+
+    result->cycles++;
+    result->ticks += ticks;
+    result->timer_period_changes += stepper_cycle_timer_period_changes();
+    result->duration_us += sim_time_us - cycle_start_us;
+
+    if(stepper_cycle_error() != CYCLE_ERROR_NONE || timeout) {
+        result->failed_cycles++;
+    }
+
+    for(int i = 0; i < prepared_count; i++) {
+        if(prepared[i]->error & (STEPPER_ERROR_SOFT_END_MIN | STEPPER_ERROR_SOFT_END_MAX |
+                STEPPER_ERROR_HARD_END_MIN | STEPPER_ERROR_HARD_END_MAX)) {
+            result->violations++;
+        }
+    }
+
+    if(timeout) {
+        snprintf(result->error, sizeof(result->error),
+            "line %d: cycle not finished in %llu ticks", line, max_ticks);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Выполнить один цикл для всех подготовленных моторов.
+ */
+static bool _run_cycle(sim_job_t* job, unsigned long long max_ticks,
+        sim_job_result_t* result, int line) {
+    stepper* prepared[MAX_STEPPERS];
+    int prepared_count = 0;
+
+    for(int i = 0; i < job->motor_count; i++) {
+        sim_motor_t* m = &job->motors[i];
+        if(m->has_steps) {
+            prepare_steps(&m->smotor, m->step_count, m->dir, m->step_delay);
+            prepared[prepared_count++] = &m->smotor;
+        } else if(m->step_buffer.size() > 0) {
+            prepare_buffered_steps(&m->smotor, m->step_buffer.size(),
+                &m->step_buffer[0], &m->dir_buffer[0], &m->delay_buffer[0]);
+            prepared[prepared_count++] = &m->smotor;
+        }
+    }
+
+    // следующий цикл готовим с нуля
+    for(int i = 0; i < job->motor_count; i++) {
+        job->motors[i].has_steps = false;
+        job->motors[i].step_buffer.clear();
+        job->motors[i].dir_buffer.clear();
+        job->motors[i].delay_buffer.clear();
+    }
+
+    if(prepared_count == 0) {
+        snprintf(result->error, sizeof(result->error), "line %d: cycle without steps", line);
+        return false;
+    }
+
+    return _run_prepared_cycle(job, prepared, prepared_count, max_ticks, result, line);
+}
+
+/**
+ * Путь к файлу относительно файла задания.
+ */
+static void _job_relative_path(sim_job_t* job, const char* name, char* path, size_t size) {
+    const char* slash = strrchr(job->path, '/');
+    if(name[0] != '/' && slash != NULL) {
+        snprintf(path, size, "%.*s/%s", (int)(slash - job->path), job->path, name);
+    } else {
+        snprintf(path, size, "%s", name);
+    }
+}
+
+/**
+ * Выполнить сегмент программы движения (stepper_program.h) отдельным циклом.
+ */
+static bool _run_segment(sim_job_t* job, stepper** axes, const stepper_program_record* record,
+        unsigned long long max_ticks, sim_job_result_t* result, int line) {
+    if(!stepper_program_prepare(record, axes, job->motor_count)) {
+        return false;
+    }
+
+    stepper* prepared[MAX_STEPPERS];
+    int prepared_count = 0;
+    for(int i = 0; i < job->motor_count; i++) {
+        if(record->type == PROGRAM_DWELL ? i == 0 :
+                (record->axis_mask & (1 << i)) && record->axes[i].step_count > 0) {
+            prepared[prepared_count++] = axes[i];
+        }
+    }
+    return _run_prepared_cycle(job, prepared, prepared_count, max_ticks, result, line);
+}
+
+/**
+ * Выполнить двоичную программу движения (stepper_program.h): файл
+ * отображается в память (mmap), каждый сегмент - отдельный цикл,
+ * оси программы - моторы задания в порядке объявления.
+ */
+static bool _run_program(sim_job_t* job, const char* path, unsigned long long max_ticks,
+        sim_job_result_t* result, int line) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if(fd >= 0) {
+            close(fd);
+        }
+        snprintf(result->error, sizeof(result->error), "line %d: can't open program '%.*s'",
+            line, SIM_JOB_ERROR_PATH_MAX, path);
+        return false;
+    }
+    const unsigned char* data = (const unsigned char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        snprintf(result->error, sizeof(result->error), "line %d: can't map program '%.*s'",
+            line, SIM_JOB_ERROR_PATH_MAX, path);
+        return false;
+    }
+
+    stepper* axes[MAX_STEPPERS];
+    for(int i = 0; i < job->motor_count; i++) {
+        axes[i] = &job->motors[i].smotor;
+    }
+
+    stepper_program_decoder decoder;
+    stepper_program_decoder_init(&decoder);
+    stepper_program_status_t status = PROGRAM_NEED_MORE;
+    bool ok = true;
+    off_t offset = 0;
+    for(; ok && offset < st.st_size; offset++) {
+        status = stepper_program_decode(&decoder, data[offset]);
+        if(status == PROGRAM_RECORD) {
+            result->segments++;
+            ok = _run_segment(job, axes, &decoder.record, max_ticks, result, line);
+            if(!ok && result->error[0] == '\0') {
+                snprintf(result->error, sizeof(result->error),
+                    "line %d: program offset %ld: bad segment", line, (long)offset);
+            }
+        } else if(status != PROGRAM_NEED_MORE) {
+            break;
+        }
+    }
+    munmap((void*)data, st.st_size);
+
+    if(ok && status != PROGRAM_FINISHED) {
+        snprintf(result->error, sizeof(result->error),
+            "line %d: program offset %ld: %s", line, (long)offset,
+            status == PROGRAM_ERROR ? "bad record" : "no end record");
+        ok = false;
+    }
+    return ok;
+}
+
+/**
+ * Выполнить G-код (stepper_gcode.h): циклы stepper_gcode_next_cycle
+ * (сегменты строк подряд - одним циклом), оси - моторы задания.
+ */
+static bool _run_gcode(sim_job_t* job, const char* path, unsigned long long max_ticks,
+        sim_job_result_t* result, int line) {
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        snprintf(result->error, sizeof(result->error), "line %d: can't open G-code '%.*s'",
+            line, SIM_JOB_ERROR_PATH_MAX, path);
+        return false;
+    }
+
+    stepper* axes[MAX_STEPPERS];
+    for(int i = 0; i < job->motor_count; i++) {
+        axes[i] = &job->motors[i].smotor;
+    }
+    stepper_gcode_init(axes, job->motor_count);
+
+    char str[SIM_JOB_LINE_MAX];
+    int gcode_line = 0;
+    bool ok = true;
+    while(ok) {
+        // строки добавляются в цикл, пока он не заполнится
+        if(!stepper_gcode_next_cycle() && !stepper_gcode_program_end() &&
+                fgets(str, sizeof(str), file) != NULL) {
+            gcode_line++;
+            if(!stepper_gcode_parse(str)) {
+                snprintf(result->error, sizeof(result->error),
+                    "line %d: G-code line %d: bad command", line, gcode_line);
+                ok = false;
+            }
+            continue;
+        }
+
+        int segments = stepper_gcode_cycle_segments();
+        if(segments == 0) {
+            // G-код выполнен
+            break;
+        }
+        result->segments += segments;
+        int mask = stepper_gcode_prepare_cycle();
+        stepper* prepared[MAX_STEPPERS];
+        int prepared_count = 0;
+        for(int i = 0; i < job->motor_count; i++) {
+            if(mask & (1 << i)) {
+                prepared[prepared_count++] = axes[i];
+            }
+        }
+        ok = mask != 0 &&
+            _run_prepared_cycle(job, prepared, prepared_count, max_ticks, result, line);
+        if(!ok && result->error[0] == '\0') {
+            snprintf(result->error, sizeof(result->error),
+                "line %d: G-code line %d: bad segment", line, gcode_line);
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+/**
+ * Выполнить одну команду из файла задания.
+ */
+static bool _exec_line(sim_job_t* job, char* str, int line, sim_job_result_t* result) {
+    char* argv[16];
+    int argc = 0;
+    for(char* tok = strtok(str, " \t\r\n"); tok != NULL && argc < 16; tok = strtok(NULL, " \t\r\n")) {
+        argv[argc++] = tok;
+    }
+    if(argc == 0) {
+        return true;
+    }
+
+    const char* cmd = argv[0];
+    sim_motor_t* m = NULL;
+    if(argc > 1 && strcmp(cmd, "timer") != 0 && strcmp(cmd, "adaptive") != 0 &&
+            strcmp(cmd, "multiplier") != 0 && strcmp(cmd, "errors") != 0 &&
+            strcmp(cmd, "motor") != 0 && strcmp(cmd, "cycle") != 0 &&
+            strcmp(cmd, "program") != 0 && strcmp(cmd, "gcode") != 0) {
+        m = _find_motor(job, argv[1]);
+        if(m == NULL) {
+            snprintf(result->error, sizeof(result->error), "line %d: unknown motor '%s'", line, argv[1]);
+            return false;
+        }
+    }
+
+    if(strcmp(cmd, "timer") == 0 && argc == 2 && strcmp(argv[1], "auto") == 0) {
+        job->timer_auto = true;
+    } else if(strcmp(cmd, "timer") == 0 && argc == 2) {
+        job->timer_auto = false;
+        job->timer_period_us = strtoul(argv[1], NULL, 10);
+        if(job->timer_period_us == 0) {
+            snprintf(result->error, sizeof(result->error), "line %d: bad timer period", line);
+            return false;
+        }
+        stepper_configure_timer(job->timer_period_us, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 0);
+    } else if(strcmp(cmd, "adaptive") == 0 && argc == 2) {
+        stepper_set_timer_period_adaptive(atoi(argv[1]) != 0);
+    } else if(strcmp(cmd, "multiplier") == 0 && argc == 2) {
+        stepper_set_step_multiplier_threshold(strtoul(argv[1], NULL, 10));
+    } else if(strcmp(cmd, "motor") == 0 && argc == 8 && strlen(argv[1]) == 1) {
+        if(job->motor_count >= MAX_STEPPERS || _find_motor(job, argv[1]) != NULL) {
+            snprintf(result->error, sizeof(result->error), "line %d: can't add motor '%s'", line, argv[1]);
+            return false;
+        }
+        m = &job->motors[job->motor_count];
+        job->motor_count++;
+
+        init_stepper(&m->smotor, argv[1][0],
+            atoi(argv[2]), atoi(argv[3]), atoi(argv[4]),
+            atoi(argv[5]) != 0, strtoul(argv[6], NULL, 10), strtoul(argv[7], NULL, 10));
+    } else if(strcmp(cmd, "ends") == 0 && argc == 8) {
+        end_strategy_t min_end_strategy;
+        end_strategy_t max_end_strategy;
+        if(!_parse_end_strategy(argv[4], &min_end_strategy) || !_parse_end_strategy(argv[5], &max_end_strategy)) {
+            snprintf(result->error, sizeof(result->error), "line %d: bad end strategy", line);
+            return false;
+        }
+        init_stepper_ends(&m->smotor, atoi(argv[2]), atoi(argv[3]),
+            min_end_strategy, max_end_strategy, atoll(argv[6]), atoll(argv[7]));
+    } else if(strcmp(cmd, "switch") == 0 && argc == 4) {
+        if(strcmp(argv[2], "min") == 0 && m->smotor.pin_min != NO_PIN) {
+            m->switch_min = true;
+            m->switch_min_pos = atoll(argv[3]);
+        } else if(strcmp(argv[2], "max") == 0 && m->smotor.pin_max != NO_PIN) {
+            m->switch_max = true;
+            m->switch_max_pos = atoll(argv[3]);
+        } else {
+            snprintf(result->error, sizeof(result->error), "line %d: bad switch", line);
+            return false;
+        }
+    } else if(strcmp(cmd, "errors") == 0 && (argc == 5 || argc == 6)) {
+        error_handle_strategy_t handles[5] = {DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE};
+        for(int i = 0; i < argc - 1; i++) {
+            if(!_parse_handle_strategy(argv[i + 1], &handles[i])) {
+                snprintf(result->error, sizeof(result->error), "line %d: bad error handle strategy", line);
+                return false;
+            }
+        }
+        stepper_set_error_handle_strategy(handles[0], handles[1], handles[2], handles[3], handles[4]);
+    } else if(strcmp(cmd, "dual_edge") == 0 && argc == 2) {
+        init_stepper_dual_edge(&m->smotor, true);
+    } else if(strcmp(cmd, "backlash") == 0 && argc == 3) {
+        init_stepper_backlash(&m->smotor, strtoul(argv[2], NULL, 10));
+    } else if(strcmp(cmd, "steps") == 0 && argc == 5) {
+        m->has_steps = true;
+        m->step_count = strtoul(argv[2], NULL, 10);
+        m->dir = atoi(argv[3]);
+        m->step_delay = strtoul(argv[4], NULL, 10);
+    } else if(strcmp(cmd, "series") == 0 && argc == 5) {
+        m->step_buffer.push_back(strtoul(argv[2], NULL, 10));
+        m->dir_buffer.push_back(atoi(argv[3]));
+        m->delay_buffer.push_back(strtoul(argv[4], NULL, 10));
+    } else if(strcmp(cmd, "cycle") == 0 && argc <= 2) {
+        unsigned long long max_ticks = argc == 2 ? strtoull(argv[1], NULL, 10) : SIM_JOB_DEFAULT_MAX_TICKS;
+        return _run_cycle(job, max_ticks, result, line);
+    } else if(strcmp(cmd, "program") == 0 && (argc == 2 || argc == 3)) {
+        unsigned long long max_ticks = argc == 3 ? strtoull(argv[2], NULL, 10) : SIM_JOB_DEFAULT_MAX_TICKS;
+
+        char path[SIM_JOB_LINE_MAX];
+        _job_relative_path(job, argv[1], path, sizeof(path));
+        return _run_program(job, path, max_ticks, result, line);
+    } else if(strcmp(cmd, "gcode") == 0 && (argc == 2 || argc == 3)) {
+        unsigned long long max_ticks = argc == 3 ? strtoull(argv[2], NULL, 10) : SIM_JOB_DEFAULT_MAX_TICKS;
+        char path[SIM_JOB_LINE_MAX];
+        _job_relative_path(job, argv[1], path, sizeof(path));
+        return _run_gcode(job, path, max_ticks, result, line);
+    } else {
+        snprintf(result->error, sizeof(result->error), "line %d: bad command '%s'", line, cmd);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Загрузить задание из файла и выполнить его в виртуальном времени.
+ *
+ * Движок stepper_h хранит состояние в глобальных переменных, поэтому
+ * в одном процессе одновременно может выполняться только одно задание.
+ *
+ * @param path - путь к файлу задания
+ * @param result - результат выполнения
+ * @return true - задание выполнено без ошибок
+ */
+bool sim_job_run(const char* path, sim_job_result_t* result) {
+    memset(result, 0, sizeof(sim_job_result_t));
+
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        snprintf(result->error, sizeof(result->error), "can't open file");
+        return false;
+    }
+
+    sim_board_reset();
+    _calibrate_cycles();
+    stepper_set_timer_enabled(false);
+    // время в симуляторе виртуальное, обработчик всегда укладывается в период
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, IGNORE);
+
+    sim_job_t* job = new sim_job_t();
+    job->path = path;
+    job->timer_period_us = SIM_JOB_DEFAULT_TIMER_PERIOD_US;
+    stepper_configure_timer(job->timer_period_us, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 0);
+
+    char str[SIM_JOB_LINE_MAX];
+    int line = 0;
+    bool ok = true;
+    while(ok && fgets(str, sizeof(str), file) != NULL) {
+        line++;
+
+        // комментарий
+        char* comment = strchr(str, '#');
+        if(comment != NULL) {
+            *comment = '\0';
+        }
+
+        ok = _exec_line(job, str, line, result);
+    }
+    fclose(file);
+
+    result->motor_count = job->motor_count;
+    for(int i = 0; i < job->motor_count; i++) {
+        result->motor_names[i] = job->motors[i].smotor.name;
+        result->steps[i] = sim_board_pin_falls(job->motors[i].smotor.pin_step);
+        if(job->motors[i].smotor.dual_edge) {
+            // шаг по обоим фронтам
+            result->steps[i] += sim_board_pin_rises(job->motors[i].smotor.pin_step);
+        }
+        result->positions[i] = job->motors[i].smotor.current_pos;
+    }
+    delete job;
+
+    return ok && result->failed_cycles == 0;
+}
+
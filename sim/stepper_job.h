@@ -0,0 +1,146 @@
+/**
+ * stepper_job.h
+ *
+ * Задание (программа движения) для симулятора: загрузка из текстового
+ * файла и выполнение на движке stepper_h в виртуальном времени.
+ *
+ * Формат файла задания - по одной команде на строку, '#' - комментарий:
+ *
+ *   timer <period_us|auto>
+ *       период таймера, микросекунды (по умолчанию 10);
+ *       auto - подбирать перед каждым циклом (stepper_configure_timer_auto)
+ *   adaptive <0|1>
+ *       адаптивный период таймера (stepper_set_timer_period_adaptive)
+ *   multiplier <step_delay_us>
+ *       группировать шаги чаще step_delay_us (stepper_set_step_multiplier_threshold)
+ *   motor <name> <pin_step> <pin_dir> <pin_en> <dir_inv> <min_step_delay> <distance_per_step>
+ *       объявить мотор (имя - один символ, pin_en=-1 - не подключен)
+ *   ends <name> <pin_min> <pin_max> <CONST|INF> <CONST|INF> <min_pos> <max_pos>
+ *       концевые датчики и виртуальные границы мотора
+ *   dual_edge <name>
+ *       шаг по обоим фронтам сигнала step (init_stepper_dual_edge)
+ *   backlash <name> <steps>
+ *       компенсация люфта при смене направления (init_stepper_backlash)
+ *   switch <name> <min|max> <pos>
+ *       концевой датчик срабатывает, когда мотор доходит до pos
+ *       (для min: current_pos <= pos, для max: current_pos >= pos)
+ *   errors <hard_end> <soft_end> <small_step_delay> <timing_exceed> [aliquant_step_delay]
+ *       стратегия реакции на ошибки (IGNORE/FIX/STOP_MOTOR/CANCEL_CYCLE)
+ *   steps <name> <step_count> <dir> <step_delay>
+ *       шаги с постоянной скоростью в следующем цикле
+ *   series <name> <step_count> <dir> <step_delay>
+ *       добавить серию (prepare_buffered_steps) в следующий цикл
+ *   cycle [max_ticks]
+ *       запустить цикл для всех подготовленных моторов и дождаться
+ *       завершения (не более max_ticks импульсов таймера)
+ *   program <path> [max_ticks]
+ *       выполнить двоичную программу движения (stepper_program.h, файл
+ *       отображается в память): каждый сегмент - отдельный цикл, оси
+ *       программы - моторы в порядке объявления; путь - относительно
+ *       файла задания
+ *   gcode <path> [max_ticks]
+ *       выполнить G-код (stepper_gcode.h): циклы stepper_gcode_next_cycle
+ *       (сегменты линий и дуг подряд - одним циклом, пауза - отдельный
+ *       цикл), оси - моторы задания (по именам); путь - относительно
+ *       файла задания
+ *
+ * Пример:
+ *   timer 10
+ *   motor x 10 11 -1 1 1000 7500
+ *   ends x -1 -1 CONST CONST 0 300000000
+ *   steps x 2000 1 1000
+ *   cycle
+ */
+
+#ifndef STEPPER_JOB_H
+#define STEPPER_JOB_H
+
+#include "stepper_lib_config.h"
+
+// из stepper_lib_config.h
+#ifndef MAX_STEPPERS
+#define MAX_STEPPERS 6
+#endif
+
+/**
+ * Результат выполнения задания (простая структура без указателей -
+ * передается через pipe из процесса-исполнителя).
+ */
+typedef struct {
+    /** Ошибка загрузки или выполнения задания, пустая строка - ошибки нет */
+    char error[160];
+
+    /** Количество выполненных циклов */
+    int cycles;
+
+    /** Количество циклов, завершенных с ошибкой */
+    int failed_cycles;
+
+    /**
+     * Количество сегментов программы и G-кода (линий, отрезков дуг),
+     * выполненных циклами (сегментов на цикл - сколько перемещений
+     * проходит без остановки и перезапуска таймера между циклами)
+     */
+    int segments;
+
+    /** Длительность всех циклов в виртуальном времени, микросекунды */
+    unsigned long long duration_us;
+
+    /** Количество импульсов таймера */
+    unsigned long long ticks;
+
+    /** Количество смен периода таймера (адаптивный период) */
+    unsigned long timer_period_changes;
+
+    /** Количество моторов в задании */
+    int motor_count;
+
+    /** Имена моторов */
+    char motor_names[MAX_STEPPERS];
+
+    /**
+     * Количество шагов для каждого мотора (фронтов HIGH>LOW на ножке step,
+     * для dual_edge - всех фронтов)
+     */
+    unsigned long long steps[MAX_STEPPERS];
+
+    /** Положение каждого мотора после последнего цикла */
+    long long positions[MAX_STEPPERS];
+
+    /** Количество выходов за виртуальные границы и срабатываний концевиков */
+    int violations;
+
+    /**
+     * Максимальное время работы обработчика прерывания таймера, наносекунды
+     * (по счетчику тактов процессора, без цены самого замера)
+     */
+    unsigned long long isr_max_ns;
+
+    /**
+     * Суммарное время работы обработчика прерывания таймера, наносекунды
+     * (процессорное время всех импульсов цикла одним замером минус время
+     * такого же цикла с пустым обработчиком)
+     */
+    unsigned long long isr_total_ns;
+
+    /**
+     * Максимальное количество обращений к пинам за один импульс таймера
+     * (работа обработчика, не зависит от прерываний и нагрузки на хост)
+     */
+    unsigned long isr_max_pin_ops;
+} sim_job_result_t;
+
+/**
+ * Загрузить задание из файла и выполнить его в виртуальном времени.
+ *
+ * Движок stepper_h хранит состояние в глобальных переменных, поэтому
+ * в одном процессе одновременно может выполняться только одно задание.
+ *
+ * @param path - путь к файлу задания
+ * @param result - результат выполнения
+ * @return true - задание выполнено без ошибок
+ */
+bool sim_job_run(const char* path, sim_job_result_t* result);
+
+#endif // STEPPER_JOB_H
+
@@ -0,0 +1,169 @@
+/**
+ * stepper_prog.cpp
+ *
+ * Запись двоичной программы движения (stepper_program.h) из текстового
+ * описания сегментов.
+ *
+ * Запуск:
+ *   ./stepper_prog program.prog program.sprg
+ *
+ * Формат текстового описания - по одной команде на строку, '#' - комментарий:
+ *
+ *   axes <count>
+ *       количество осей (первая команда)
+ *   move <axis> <step_count> <dir> <step_delay> [<axis> ...]
+ *       сегмент с постоянной скоростью, оси - номера с 0
+ *   accel <axis> <step_count> <dir> <start_delay> <step_delay> <ramp_steps> [<axis> ...]
+ *       сегмент с разгоном и торможением
+ *   dwell <us>
+ *       пауза
+ *
+ * Запись PROGRAM_END добавляется в конце автоматически.
+ *
+ * LGPLv3, 2014-2024
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "stepper_program.h"
+
+// Максимальная длина строки в текстовом описании
+#define PROG_LINE_MAX 512
+
+/**
+ * Разобрать одну команду в запись программы.
+ *
+ * @return true - команда разобрана; record->type=PROGRAM_END - строка
+ *     без записи (пустая, комментарий или axes)
+ */
+static bool _parse_line(char* str, int* axis_count, stepper_program_record* record) {
+    char* argv[2 + 6*STEPPER_PROGRAM_MAX_AXES];
+    int argc = 0;
+    for(char* tok = strtok(str, " \t\r\n"); tok != NULL && argc < (int)(sizeof(argv)/sizeof(argv[0]));
+            tok = strtok(NULL, " \t\r\n")) {
+        argv[argc++] = tok;
+    }
+
+    memset(record, 0, sizeof(stepper_program_record));
+    record->type = PROGRAM_END;
+    if(argc == 0) {
+        return true;
+    }
+
+    const char* cmd = argv[0];
+    if(strcmp(cmd, "axes") == 0 && argc == 2 && *axis_count == 0) {
+        *axis_count = atoi(argv[1]);
+        return *axis_count >= 1 && *axis_count <= STEPPER_PROGRAM_MAX_AXES;
+    } else if(*axis_count == 0) {
+        return false;
+    }
+
+    if(strcmp(cmd, "dwell") == 0 && argc == 2) {
+        record->type = PROGRAM_DWELL;
+        record->dwell_us = strtoul(argv[1], NULL, 10);
+        return true;
+    }
+
+    int fields;
+    if(strcmp(cmd, "move") == 0) {
+        record->type = PROGRAM_MOVE;
+        fields = 4;
+    } else if(strcmp(cmd, "accel") == 0) {
+        record->type = PROGRAM_ACCEL;
+        fields = 6;
+    } else {
+        return false;
+    }
+    if(argc == 1 || (argc - 1) % fields != 0) {
+        return false;
+    }
+
+    for(int i = 1; i < argc; i += fields) {
+        int a = atoi(argv[i]);
+        if(a < 0 || a >= *axis_count || (record->axis_mask & (1 << a))) {
+            return false;
+        }
+        record->axis_mask |= 1 << a;
+
+        stepper_program_axis* axis = &record->axes[a];
+        axis->step_count = strtoul(argv[i + 1], NULL, 10);
+        axis->dir = atoi(argv[i + 2]);
+        if(record->type == PROGRAM_MOVE) {
+            axis->step_delay = strtoul(argv[i + 3], NULL, 10);
+        } else {
+            axis->start_delay = strtoul(argv[i + 3], NULL, 10);
+            axis->step_delay = strtoul(argv[i + 4], NULL, 10);
+            axis->ramp_steps = strtoul(argv[i + 5], NULL, 10);
+            if(axis->start_delay == 0 || axis->step_delay == 0) {
+                return false;
+            }
+        }
+        if(axis->dir < -1 || axis->dir > 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if(argc != 3) {
+        fprintf(stderr, "usage: %s program.prog program.sprg\n", argv[0]);
+        return 2;
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if(in == NULL) {
+        fprintf(stderr, "%s: can't open file\n", argv[1]);
+        return 1;
+    }
+    FILE* out = fopen(argv[2], "wb");
+    if(out == NULL) {
+        fclose(in);
+        fprintf(stderr, "%s: can't create file\n", argv[2]);
+        return 1;
+    }
+
+    unsigned char buf[STEPPER_PROGRAM_RECORD_MAX];
+    stepper_program_record record;
+    char str[PROG_LINE_MAX];
+    int line = 0;
+    int axis_count = 0;
+    bool header = false;
+    bool ok = true;
+    while(ok && fgets(str, sizeof(str), in) != NULL) {
+        line++;
+
+        // комментарий
+        char* comment = strchr(str, '#');
+        if(comment != NULL) {
+            *comment = '\0';
+        }
+
+        if(!_parse_line(str, &axis_count, &record)) {
+            fprintf(stderr, "%s: line %d: bad command\n", argv[1], line);
+            ok = false;
+        } else if(axis_count > 0 && !header) {
+            fwrite(buf, 1, stepper_program_write_header(buf, axis_count), out);
+            header = true;
+        } else if(record.type != PROGRAM_END) {
+            fwrite(buf, 1, stepper_program_write_record(buf, &record), out);
+        }
+    }
+    fclose(in);
+
+    if(ok && !header) {
+        fprintf(stderr, "%s: no axes\n", argv[1]);
+        ok = false;
+    }
+    if(ok) {
+        record.type = PROGRAM_END;
+        fwrite(buf, 1, stepper_program_write_record(buf, &record), out);
+    }
+    if(fclose(out) != 0 || !ok) {
+        remove(argv[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ * stepper_sim.cpp
+ *
+ * Пакетный симулятор заданий stepper_h для проверки программ движения
+ * на хосте (Linux).
+ *
+ * Каждое задание выполняется в виртуальном времени на собственном
+ * экземпляре движка. Движок хранит состояние в глобальных переменных,
+ * поэтому экземпляры - это отдельные процессы (fork), а не потоки:
+ * одновременно работают не более N процессов-исполнителей, результат
+ * каждого задания возвращается родителю через pipe.
+ *
+ * Запуск:
+ *   ./stepper_sim [-j N] job1.job job2.job ...
+ *
+ *   -j N - количество процессов-исполнителей
+ *       (по умолчанию - количество ядер процессора)
+ *
+ * Для каждого задания выводится строка с длительностью в виртуальном
+ * времени, количеством шагов каждого мотора, количеством выходов за
+ * границы, максимальным временем работы обработчика таймера на один
+ * импульс (по счетчику тактов процессора, сюда же попадают прерывания
+ * хоста) и максимальным количеством обращений к пинам за один импульс
+ * (работа обработчика без шума хоста); в конце - общая строка со временем
+ * выполнения всего пакета.
+ *
+ * LGPLv3, 2014-2024
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <vector>
+
+#include "stepper_job.h"
+
+/**
+ * Задание в пакете
+ */
+typedef struct {
+    const char* path;
+
+    // процесс-исполнитель
+    pid_t pid;
+    int fd;
+
+    bool done;
+    bool ok;
+    sim_job_result_t result;
+} sim_batch_job_t;
+
+static unsigned long long _now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static void _usage(const char* name) {
+    fprintf(stderr, "usage: %s [-j workers] job1.job [job2.job ...]\n", name);
+}
+
+/**
+ * Запустить задание в отдельном процессе.
+ */
+static bool _spawn(sim_batch_job_t* job) {
+    int fds[2];
+    if(pipe(fds) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if(pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if(pid == 0) {
+        // процесс-исполнитель
+        close(fds[0]);
+
+        sim_job_result_t result;
+        bool ok = sim_job_run(job->path, &result);
+
+        size_t written = 0;
+        while(written < sizeof(result)) {
+            ssize_t n = write(fds[1], (char*)&result + written, sizeof(result) - written);
+            if(n <= 0) {
+                _exit(2);
+            }
+            written += n;
+        }
+        close(fds[1]);
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    job->pid = pid;
+    job->fd = fds[0];
+    return true;
+}
+
+/**
+ * Забрать результат завершившегося процесса-исполнителя.
+ */
+static void _collect(sim_batch_job_t* job, int status) {
+    size_t received = 0;
+    while(received < sizeof(job->result)) {
+        ssize_t n = read(job->fd, (char*)&job->result + received, sizeof(job->result) - received);
+        if(n <= 0) {
+            break;
+        }
+        received += n;
+    }
+    close(job->fd);
+
+    if(received != sizeof(job->result)) {
+        memset(&job->result, 0, sizeof(job->result));
+        snprintf(job->result.error, sizeof(job->result.error), "worker crashed");
+        job->ok = false;
+    } else {
+        job->ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    job->done = true;
+}
+
+static void _print_result(const sim_batch_job_t* job) {
+    const sim_job_result_t* r = &job->result;
+
+    printf("%s: %s cycles=%d failed=%d segments=%d time_us=%llu ticks=%llu steps=",
+        job->path, job->ok ? "ok" : "FAIL", r->cycles, r->failed_cycles, r->segments,
+        r->duration_us, r->ticks);
+    for(int i = 0; i < r->motor_count; i++) {
+        printf("%s%c:%llu", i > 0 ? "," : "", r->motor_names[i], r->steps[i]);
+    }
+    printf(" pos=");
+    for(int i = 0; i < r->motor_count; i++) {
+        printf("%s%c:%lld", i > 0 ? "," : "", r->motor_names[i], r->positions[i]);
+    }
+    printf(" violations=%d isr_max_ns=%llu isr_avg_ns=%llu isr_max_pin_ops=%lu period_changes=%lu",
+        r->violations, r->isr_max_ns, r->ticks > 0 ? r->isr_total_ns / r->ticks : 0,
+        r->isr_max_pin_ops, r->timer_period_changes);
+    if(r->error[0] != '\0') {
+        printf(" error=\"%s\"", r->error);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    int opt;
+    while((opt = getopt(argc, argv, "j:h")) != -1) {
+        if(opt == 'j') {
+            workers = atoi(optarg);
+        } else {
+            _usage(argv[0]);
+            return 2;
+        }
+    }
+    if(workers < 1) {
+        workers = 1;
+    }
+    if(optind >= argc) {
+        _usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<sim_batch_job_t> jobs(argc - optind);
+    for(size_t i = 0; i < jobs.size(); i++) {
+        memset(&jobs[i], 0, sizeof(sim_batch_job_t));
+        jobs[i].path = argv[optind + i];
+    }
+
+    unsigned long long start_ms = _now_ms();
+
+    size_t next = 0;
+    int running = 0;
+    while(next < jobs.size() || running > 0) {
+        // держим занятыми все процессы-исполнители
+        while(running < workers && next < jobs.size()) {
+            if(!_spawn(&jobs[next])) {
+                snprintf(jobs[next].result.error, sizeof(jobs[next].result.error), "can't start worker");
+                jobs[next].done = true;
+            } else {
+                running++;
+            }
+            next++;
+        }
+
+        if(running == 0) {
+            continue;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if(pid < 0) {
+            break;
+        }
+        for(size_t i = 0; i < jobs.size(); i++) {
+            if(jobs[i].pid == pid && !jobs[i].done) {
+                _collect(&jobs[i], status);
+                running--;
+                break;
+            }
+        }
+    }
+
+    unsigned long long wall_ms = _now_ms() - start_ms;
+
+    // результаты в том же порядке, что и задания
+    int failed = 0;
+    for(size_t i = 0; i < jobs.size(); i++) {
+        _print_result(&jobs[i]);
+        if(!jobs[i].ok) {
+            failed++;
+        }
+    }
+    printf("# jobs=%d failed=%d workers=%d wall_ms=%llu\n",
+        (int)jobs.size(), failed, workers, wall_ms);
+
+    return failed == 0 ? 0 : 1;
+}
+
@@ -249,5 +249,52 @@ unsigned long stepper_configure_timer_1Hz(int timer) {
     return 1000000;
 }
 
+// Automatic period
+
+/**
+ * Подобрать предварительный масштаб (prescaler) и значение корректировки
+ * (adjustment) таймера для периода period_us на текущей платформе.
+ *
+ * AVR 16МГц: 16 тиков таймера в микросекунду без предварительного масштаба,
+ * все таймеры - 16 бит (значение счетчика не больше 65536); берем
+ * наименьший предварительный масштаб, при котором период влезает в счетчик
+ * (чем меньше масштаб, тем точнее период).
+ *
+ * @param period_us - период таймера, микросекунды
+ * @param timer - системный идентификатор таймера
+ * @param prescaler - (out) предварительный масштаб таймера
+ * @param adjustment - (out) значение корректировки (уже с вычетом 1)
+ * @return true - период можно получить на этом таймере точно,
+ *     false - нельзя (значения prescaler и adjustment не меняются)
+ */
+bool stepper_timer_period_settings(unsigned long period_us, int timer, int* prescaler, unsigned int* adjustment) {
+    const int prescalers[] = {TIMER_PRESCALER_1_1, TIMER_PRESCALER_1_8,
+        TIMER_PRESCALER_1_64, TIMER_PRESCALER_1_256, TIMER_PRESCALER_1_1024};
+    const unsigned long dividers[] = {1, 8, 64, 256, 1024};
+    
+    const unsigned long ticks_per_us = F_CPU / 1000000;
+    
+    // не переполнить тики (и все равно столько не влезет в счетчик)
+    if(period_us == 0 || period_us > 0xFFFFFFFF / ticks_per_us) {
+        return false;
+    }
+    unsigned long ticks = period_us * ticks_per_us;
+    
+    for(int i = 0; i < 5; i++) {
+        unsigned long counts = ticks / dividers[i];
+        if(counts <= 65536) {
+            if(ticks % dividers[i] != 0 || counts < 2) {
+                // точно получить период не получится
+                return false;
+            }
+            *prescaler = prescalers[i];
+            // minus 1 cause count from zero.
+            *adjustment = counts - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
 #endif // ARDUINO_ARCH_AVR
 
@@ -0,0 +1,80 @@
+/**
+ * Arduino.cpp
+ *
+ * Минимальная замена Arduino API для бэкенда Linux (STEPPER_LINUX):
+ * время - CLOCK_MONOTONIC, ножки - через подключаемый приемник
+ * (stepper_linux_set_gpio).
+ */
+
+#ifdef STEPPER_LINUX
+
+#include "Arduino.h"
+#include "stepper_linux.h"
+
+#include <stddef.h>
+#include <time.h>
+
+// Количество ножек для значений в памяти
+#define STEPPER_LINUX_PINS 256
+
+// Значения ножек в памяти (приемник по умолчанию)
+static int _pin_values[STEPPER_LINUX_PINS];
+
+static void _memory_pin_mode(int pin, int mode) {
+    // в памяти режим ножки не нужен
+    (void)pin;
+    (void)mode;
+}
+
+static void _memory_digital_write(int pin, int val) {
+    if(pin >= 0 && pin < STEPPER_LINUX_PINS) {
+        _pin_values[pin] = val;
+    }
+}
+
+static int _memory_digital_read(int pin) {
+    if(pin >= 0 && pin < STEPPER_LINUX_PINS) {
+        return _pin_values[pin];
+    }
+    return LOW;
+}
+
+static const stepper_linux_gpio_t _memory_gpio = {
+    _memory_pin_mode, _memory_digital_write, _memory_digital_read
+};
+
+// Текущий приемник
+static const stepper_linux_gpio_t* _gpio = &_memory_gpio;
+
+/**
+ * Подключить приемник для ножек.
+ *
+ * @param gpio - приемник; NULL - значения ножек в памяти (по умолчанию)
+ */
+void stepper_linux_set_gpio(const stepper_linux_gpio_t* gpio) {
+    _gpio = gpio != NULL ? gpio : &_memory_gpio;
+}
+
+/**
+ * Микросекунды по CLOCK_MONOTONIC (как и на Arduino, значение
+ * переполняется - считать разницу между двумя вызовами).
+ */
+unsigned long micros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)(now.tv_sec * 1000000ULL + now.tv_nsec / 1000);
+}
+
+void pinMode(int pin, int mode) {
+    _gpio->pin_mode(pin, mode);
+}
+
+void digitalWrite(int pin, int val) {
+    _gpio->digital_write(pin, val);
+}
+
+int digitalRead(int pin) {
+    return _gpio->digital_read(pin);
+}
+
+#endif // STEPPER_LINUX
@@ -0,0 +1,36 @@
+/**
+ * Arduino.h
+ *
+ * Минимальная замена Arduino API для бэкенда Linux (STEPPER_LINUX):
+ * то, что использует библиотека stepper_h.
+ */
+
+#ifndef WPROGRAM_H
+#define WPROGRAM_H
+
+#define OUTPUT 1
+#define INPUT 0
+
+#define HIGH 1
+#define LOW 0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Микросекунды по CLOCK_MONOTONIC.
+ */
+unsigned long micros();
+
+void pinMode(int pin, int mode);
+
+void digitalWrite(int pin, int val);
+
+int digitalRead(int pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WPROGRAM_H
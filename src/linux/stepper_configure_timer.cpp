@@ -0,0 +1,274 @@
+/**
+ * stepper_configure_timer.cpp
+ *
+ * Настройки таймера для бэкенда Linux (STEPPER_LINUX): виртуальная
+ * частота 1ГГц, один отсчет таймера с prescaler 1:1 - одна наносекунда.
+ */
+
+#ifdef STEPPER_LINUX
+
+#include "stepper.h"
+extern "C" {
+    #include "timer_setup.h"
+}
+
+// Typical freqs
+
+/**
+ * freq: 1MHz = 1000000 ops/sec
+ * period: 1sec/1000000 = 1us
+ */
+unsigned long stepper_configure_timer_1MHz(int timer) {
+    // to set timer clock period to 1us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=1000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(1, timer, TIMER_PRESCALER_1_1, 1000-1);
+    return 1;
+}
+
+/**
+ * freq: 500KHz = 500000 ops/sec
+ * period: 1sec/500000 = 2us
+ */
+unsigned long stepper_configure_timer_500KHz(int timer) {
+    // to set timer clock period to 2us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=2000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(2, timer, TIMER_PRESCALER_1_1, 2000-1);
+    return 2;
+}
+
+/**
+ * freq: 200KHz = 200000 ops/sec
+ * period: 1sec/200000 = 5us
+ */
+unsigned long stepper_configure_timer_200KHz(int timer) {
+    // to set timer clock period to 5us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=5000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(5, timer, TIMER_PRESCALER_1_1, 5000-1);
+    return 5;
+}
+
+/**
+ * freq: 100KHz = 100000 ops/sec
+ * period: 1sec/100000 = 10us
+ */
+unsigned long stepper_configure_timer_100KHz(int timer) {
+    // to set timer clock period to 10us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=10000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(10, timer, TIMER_PRESCALER_1_1, 10000-1);
+    return 10;
+}
+
+/**
+ * freq: 50KHz = 50000 ops/sec
+ * period: 1sec/50000 = 20us
+ */
+unsigned long stepper_configure_timer_50KHz(int timer) {
+    // to set timer clock period to 20us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=20000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(20, timer, TIMER_PRESCALER_1_1, 20000-1);
+    return 20;
+}
+
+/**
+ * freq: 20KHz = 20000 ops/sec
+ * period: 1sec/20000 = 50us
+ */
+unsigned long stepper_configure_timer_20KHz(int timer) {
+    // to set timer clock period to 50us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=50000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(50, timer, TIMER_PRESCALER_1_1, 50000-1);
+    return 50;
+}
+
+/**
+ * freq: 10KHz = 10000 ops/sec
+ * period: 1sec/10000 = 100us
+ */
+unsigned long stepper_configure_timer_10KHz(int timer) {
+    // to set timer clock period to 100us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=100000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(100, timer, TIMER_PRESCALER_1_1, 100000-1);
+    return 100;
+}
+
+/**
+ * freq: 5KHz = 5000 ops/sec
+ * period: 1sec/5000 = 200us
+ */
+unsigned long stepper_configure_timer_5KHz(int timer) {
+    // to set timer clock period to 200us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=200000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(200, timer, TIMER_PRESCALER_1_1, 200000-1);
+    return 200;
+}
+
+/**
+ * freq: 2KHz = 2000 ops/sec
+ * period: 1sec/2000 = 500us
+ */
+unsigned long stepper_configure_timer_2KHz(int timer) {
+    // to set timer clock period to 500us on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=500000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(500, timer, TIMER_PRESCALER_1_1, 500000-1);
+    return 500;
+}
+
+/**
+ * freq: 1KHz = 1000 ops/sec
+ * period: 1sec/1000 = 1ms
+ */
+unsigned long stepper_configure_timer_1KHz(int timer) {
+    // to set timer clock period to 1ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=1000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(1000, timer, TIMER_PRESCALER_1_1, 1000000-1);
+    return 1000;
+}
+
+/**
+ * freq: 500Hz = 500 ops/sec
+ * period: 1sec/500 = 2ms
+ */
+unsigned long stepper_configure_timer_500Hz(int timer) {
+    // to set timer clock period to 2ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=2000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(2000, timer, TIMER_PRESCALER_1_1, 2000000-1);
+    return 2000;
+}
+
+/**
+ * freq: 200Hz = 200 ops/sec
+ * period: 1sec/200 = 5ms
+ */
+unsigned long stepper_configure_timer_200Hz(int timer) {
+    // to set timer clock period to 5ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=5000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(5000, timer, TIMER_PRESCALER_1_1, 5000000-1);
+    return 5000;
+}
+
+/**
+ * freq: 100Hz = 100 ops/sec
+ * period: 1sec/100 = 10ms
+ */
+unsigned long stepper_configure_timer_100Hz(int timer) {
+    // to set timer clock period to 10ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=10000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(10000, timer, TIMER_PRESCALER_1_1, 10000000-1);
+    return 10000;
+}
+
+/**
+ * freq: 50Hz = 50 ops/sec
+ * period: 1sec/50 = 20ms
+ */
+unsigned long stepper_configure_timer_50Hz(int timer) {
+    // to set timer clock period to 20ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=20000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(20000, timer, TIMER_PRESCALER_1_1, 20000000-1);
+    return 20000;
+}
+
+/**
+ * freq: 20Hz = 20 ops/sec
+ * period: 1sec/20 = 50ms
+ */
+unsigned long stepper_configure_timer_20Hz(int timer) {
+    // to set timer clock period to 50ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=50000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(50000, timer, TIMER_PRESCALER_1_1, 50000000-1);
+    return 50000;
+}
+
+/**
+ * freq: 10Hz = 10 ops/sec
+ * period: 1sec/10 = 100ms
+ */
+unsigned long stepper_configure_timer_10Hz(int timer) {
+    // to set timer clock period to 100ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=100000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(100000, timer, TIMER_PRESCALER_1_1, 100000000-1);
+    return 100000;
+}
+
+/**
+ * freq: 5Hz = 5 ops/sec
+ * period: 1sec/5 = 200ms
+ */
+unsigned long stepper_configure_timer_5Hz(int timer) {
+    // to set timer clock period to 200ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=200000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(200000, timer, TIMER_PRESCALER_1_1, 200000000-1);
+    return 200000;
+}
+
+/**
+ * freq: 2Hz = 2 ops/sec
+ * period: 1sec/2 = 500ms
+ */
+unsigned long stepper_configure_timer_2Hz(int timer) {
+    // to set timer clock period to 500ms on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=500000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(500000, timer, TIMER_PRESCALER_1_1, 500000000-1);
+    return 500000;
+}
+
+/**
+ * freq: 1Hz = 1 ops/sec
+ * period: 1sec/1 = 1s
+ */
+unsigned long stepper_configure_timer_1Hz(int timer) {
+    // to set timer clock period to 1s on 1GHz virtual CPU
+    // use prescaler 1:1 (TIMER_PRESCALER_1_1) and adjustment=1000000000-1,
+    // minus 1 cause count from zero.
+    stepper_configure_timer(1000000, timer, TIMER_PRESCALER_1_1, 1000000000-1);
+    return 1000000;
+}
+
+// Automatic period
+
+/**
+ * Подобрать предварительный масштаб (prescaler) и значение корректировки
+ * (adjustment) таймера для периода period_us на текущей платформе.
+ *
+ * Linux: 1000 отсчетов таймера в микросекунду без предварительного
+ * масштаба, счетчик 32 бит (период до 4 секунд).
+ *
+ * @param period_us - период таймера, микросекунды
+ * @param timer - системный идентификатор таймера
+ * @param prescaler - (out) предварительный масштаб таймера
+ * @param adjustment - (out) значение корректировки (уже с вычетом 1)
+ * @return true - период можно получить на этом таймере точно,
+ *     false - нельзя (значения prescaler и adjustment не меняются)
+ */
+bool stepper_timer_period_settings(unsigned long period_us, int timer, int* prescaler, unsigned int* adjustment) {
+    // все таймеры-потоки одинаковые
+    (void)timer;
+    
+    if(period_us == 0 || period_us > 0xFFFFFFFFUL / 1000) {
+        return false;
+    }
+    *prescaler = TIMER_PRESCALER_1_1;
+    // minus 1 cause count from zero.
+    *adjustment = period_us * 1000 - 1;
+    return true;
+}
+
+#endif // STEPPER_LINUX
@@ -0,0 +1,88 @@
+/**
+ * stepper_linux.h
+ *
+ * Бэкенд stepper_h для Linux (сборка с -DSTEPPER_LINUX): таймер - поток
+ * реального времени (SCHED_FIFO, если хватает прав) на clock_nanosleep,
+ * ножки - подключаемый приемник (по умолчанию - значения в памяти).
+ *
+ * Позволяет запускать движок на Linux-контроллерах и измерять дрожание
+ * (jitter) таймера на обычных компьютерах.
+ *
+ * LGPLv3, 2014-2024
+ */
+
+#ifndef STEPPER_LINUX_H
+#define STEPPER_LINUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Приемник для ножек: реализация pinMode/digitalWrite/digitalRead
+ * (например, через libgpiod или sysfs).
+ */
+typedef struct {
+    void (*pin_mode)(int pin, int mode);
+    void (*digital_write)(int pin, int val);
+    int (*digital_read)(int pin);
+} stepper_linux_gpio_t;
+
+/**
+ * Подключить приемник для ножек.
+ *
+ * @param gpio - приемник; NULL - значения ножек в памяти (по умолчанию)
+ */
+void stepper_linux_set_gpio(const stepper_linux_gpio_t* gpio);
+
+/**
+ * Заблокировать обработчик таймера (аналог запрета прерываний): поток
+ * таймера работает параллельно с loop(), поэтому функции движка, которые
+ * меняют настройки моторов и цикла (prepare_xxx, stepper_start_cycle,
+ * stepper_finish_cycle, stepper_pause_cycle, stepper_hold_cycle,
+ * stepper_set_speed_override и т.п.), берут блокировку сами; снаружи -
+ * чтобы несколько вызовов выполнились для обработчика целиком.
+ * Рекурсивная: можно вызывать вложенно из того же потока.
+ *
+ * Без блокировки работают stepper_snapshot, stepper_handle_events
+ * и stepper_handle_deferred (барьеры памяти).
+ */
+void stepper_linux_isr_lock();
+
+/**
+ * Разблокировать обработчик таймера (stepper_linux_isr_lock).
+ */
+void stepper_linux_isr_unlock();
+
+/**
+ * Статистика таймера с момента stepper_linux_reset_timer_stats.
+ */
+typedef struct {
+    /** Количество импульсов таймера */
+    unsigned long long ticks;
+
+    /** Наибольшее опоздание импульса относительно расписания, наносекунды */
+    unsigned long long max_late_ns;
+
+    /** Суммарное опоздание импульсов, наносекунды */
+    unsigned long long total_late_ns;
+
+    /** Поток таймера работает с приоритетом реального времени (SCHED_FIFO) */
+    int realtime;
+} stepper_linux_timer_stats_t;
+
+/**
+ * Получить статистику таймера.
+ */
+void stepper_linux_timer_stats(stepper_linux_timer_stats_t* stats);
+
+/**
+ * Обнулить статистику таймера.
+ */
+void stepper_linux_reset_timer_stats();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STEPPER_LINUX_H
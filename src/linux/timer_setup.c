@@ -0,0 +1,255 @@
+/**
+ * timer_setup.c
+ *
+ * Таймер для бэкенда Linux (STEPPER_LINUX): поток, который вызывает
+ * _timer_handle_interrupts по расписанию (clock_nanosleep с абсолютным
+ * временем, без накопления ошибки), с приоритетом реального времени
+ * SCHED_FIFO, если хватает прав.
+ *
+ * Виртуальная частота "процессора" - 1ГГц: один отсчет таймера
+ * с prescaler 1:1 - одна наносекунда, период импульса -
+ * (adjustment+1)*prescaler наносекунд.
+ *
+ * LGPLv3, 2014-2024
+ */
+
+#ifdef STEPPER_LINUX
+
+#include "timer_setup.h"
+#include "stepper_linux.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+// Define timer ids
+const int _TIMER1 = 1;
+const int _TIMER2 = 2;
+const int _TIMER3 = 3;
+const int _TIMER4 = 4;
+const int _TIMER5 = 5;
+
+// 32-bit timers
+const int _TIMER2_32BIT = 6;
+const int _TIMER4_32BIT = 7;
+
+const int TIMER_DEFAULT = 4; // TIMER4;
+
+// Define timer prescaler options
+const int TIMER_PRESCALER_1_1    = 1;
+const int TIMER_PRESCALER_1_2    = 2;
+const int TIMER_PRESCALER_1_4    = 4;
+const int TIMER_PRESCALER_1_8    = 8;
+const int TIMER_PRESCALER_1_16   = 16;
+const int TIMER_PRESCALER_1_32   = 32;
+const int TIMER_PRESCALER_1_64   = 64;
+const int TIMER_PRESCALER_1_256  = 256;
+const int TIMER_PRESCALER_1_1024 = 1024;
+
+// Поток таймера: один на все запуски. _timer_init_ISR и _timer_stop_ISR
+// вызываются и из обработчика (завершение цикла, смена периода),
+// поэтому поток не ждем (join), а только меняем его настройки.
+static pthread_mutex_t _timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+// поток запущен
+static int _timer_thread_alive = 0;
+// таймер включен
+static volatile int _timer_enabled = 0;
+// начать отсчет периода заново (после _timer_init_ISR)
+static int _timer_restart = 0;
+static int _timer_id = 0;
+static unsigned long long _timer_period_ns = 0;
+
+// статистика
+static stepper_linux_timer_stats_t _timer_stats;
+
+// Блокировка обработчика (stepper_linux_isr_lock): поток таймера держит ее,
+// пока работает _timer_handle_interrupts. Рекурсивная: обработчик сам
+// вызывает функции движка, которые ее берут (stepper_finish_cycle).
+// Наследование приоритета: loop() держит ее с обычным приоритетом,
+// поток таймера SCHED_FIFO ждет ее - без наследования поток с средним
+// приоритетом мог бы вытеснить loop() и задержать таймер на любое время.
+// Порядок: сначала _isr_mutex, потом _timer_mutex.
+static pthread_mutex_t _isr_mutex;
+static pthread_once_t _isr_mutex_once = PTHREAD_ONCE_INIT;
+
+static void _isr_mutex_init() {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&_isr_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void _timespec_add_ns(struct timespec* ts, unsigned long long ns) {
+    ts->tv_sec += ns / 1000000000ULL;
+    ts->tv_nsec += ns % 1000000000ULL;
+    if(ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+static void* _timer_thread(void* arg) {
+    // настройки потока - в общих переменных
+    (void)arg;
+    
+    struct timespec next;
+    for(;;) {
+        pthread_mutex_lock(&_timer_mutex);
+        if(!_timer_enabled) {
+            _timer_thread_alive = 0;
+            pthread_mutex_unlock(&_timer_mutex);
+            return NULL;
+        }
+        if(_timer_restart) {
+            _timer_restart = 0;
+            clock_gettime(CLOCK_MONOTONIC, &next);
+        }
+        unsigned long long period_ns = _timer_period_ns;
+        int timer = _timer_id;
+        pthread_mutex_unlock(&_timer_mutex);
+        
+        _timespec_add_ns(&next, period_ns);
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) != 0) {
+            // прервали сигналом - спим дальше
+        }
+        
+        // опоздание относительно расписания
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long late_ns = (now.tv_sec - next.tv_sec) * 1000000000LL + (now.tv_nsec - next.tv_nsec);
+        if(late_ns < 0) {
+            late_ns = 0;
+        } else if((unsigned long long)late_ns >= period_ns) {
+            // пропущенные импульсы не повторяем пачкой: как у аппаратного
+            // таймера (один флаг прерывания), остается один импульс -
+            // текущий, расписание сдвигаем на последний пропущенный
+            _timespec_add_ns(&next, late_ns / period_ns * period_ns);
+        }
+        
+        pthread_mutex_lock(&_timer_mutex);
+        // таймер выключили или перезапустили, пока спали
+        int skip = !_timer_enabled || _timer_restart;
+        if(!skip) {
+            _timer_stats.ticks++;
+            _timer_stats.total_late_ns += late_ns;
+            if((unsigned long long)late_ns > _timer_stats.max_late_ns) {
+                _timer_stats.max_late_ns = late_ns;
+            }
+        }
+        pthread_mutex_unlock(&_timer_mutex);
+        
+        if(!skip) {
+            stepper_linux_isr_lock();
+            _timer_handle_interrupts(timer);
+            stepper_linux_isr_unlock();
+        }
+    }
+}
+
+/**
+ * Init ISR (Interrupt service routine) for the timer and start timer.
+ * 
+ * Linux: start (or reconfigure) timer thread, handler would be called
+ * every (adjustment+1)*prescaler nanoseconds.
+ * 
+ * @param timer
+ *   timer id passed to _timer_handle_interrupts
+ * @param prescaler
+ *   timer prescaler (1, 2, 4, 8, 16, 32, 64, 256, 1024)
+ * @param adjustment
+ *   adjustment divider after timer prescaled - timer compare match value.
+ */
+void _timer_init_ISR(int timer, int prescaler, unsigned int adjustment) {
+    pthread_mutex_lock(&_timer_mutex);
+    _timer_id = timer;
+    _timer_period_ns = ((unsigned long long)adjustment + 1) * prescaler;
+    _timer_enabled = 1;
+    _timer_restart = 1;
+    
+    if(!_timer_thread_alive) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        
+        // приоритет реального времени, если хватает прав
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+        
+        pthread_t thread;
+        if(pthread_create(&thread, &attr, _timer_thread, NULL) == 0) {
+            _timer_stats.realtime = 1;
+            _timer_thread_alive = 1;
+        } else {
+            // без прав на SCHED_FIFO - обычный поток
+            pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+            if(pthread_create(&thread, &attr, _timer_thread, NULL) == 0) {
+                _timer_stats.realtime = 0;
+                _timer_thread_alive = 1;
+            }
+        }
+        pthread_attr_destroy(&attr);
+    }
+    pthread_mutex_unlock(&_timer_mutex);
+}
+
+/**
+ * Stop ISR (Interrupt service routine) for the timer.
+ * 
+ * Linux: handler would not be called after this, thread exits
+ * at the next timer period.
+ * 
+ * @param timer
+ *     system timer id for started ISR
+ */
+void _timer_stop_ISR(int timer) {
+    // поток таймера один
+    (void)timer;
+    
+    pthread_mutex_lock(&_timer_mutex);
+    _timer_enabled = 0;
+    pthread_mutex_unlock(&_timer_mutex);
+}
+
+/**
+ * Заблокировать обработчик таймера (аналог запрета прерываний).
+ */
+void stepper_linux_isr_lock() {
+    pthread_once(&_isr_mutex_once, _isr_mutex_init);
+    pthread_mutex_lock(&_isr_mutex);
+}
+
+/**
+ * Разблокировать обработчик таймера.
+ */
+void stepper_linux_isr_unlock() {
+    pthread_mutex_unlock(&_isr_mutex);
+}
+
+/**
+ * Получить статистику таймера.
+ */
+void stepper_linux_timer_stats(stepper_linux_timer_stats_t* stats) {
+    pthread_mutex_lock(&_timer_mutex);
+    *stats = _timer_stats;
+    pthread_mutex_unlock(&_timer_mutex);
+}
+
+/**
+ * Обнулить статистику таймера.
+ */
+void stepper_linux_reset_timer_stats() {
+    pthread_mutex_lock(&_timer_mutex);
+    int realtime = _timer_stats.realtime;
+    memset(&_timer_stats, 0, sizeof(_timer_stats));
+    _timer_stats.realtime = realtime;
+    pthread_mutex_unlock(&_timer_mutex);
+}
+
+#endif // STEPPER_LINUX
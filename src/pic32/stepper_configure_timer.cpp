@@ -444,5 +444,66 @@ unsigned long stepper_configure_timer_1Hz(int timer) {
     return 1000000;
 }
 
+// Automatic period
+
+/**
+ * Подобрать предварительный масштаб (prescaler) и значение корректировки
+ * (adjustment) таймера для периода period_us на текущей платформе.
+ *
+ * PIC32MX 80МГц (PIC32MX1xx/2xx - 40МГц): 80 (40) тиков таймера в микросекунду
+ * без предварительного масштаба. PIC32MZ 200МГц: таймеры тактируются от шины
+ * периферии PBCLK3 = F_CPU/(PB3DIV+1) (обычно 100МГц - 100 тиков в микросекунду).
+ * Таймеры 16 бит, _TIMER2_32BIT и _TIMER4_32BIT - 32 бит; берем наименьший
+ * предварительный масштаб, при котором период влезает в счетчик (чем меньше
+ * масштаб, тем точнее период).
+ *
+ * @param period_us - период таймера, микросекунды
+ * @param timer - системный идентификатор таймера
+ * @param prescaler - (out) предварительный масштаб таймера
+ * @param adjustment - (out) значение корректировки (уже с вычетом 1)
+ * @return true - период можно получить на этом таймере точно,
+ *     false - нельзя (значения prescaler и adjustment не меняются)
+ */
+bool stepper_timer_period_settings(unsigned long period_us, int timer, int* prescaler, unsigned int* adjustment) {
+    const int prescalers[] = {TIMER_PRESCALER_1_1, TIMER_PRESCALER_1_2,
+        TIMER_PRESCALER_1_4, TIMER_PRESCALER_1_8, TIMER_PRESCALER_1_16,
+        TIMER_PRESCALER_1_32, TIMER_PRESCALER_1_64, TIMER_PRESCALER_1_256};
+    const unsigned long dividers[] = {1, 2, 4, 8, 16, 32, 64, 256};
+    
+#if defined(__PIC32MX1XX__) || defined(__PIC32MX2XX__)
+    // 40MHz
+    const unsigned long long timer_hz = 40000000;
+#elif defined(__PIC32MZXX__)
+    // 200MHz, таймеры - от PBCLK3
+    const unsigned long long timer_hz = F_CPU / (PB3DIVbits.PBDIV + 1);
+#else
+    // 80MHz
+    const unsigned long long timer_hz = 80000000;
+#endif
+    
+    const unsigned long long counts_max =
+        (timer == _TIMER2_32BIT || timer == _TIMER4_32BIT) ? 0x100000000ULL : 65536;
+    
+    if((period_us * timer_hz) % 1000000 != 0) {
+        // частота таймера - не целое количество тиков в микросекунду
+        return false;
+    }
+    unsigned long long ticks = period_us * timer_hz / 1000000;
+    for(int i = 0; i < 8; i++) {
+        unsigned long long counts = ticks / dividers[i];
+        if(counts <= counts_max) {
+            if(ticks % dividers[i] != 0 || counts < 2) {
+                // точно получить период не получится
+                return false;
+            }
+            *prescaler = prescalers[i];
+            // minus 1 cause count from zero.
+            *adjustment = counts - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
 #endif // __PIC32__
 
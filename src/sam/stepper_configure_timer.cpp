@@ -255,5 +255,41 @@ unsigned long stepper_configure_timer_1Hz(int timer) {
     return 1000000;
 }
 
+// Automatic period
+
+/**
+ * Подобрать предварительный масштаб (prescaler) и значение корректировки
+ * (adjustment) таймера для периода period_us на текущей платформе.
+ *
+ * SAM 84МГц: частота таймера MCK/2, MCK/8, MCK/32 или MCK/128,
+ * счетчики 32 бит; берем наименьший предварительный масштаб, при котором
+ * период получается точно и влезает в счетчик.
+ *
+ * @param period_us - период таймера, микросекунды
+ * @param timer - системный идентификатор таймера
+ * @param prescaler - (out) предварительный масштаб таймера
+ * @param adjustment - (out) значение корректировки (уже с вычетом 1)
+ * @return true - период можно получить на этом таймере точно,
+ *     false - нельзя (значения prescaler и adjustment не меняются)
+ */
+bool stepper_timer_period_settings(unsigned long period_us, int timer, int* prescaler, unsigned int* adjustment) {
+    const int prescalers[] = {TIMER_PRESCALER_1_2, TIMER_PRESCALER_1_8,
+        TIMER_PRESCALER_1_32, TIMER_PRESCALER_1_128};
+    const unsigned long long dividers[] = {2, 8, 32, 128};
+    
+    // 84MHz
+    unsigned long long ticks = (unsigned long long)period_us * 84;
+    for(int i = 0; i < 4; i++) {
+        unsigned long long counts = ticks / dividers[i];
+        if(ticks % dividers[i] == 0 && counts >= 2 && counts <= 0x100000000ULL) {
+            *prescaler = prescalers[i];
+            // minus 1 cause count from zero.
+            *adjustment = counts - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
 #endif // ARDUINO_ARCH_SAM
 
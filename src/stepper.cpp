@@ -54,11 +54,19 @@ void init_stepper(stepper* smotor, char name,
     smotor->pin_dir = pin_dir;
     smotor->pin_en = pin_en;
     
+    // шаг по фронту HIGH>LOW
+    smotor->dual_edge = false;
+    smotor->step_level = LOW;
+    
     smotor->dir_inv = invert_dir ? -1 : 1;
     smotor->min_step_delay = min_step_delay;
     
     smotor->distance_per_step = distance_per_step;
     
+    // без компенсации люфта
+    smotor->backlash_steps = 0;
+    smotor->backlash_dir = 0;
+    
     // Значения по умолчанию
     // обнулить текущую позицию
     smotor->current_pos = 0;
@@ -142,3 +150,48 @@ void init_stepper_ends(stepper* smotor,
     }
 }
 
+/**
+ * Режим шага по обоим фронтам сигнала step (DEDGE) для драйверов,
+ * которые его поддерживают (TMC и т.п.): на каждый шаг ножка step
+ * переключается один раз (LOW>HIGH или HIGH>LOW) вместо пары HIGH, LOW.
+ * В 2 раза меньше записей в ножку и на 1 импульс таймера на шаг меньше:
+ * минимальная задержка между шагами мотора должна вмещать 2 периода
+ * таймера (проверка границ, переключение), вместе с
+ * stepper_set_two_tick_steps - 1 период.
+ * 
+ * Режим DEDGE должен быть включен в самом драйвере. При включении
+ * ножка step сбрасывается в LOW, поэтому вызывать до начала движения.
+ * 
+ * @param smotor
+ * @param dual_edge
+ *   true: шаг по обоим фронтам
+ *   false: шаг по фронту HIGH>LOW (по умолчанию)
+ */
+void init_stepper_dual_edge(stepper* smotor, bool dual_edge) {
+    smotor->dual_edge = dual_edge;
+    
+    // начинаем с известного уровня
+    smotor->step_level = LOW;
+    digitalWrite(smotor->pin_step, LOW);
+}
+
+/**
+ * Компенсация люфта передачи: когда мотор меняет направление вращения
+ * (новое направление в prepare_xxx или смена серии в dir_buffer),
+ * движок перед первым шагом в новую сторону вставляет backlash_steps
+ * шагов с максимальной скоростью (min_step_delay). Шаги компенсации
+ * не меняют current_pos и не считаются в шагах серии, время цикла
+ * увеличивается на время этих шагов.
+ * 
+ * Направление последнего движения сбрасывается (неизвестно), поэтому
+ * первое движение после вызова идет без компенсации. Если цикл прерван
+ * во время компенсации, оставшиеся шаги компенсации не делаются.
+ * 
+ * @param smotor
+ * @param backlash_steps - люфт, шаги мотора (0 - без компенсации)
+ */
+void init_stepper_backlash(stepper* smotor, unsigned long backlash_steps) {
+    smotor->backlash_steps = backlash_steps;
+    smotor->backlash_dir = 0;
+}
+
@@ -16,6 +16,7 @@
 #define NO_PIN -1
 
 #include "stddef.h"
+#include "stepper_lib_config.h"
 
 /**
  * Стратегия определения границы движения координаты в одном из направлений:
@@ -114,6 +115,14 @@ typedef struct {
      */
     int pin_en;
     
+    /**
+     * Драйвер делает шаг на обоих фронтах сигнала step (LOW>HIGH и HIGH>LOW,
+     * режим DEDGE драйверов TMC): на каждый шаг ножка step переключается
+     * один раз (см. init_stepper_dual_edge).
+     * Значение по умолчанию: false (шаг по фронту HIGH>LOW)
+     */
+    bool dual_edge;
+    
     /*************************************************************/
     /* Концевые датчики */
     /*************************************************************/
@@ -197,6 +206,15 @@ typedef struct {
      */
     unsigned long distance_per_step;
     
+    /**
+     * Люфт передачи, шаги мотора: при смене направления вращения
+     * движок перед первым шагом в новую сторону делает backlash_steps
+     * шагов с максимальной скоростью, которые не меняют current_pos
+     * (см. init_stepper_backlash).
+     * Значение по умолчанию: 0 (без компенсации люфта)
+     */
+    unsigned long backlash_steps;
+    
     /*************************************************************/
     /* Характеристики рабочей области */
     /*************************************************************/
@@ -293,8 +311,35 @@ typedef struct {
       * Начальное значение: STEPPER_ERROR_NONE
       */
     int error = STEPPER_ERROR_NONE;
+    
+    /**
+     * Текущий уровень на ножке step для dual_edge (0 - LOW, 1 - HIGH):
+     * ножку переключаем, а не читаем обратно.
+     */
+    int step_level = 0;
+    
+    /**
+     * Направление, в котором выбран люфт (1 - вперед, -1 - назад):
+     * последний сделанный шаг или завершенная компенсация; 0 - неизвестно:
+     * компенсации не будет, пока мотор не сменит направление.
+     */
+    int backlash_dir = 0;
 } stepper;
 
+/**
+ * Снимок состояния мотора (stepper_snapshot).
+ */
+typedef struct {
+    /** Текущее положение мотора (см. stepper.current_pos) */
+    long long current_pos;
+    
+    /** Статус мотора в цикле вращения (см. stepper.status) */
+    stepper_status_t status;
+    
+    /** Побитовые флаги ошибок мотора (см. stepper.error) */
+    int error;
+} stepper_snapshot_t;
+
 /**
  * Глобальные ошибки цикла вращения моторов
  */
@@ -305,6 +350,7 @@ typedef enum {
     /**
      * Хотябы у одного из моторов, добавленных в список вращения,
      * минимальная задержка между шагами не вмещает 3 периода таймера
+     * (2 для stepper_set_two_tick_steps или dual_edge, 1 для обоих)
      * (следует проверить настройки мотора - значение step_delay или
      * настройки частоты таймера цикла stepper_configure_timer).
      */
@@ -352,6 +398,58 @@ typedef enum {
     CANCEL_CYCLE
 } error_handle_strategy_t;
 
+/**
+ * События цикла вращения моторов (stepper_set_event_handler)
+ */
+typedef enum {
+    /** Мотор закончил серию шагов (в т.ч. последнюю) */
+    STEPPER_EVENT_SERIES_FINISHED,
+    
+    /** Мотор закончил вращение: сделал все шаги или остановлен из-за ошибки */
+    STEPPER_EVENT_MOTOR_FINISHED,
+    
+    /** Цикл завершился (все моторы закончили вращение, цикл отменен или остановлен) */
+    STEPPER_EVENT_CYCLE_FINISHED,
+    
+    /**
+     * Ошибка: у мотора появился флаг ошибки (см. stepper.error) или
+     * обработчик таймера не уложился в период (мотора нет,
+     * CYCLE_ERROR_HANDLER_TIMING_EXCEEDED)
+     */
+    STEPPER_EVENT_ERROR,
+    
+    /** Количество событий */
+    STEPPER_EVENT_COUNT
+} stepper_event_t;
+
+/**
+ * Способ доставки события обработчику
+ */
+typedef enum {
+    /**
+     * Сразу из обработчика прерывания таймера - минимальная задержка.
+     * Обработчик события должен быть коротким; запускать новый цикл
+     * (stepper_start_cycle) можно только из STEPPER_EVENT_CYCLE_FINISHED,
+     * он приходит в самом конце обработчика прерывания.
+     */
+    STEPPER_EVENT_IMMEDIATE,
+    
+    /**
+     * Через очередь событий: обработчик вызывается из stepper_handle_events
+     * (например, из loop())
+     */
+    STEPPER_EVENT_DEFERRED
+} stepper_event_delivery_t;
+
+/**
+ * Обработчик события цикла.
+ *
+ * @param event - событие
+ * @param smotor - мотор, с которым произошло событие
+ *     (NULL для STEPPER_EVENT_CYCLE_FINISHED и ошибки цикла)
+ */
+typedef void (*stepper_event_handler_t)(stepper_event_t event, stepper* smotor);
+
 /**
  * Инициализировать шаговый мотор необходимыми значениями.
  * 
@@ -429,6 +527,42 @@ void init_stepper_ends(stepper* smotor,
         end_strategy_t min_end_strategy, end_strategy_t max_end_strategy,
         long long min_pos, long long max_pos);
 
+/**
+ * Режим шага по обоим фронтам сигнала step (DEDGE) для драйверов,
+ * которые его поддерживают (TMC и т.п.): на каждый шаг ножка step
+ * переключается один раз (LOW>HIGH или HIGH>LOW) вместо пары HIGH, LOW.
+ * В 2 раза меньше записей в ножку и на 1 импульс таймера на шаг меньше:
+ * минимальная задержка между шагами мотора должна вмещать 2 периода
+ * таймера (проверка границ, переключение), вместе с
+ * stepper_set_two_tick_steps - 1 период.
+ * 
+ * Режим DEDGE должен быть включен в самом драйвере. При включении
+ * ножка step сбрасывается в LOW, поэтому вызывать до начала движения.
+ * 
+ * @param smotor
+ * @param dual_edge
+ *   true: шаг по обоим фронтам
+ *   false: шаг по фронту HIGH>LOW (по умолчанию)
+ */
+void init_stepper_dual_edge(stepper* smotor, bool dual_edge);
+
+/**
+ * Компенсация люфта передачи: когда мотор меняет направление вращения
+ * (новое направление в prepare_xxx или смена серии в dir_buffer),
+ * движок перед первым шагом в новую сторону вставляет backlash_steps
+ * шагов с максимальной скоростью (min_step_delay). Шаги компенсации
+ * не меняют current_pos и не считаются в шагах серии, время цикла
+ * увеличивается на время этих шагов.
+ * 
+ * Направление последнего движения сбрасывается (неизвестно), поэтому
+ * первое движение после вызова идет без компенсации. Если цикл прерван
+ * во время компенсации, оставшиеся шаги компенсации не делаются.
+ * 
+ * @param smotor
+ * @param backlash_steps - люфт, шаги мотора (0 - без компенсации)
+ */
+void init_stepper_backlash(stepper* smotor, unsigned long backlash_steps);
+
 /**
  * Подготовить мотор к запуску ограниченной серии шагов - задать нужное количество
  * шагов, направление и задержку между шагами для регулирования скорости (0 для максимальной скорости).
@@ -555,6 +689,32 @@ void prepare_simple_buffered_steps(stepper *smotor, int buf_size, unsigned long*
  */
 void prepare_buffered_steps(stepper *smotor, int buf_size, unsigned long* step_buffer, int* dir_buffer, unsigned long* delay_buffer);
 
+/**
+ * Привести массивы серий для prepare_buffered_steps к каноническому виду
+ * (на месте, до вызова prepare_buffered_steps):
+ * - задержка 0 (максимальная скорость) заменяется на min_step_delay мотора;
+ * - серии без шагов (step_buffer[i]=0) удаляются (prepare_buffered_steps
+ *   считает мотор завершившим вращение на первой же пустой серии);
+ * - соседние серии с одинаковыми направлением и задержкой объединяются
+ *   в одну (меньше элементов в массивах и переходов между сериями
+ *   в обработчике прерываний таймера).
+ * 
+ * Перед изменением массивов проверяет все серии: если хотя бы одна
+ * задержка (кроме 0) меньше min_step_delay или направление не -1, 0, 1,
+ * массивы не меняются.
+ * 
+ * Количество шагов, положение мотора в конце цикла и время цикла
+ * не меняются.
+ * 
+ * @param buf_size - количество серий (количество элементов в массивах step_buffer, dir_buffer, delay_buffer)
+ * @param step_buffer - массив с количеством шагов для каждой серии
+ * @param dir_buffer - массив с направлениями движения для каждой серии
+ * @param delay_buffer - массив задержек между шагами для каждой из серий, микросекунды
+ * @return новое количество серий (может быть 0 - шагов нет),
+ *     -1 - некорректная задержка или направление, массивы не изменены
+ */
+int normalize_buffered_steps(stepper *smotor, int buf_size, unsigned long* step_buffer, int* dir_buffer, unsigned long* delay_buffer);
+
 /**
  * Подготовить мотор к запуску ограниченной серии шагов с переменной скоростью - задать нужное количество
  * шагов, направление и указатель на функцию, вычисляющую задержку перед каждым шагом для регулирования скорости.
@@ -606,9 +766,55 @@ void stepper_pause_cycle();
 
 /**
  * Продолжить вращение, если оно было поставлено на паузу
+ * (после stepper_hold_cycle - с плавным разгоном).
  */
 void stepper_resume_cycle();
 
+/**
+ * Плавная остановка (feed hold): все моторы замедляются вдоль
+ * траектории (задержки всех моторов растут в одинаковое количество раз)
+ * до STEPPER_HOLD_MIN_PERCENT процентов от запланированной скорости,
+ * после этого цикл встает на паузу (stepper_cycle_paused).
+ * 
+ * stepper_resume_cycle продолжает вращение с того же места (счетчики
+ * шагов и положение не теряются) и плавно разгоняет моторы до
+ * запланированной скорости за то же время.
+ * 
+ * В отличие от stepper_pause_cycle, моторы не останавливаются резко
+ * на полной скорости и не теряют шаги.
+ * 
+ * @param decel_time_us - время замедления, микросекунды
+ */
+void stepper_hold_cycle(unsigned long decel_time_us=STEPPER_HOLD_DECEL_US);
+
+/**
+ * Идет плавная остановка (stepper_hold_cycle) или плавный разгон после нее.
+ */
+bool stepper_cycle_holding();
+
+/**
+ * Поправка скорости (feed rate override) для всех моторов прямо во время
+ * цикла, без перепланирования: задержки между шагами (постоянные, из буфера,
+ * из серий и вычисляемые динамически) делятся на percent/100.
+ * 
+ * Поправка одна на все моторы и применяется плавно: меняется на 1%
+ * за STEPPER_SPEED_OVERRIDE_RAMP_US микросекунд; каждый цикл начинается
+ * со 100%. Поправка не растет выше той, при которой хотя бы один мотор
+ * шагал бы чаще min_step_delay: моторы упираются в минимальную задержку
+ * одновременно, отношение скоростей (траектория) не меняется - ошибкой
+ * это не считается.
+ * 
+ * @param percent - скорость в процентах от запланированной:
+ *     от 1 до STEPPER_SPEED_OVERRIDE_MAX, 100 - без поправки (по умолчанию)
+ * @return false - значение вне допустимого диапазона, поправка не изменилась
+ */
+bool stepper_set_speed_override(unsigned int percent);
+
+/**
+ * Поправка скорости (stepper_set_speed_override), проценты.
+ */
+unsigned int stepper_speed_override();
+
 /**
  * Текущий статус цикла:
  * true - в процессе выполнения,
@@ -638,6 +844,126 @@ stepper_cycle_error_t stepper_cycle_error();
  */
 unsigned long stepper_cycle_max_time();
 
+/**
+ * Текущий период таймера, микросекунды. С адаптивным периодом
+ * (stepper_set_timer_period_adaptive) во время цикла может быть
+ * больше периода, заданного stepper_configure_timer.
+ */
+unsigned long stepper_cycle_timer_period();
+
+/**
+ * Количество смен периода таймера в текущем цикле
+ * (адаптивный период, см. stepper_set_timer_period_adaptive).
+ */
+unsigned long stepper_cycle_timer_period_changes();
+
+/**
+ * Количество пропущенных импульсов таймера в текущем цикле, время которых
+ * моторы догоняли (cycle_timing_exceed_handle=FIX, см.
+ * stepper_set_error_handle_strategy).
+ */
+unsigned long stepper_cycle_missed_ticks();
+
+/**
+ * Согласованный снимок положения, статуса и ошибок моторов - можно
+ * часто вызывать из loop() во время цикла, прерывания не запрещаются.
+ *
+ * Обработчик таймера меняет current_pos (long long) и другие поля мотора,
+ * на AVR и PIC32 чтение таких значений из loop() не атомарно и может
+ * попасть на середину записи. Обработчик увеличивает счетчик версий
+ * в начале и в конце каждого импульса (seqlock), снимок копируется
+ * заново, если за время копирования счетчик изменился.
+ *
+ * На одноядерных платформах (AVR, PIC32, SAM) достаточно барьеров
+ * компилятора; на бэкенде Linux, где обработчик работает в отдельном
+ * потоке на другом ядре, счетчик и копирование разделены барьерами
+ * процессора (__atomic_thread_fence).
+ *
+ * @param smotors - моторы
+ * @param count - количество моторов
+ * @param snapshots - снимки, по одному на каждый мотор
+ */
+void stepper_snapshot(stepper** smotors, int count, stepper_snapshot_t* snapshots);
+
+/////////////////////////////////////////
+// События цикла
+
+/**
+ * Назначить обработчик события цикла вместо опроса stepper_cycle_running.
+ *
+ * @param event - событие
+ * @param handler - обработчик, NULL - не сообщать о событии
+ * @param delivery - доставка события:
+ *     STEPPER_EVENT_IMMEDIATE - из обработчика прерывания таймера,
+ *     STEPPER_EVENT_DEFERRED - из stepper_handle_events
+ */
+void stepper_set_event_handler(stepper_event_t event, stepper_event_handler_t handler,
+        stepper_event_delivery_t delivery=STEPPER_EVENT_DEFERRED);
+
+/**
+ * Вызвать обработчики событий из очереди (STEPPER_EVENT_DEFERRED).
+ * Вызывать из loop().
+ *
+ * @return количество обработанных событий
+ */
+int stepper_handle_events();
+
+/**
+ * Количество событий, которые не поместились в очередь
+ * (STEPPER_EVENT_QUEUE_SIZE) и были потеряны.
+ */
+unsigned long stepper_events_lost();
+
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+/**
+ * Концевые датчики на прерываниях (STEPPER_ENDSTOP_INTERRUPTS): перечитать
+ * состояние концевиков моторов цикла. Срабатывание концевика запоминается
+ * до ближайшей проверки в обработчике таймера, поэтому короткий импульс
+ * между проверками не теряется.
+ * 
+ * Для ножек с внешним прерыванием (digitalPinToInterrupt) библиотека
+ * сама вызывает функцию по изменению уровня на время цикла; для остальных
+ * ножек вызывать из своего обработчика прерывания (например, pin change).
+ */
+void stepper_endstops_changed();
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+
+#ifdef STEPPER_DEFERRED_STEPS
+/**
+ * Отложенные вычисления (STEPPER_DEFERRED_STEPS): подготовить данные
+ * для следующего шага моторам, которые только что шагнули (переход
+ * на новую серию, задержка до следующего шага, ее проверка).
+ * 
+ * Обработчик таймера только выдает шаги, поэтому его время работы
+ * не зависит от сложности движения. Вызывать из loop() или из своего
+ * программного прерывания с приоритетом ниже, чем у таймера
+ * (см. stepper_deferred_request), но не из обоих мест сразу.
+ * Данные для шага должны быть готовы до проверки границ перед этим
+ * шагом, иначе шаг задерживается (stepper_deferred_underruns).
+ *
+ * @return количество моторов, для которых подготовлен следующий шаг
+ */
+int stepper_handle_deferred();
+
+/**
+ * Отложенные вычисления (STEPPER_DEFERRED_STEPS): обработчик таймера
+ * вызывает эту функцию, когда есть работа для stepper_handle_deferred.
+ * 
+ * По умолчанию ничего не делает (stepper_handle_deferred вызывается
+ * из loop). Функция объявлена слабой (weak): ее можно заменить своей,
+ * которая запускает программное прерывание с низким приоритетом,
+ * а оно вызывает stepper_handle_deferred.
+ */
+void stepper_deferred_request();
+
+/**
+ * Отложенные вычисления (STEPPER_DEFERRED_STEPS): количество шагов
+ * в текущем (или последнем) цикле, которые пришлось задержать, потому что
+ * stepper_handle_deferred не успел подготовить для них данные.
+ */
+unsigned long stepper_deferred_underruns();
+#endif // STEPPER_DEFERRED_STEPS
+
 /////////////////////////////////////////
 // Системные настройки
 
@@ -705,6 +1031,30 @@ unsigned long stepper_cycle_max_time();
  */
 void stepper_configure_timer(unsigned long target_period_us, int timer, int prescaler, unsigned int adjustment);
 
+/**
+ * Максимальный период таймера, при котором можно запустить цикл
+ * для моторов, подготовленных к запуску (prepare_xxx): минимальная задержка
+ * между шагами каждого мотора должна вмещать не меньше 3х периодов
+ * (2х для stepper_set_two_tick_steps) и делиться на период без остатка.
+ * Выбираем наибольший делитель НОД минимальных задержек всех моторов,
+ * который вмещается в самую маленькую из них 3 (2) раза.
+ * 
+ * Если разрешены некратные задержки (aliquant_step_delay_handle=FIX,
+ * см. stepper_set_error_handle_strategy), кратность не требуется:
+ * период - треть (половина) самой маленькой минимальной задержки
+ * (максимальная скорость моторов с некратной задержкой при этом
+ * округляется вниз до целого количества периодов на шаг).
+ * 
+ * Чем больше период, тем реже вызывается обработчик прерывания
+ * и тем меньше нагрузка на процессор.
+ * 
+ * Для настройки таймера с этим периодом см. stepper_configure_timer_auto
+ * (stepper_configure_timer.h).
+ * 
+ * @return период таймера, микросекунды; 0, если моторы не подготовлены
+ */
+unsigned long stepper_timer_period_auto();
+
 /**
  * Режим отладки: не включать аппаратный таймер при запуске цикла шагов,
  * шаги можно осуществлять вручную серией вызовов _stepper_handle_interrupts.
@@ -715,6 +1065,76 @@ void stepper_configure_timer(unsigned long target_period_us, int timer, int pres
  */
 void stepper_set_timer_enabled(bool enabled);
 
+/**
+ * Шаг мотора в 2 импульса таймера вместо 3х: проверка границ
+ * и концевиков выполняется на том же импульсе, что и HIGH на ножке step
+ * (непосредственно перед ним), шаг - на следующем импульсе по HIGH>LOW.
+ * Минимальная задержка между шагами мотора должна вмещать 2 периода
+ * таймера вместо 3х - при той же частоте таймера можно крутить моторы
+ * в 1.5 раза быстрее, но обработчик прерывания на импульсе HIGH
+ * выполняется дольше.
+ * 
+ * Менять только между циклами.
+ * 
+ * @param two_tick
+ *   false: шаг в 3 импульса (по умолчанию)
+ *   true: шаг в 2 импульса
+ */
+void stepper_set_two_tick_steps(bool two_tick);
+
+/**
+ * Группировка шагов для очень высоких скоростей: если задержка между
+ * шагами мотора меньше порога, обработчик прерывания делает 2, 4 или 8
+ * шагов (импульсов на ножке step) подряд на одном импульсе таймера,
+ * а следующую группу планирует на соответствующее время позже.
+ * Частота шагов в среднем сохраняется, точность отдельного шага
+ * снижается до группы.
+ * 
+ * Минимальная задержка между шагами мотора может быть меньше 3х
+ * (2х, 1го) периодов таймера - достаточно, чтобы их вмещала группа
+ * из 8 шагов. Только для моторов с постоянной скоростью в серии
+ * (prepare_steps, prepare_whirl, prepare_buffered_steps).
+ * 
+ * Импульсы в группе идут друг за другом без задержки (ширина импульса -
+ * время пары вызовов digitalWrite), драйвер должен их успевать
+ * различать.
+ * 
+ * Менять только между циклами.
+ * 
+ * @param step_delay_us - задержка между шагами, микросекунды, ниже которой
+ *     шаги группируются; 0 - не группировать (по умолчанию)
+ */
+void stepper_set_step_multiplier_threshold(unsigned long step_delay_us);
+
+/**
+ * Адаптивный период таймера: во время цикла увеличивать период таймера
+ * (в 2, 4, ... 2^STEPPER_TIMER_ADAPTIVE_MAX_SHIFT раз относительно
+ * периода, заданного stepper_configure_timer), если все моторы в текущих
+ * сериях движутся медленно или стоят на месте (dir=0), и возвращать
+ * обратно, когда моторам нужен более частый таймер.
+ * 
+ * Период пересматривается на границах серий (prepare_buffered_steps)
+ * и при завершении вращения моторов. Увеличенный период подходит мотору,
+ * если задержка между шагами текущей серии вмещает 3 периода и делится
+ * на период без остатка (или погрешность в один период не делает
+ * промежуток между шагами меньше минимальной задержки). Моторы
+ * с переменной скоростью (prepare_simple_buffered_steps,
+ * prepare_dynamic_xxx) работают только с базовым периодом.
+ * 
+ * Применяется только к периодам, которые таймер получает точно
+ * (stepper_timer_period_settings). После завершения цикла
+ * восстанавливаются базовые настройки таймера.
+ * 
+ * Количество смен периода в цикле: stepper_cycle_timer_period_changes.
+ * 
+ * Менять только между циклами.
+ * 
+ * @param adaptive
+ *   false: период таймера не меняется во время цикла (по умолчанию)
+ *   true: адаптивный период
+ */
+void stepper_set_timer_period_adaptive(bool adaptive);
+
 /**
  * Стратегия реакции на некоторые исключительные ситуации, которые
  * могут произойти во время вращения моторов.
@@ -731,14 +1151,41 @@ void stepper_set_timer_enabled(bool enabled);
  *     по умолчанию: CANCEL_CYCLE
  * @param cycle_timing_exceed_handle - обработчик прерывания выполняется дольше,
  *       чем период таймера.
- *     допустимые значения: IGNORE/CANCEL_CYCLE
+ *     допустимые значения: IGNORE/FIX/CANCEL_CYCLE
+ *     IGNORE: продолжать цикл, время пропущенных импульсов таймера теряется
+ *       (моторы отстают от расписания);
+ *     FIX: продолжать цикл, время пропущенных импульсов (по micros) вычитается
+ *       из таймеров моторов до следующего шага, но так, чтобы ни один шаг
+ *       не пропал - шаг сдвигается не больше, чем на несколько импульсов,
+ *       остаток догоняем на следующих шагах (stepper_cycle_missed_ticks);
+ *     CANCEL_CYCLE: завершить цикл.
+ *     по умолчанию: CANCEL_CYCLE
+ * @param aliquant_step_delay_handle - период таймера некратен минимальной
+ *       задержке между шагами мотора (CYCLE_ERROR_TIMER_PERIOD_ALIQUANT_STEP_DELAY).
+ *     допустимые значения: FIX/CANCEL_CYCLE
+ *     FIX: запускать цикл - неиспользованные микросекунды каждого шага
+ *       переносятся на следующий шаг, поэтому средняя скорость вращения
+ *       точно соответствует задержке, а отдельные промежутки между шагами
+ *       отличаются от нее не больше, чем на один период таймера; но
+ *       промежуток не бывает короче минимальной задержки мотора: шаги
+ *       идут только на импульсах, поэтому максимальная скорость мотора -
+ *       минимальная задержка, округленная вверх до целого количества
+ *       периодов (задержки короче этой выполняются с ней);
+ *     CANCEL_CYCLE: не запускать цикл.
  *     по умолчанию: CANCEL_CYCLE
  */
 void stepper_set_error_handle_strategy(
         error_handle_strategy_t hard_end_handle,
         error_handle_strategy_t soft_end_handle,
         error_handle_strategy_t small_step_delay_handle,
-        error_handle_strategy_t cycle_timing_exceed_handle);
+        error_handle_strategy_t cycle_timing_exceed_handle,
+        error_handle_strategy_t aliquant_step_delay_handle=DONT_CHANGE);
+
+/**
+ * Стратегия реакции на выход за границы по аппаратному концевику
+ * (stepper_set_error_handle_strategy): STOP_MOTOR или CANCEL_CYCLE.
+ */
+error_handle_strategy_t stepper_hard_end_handle();
 
 
 #endif // STEPPER_H
@@ -123,6 +123,39 @@ unsigned long stepper_configure_timer_2Hz(int timer);
  */
 unsigned long stepper_configure_timer_1Hz(int timer);
 
+// Automatic period
+
+/**
+ * Подобрать предварительный масштаб (prescaler) и значение корректировки
+ * (adjustment) таймера для периода period_us на текущей платформе.
+ *
+ * Find timer prescaler and adjustment for period_us on current platform.
+ *
+ * @param period_us - период таймера, микросекунды
+ * @param timer - системный идентификатор таймера
+ * @param prescaler - (out) предварительный масштаб таймера
+ * @param adjustment - (out) значение корректировки (уже с вычетом 1)
+ * @return true - период можно получить на этом таймере точно,
+ *     false - нельзя (значения prescaler и adjustment не меняются)
+ */
+bool stepper_timer_period_settings(unsigned long period_us, int timer, int* prescaler, unsigned int* adjustment);
+
+/**
+ * Настроить таймер на максимальный допустимый период для моторов,
+ * подготовленных к запуску в следующем цикле (см. stepper_timer_period_auto):
+ * вызывать после prepare_xxx, но перед stepper_start_cycle.
+ * Если таймер не может получить этот период точно (разрядность счетчика,
+ * нецелое число тиков), берется следующий по убыванию делитель НОД
+ * минимальных задержек, который таймер получает точно.
+ *
+ * Configure timer to the longest period legal for the prepared motors.
+ *
+ * @param timer - системный идентификатор таймера
+ * @return период таймера, микросекунды; 0 - подходящий период подобрать
+ *     не удалось, настройки таймера не изменились
+ */
+unsigned long stepper_configure_timer_auto(int timer);
+
 #endif // STEPPER_CONFIGURE_TIMER_H
 
 
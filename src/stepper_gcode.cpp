@@ -0,0 +1,841 @@
+/**
+ * stepper_gcode.cpp
+ *
+ * Интерпретатор G-кода: строки разбираются по одной, перемещения
+ * выполняются сегментами stepper_program.
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#include "Arduino.h"
+#include "stepper_gcode.h"
+
+#include "math.h"
+#include "limits.h"
+
+// из stepper_lib_config.h
+#ifndef STEPPER_GCODE_LINE_MAX
+#define STEPPER_GCODE_LINE_MAX 96
+#endif
+
+#ifndef STEPPER_GCODE_ARC_SEGMENT_NM
+#define STEPPER_GCODE_ARC_SEGMENT_NM 200000
+#endif
+
+#ifndef STEPPER_GCODE_CHAIN
+#define STEPPER_GCODE_CHAIN 32
+#endif
+
+// Перемещение, которое выдает stepper_gcode_next_segment
+#define PENDING_NONE 0
+#define PENDING_LINE 1
+#define PENDING_ARC 2
+#define PENDING_DWELL 3
+
+// Числа в G-коде - с 6 знаками после запятой (миллиметры -> нанометры)
+#define GCODE_SCALE 1000000LL
+
+// Наибольшая целая часть числа: после умножения на GCODE_SCALE
+// и перевода дюймов в нанометры (_to_nm, x25.4) число помещается
+// в long long
+#define GCODE_INT_PART_MAX (LLONG_MAX/GCODE_SCALE/26)
+
+// Моторы для осей
+static stepper* _gcode_axes[STEPPER_PROGRAM_MAX_AXES];
+static int _gcode_axis_count = 0;
+
+// Положение осей: точное (нанометры) и в шагах, которые уже выданы
+// в сегментах (ошибка округления до шага не накапливается)
+static long long _gcode_pos_nm[STEPPER_PROGRAM_MAX_AXES];
+static long _gcode_pos_steps[STEPPER_PROGRAM_MAX_AXES];
+
+// Модальные настройки
+static bool _gcode_relative = false;
+static bool _gcode_inches = false;
+static int _gcode_motion = 0;
+// скорость подачи, нанометры в минуту (0 - не задана)
+static long long _gcode_feed = 0;
+
+// Перемещение из последней разобранной строки
+static unsigned char _gcode_pending = PENDING_NONE;
+static bool _gcode_rapid = false;
+static long long _gcode_target_nm[STEPPER_PROGRAM_MAX_AXES];
+static unsigned long _gcode_dwell_us = 0;
+static bool _gcode_end = false;
+
+// Дуга: центр, радиус, начальный угол, угол дуги, начальное положение
+// всех осей, текущий и последний отрезок
+static int _arc_x;
+static int _arc_y;
+static double _arc_cx;
+static double _arc_cy;
+static double _arc_r;
+static double _arc_a0;
+static double _arc_sweep;
+static long long _arc_start_nm[STEPPER_PROGRAM_MAX_AXES];
+static unsigned long _arc_k;
+static unsigned long _arc_n;
+
+// Время последнего сегмента (_segment_to), микросекунды
+static unsigned long long _gcode_segment_us = 0;
+
+// Следующий цикл, который набирает stepper_gcode_next_cycle: пауза
+// (_gcode_record) или цепочка сегментов линий и дуг - серии для каждой
+// оси. Цепочек две: одна выполняется, другая набирается (_chain_fill)
+static stepper_program_record _gcode_record;
+static bool _gcode_cycle_dwell = false;
+static unsigned long _chain_steps[2][STEPPER_PROGRAM_MAX_AXES][STEPPER_GCODE_CHAIN];
+static int _chain_dirs[2][STEPPER_PROGRAM_MAX_AXES][STEPPER_GCODE_CHAIN];
+static unsigned long _chain_delays[2][STEPPER_PROGRAM_MAX_AXES][STEPPER_GCODE_CHAIN];
+static int _chain_len[2][STEPPER_PROGRAM_MAX_AXES];
+static int _chain_segments[2];
+static int _chain_fill = 0;
+// время от начала набираемой цепочки, микросекунды: конец последнего
+// сегмента и последний шаг каждой оси
+static unsigned long long _chain_us = 0;
+static unsigned long long _chain_axis_us[STEPPER_PROGRAM_MAX_AXES];
+// Положение осей после подготовленного цикла
+static long long _gcode_target_pos[STEPPER_PROGRAM_MAX_AXES];
+
+// Выполнение из потока символов
+static int (*_gcode_read_byte)(void* source) = NULL;
+static void* _gcode_source = NULL;
+static char _gcode_line[STEPPER_GCODE_LINE_MAX];
+static int _gcode_line_len = 0;
+static bool _gcode_line_overflow = false;
+// Поток закончился (STEPPER_GCODE_EOF)
+static bool _gcode_eof = false;
+static bool _gcode_cycle_started = false;
+static stepper_gcode_status_t _gcode_status = GCODE_FINISHED;
+static unsigned long _gcode_lines = 0;
+
+/**
+ * Разобрать число: знак, целая часть, не больше 6 знаков после запятой
+ * (остальные отбрасываются).
+ *
+ * @param str - указатель на начало числа, после разбора - на следующий символ
+ * @param val - число, умноженное на GCODE_SCALE
+ * @return true - число разобрано
+ */
+static bool _parse_number(const char** str, long long* val) {
+    const char* p = *str;
+    bool neg = false;
+    if(*p == '-' || *p == '+') {
+        neg = *p == '-';
+        p++;
+    }
+
+    long long int_part = 0;
+    long long frac_part = 0;
+    long long frac_scale = GCODE_SCALE;
+    bool digits = false;
+    while(*p >= '0' && *p <= '9') {
+        int_part = int_part*10 + (*p - '0');
+        if(int_part > GCODE_INT_PART_MAX) {
+            return false;
+        }
+        digits = true;
+        p++;
+    }
+    if(*p == '.') {
+        p++;
+        while(*p >= '0' && *p <= '9') {
+            if(frac_scale > 1) {
+                frac_scale /= 10;
+                frac_part += (*p - '0')*frac_scale;
+            }
+            digits = true;
+            p++;
+        }
+    }
+    if(!digits) {
+        return false;
+    }
+
+    *val = int_part*GCODE_SCALE + frac_part;
+    if(neg) {
+        *val = -*val;
+    }
+    *str = p;
+    return true;
+}
+
+/**
+ * Ось по букве G-кода (буква имени мотора), -1 - не ось.
+ */
+static int _axis_by_letter(char letter) {
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        char name = _gcode_axes[i]->name;
+        if(name >= 'a' && name <= 'z') {
+            name = name - 'a' + 'A';
+        }
+        if(name == letter) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Координата из G-кода в нанометры.
+ */
+static long long _to_nm(long long val, bool inches) {
+    // число уже умножено на 10^6: миллиметры - нанометры,
+    // дюйм - 25.4мм (сначала делим: val*254 не помещается
+    // в long long для больших чисел)
+    return inches ? val/10*254 + val%10*254/10 : val;
+}
+
+/**
+ * Положение в нанометрах - в шаги мотора оси i (с округлением до ближайшего).
+ */
+static long _nm_to_steps(int i, long long nm) {
+    long long dps = _gcode_axes[i]->distance_per_step;
+    return nm >= 0 ? (nm + dps/2)/dps : -((-nm + dps/2)/dps);
+}
+
+/**
+ * Начать новую цепочку в буфере b.
+ */
+static void _chain_reset(int b) {
+    for(int i = 0; i < STEPPER_PROGRAM_MAX_AXES; i++) {
+        _chain_len[b][i] = 0;
+        _chain_axis_us[i] = 0;
+    }
+    _chain_segments[b] = 0;
+    _chain_us = 0;
+}
+
+/**
+ * Сегмент до точки target (нанометры) со скоростью подачи или
+ * с максимальной скоростью (rapid).
+ *
+ * @return true - сегмент готов
+ *     false - точка совпадает с текущей с точностью до шага
+ */
+static bool _segment_to(const long long* target, bool rapid, stepper_program_record* record) {
+    double length = 0;
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        double d = (double)(target[i] - _gcode_pos_nm[i]);
+        length += d*d;
+        _gcode_pos_nm[i] = target[i];
+    }
+    length = sqrt(length);
+
+    // время на сегмент - по скорости подачи, но ни одна ось
+    // не шагает чаще min_step_delay
+    unsigned long long time_us = rapid || _gcode_feed == 0 ? 0 :
+        (unsigned long long)(length*60000000.0/_gcode_feed);
+    long steps[STEPPER_PROGRAM_MAX_AXES];
+    bool has_steps = false;
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        steps[i] = _nm_to_steps(i, target[i]) - _gcode_pos_steps[i];
+        unsigned long long min_time_us = (unsigned long long)labs(steps[i])*_gcode_axes[i]->min_step_delay;
+        if(time_us < min_time_us) {
+            time_us = min_time_us;
+        }
+        has_steps = has_steps || steps[i] != 0;
+    }
+    if(!has_steps) {
+        return false;
+    }
+    _gcode_segment_us = time_us;
+
+    record->type = PROGRAM_MOVE;
+    record->axis_mask = 0;
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        if(steps[i] == 0) {
+            continue;
+        }
+        unsigned long step_count = labs(steps[i]);
+        unsigned long long step_delay = time_us/step_count;
+
+        record->axis_mask |= 1 << i;
+        record->axes[i].step_count = step_count;
+        record->axes[i].dir = steps[i] > 0 ? 1 : -1;
+        record->axes[i].step_delay = step_delay > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (unsigned long)step_delay;
+        _gcode_pos_steps[i] += steps[i];
+    }
+    return true;
+}
+
+/**
+ * Прочитать из потока символы до конца строки (_gcode_line) или
+ * до конца потока (_gcode_eof).
+ *
+ * @return true - строка прочитана (последняя строка потока может быть
+ *     без '\n')
+ *     false - данных пока нет (прочитанные символы остаются в буфере)
+ *     или поток закончился
+ */
+static bool _gcode_read_line() {
+    while(true) {
+        int b = _gcode_read_byte(_gcode_source);
+        if(b == STEPPER_GCODE_EOF) {
+            _gcode_eof = true;
+            if(_gcode_line_len == 0 && !_gcode_line_overflow) {
+                return false;
+            }
+            break;
+        } else if(b < 0) {
+            return false;
+        } else if(b == '\n') {
+            break;
+        } else if(_gcode_line_len < STEPPER_GCODE_LINE_MAX - 1) {
+            _gcode_line[_gcode_line_len++] = b;
+        } else {
+            _gcode_line_overflow = true;
+        }
+    }
+
+    _gcode_lines++;
+    _gcode_line[_gcode_line_len] = '\0';
+    _gcode_line_len = 0;
+    return true;
+}
+
+/**
+ * Подготовить интерпретатор: оси, текущее положение - current_pos
+ * моторов, миллиметры, абсолютные координаты, скорость подачи не задана.
+ *
+ * @param axes - моторы для осей
+ * @param axis_count - количество моторов (не более STEPPER_PROGRAM_MAX_AXES)
+ * @return true - интерпретатор готов
+ *     false - некорректное количество моторов
+ */
+bool stepper_gcode_init(stepper** axes, int axis_count) {
+    if(axis_count < 1 || axis_count > STEPPER_PROGRAM_MAX_AXES) {
+        return false;
+    }
+
+    for(int i = 0; i < axis_count; i++) {
+        _gcode_axes[i] = axes[i];
+        _gcode_pos_nm[i] = axes[i]->current_pos;
+        // distance_per_step - unsigned long: делим в знаковых
+        _gcode_pos_steps[i] = axes[i]->current_pos / (long long)axes[i]->distance_per_step;
+    }
+    _gcode_axis_count = axis_count;
+
+    _gcode_relative = false;
+    _gcode_inches = false;
+    _gcode_motion = 0;
+    _gcode_feed = 0;
+    _gcode_pending = PENDING_NONE;
+    _gcode_end = false;
+    _gcode_cycle_dwell = false;
+    _chain_fill = 0;
+    _chain_reset(_chain_fill);
+    return true;
+}
+
+/**
+ * Разобрать строку G-кода. Перемещение из строки выполняется
+ * сегментами stepper_gcode_next_segment; следующую строку можно
+ * разбирать, только когда все сегменты получены.
+ *
+ * @param line - строка без символа конца строки
+ * @return true - строка разобрана
+ *     false - ошибка в строке (положение и настройки не изменились)
+ */
+bool stepper_gcode_parse(const char* line) {
+    if(_gcode_pending != PENDING_NONE || _gcode_axis_count == 0) {
+        return false;
+    }
+
+    // слова строки
+    bool has_axis[STEPPER_PROGRAM_MAX_AXES];
+    long long axis_val[STEPPER_PROGRAM_MAX_AXES];
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        has_axis[i] = false;
+    }
+    bool has_i = false, has_j = false, has_f = false, has_p = false, has_s = false;
+    long long val_i = 0, val_j = 0, val_f = 0, val_p = 0, val_s = 0;
+
+    // команды строки (применяются после разбора всей строки)
+    int motion = -1;
+    bool dwell = false;
+    bool home = false;
+    bool end = false;
+    bool relative = _gcode_relative;
+    bool inches = _gcode_inches;
+
+    const char* p = line;
+    while(*p != '\0') {
+        char letter = *p;
+        if(letter == ' ' || letter == '\t' || letter == '\r' || letter == '\n') {
+            p++;
+            continue;
+        } else if(letter == ';' || letter == '*') {
+            // комментарий или контрольная сумма до конца строки
+            break;
+        } else if(letter == '(') {
+            // комментарий в скобках
+            while(*p != '\0' && *p != ')') {
+                p++;
+            }
+            if(*p == ')') {
+                p++;
+            }
+            continue;
+        }
+
+        if(letter >= 'a' && letter <= 'z') {
+            letter = letter - 'a' + 'A';
+        }
+        p++;
+        long long val;
+        if(!_parse_number(&p, &val)) {
+            return false;
+        }
+
+        int axis = _axis_by_letter(letter);
+        if(axis >= 0) {
+            if(has_axis[axis]) {
+                return false;
+            }
+            has_axis[axis] = true;
+            axis_val[axis] = val;
+        } else if(letter == 'G' || letter == 'M') {
+            if(val < 0 || val % GCODE_SCALE != 0) {
+                return false;
+            }
+            long code = val / GCODE_SCALE;
+            if(letter == 'M') {
+                // остальные M-команды пропускаем
+                end = end || code == 2 || code == 30;
+            } else if(code <= 3) {
+                motion = code;
+            } else if(code == 4) {
+                dwell = true;
+            } else if(code == 17) {
+                // плоскость XY - единственная
+            } else if(code == 20 || code == 21) {
+                inches = code == 20;
+            } else if(code == 28) {
+                home = true;
+            } else if(code == 90 || code == 91) {
+                relative = code == 91;
+            } else {
+                return false;
+            }
+        } else if(letter == 'I' && !has_i) {
+            has_i = true;
+            val_i = val;
+        } else if(letter == 'J' && !has_j) {
+            has_j = true;
+            val_j = val;
+        } else if(letter == 'F' && !has_f && val > 0) {
+            has_f = true;
+            val_f = val;
+        } else if(letter == 'P' && !has_p && val >= 0) {
+            has_p = true;
+            val_p = val;
+        } else if(letter == 'S' && !has_s && val >= 0) {
+            has_s = true;
+            val_s = val;
+        } else if(letter != 'N') {
+            return false;
+        }
+    }
+
+    bool has_axes = false;
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        has_axes = has_axes || has_axis[i];
+    }
+
+    long long feed = has_f ? _to_nm(val_f, inches) : _gcode_feed;
+    int new_motion = motion >= 0 ? motion : _gcode_motion;
+    bool move = !dwell && !home && (has_axes || (motion >= 2 && motion <= 3));
+
+    // проверки до изменения состояния
+    if(move && new_motion != 0 && feed == 0) {
+        // скорость подачи не задана
+        return false;
+    }
+    if(move && (new_motion == 2 || new_motion == 3)) {
+        _arc_x = _axis_by_letter('X');
+        _arc_y = _axis_by_letter('Y');
+        if(_arc_x < 0 || _arc_y < 0 || !(has_i || has_j)) {
+            return false;
+        }
+    }
+
+    _gcode_relative = relative;
+    _gcode_inches = inches;
+    _gcode_feed = feed;
+    _gcode_motion = new_motion;
+    _gcode_end = _gcode_end || end;
+
+    if(dwell) {
+        // G4 P - миллисекунды, S - секунды
+        unsigned long long dwell_us = has_p ? val_p/1000 : val_s;
+        if(dwell_us > 0) {
+            // пауза - цикл оси 0 (stepper_program_prepare)
+            if(dwell_us < _gcode_axes[0]->min_step_delay) {
+                dwell_us = _gcode_axes[0]->min_step_delay;
+            }
+            _gcode_dwell_us = dwell_us > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (unsigned long)dwell_us;
+            _gcode_pending = PENDING_DWELL;
+        }
+    } else if(home) {
+        // в 0 по указанным осям (без осей - по всем)
+        for(int i = 0; i < _gcode_axis_count; i++) {
+            _gcode_target_nm[i] = !has_axes || has_axis[i] ? 0 : _gcode_pos_nm[i];
+        }
+        _gcode_rapid = true;
+        _gcode_pending = PENDING_LINE;
+    } else if(move) {
+        for(int i = 0; i < _gcode_axis_count; i++) {
+            if(!has_axis[i]) {
+                _gcode_target_nm[i] = _gcode_pos_nm[i];
+            } else if(relative) {
+                _gcode_target_nm[i] = _gcode_pos_nm[i] + _to_nm(axis_val[i], inches);
+            } else {
+                _gcode_target_nm[i] = _to_nm(axis_val[i], inches);
+            }
+        }
+
+        if(new_motion <= 1) {
+            _gcode_rapid = new_motion == 0;
+            _gcode_pending = PENDING_LINE;
+        } else {
+            // центр дуги (I, J - всегда относительно начальной точки)
+            double sx = (double)_gcode_pos_nm[_arc_x];
+            double sy = (double)_gcode_pos_nm[_arc_y];
+            _arc_cx = sx + (double)_to_nm(val_i, inches);
+            _arc_cy = sy + (double)_to_nm(val_j, inches);
+            _arc_r = sqrt((sx - _arc_cx)*(sx - _arc_cx) + (sy - _arc_cy)*(sy - _arc_cy));
+            _arc_a0 = atan2(sy - _arc_cy, sx - _arc_cx);
+
+            double a1 = atan2((double)_gcode_target_nm[_arc_y] - _arc_cy,
+                (double)_gcode_target_nm[_arc_x] - _arc_cx);
+            _arc_sweep = a1 - _arc_a0;
+            // конечная точка совпадает с начальной - полный круг
+            if(new_motion == 2 && _arc_sweep >= -1e-9) {
+                _arc_sweep -= 2*M_PI;
+            } else if(new_motion == 3 && _arc_sweep <= 1e-9) {
+                _arc_sweep += 2*M_PI;
+            }
+
+            double arc_length = fabs(_arc_sweep)*_arc_r;
+            _arc_n = (unsigned long)ceil(arc_length/STEPPER_GCODE_ARC_SEGMENT_NM);
+            if(_arc_n == 0) {
+                _arc_n = 1;
+            }
+            _arc_k = 0;
+            for(int i = 0; i < _gcode_axis_count; i++) {
+                _arc_start_nm[i] = _gcode_pos_nm[i];
+            }
+            _gcode_rapid = false;
+            _gcode_pending = PENDING_ARC;
+        }
+    }
+    return true;
+}
+
+/**
+ * Следующий сегмент перемещения из последней разобранной строки.
+ *
+ * @param record - сегмент PROGRAM_MOVE или PROGRAM_DWELL для
+ *     stepper_program_prepare
+ * @return true - сегмент готов
+ *     false - перемещение завершено (или в строке его не было)
+ */
+bool stepper_gcode_next_segment(stepper_program_record* record) {
+    if(_gcode_pending == PENDING_DWELL) {
+        _gcode_pending = PENDING_NONE;
+        record->type = PROGRAM_DWELL;
+        record->axis_mask = 0;
+        record->dwell_us = _gcode_dwell_us;
+        return true;
+    } else if(_gcode_pending == PENDING_LINE) {
+        _gcode_pending = PENDING_NONE;
+        return _segment_to(_gcode_target_nm, _gcode_rapid, record);
+    } else if(_gcode_pending == PENDING_ARC) {
+        // отрезки дуги короче шага пропускаем
+        while(_arc_k < _arc_n) {
+            _arc_k++;
+            long long point[STEPPER_PROGRAM_MAX_AXES];
+            if(_arc_k == _arc_n) {
+                // последний отрезок - точно в конечную точку
+                for(int i = 0; i < _gcode_axis_count; i++) {
+                    point[i] = _gcode_target_nm[i];
+                }
+            } else {
+                // остальные оси - по винтовой линии
+                for(int i = 0; i < _gcode_axis_count; i++) {
+                    point[i] = _arc_start_nm[i] +
+                        (_gcode_target_nm[i] - _arc_start_nm[i])*(long long)_arc_k/(long long)_arc_n;
+                }
+                double a = _arc_a0 + _arc_sweep*_arc_k/_arc_n;
+                point[_arc_x] = (long long)floor(_arc_cx + _arc_r*cos(a) + 0.5);
+                point[_arc_y] = (long long)floor(_arc_cy + _arc_r*sin(a) + 0.5);
+            }
+            if(_segment_to(point, false, record)) {
+                return true;
+            }
+        }
+        _gcode_pending = PENDING_NONE;
+    }
+    return false;
+}
+
+/**
+ * Хватит ли в буфере b места для сегмента: у каждой оси до 2 серий
+ * (пауза и шаги).
+ */
+static bool _chain_has_room(int b) {
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        if(_chain_len[b][i] > STEPPER_GCODE_CHAIN - 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Добавить сегмент в цепочку b: серии для осей с шагами. Каждая ось
+ * проходит сегмент за одно и то же время - задержка считается от общего
+ * времени конца сегмента, поэтому округление задержек не накапливается
+ * и оси не расходятся. Ось, которая стояла в прошлых сегментах, сначала
+ * стоит (dir=0) до начала сегмента; промежуток короче min_step_delay
+ * добавляется к шагам сегмента.
+ */
+static void _chain_add(int b, const stepper_program_record* record) {
+    unsigned long long start_us = _chain_us;
+    _chain_us += _gcode_segment_us;
+
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        if(!(record->axis_mask & (1 << i))) {
+            continue;
+        }
+
+        unsigned long long idle_us = start_us - _chain_axis_us[i];
+        if(idle_us > 0 && idle_us >= _gcode_axes[i]->min_step_delay) {
+            // пауза длиннее задержки 32 бит - несколько "шагов"
+            unsigned long count = (unsigned long)(idle_us/0x100000000ULL) + 1;
+            int n = _chain_len[b][i]++;
+            _chain_steps[b][i][n] = count;
+            _chain_dirs[b][i][n] = 0;
+            _chain_delays[b][i][n] = (unsigned long)(idle_us/count);
+            _chain_axis_us[i] += idle_us/count*count;
+        }
+
+        unsigned long step_count = record->axes[i].step_count;
+        unsigned long long step_delay = (_chain_us - _chain_axis_us[i])/step_count;
+        if(step_delay > 0xFFFFFFFFULL) {
+            step_delay = 0xFFFFFFFFULL;
+        }
+        int n = _chain_len[b][i]++;
+        _chain_steps[b][i][n] = step_count;
+        _chain_dirs[b][i][n] = record->axes[i].dir;
+        _chain_delays[b][i][n] = (unsigned long)step_delay;
+        _chain_axis_us[i] += step_delay*step_count;
+    }
+    _chain_segments[b]++;
+}
+
+/**
+ * Добавить в следующий цикл вращения сегменты перемещения из последней
+ * разобранной строки. Сегменты линий и дуг подряд, из нескольких строк,
+ * идут одним циклом (серии prepare_buffered_steps для каждой оси, не больше
+ * STEPPER_GCODE_CHAIN серий на ось), время каждого сегмента одинаковое
+ * для всех его осей; пауза - отдельный цикл.
+ * Можно вызывать, пока выполняется текущий цикл.
+ *
+ * @return true - следующий цикл заполнен (остальные сегменты строки -
+ *     после stepper_gcode_prepare_cycle)
+ *     false - перемещение из строки добавлено целиком, можно разбирать
+ *     следующую строку
+ */
+bool stepper_gcode_next_cycle() {
+    if(_gcode_cycle_dwell) {
+        return true;
+    }
+
+    int b = _chain_fill;
+    while(_gcode_pending != PENDING_NONE) {
+        if(_gcode_pending == PENDING_DWELL) {
+            // пауза - после цепочки отдельным циклом
+            if(_chain_segments[b] == 0) {
+                stepper_gcode_next_segment(&_gcode_record);
+                _gcode_cycle_dwell = true;
+            }
+            return true;
+        }
+        if(!_chain_has_room(b)) {
+            return true;
+        }
+
+        stepper_program_record record;
+        if(stepper_gcode_next_segment(&record)) {
+            _chain_add(b, &record);
+        }
+    }
+    return false;
+}
+
+/**
+ * Количество сегментов в следующем цикле (stepper_gcode_next_cycle),
+ * пауза - один сегмент.
+ */
+int stepper_gcode_cycle_segments() {
+    return _gcode_cycle_dwell ? 1 : _chain_segments[_chain_fill];
+}
+
+/**
+ * Подготовить моторы к следующему циклу (stepper_gcode_next_cycle):
+ * prepare_buffered_steps или пауза prepare_steps - дальше
+ * stepper_start_cycle. Новые сегменты после этого идут в следующий цикл.
+ *
+ * @return маска осей, которые участвуют в цикле (для паузы - ось 0),
+ *     0 - цикл не подготовлен (уже идет цикл вращения или нет сегментов)
+ */
+int stepper_gcode_prepare_cycle() {
+    if(stepper_cycle_running()) {
+        return 0;
+    }
+
+    if(_gcode_cycle_dwell) {
+        stepper_program_target(&_gcode_record, _gcode_axes, _gcode_axis_count, _gcode_target_pos);
+        if(!stepper_program_prepare(&_gcode_record, _gcode_axes, _gcode_axis_count)) {
+            return 0;
+        }
+        _gcode_cycle_dwell = false;
+        return 1;
+    }
+
+    int b = _chain_fill;
+    if(_chain_segments[b] == 0) {
+        return 0;
+    }
+    int mask = 0;
+    for(int i = 0; i < _gcode_axis_count; i++) {
+        _gcode_target_pos[i] = _gcode_axes[i]->current_pos;
+        if(_chain_len[b][i] == 0) {
+            continue;
+        }
+        for(int n = 0; n < _chain_len[b][i]; n++) {
+            _gcode_target_pos[i] += (long long)_chain_dirs[b][i][n] *
+                (long long)_chain_steps[b][i][n] * (long long)_gcode_axes[i]->distance_per_step;
+        }
+        prepare_buffered_steps(_gcode_axes[i], _chain_len[b][i],
+            _chain_steps[b][i], _chain_dirs[b][i], _chain_delays[b][i]);
+        mask |= 1 << i;
+    }
+    // буферы этой цепочки заняты до конца цикла -
+    // следующую набираем в другие
+    _chain_fill = 1 - b;
+    _chain_reset(_chain_fill);
+    return mask;
+}
+
+/**
+ * Встретилась команда конца программы (M2, M30).
+ */
+bool stepper_gcode_program_end() {
+    return _gcode_end;
+}
+
+/**
+ * Запустить выполнение G-кода из потока символов (Serial, файл на SD
+ * и т.п.) - дальше нужно вызывать stepper_gcode_handle из loop.
+ *
+ * @param axes - моторы для осей
+ * @param axis_count - количество моторов
+ * @param read_byte - функция чтения следующего символа из потока:
+ *     0..255 - символ, -1 - данных пока нет (например, Serial.read()),
+ *     STEPPER_GCODE_EOF - конец потока (например, конец файла на SD)
+ * @param source - параметр для read_byte
+ * @return true - выполнение запущено
+ *     false - уже идет цикл вращения или некорректные параметры
+ */
+bool stepper_gcode_start(stepper** axes, int axis_count,
+        int (*read_byte)(void* source), void* source) {
+    if(stepper_cycle_running() || read_byte == NULL || !stepper_gcode_init(axes, axis_count)) {
+        return false;
+    }
+
+    _gcode_read_byte = read_byte;
+    _gcode_source = source;
+    _gcode_line_len = 0;
+    _gcode_line_overflow = false;
+    _gcode_eof = false;
+    _gcode_cycle_started = false;
+    _gcode_lines = 0;
+    _gcode_status = GCODE_RUNNING;
+    return true;
+}
+
+/**
+ * Прочитать из потока доступные символы, подготовить следующий сегмент
+ * и запустить его, если текущий цикл завершился. Вызывать из loop.
+ *
+ * @return true - G-код выполняется
+ *     false - выполнение завершено (stepper_gcode_status: GCODE_FINISHED
+ *     или GCODE_ERROR) или не запускалось
+ */
+bool stepper_gcode_handle() {
+    if(_gcode_status != GCODE_RUNNING) {
+        return false;
+    }
+
+    // набираем следующий цикл, пока выполняется текущий:
+    // сегменты строк подряд - пока цикл не заполнится
+    while(!stepper_gcode_next_cycle()) {
+        if(_gcode_end || _gcode_eof || !_gcode_read_line()) {
+            break;
+        } else if(_gcode_line_overflow || !stepper_gcode_parse(_gcode_line)) {
+            stepper_gcode_cancel();
+            return false;
+        }
+    }
+
+    if(stepper_cycle_running()) {
+        return true;
+    }
+    if(_gcode_cycle_started &&
+            !stepper_program_segment_done(_gcode_axes, _gcode_axis_count, _gcode_target_pos)) {
+        _gcode_status = GCODE_ERROR;
+        return false;
+    }
+
+    if(stepper_gcode_cycle_segments() > 0) {
+        if(stepper_gcode_prepare_cycle() == 0 || !stepper_start_cycle()) {
+            stepper_gcode_cancel();
+            return false;
+        }
+        _gcode_cycle_started = true;
+    } else if(_gcode_end || _gcode_eof) {
+        _gcode_status = GCODE_FINISHED;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Состояние выполнения G-кода.
+ */
+stepper_gcode_status_t stepper_gcode_status() {
+    return _gcode_status;
+}
+
+/**
+ * Количество прочитанных строк (при ошибке в строке - ее номер).
+ */
+unsigned long stepper_gcode_lines() {
+    return _gcode_lines;
+}
+
+/**
+ * Прервать выполнение G-кода (GCODE_ERROR).
+ */
+void stepper_gcode_cancel() {
+    if(_gcode_status == GCODE_RUNNING) {
+        stepper_finish_cycle();
+        _gcode_status = GCODE_ERROR;
+    }
+}
+
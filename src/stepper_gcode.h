@@ -0,0 +1,179 @@
+/**
+ * stepper_gcode.h
+ *
+ * Интерпретатор G-кода: строки разбираются по одной в буферах
+ * фиксированного размера, перемещения переводятся в шаги моторов
+ * (нанометры, distance_per_step) и выполняются сегментами: сегменты
+ * линий и дуг подряд идут одним циклом (серии prepare_buffered_steps,
+ * до STEPPER_GCODE_CHAIN серий на ось), следующий цикл набирается,
+ * пока выполняется текущий.
+ *
+ * Команды:
+ *   G0 - перемещение с максимальной скоростью (все оси заканчивают
+ *     одновременно, скорость задает самая медленная ось)
+ *   G1 - линейное перемещение со скоростью подачи F
+ *   G2, G3 - дуга по/против часовой стрелки в плоскости XY, центр - I, J
+ *     относительно начальной точки, остальные оси - по винтовой линии;
+ *     дуга разбивается на отрезки длиной STEPPER_GCODE_ARC_SEGMENT_NM
+ *   G4 - пауза: P - миллисекунды или S - секунды
+ *   G20, G21 - единицы измерения: дюймы, миллиметры (по умолчанию)
+ *   G28 - вернуться в 0 по указанным осям (без осей - по всем) с
+ *     максимальной скоростью, поиск нуля по концевикам - stepper_homing.h
+ *   G90, G91 - абсолютные (по умолчанию) и относительные координаты
+ *   F - скорость подачи, единиц в минуту (модальная)
+ *   M2, M30 - конец программы
+ *
+ * Оси - буквы имен моторов (smotor->name, 'x' - X). Номера строк N,
+ * контрольные суммы '*', комментарии ';' и '(...)' и остальные
+ * M-команды пропускаются.
+ *
+ * Числа разбираются в целых числах (фиксированная точка, 6 знаков после
+ * запятой), число с плавающей точкой используется только для длины
+ * перемещения и для дуг.
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#ifndef STEPPER_GCODE_H
+#define STEPPER_GCODE_H
+
+#include "stepper.h"
+#include "stepper_program.h"
+
+/**
+ * read_byte (stepper_gcode_start): конец потока - последняя строка
+ * (без '\n') выполняется, дальше GCODE_FINISHED
+ */
+#define STEPPER_GCODE_EOF -2
+
+/**
+ * Состояние выполнения G-кода
+ */
+typedef enum {
+    /** Выполнение не запускалось или завершено (M2, M30, конец потока) */
+    GCODE_FINISHED,
+
+    /** G-код выполняется */
+    GCODE_RUNNING,
+
+    /**
+     * Ошибка: неизвестная команда, некорректное число, не задана
+     * скорость подачи, слишком длинная строка, ошибка цикла вращения
+     * или выполнение прервано
+     */
+    GCODE_ERROR
+} stepper_gcode_status_t;
+
+/**
+ * Подготовить интерпретатор: оси, текущее положение - current_pos
+ * моторов, миллиметры, абсолютные координаты, скорость подачи не задана.
+ *
+ * @param axes - моторы для осей
+ * @param axis_count - количество моторов (не более STEPPER_PROGRAM_MAX_AXES)
+ * @return true - интерпретатор готов
+ *     false - некорректное количество моторов
+ */
+bool stepper_gcode_init(stepper** axes, int axis_count);
+
+/**
+ * Разобрать строку G-кода. Перемещение из строки выполняется
+ * сегментами stepper_gcode_next_segment; следующую строку можно
+ * разбирать, только когда все сегменты получены.
+ *
+ * @param line - строка без символа конца строки
+ * @return true - строка разобрана
+ *     false - ошибка в строке (положение и настройки не изменились)
+ */
+bool stepper_gcode_parse(const char* line);
+
+/**
+ * Следующий сегмент перемещения из последней разобранной строки.
+ *
+ * @param record - сегмент PROGRAM_MOVE или PROGRAM_DWELL для
+ *     stepper_program_prepare
+ * @return true - сегмент готов
+ *     false - перемещение завершено (или в строке его не было)
+ */
+bool stepper_gcode_next_segment(stepper_program_record* record);
+
+/**
+ * Добавить в следующий цикл вращения сегменты перемещения из последней
+ * разобранной строки. Сегменты линий и дуг подряд, из нескольких строк,
+ * идут одним циклом (серии prepare_buffered_steps для каждой оси, не больше
+ * STEPPER_GCODE_CHAIN серий на ось), время каждого сегмента одинаковое
+ * для всех его осей; пауза - отдельный цикл.
+ * Можно вызывать, пока выполняется текущий цикл.
+ *
+ * @return true - следующий цикл заполнен (остальные сегменты строки -
+ *     после stepper_gcode_prepare_cycle)
+ *     false - перемещение из строки добавлено целиком, можно разбирать
+ *     следующую строку
+ */
+bool stepper_gcode_next_cycle();
+
+/**
+ * Количество сегментов в следующем цикле (stepper_gcode_next_cycle),
+ * пауза - один сегмент.
+ */
+int stepper_gcode_cycle_segments();
+
+/**
+ * Подготовить моторы к следующему циклу (stepper_gcode_next_cycle):
+ * prepare_buffered_steps или пауза prepare_steps - дальше
+ * stepper_start_cycle. Новые сегменты после этого идут в следующий цикл.
+ *
+ * @return маска осей, которые участвуют в цикле (для паузы - ось 0),
+ *     0 - цикл не подготовлен (уже идет цикл вращения или нет сегментов)
+ */
+int stepper_gcode_prepare_cycle();
+
+/**
+ * Встретилась команда конца программы (M2, M30).
+ */
+bool stepper_gcode_program_end();
+
+/**
+ * Запустить выполнение G-кода из потока символов (Serial, файл на SD
+ * и т.п.) - дальше нужно вызывать stepper_gcode_handle из loop.
+ *
+ * @param axes - моторы для осей
+ * @param axis_count - количество моторов
+ * @param read_byte - функция чтения следующего символа из потока:
+ *     0..255 - символ, -1 - данных пока нет (например, Serial.read()),
+ *     STEPPER_GCODE_EOF - конец потока (например, конец файла на SD)
+ * @param source - параметр для read_byte
+ * @return true - выполнение запущено
+ *     false - уже идет цикл вращения или некорректные параметры
+ */
+bool stepper_gcode_start(stepper** axes, int axis_count,
+        int (*read_byte)(void* source), void* source);
+
+/**
+ * Прочитать из потока доступные символы, подготовить следующий сегмент
+ * и запустить его, если текущий цикл завершился. Вызывать из loop.
+ *
+ * @return true - G-код выполняется
+ *     false - выполнение завершено (stepper_gcode_status: GCODE_FINISHED
+ *     или GCODE_ERROR) или не запускалось
+ */
+bool stepper_gcode_handle();
+
+/**
+ * Состояние выполнения G-кода.
+ */
+stepper_gcode_status_t stepper_gcode_status();
+
+/**
+ * Количество прочитанных строк (при ошибке в строке - ее номер).
+ */
+unsigned long stepper_gcode_lines();
+
+/**
+ * Прервать выполнение G-кода (GCODE_ERROR).
+ */
+void stepper_gcode_cancel();
+
+#endif // STEPPER_GCODE_H
+
@@ -0,0 +1,234 @@
+/**
+ * stepper_homing.cpp
+ *
+ * Поиск нуля (homing) по аппаратным концевым датчикам для нескольких
+ * моторов одновременно.
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#include "Arduino.h"
+#include "stepper_homing.h"
+
+// из stepper_lib_config.h
+#ifndef MAX_STEPPERS
+#define MAX_STEPPERS 6
+#endif
+
+// Моторы, для которых идет поиск нуля
+static stepper_homing* _homings[MAX_STEPPERS];
+static int _homing_count = 0;
+
+// Текущий этап
+static stepper_homing_phase_t _homing_phase = HOMING_IDLE;
+
+// Стратегия для аппаратных концевиков до начала поиска
+// (восстанавливается после завершения)
+static error_handle_strategy_t _homing_hard_end_handle = CANCEL_CYCLE;
+
+/**
+ * Завершить поиск нуля (HOMING_DONE или HOMING_FAILED): вернуть
+ * стратегию для аппаратных концевиков, которая была до начала поиска.
+ */
+static void _homing_finish(stepper_homing_phase_t phase) {
+    _homing_phase = phase;
+    stepper_set_error_handle_strategy(_homing_hard_end_handle, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE);
+}
+
+/**
+ * Концевой датчик, к которому движется мотор, сработал.
+ */
+static bool _homing_end_pressed(stepper_homing* homing) {
+    int pin = homing->dir < 0 ? homing->smotor->pin_min : homing->smotor->pin_max;
+    return digitalRead(pin);
+}
+
+/**
+ * Мотор остановился по концевику, к которому движется.
+ */
+static bool _homing_end_reached(stepper_homing* homing) {
+    return homing->smotor->error &
+        (homing->dir < 0 ? STEPPER_ERROR_HARD_END_MIN : STEPPER_ERROR_HARD_END_MAX);
+}
+
+/**
+ * Запустить цикл вращения для следующего этапа.
+ */
+static bool _homing_start_phase(stepper_homing_phase_t phase) {
+    for(int i = 0; i < _homing_count; i++) {
+        stepper_homing* homing = _homings[i];
+
+        // виртуальные границы не проверяем до конца поиска
+        if(phase == HOMING_FAST_APPROACH) {
+            prepare_steps(homing->smotor, homing->max_steps, homing->dir,
+                homing->fast_step_delay, CALIBRATE_START_MIN_POS);
+        } else if(phase == HOMING_BACK_OFF) {
+            prepare_steps(homing->smotor, homing->back_off_steps, -homing->dir,
+                homing->slow_step_delay, CALIBRATE_START_MIN_POS);
+        } else { // HOMING_SLOW_APPROACH
+            prepare_steps(homing->smotor, homing->back_off_steps*2, homing->dir,
+                homing->slow_step_delay, CALIBRATE_START_MIN_POS);
+        }
+    }
+
+    _homing_phase = phase;
+    if(!stepper_start_cycle()) {
+        _homing_finish(HOMING_FAILED);
+    }
+    return _homing_phase != HOMING_FAILED;
+}
+
+/**
+ * Настроить поиск нуля для мотора.
+ *
+ * @param homing - настройки поиска нуля
+ * @param smotor - мотор, концевой датчик (pin_min или pin_max)
+ *     должен быть подключен
+ * @param dir - направление движения к концевику: -1 (pin_min) или 1 (pin_max)
+ * @param fast_step_delay - задержка между шагами при быстром подходе, микросекунды
+ * @param slow_step_delay - задержка между шагами при отходе и медленном
+ *     подходе, микросекунды
+ * @param back_off_steps - количество шагов отхода от концевика
+ * @param max_steps - максимальное количество шагов при быстром подходе
+ *     (концевик не сработал - ошибка)
+ */
+void init_stepper_homing(stepper_homing* homing, stepper* smotor, int dir,
+        unsigned long fast_step_delay, unsigned long slow_step_delay,
+        unsigned long back_off_steps, unsigned long max_steps) {
+    homing->smotor = smotor;
+    homing->dir = dir;
+    homing->fast_step_delay = fast_step_delay;
+    homing->slow_step_delay = slow_step_delay;
+    homing->back_off_steps = back_off_steps;
+    homing->max_steps = max_steps;
+    homing->homed = false;
+}
+
+/**
+ * Запустить поиск нуля для нескольких моторов одновременно.
+ *
+ * Каждый этап - отдельный цикл вращения для всех моторов, мотор
+ * останавливается по своему концевику, не дожидаясь остальных.
+ * На время поиска для аппаратных концевиков включается стратегия
+ * STOP_MOTOR (stepper_set_error_handle_strategy), после завершения
+ * (HOMING_DONE, HOMING_FAILED, stepper_homing_cancel) восстанавливается
+ * прежняя.
+ *
+ * Во время поиска моторы вращаются в режиме калибровки
+ * CALIBRATE_START_MIN_POS (current_pos=min_pos, виртуальные границы
+ * не проверяются), после медленного подхода положение фиксируется:
+ * current_pos=min_pos (dir=-1) или current_pos=max_pos (dir=1).
+ *
+ * Дальше нужно вызывать stepper_homing_handle из loop.
+ *
+ * @param homings - настройки поиска нуля для моторов
+ * @param count - количество моторов (не более MAX_STEPPERS)
+ * @return true - быстрый подход запущен
+ *     false - поиск нуля не запущен (уже идет цикл вращения или
+ *     некорректные настройки)
+ */
+bool stepper_homing_start(stepper_homing** homings, int count) {
+    if(stepper_cycle_running() || count <= 0 || count > MAX_STEPPERS) {
+        return false;
+    }
+
+    for(int i = 0; i < count; i++) {
+        stepper_homing* homing = homings[i];
+        if( (homing->dir != -1 && homing->dir != 1) ||
+                (homing->dir < 0 ? homing->smotor->pin_min : homing->smotor->pin_max) == NO_PIN ||
+                homing->back_off_steps == 0 || homing->max_steps == 0 ) {
+            return false;
+        }
+    }
+
+    for(int i = 0; i < count; i++) {
+        _homings[i] = homings[i];
+        _homings[i]->homed = false;
+    }
+    _homing_count = count;
+
+    // каждый мотор останавливается по своему концевику
+    _homing_hard_end_handle = stepper_hard_end_handle();
+    stepper_set_error_handle_strategy(STOP_MOTOR, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE);
+
+    return _homing_start_phase(HOMING_FAST_APPROACH);
+}
+
+/**
+ * Перейти к следующему этапу поиска нуля, если текущий цикл завершился.
+ * Вызывать из loop.
+ *
+ * @return true - поиск нуля продолжается
+ *     false - поиск нуля завершен (stepper_homing_phase: HOMING_DONE
+ *     или HOMING_FAILED) или не запускался
+ */
+bool stepper_homing_handle() {
+    if(_homing_phase == HOMING_IDLE || _homing_phase == HOMING_DONE ||
+            _homing_phase == HOMING_FAILED) {
+        return false;
+    }
+    if(stepper_cycle_running()) {
+        return true;
+    }
+    if(stepper_cycle_error() != CYCLE_ERROR_NONE) {
+        _homing_finish(HOMING_FAILED);
+        return false;
+    }
+
+    if(_homing_phase == HOMING_FAST_APPROACH) {
+        // все моторы должны дойти до концевиков
+        for(int i = 0; i < _homing_count; i++) {
+            if(!_homing_end_reached(_homings[i])) {
+                _homing_finish(HOMING_FAILED);
+                return false;
+            }
+        }
+        return _homing_start_phase(HOMING_BACK_OFF);
+    } else if(_homing_phase == HOMING_BACK_OFF) {
+        // все концевики должны отпуститься
+        for(int i = 0; i < _homing_count; i++) {
+            if(_homing_end_pressed(_homings[i])) {
+                _homing_finish(HOMING_FAILED);
+                return false;
+            }
+        }
+        return _homing_start_phase(HOMING_SLOW_APPROACH);
+    } else { // HOMING_SLOW_APPROACH
+        for(int i = 0; i < _homing_count; i++) {
+            if(!_homing_end_reached(_homings[i])) {
+                _homing_finish(HOMING_FAILED);
+                return false;
+            }
+        }
+
+        // фиксируем положение
+        for(int i = 0; i < _homing_count; i++) {
+            stepper* smotor = _homings[i]->smotor;
+            smotor->current_pos = _homings[i]->dir < 0 ? smotor->min_pos : smotor->max_pos;
+            _homings[i]->homed = true;
+        }
+        _homing_finish(HOMING_DONE);
+        return false;
+    }
+}
+
+/**
+ * Текущий этап поиска нуля.
+ */
+stepper_homing_phase_t stepper_homing_phase() {
+    return _homing_phase;
+}
+
+/**
+ * Прервать поиск нуля (этап HOMING_FAILED).
+ */
+void stepper_homing_cancel() {
+    if(_homing_phase == HOMING_FAST_APPROACH || _homing_phase == HOMING_BACK_OFF ||
+            _homing_phase == HOMING_SLOW_APPROACH) {
+        stepper_finish_cycle();
+        _homing_finish(HOMING_FAILED);
+    }
+}
+
@@ -0,0 +1,138 @@
+/**
+ * stepper_homing.h
+ *
+ * Поиск нуля (homing) по аппаратным концевым датчикам для нескольких
+ * моторов одновременно: быстрый подход к концевику, отход назад,
+ * медленный повторный подход, фиксация положения.
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#ifndef STEPPER_HOMING_H
+#define STEPPER_HOMING_H
+
+#include "stepper.h"
+
+/**
+ * Этап поиска нуля
+ */
+typedef enum {
+    /** Поиск нуля не запускался */
+    HOMING_IDLE,
+
+    /** Быстрый подход к концевику */
+    HOMING_FAST_APPROACH,
+
+    /** Отход от концевика */
+    HOMING_BACK_OFF,
+
+    /** Медленный повторный подход к концевику */
+    HOMING_SLOW_APPROACH,
+
+    /** Поиск нуля завершен, положение всех моторов зафиксировано */
+    HOMING_DONE,
+
+    /** Поиск нуля завершен с ошибкой */
+    HOMING_FAILED
+} stepper_homing_phase_t;
+
+/**
+ * Настройки поиска нуля для одного мотора.
+ */
+typedef struct {
+    /** Мотор */
+    stepper* smotor;
+
+    /**
+     * Направление движения к концевику:
+     * -1: к концевику pin_min, после поиска current_pos=min_pos
+     * 1: к концевику pin_max, после поиска current_pos=max_pos
+     */
+    int dir;
+
+    /** Задержка между шагами при быстром подходе, микросекунды */
+    unsigned long fast_step_delay;
+
+    /** Задержка между шагами при отходе и медленном подходе, микросекунды */
+    unsigned long slow_step_delay;
+
+    /**
+     * Количество шагов отхода от концевика (медленный подход - не более
+     * чем в 2 раза больше)
+     */
+    unsigned long back_off_steps;
+
+    /** Максимальное количество шагов при быстром подходе */
+    unsigned long max_steps;
+
+    /** Положение мотора зафиксировано */
+    bool homed;
+} stepper_homing;
+
+/**
+ * Настроить поиск нуля для мотора.
+ *
+ * @param homing - настройки поиска нуля
+ * @param smotor - мотор, концевой датчик (pin_min или pin_max)
+ *     должен быть подключен
+ * @param dir - направление движения к концевику: -1 (pin_min) или 1 (pin_max)
+ * @param fast_step_delay - задержка между шагами при быстром подходе, микросекунды
+ * @param slow_step_delay - задержка между шагами при отходе и медленном
+ *     подходе, микросекунды
+ * @param back_off_steps - количество шагов отхода от концевика
+ * @param max_steps - максимальное количество шагов при быстром подходе
+ *     (концевик не сработал - ошибка)
+ */
+void init_stepper_homing(stepper_homing* homing, stepper* smotor, int dir,
+        unsigned long fast_step_delay, unsigned long slow_step_delay,
+        unsigned long back_off_steps, unsigned long max_steps);
+
+/**
+ * Запустить поиск нуля для нескольких моторов одновременно.
+ *
+ * Каждый этап - отдельный цикл вращения для всех моторов, мотор
+ * останавливается по своему концевику, не дожидаясь остальных.
+ * На время поиска для аппаратных концевиков включается стратегия
+ * STOP_MOTOR (stepper_set_error_handle_strategy), после завершения
+ * (HOMING_DONE, HOMING_FAILED, stepper_homing_cancel) восстанавливается
+ * прежняя.
+ *
+ * Во время поиска моторы вращаются в режиме калибровки
+ * CALIBRATE_START_MIN_POS (current_pos=min_pos, виртуальные границы
+ * не проверяются), после медленного подхода положение фиксируется:
+ * current_pos=min_pos (dir=-1) или current_pos=max_pos (dir=1).
+ *
+ * Дальше нужно вызывать stepper_homing_handle из loop.
+ *
+ * @param homings - настройки поиска нуля для моторов
+ * @param count - количество моторов (не более MAX_STEPPERS)
+ * @return true - быстрый подход запущен
+ *     false - поиск нуля не запущен (уже идет цикл вращения или
+ *     некорректные настройки)
+ */
+bool stepper_homing_start(stepper_homing** homings, int count);
+
+/**
+ * Перейти к следующему этапу поиска нуля, если текущий цикл завершился.
+ * Вызывать из loop.
+ *
+ * @return true - поиск нуля продолжается
+ *     false - поиск нуля завершен (stepper_homing_phase: HOMING_DONE
+ *     или HOMING_FAILED) или не запускался
+ */
+bool stepper_homing_handle();
+
+/**
+ * Текущий этап поиска нуля.
+ */
+stepper_homing_phase_t stepper_homing_phase();
+
+/**
+ * Прервать поиск нуля (этап HOMING_FAILED).
+ */
+void stepper_homing_cancel();
+
+#endif // STEPPER_HOMING_H
+
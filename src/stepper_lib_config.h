@@ -6,7 +6,95 @@
 
 // максимальное количество шаговых моторов
 // maximun number of stepper motors
+#ifndef MAX_STEPPERS
 #define MAX_STEPPERS 6
+#endif
+
+// планировщик шагов на колесе времени: обработчик таймера на каждом
+// импульсе трогает только моторы, у которых на этом импульсе проверка
+// границ, HIGH или шаг (для большого количества моторов, MAX_STEPPERS до 32)
+// timing wheel step scheduler: per tick cost does not depend on motor count
+// (for large motor counts, MAX_STEPPERS up to 32)
+//#define STEPPER_TIMING_WHEEL
+
+// концевые датчики на прерываниях: обработчик таймера не читает ножки
+// концевиков перед каждым шагом, а проверяет флаги, которые выставляет
+// обработчик изменения уровня (stepper_endstops_changed), MAX_STEPPERS до 32
+// endstops on pin interrupts: timer handler tests latched flags set by
+// pin change handler (stepper_endstops_changed) instead of reading
+// endstop pins before every step, MAX_STEPPERS up to 32
+//#define STEPPER_ENDSTOP_INTERRUPTS
+
+// опрос концевиков без прерываний: обработчик таймера читает ножки
+// концевиков один раз за импульс (целыми портами, если есть
+// portInputRegister), уровень концевика меняется после
+// STEPPER_ENDSTOP_DEBOUNCE одинаковых чтений подряд (фильтр помех),
+// MAX_STEPPERS до 32
+// endstops polling without interrupts: timer handler samples endstops
+// once per tick (as whole port reads when portInputRegister is available),
+// endstop level changes after STEPPER_ENDSTOP_DEBOUNCE equal samples
+// in a row (noise filter), MAX_STEPPERS up to 32
+//#define STEPPER_ENDSTOP_DEBOUNCE 3
+
+// отложенные вычисления: обработчик таймера только выдает шаги,
+// данные для следующего шага (переход на новую серию, next_step_delay,
+// проверка задержки) готовит stepper_handle_deferred вне прерывания
+// таймера (из loop или программного прерывания с низким приоритетом,
+// см. stepper_deferred_request); не совместимо с STEPPER_TIMING_WHEEL
+// deferred step data: timer handler only emits step edges, next step
+// data (series switch, next_step_delay, step delay checks) is computed
+// by stepper_handle_deferred outside of the timer interrupt (from loop
+// or low-priority software interrupt, see stepper_deferred_request);
+// not compatible with STEPPER_TIMING_WHEEL
+//#define STEPPER_DEFERRED_STEPS
+
+// размер колеса времени (импульсов таймера)
+// timing wheel size (timer ticks)
+#define STEPPER_TIMING_WHEEL_SIZE 32
+
+// поправка скорости (stepper_set_speed_override): наибольшее значение
+// (проценты) и время изменения на 1% (микросекунды)
+// speed override (stepper_set_speed_override): max value (percent)
+// and time to change it by 1% (us)
+#define STEPPER_SPEED_OVERRIDE_MAX 400
+#define STEPPER_SPEED_OVERRIDE_RAMP_US 1000
+
+// плавная остановка (stepper_hold_cycle): время замедления
+// по умолчанию (микросекунды) и скорость, на которой цикл встает
+// на паузу (проценты от запланированной)
+// feed hold (stepper_hold_cycle): default deceleration time (us)
+// and speed to pause at (percent of planned speed)
+#define STEPPER_HOLD_DECEL_US 200000
+#define STEPPER_HOLD_MIN_PERCENT 10
+
+// размер очереди событий цикла (stepper_handle_events), не больше 255
+// cycle event queue size (stepper_handle_events), max 255
+#define STEPPER_EVENT_QUEUE_SIZE 16
+
+// адаптивный период таймера (stepper_set_timer_period_adaptive):
+// период увеличивается не больше, чем в 2^STEPPER_TIMER_ADAPTIVE_MAX_SHIFT раз
+// adaptive timer period: max period is base period*2^STEPPER_TIMER_ADAPTIVE_MAX_SHIFT
+#define STEPPER_TIMER_ADAPTIVE_MAX_SHIFT 4
+
+// G-код (stepper_gcode.h): максимальная длина строки (символов),
+// длина хорды при разбиении дуг G2/G3 на отрезки (нанометры)
+// и количество серий на ось в одном цикле вращения - сегменты линий
+// и дуг подряд (буферы серий на 2 цикла для каждой оси:
+// 2*STEPPER_GCODE_CHAIN*STEPPER_PROGRAM_MAX_AXES)
+// G-code (stepper_gcode.h): max line length (chars),
+// chord length for G2/G3 arc segmentation (nanometers)
+// and series per axis in one motion cycle - consecutive line and arc
+// segments (series buffers for 2 cycles per axis:
+// 2*STEPPER_GCODE_CHAIN*STEPPER_PROGRAM_MAX_AXES)
+#define STEPPER_GCODE_LINE_MAX 96
+#define STEPPER_GCODE_ARC_SEGMENT_NM 200000
+#define STEPPER_GCODE_CHAIN 32
+
+// протокол связи с хостом (stepper_link.h): размер очереди сегментов
+// (кредиты для хоста), не больше 255
+// host link protocol (stepper_link.h): segment queue size
+// (credits for the host), max 255
+#define STEPPER_LINK_QUEUE_SIZE 4
 
 // включить отладку через последовательный порт
 // enable serial port debug messages
@@ -60,6 +148,18 @@
 #define STEPPER_TIMER_DEFAULT_PERIOD_US 20
 
 //#endif // __PIC32__
+#elif defined( STEPPER_LINUX )
+// Linux (src/linux): виртуальная частота 1ГГц
+
+// для периода 20 микросекунд (50тыс вызовов в секунду == 50КГц)
+// to set timer clock period to 20us (50000 operations per second == 50KHz)
+// on 1GHz virtual CPU use prescaler 1:1 (TIMER_PRESCALER_1_1)
+// and adjustment=20000-1, minus 1 cause count from zero.
+#define STEPPER_TIMER_DEFAULT_PRESCALER TIMER_PRESCALER_1_1
+#define STEPPER_TIMER_DEFAULT_ADJUSTMENT 20000-1
+#define STEPPER_TIMER_DEFAULT_PERIOD_US 20
+
+//#endif // STEPPER_LINUX
 #else // unknown arch (most likely in test mode)
 
 // test mode: put some values looking like true
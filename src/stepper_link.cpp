@@ -0,0 +1,403 @@
+/**
+ * stepper_link.cpp
+ *
+ * Двоичный протокол связи с хостом: кадры, CRC, очередь сегментов
+ * и управление потоком по кредитам.
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#include "Arduino.h"
+#include "stepper_link.h"
+
+// из stepper_lib_config.h
+#ifndef STEPPER_LINK_QUEUE_SIZE
+#define STEPPER_LINK_QUEUE_SIZE 4
+#endif
+
+// Части кадра, которые читает разборщик
+#define PARSE_SYNC 0
+#define PARSE_TYPE 1
+#define PARSE_SEQ 2
+#define PARSE_LEN 3
+#define PARSE_PAYLOAD 4
+#define PARSE_CRC_LOW 5
+#define PARSE_CRC_HIGH 6
+
+// Моторы для осей программы
+static stepper* _link_axes[STEPPER_PROGRAM_MAX_AXES];
+static int _link_axis_count = 0;
+
+// Канал связи с хостом
+static int (*_link_read_byte)(void* source) = NULL;
+static void (*_link_write_byte)(unsigned char b, void* source) = NULL;
+static void* _link_source = NULL;
+
+static stepper_link_parser _link_parser;
+
+// Декодер записей программы из кадров LINK_SEGMENT
+static stepper_program_decoder _link_decoder;
+
+// Очередь сегментов (кольцевой буфер)
+static stepper_program_record _link_queue[STEPPER_LINK_QUEUE_SIZE];
+static int _link_queue_head = 0;
+static int _link_queue_count = 0;
+
+// Положение осей после текущего сегмента
+static long long _link_target_pos[STEPPER_PROGRAM_MAX_AXES];
+
+// Номер следующего ожидаемого кадра
+static unsigned char _link_expected_seq = 0;
+
+// Получен конец программы
+static bool _link_end = false;
+// Передача идет
+static bool _link_running = false;
+
+static stepper_link_status_t _link_status = LINK_FINISHED;
+static stepper_link_stats_t _link_stats;
+
+/**
+ * CRC-16/CCITT (полином 0x1021, начальное значение 0xFFFF).
+ *
+ * @param crc - CRC предыдущих байт (0xFFFF - для первого байта)
+ * @param b - следующий байт
+ * @return CRC с учетом байта b
+ */
+unsigned int stepper_link_crc16(unsigned int crc, unsigned char b) {
+    crc ^= (unsigned int)b << 8;
+    for(int i = 0; i < 8; i++) {
+        crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc & 0xFFFF;
+}
+
+/**
+ * Записать кадр.
+ *
+ * @param buf - буфер не меньше STEPPER_LINK_FRAME_MAX байт
+ * @param type - тип кадра
+ * @param seq - номер кадра
+ * @param payload - данные
+ * @param len - размер данных, не больше STEPPER_LINK_PAYLOAD_MAX
+ * @return количество записанных байт, 0 - слишком много данных
+ */
+int stepper_link_write_frame(unsigned char* buf, unsigned char type, unsigned char seq,
+        const unsigned char* payload, int len) {
+    if(len < 0 || len > STEPPER_LINK_PAYLOAD_MAX) {
+        return 0;
+    }
+
+    int size = 0;
+    buf[size++] = STEPPER_LINK_SYNC;
+    buf[size++] = type;
+    buf[size++] = seq;
+    buf[size++] = len;
+    for(int i = 0; i < len; i++) {
+        buf[size++] = payload[i];
+    }
+
+    unsigned int crc = 0xFFFF;
+    for(int i = 1; i < size; i++) {
+        crc = stepper_link_crc16(crc, buf[i]);
+    }
+    buf[size++] = crc & 0xFF;
+    buf[size++] = (crc >> 8) & 0xFF;
+    return size;
+}
+
+/**
+ * Подготовить разборщик к чтению кадров (ищет начало кадра).
+ */
+void stepper_link_parser_init(stepper_link_parser* parser) {
+    parser->state = PARSE_SYNC;
+    parser->pos = 0;
+    parser->crc = 0xFFFF;
+    parser->frame_crc = 0;
+}
+
+/**
+ * Передать разборщику очередной байт.
+ *
+ * @return LINK_PARSE_FRAME - кадр готов (parser->frame), следующий байт
+ *     ищет начало нового кадра
+ */
+stepper_link_parse_status_t stepper_link_parse(stepper_link_parser* parser, unsigned char b) {
+    switch(parser->state) {
+        case PARSE_SYNC:
+            // байты между кадрами пропускаем
+            if(b == STEPPER_LINK_SYNC) {
+                parser->crc = 0xFFFF;
+                parser->pos = 0;
+                parser->state = PARSE_TYPE;
+            }
+            return LINK_PARSE_MORE;
+        case PARSE_TYPE:
+            parser->frame.type = b;
+            parser->crc = stepper_link_crc16(parser->crc, b);
+            parser->state = PARSE_SEQ;
+            return LINK_PARSE_MORE;
+        case PARSE_SEQ:
+            parser->frame.seq = b;
+            parser->crc = stepper_link_crc16(parser->crc, b);
+            parser->state = PARSE_LEN;
+            return LINK_PARSE_MORE;
+        case PARSE_LEN:
+            if(b > STEPPER_LINK_PAYLOAD_MAX) {
+                parser->state = PARSE_SYNC;
+                return LINK_PARSE_BAD;
+            }
+            parser->frame.len = b;
+            parser->crc = stepper_link_crc16(parser->crc, b);
+            parser->state = b > 0 ? PARSE_PAYLOAD : PARSE_CRC_LOW;
+            return LINK_PARSE_MORE;
+        case PARSE_PAYLOAD:
+            parser->frame.payload[parser->pos++] = b;
+            parser->crc = stepper_link_crc16(parser->crc, b);
+            if(parser->pos == parser->frame.len) {
+                parser->state = PARSE_CRC_LOW;
+            }
+            return LINK_PARSE_MORE;
+        case PARSE_CRC_LOW:
+            parser->frame_crc = b;
+            parser->state = PARSE_CRC_HIGH;
+            return LINK_PARSE_MORE;
+        default:
+            // PARSE_CRC_HIGH
+            parser->frame_crc |= (unsigned int)b << 8;
+            parser->state = PARSE_SYNC;
+            return parser->frame_crc == parser->crc ? LINK_PARSE_FRAME : LINK_PARSE_BAD;
+    }
+}
+
+/**
+ * Отправить хосту ответ с кредитами.
+ */
+static void _link_reply(unsigned char type, unsigned char seq) {
+    unsigned char credits = stepper_link_credits();
+    unsigned char buf[4 + 1 + 2];
+    int size = stepper_link_write_frame(buf, type, seq, &credits, 1);
+    for(int i = 0; i < size; i++) {
+        _link_write_byte(buf[i], _link_source);
+    }
+}
+
+/**
+ * Разобрать запись программы из данных кадра.
+ *
+ * @return true - запись разобрана (в том числе PROGRAM_END)
+ *     false - некорректная запись
+ */
+static bool _link_decode_record(const stepper_link_frame* frame, stepper_program_record* record) {
+    // декодер программы читает записи после заголовка
+    unsigned char header[STEPPER_PROGRAM_HEADER_SIZE];
+    int header_size = stepper_program_write_header(header, _link_axis_count);
+    stepper_program_decoder_init(&_link_decoder);
+    for(int i = 0; i < header_size; i++) {
+        stepper_program_decode(&_link_decoder, header[i]);
+    }
+
+    stepper_program_status_t status = PROGRAM_NEED_MORE;
+    for(int i = 0; i < frame->len; i++) {
+        if(status != PROGRAM_NEED_MORE) {
+            // лишние байты после записи
+            return false;
+        }
+        status = stepper_program_decode(&_link_decoder, frame->payload[i]);
+    }
+    if(status == PROGRAM_RECORD) {
+        *record = _link_decoder.record;
+        return true;
+    } else if(status == PROGRAM_FINISHED) {
+        record->type = PROGRAM_END;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Принять кадр LINK_SEGMENT.
+ */
+static void _link_handle_segment(const stepper_link_frame* frame) {
+    if(frame->seq != _link_expected_seq) {
+        _link_stats.seq_errors++;
+        if((unsigned char)(_link_expected_seq - frame->seq) <= 128) {
+            // повтор уже принятого кадра: ответ потерялся
+            _link_reply(LINK_ACK, _link_expected_seq - 1);
+        } else {
+            // пропущен кадр
+            _link_reply(LINK_NAK, _link_expected_seq);
+        }
+        return;
+    }
+
+    if(_link_queue_count == STEPPER_LINK_QUEUE_SIZE) {
+        // хост не дождался кредитов
+        _link_stats.overflows++;
+        _link_reply(LINK_NAK, _link_expected_seq);
+        return;
+    }
+
+    stepper_program_record* record =
+        &_link_queue[(_link_queue_head + _link_queue_count) % STEPPER_LINK_QUEUE_SIZE];
+    if(!_link_decode_record(frame, record)) {
+        // CRC верна, запись нет - повтор не поможет
+        stepper_link_cancel();
+        return;
+    }
+
+    if(record->type == PROGRAM_END) {
+        _link_end = true;
+    } else if(!_link_end) {
+        _link_queue_count++;
+    }
+    _link_expected_seq++;
+    _link_stats.frames++;
+    _link_reply(LINK_ACK, frame->seq);
+}
+
+/**
+ * Запустить прием сегментов от хоста (устройство): кадры LINK_SEGMENT
+ * складываются в очередь (STEPPER_LINK_QUEUE_SIZE сегментов), сегменты
+ * выполняются по очереди отдельными циклами вращения.
+ *
+ * Дальше нужно вызывать stepper_link_handle из loop.
+ *
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param read_byte - функция чтения следующего байта от хоста:
+ *     0..255 - байт, -1 - данных пока нет (например, Serial.read())
+ * @param write_byte - функция отправки байта хосту (например, Serial.write())
+ * @param source - параметр для read_byte и write_byte
+ * @return true - прием запущен
+ *     false - уже идет цикл вращения или некорректные параметры
+ */
+bool stepper_link_start(stepper** axes, int axis_count,
+        int (*read_byte)(void* source), void (*write_byte)(unsigned char b, void* source),
+        void* source) {
+    if(stepper_cycle_running() || axis_count < 1 || axis_count > STEPPER_PROGRAM_MAX_AXES ||
+            read_byte == NULL || write_byte == NULL) {
+        return false;
+    }
+
+    for(int i = 0; i < axis_count; i++) {
+        _link_axes[i] = axes[i];
+    }
+    _link_axis_count = axis_count;
+    _link_read_byte = read_byte;
+    _link_write_byte = write_byte;
+    _link_source = source;
+
+    stepper_link_parser_init(&_link_parser);
+    _link_queue_head = 0;
+    _link_queue_count = 0;
+    _link_expected_seq = 0;
+    _link_end = false;
+    _link_stats.frames = 0;
+    _link_stats.bad_frames = 0;
+    _link_stats.seq_errors = 0;
+    _link_stats.overflows = 0;
+    _link_stats.segments = 0;
+    _link_status = LINK_RUNNING;
+    _link_running = true;
+    return true;
+}
+
+/**
+ * Прочитать доступные кадры, ответить хосту и запустить следующий
+ * сегмент из очереди, если текущий цикл завершился. Вызывать из loop.
+ *
+ * @return true - передача идет
+ *     false - передача завершена (stepper_link_status: LINK_FINISHED
+ *     или LINK_ERROR) или не запускалась
+ */
+bool stepper_link_handle() {
+    if(!_link_running) {
+        return false;
+    }
+
+    // принимаем кадры, пока выполняется текущий сегмент
+    int b;
+    while(_link_running && (b = _link_read_byte(_link_source)) >= 0) {
+        stepper_link_parse_status_t status = stepper_link_parse(&_link_parser, b);
+        if(status == LINK_PARSE_BAD) {
+            _link_stats.bad_frames++;
+            _link_reply(LINK_NAK, _link_expected_seq);
+        } else if(status == LINK_PARSE_FRAME) {
+            if(_link_parser.frame.type == LINK_SEGMENT) {
+                _link_handle_segment(&_link_parser.frame);
+            } else if(_link_parser.frame.type == LINK_SYNC) {
+                _link_reply(LINK_ACK, _link_expected_seq - 1);
+            }
+        }
+    }
+    if(!_link_running) {
+        return false;
+    }
+
+    if(stepper_cycle_running()) {
+        return true;
+    }
+    if(_link_stats.segments > 0 &&
+            !stepper_program_segment_done(_link_axes, _link_axis_count, _link_target_pos)) {
+        _link_status = LINK_ERROR;
+        _link_running = false;
+        return false;
+    }
+
+    if(_link_queue_count > 0) {
+        stepper_program_record* record = &_link_queue[_link_queue_head];
+        stepper_program_target(record, _link_axes, _link_axis_count, _link_target_pos);
+        if(!stepper_program_prepare(record, _link_axes, _link_axis_count) ||
+                !stepper_start_cycle()) {
+            stepper_link_cancel();
+            return false;
+        }
+        _link_queue_head = (_link_queue_head + 1) % STEPPER_LINK_QUEUE_SIZE;
+        _link_queue_count--;
+        _link_stats.segments++;
+
+        // освободилось место в очереди - новые кредиты
+        _link_reply(LINK_ACK, _link_expected_seq - 1);
+    } else if(_link_end) {
+        _link_status = LINK_FINISHED;
+        _link_running = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Состояние передачи.
+ */
+stepper_link_status_t stepper_link_status() {
+    return _link_status;
+}
+
+/**
+ * Кредиты: свободные места в очереди сегментов.
+ */
+int stepper_link_credits() {
+    return _link_end ? 0 : STEPPER_LINK_QUEUE_SIZE - _link_queue_count;
+}
+
+/**
+ * Счетчики передачи.
+ */
+void stepper_link_stats(stepper_link_stats_t* stats) {
+    *stats = _link_stats;
+}
+
+/**
+ * Прервать передачу (LINK_ERROR).
+ */
+void stepper_link_cancel() {
+    if(_link_running) {
+        stepper_finish_cycle();
+        _link_status = LINK_ERROR;
+        _link_running = false;
+    }
+}
+
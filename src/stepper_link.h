@@ -0,0 +1,250 @@
+/**
+ * stepper_link.h
+ *
+ * Двоичный протокол связи с хостом для потоковой передачи сегментов
+ * программы движения (stepper_program.h): кадры с номерами, CRC
+ * и управлением потоком по кредитам - хост отправляет столько сегментов,
+ * сколько свободных мест в очереди сегментов на устройстве, и держит
+ * очередь заполненной, не дожидаясь ответа на каждый кадр.
+ *
+ * Кадр, все числа - little-endian:
+ *   STEPPER_LINK_SYNC (1 байт) - начало кадра
+ *   type (1 байт) - тип кадра (stepper_link_frame_type_t)
+ *   seq (1 байт) - номер кадра
+ *   len (1 байт) - размер данных, не больше STEPPER_LINK_PAYLOAD_MAX
+ *   payload (len байт) - данные
+ *   crc (2 байта) - CRC-16/CCITT (полином 0x1021, начальное значение
+ *     0xFFFF) от type, seq, len и payload
+ *
+ * Хост -> устройство:
+ *   LINK_SEGMENT - запись программы (stepper_program_write_record),
+ *     номера кадров идут подряд (после 255 - 0)
+ *   LINK_SYNC - запрос состояния (без данных)
+ * Устройство -> хост, payload - 1 байт: кредиты (свободные места в очереди):
+ *   LINK_ACK - seq - номер последнего принятого кадра, все кадры до него
+ *     включительно приняты; отправляется на каждый кадр LINK_SEGMENT
+ *     и LINK_SYNC и когда освобождается место в очереди
+ *   LINK_NAK - seq - номер кадра, который ожидает устройство: кадр
+ *     испорчен (CRC), пришел не по порядку или очередь переполнена -
+ *     хост повторяет кадры, начиная с seq
+ *
+ * Хост может отправлять кадры с номерами до (последний принятый +
+ * кредиты). Повторно полученный кадр (ответ LINK_ACK потерялся)
+ * подтверждается еще раз и в очередь не попадает. Таймауты и повтор
+ * кадров, на которые не пришел ответ, - на стороне хоста.
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#ifndef STEPPER_LINK_H
+#define STEPPER_LINK_H
+
+#include "stepper.h"
+#include "stepper_program.h"
+
+/** Начало кадра */
+#define STEPPER_LINK_SYNC 0xA5
+
+/** Максимальный размер данных кадра, байт */
+#define STEPPER_LINK_PAYLOAD_MAX STEPPER_PROGRAM_RECORD_MAX
+
+/** Максимальный размер кадра, байт */
+#define STEPPER_LINK_FRAME_MAX (4 + STEPPER_LINK_PAYLOAD_MAX + 2)
+
+/**
+ * Тип кадра
+ */
+typedef enum {
+    /** Хост -> устройство: запись программы движения */
+    LINK_SEGMENT = 0x01,
+
+    /** Хост -> устройство: запрос состояния */
+    LINK_SYNC = 0x02,
+
+    /** Устройство -> хост: кадры до seq включительно приняты */
+    LINK_ACK = 0x81,
+
+    /** Устройство -> хост: повторить кадры, начиная с seq */
+    LINK_NAK = 0x82
+} stepper_link_frame_type_t;
+
+/**
+ * Кадр
+ */
+typedef struct {
+    /** Тип кадра (stepper_link_frame_type_t) */
+    unsigned char type;
+
+    /** Номер кадра */
+    unsigned char seq;
+
+    /** Размер данных */
+    unsigned char len;
+
+    /** Данные */
+    unsigned char payload[STEPPER_LINK_PAYLOAD_MAX];
+} stepper_link_frame;
+
+/**
+ * Результат разбора очередного байта
+ */
+typedef enum {
+    /** Кадр еще не готов, нужны следующие байты */
+    LINK_PARSE_MORE,
+
+    /** Кадр готов (stepper_link_parser.frame) */
+    LINK_PARSE_FRAME,
+
+    /**
+     * Кадр испорчен (CRC или размер данных), разбор продолжается
+     * со следующего начала кадра
+     */
+    LINK_PARSE_BAD
+} stepper_link_parse_status_t;
+
+/**
+ * Потоковый разборщик кадров, память не выделяется.
+ */
+typedef struct {
+    /** Текущая часть кадра */
+    unsigned char state;
+
+    /** Прочитано байт данных */
+    unsigned char pos;
+
+    /** CRC прочитанной части кадра и принятое значение */
+    unsigned int crc;
+    unsigned int frame_crc;
+
+    /** Текущий кадр (готов после LINK_PARSE_FRAME) */
+    stepper_link_frame frame;
+} stepper_link_parser;
+
+/**
+ * Состояние передачи
+ */
+typedef enum {
+    /** Передача не запускалась или завершена (PROGRAM_END выполнен) */
+    LINK_FINISHED,
+
+    /** Передача идет */
+    LINK_RUNNING,
+
+    /**
+     * Ошибка: некорректная запись программы в кадре, ошибка цикла вращения
+     * или передача прервана (CYCLE_ERROR_HANDLER_TIMING_EXCEEDED - не ошибка,
+     * если оси дошли до конца сегмента: пропущенные импульсы догнали,
+     * cycle_timing_exceed_handle=FIX)
+     */
+    LINK_ERROR
+} stepper_link_status_t;
+
+/**
+ * Счетчики передачи
+ */
+typedef struct {
+    /** Принято кадров LINK_SEGMENT (без повторов) */
+    unsigned long frames;
+
+    /** Испорченных кадров */
+    unsigned long bad_frames;
+
+    /** Кадров не по порядку и повторов */
+    unsigned long seq_errors;
+
+    /** Кадров сверх кредитов (очередь была полна) */
+    unsigned long overflows;
+
+    /** Запущено сегментов */
+    unsigned long segments;
+} stepper_link_stats_t;
+
+/**
+ * CRC-16/CCITT (полином 0x1021, начальное значение 0xFFFF).
+ *
+ * @param crc - CRC предыдущих байт (0xFFFF - для первого байта)
+ * @param b - следующий байт
+ * @return CRC с учетом байта b
+ */
+unsigned int stepper_link_crc16(unsigned int crc, unsigned char b);
+
+/**
+ * Записать кадр.
+ *
+ * @param buf - буфер не меньше STEPPER_LINK_FRAME_MAX байт
+ * @param type - тип кадра
+ * @param seq - номер кадра
+ * @param payload - данные
+ * @param len - размер данных, не больше STEPPER_LINK_PAYLOAD_MAX
+ * @return количество записанных байт, 0 - слишком много данных
+ */
+int stepper_link_write_frame(unsigned char* buf, unsigned char type, unsigned char seq,
+        const unsigned char* payload, int len);
+
+/**
+ * Подготовить разборщик к чтению кадров (ищет начало кадра).
+ */
+void stepper_link_parser_init(stepper_link_parser* parser);
+
+/**
+ * Передать разборщику очередной байт.
+ *
+ * @return LINK_PARSE_FRAME - кадр готов (parser->frame), следующий байт
+ *     ищет начало нового кадра
+ */
+stepper_link_parse_status_t stepper_link_parse(stepper_link_parser* parser, unsigned char b);
+
+/**
+ * Запустить прием сегментов от хоста (устройство): кадры LINK_SEGMENT
+ * складываются в очередь (STEPPER_LINK_QUEUE_SIZE сегментов), сегменты
+ * выполняются по очереди отдельными циклами вращения.
+ *
+ * Дальше нужно вызывать stepper_link_handle из loop.
+ *
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param read_byte - функция чтения следующего байта от хоста:
+ *     0..255 - байт, -1 - данных пока нет (например, Serial.read())
+ * @param write_byte - функция отправки байта хосту (например, Serial.write())
+ * @param source - параметр для read_byte и write_byte
+ * @return true - прием запущен
+ *     false - уже идет цикл вращения или некорректные параметры
+ */
+bool stepper_link_start(stepper** axes, int axis_count,
+        int (*read_byte)(void* source), void (*write_byte)(unsigned char b, void* source),
+        void* source);
+
+/**
+ * Прочитать доступные кадры, ответить хосту и запустить следующий
+ * сегмент из очереди, если текущий цикл завершился. Вызывать из loop.
+ *
+ * @return true - передача идет
+ *     false - передача завершена (stepper_link_status: LINK_FINISHED
+ *     или LINK_ERROR) или не запускалась
+ */
+bool stepper_link_handle();
+
+/**
+ * Состояние передачи.
+ */
+stepper_link_status_t stepper_link_status();
+
+/**
+ * Кредиты: свободные места в очереди сегментов.
+ */
+int stepper_link_credits();
+
+/**
+ * Счетчики передачи.
+ */
+void stepper_link_stats(stepper_link_stats_t* stats);
+
+/**
+ * Прервать передачу (LINK_ERROR).
+ */
+void stepper_link_cancel();
+
+#endif // STEPPER_LINK_H
+
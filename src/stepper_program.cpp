@@ -0,0 +1,494 @@
+/**
+ * stepper_program.cpp
+ *
+ * Программа движения в компактном двоичном формате: запись, потоковое
+ * чтение и выполнение.
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#include "Arduino.h"
+#include "stepper_program.h"
+
+// Части записи, которые читает декодер
+#define DECODE_HEADER 0
+#define DECODE_RECORD 1
+#define DECODE_AXIS 2
+#define DECODE_DWELL 3
+#define DECODE_DONE 4
+
+// Размер данных оси в записи, байт
+#define AXIS_MOVE_SIZE 9
+#define AXIS_ACCEL_SIZE 17
+
+// Моторы для осей программы
+static stepper* _program_axes[STEPPER_PROGRAM_MAX_AXES];
+static int _program_axis_count = 0;
+
+// Источник байт программы
+static int (*_program_read_byte)(void* source) = NULL;
+static void* _program_source = NULL;
+
+static stepper_program_decoder _program_decoder;
+
+// Следующий сегмент прочитан и ждет завершения текущего цикла
+static bool _program_record_ready = false;
+// Прочитан конец программы
+static bool _program_end = false;
+// Программа выполняется
+static bool _program_running = false;
+
+static stepper_program_status_t _program_status = PROGRAM_FINISHED;
+static unsigned long _program_segments = 0;
+// Положение осей после текущего сегмента
+static long long _program_target_pos[STEPPER_PROGRAM_MAX_AXES];
+
+// Разгон и торможение осей в текущем сегменте PROGRAM_ACCEL
+// (curve_context для prepare_dynamic_steps)
+static stepper_program_axis _program_ramps[STEPPER_PROGRAM_MAX_AXES];
+
+static void _write_u32(unsigned char* buf, unsigned long val) {
+    buf[0] = val & 0xFF;
+    buf[1] = (val >> 8) & 0xFF;
+    buf[2] = (val >> 16) & 0xFF;
+    buf[3] = (val >> 24) & 0xFF;
+}
+
+static unsigned long _read_u32(const unsigned char* buf) {
+    return (unsigned long)buf[0] | ((unsigned long)buf[1] << 8) |
+        ((unsigned long)buf[2] << 16) | ((unsigned long)buf[3] << 24);
+}
+
+/**
+ * Задержка перед шагом curr_step сегмента PROGRAM_ACCEL: скорость
+ * (1/задержка) меняется линейно от 1/start_delay до 1/step_delay
+ * на первых ramp_steps шагах и обратно на последних.
+ */
+static unsigned long _program_ramp_delay(unsigned long curr_step, void* curve_context) {
+    stepper_program_axis* ramp = (stepper_program_axis*)curve_context;
+
+    // шагов до ближайшего края сегмента
+    unsigned long k = ramp->step_count - 1 - curr_step;
+    if(curr_step < k) {
+        k = curr_step;
+    }
+    if(k >= ramp->ramp_steps) {
+        return ramp->step_delay;
+    }
+
+    // d0*d1*n / (d1*(n-k) + d0*k)
+    unsigned long long d0 = ramp->start_delay;
+    unsigned long long d1 = ramp->step_delay;
+    return d0*d1*ramp->ramp_steps / (d1*(ramp->ramp_steps - k) + d0*k);
+}
+
+/**
+ * Количество байт, которые нужно прочитать для следующей части записи
+ * (следующая ось из axis_mask, пауза или конец записи - 0).
+ */
+static unsigned char _decode_next_part(stepper_program_decoder* decoder) {
+    stepper_program_record* record = &decoder->record;
+    if(record->type == PROGRAM_MOVE || record->type == PROGRAM_ACCEL) {
+        while(decoder->axis < STEPPER_PROGRAM_MAX_AXES && !(record->axis_mask & (1 << decoder->axis))) {
+            decoder->axis++;
+        }
+        if(decoder->axis < STEPPER_PROGRAM_MAX_AXES) {
+            decoder->state = DECODE_AXIS;
+            return record->type == PROGRAM_MOVE ? AXIS_MOVE_SIZE : AXIS_ACCEL_SIZE;
+        }
+    } else if(record->type == PROGRAM_DWELL && decoder->state == DECODE_RECORD) {
+        decoder->state = DECODE_DWELL;
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * Записать заголовок программы.
+ *
+ * @param buf - буфер не меньше STEPPER_PROGRAM_HEADER_SIZE байт
+ * @param axis_count - количество осей, 1..STEPPER_PROGRAM_MAX_AXES
+ * @return количество записанных байт, 0 - некорректное количество осей
+ */
+int stepper_program_write_header(unsigned char* buf, int axis_count) {
+    if(axis_count < 1 || axis_count > STEPPER_PROGRAM_MAX_AXES) {
+        return 0;
+    }
+    buf[0] = 'S';
+    buf[1] = 'P';
+    buf[2] = 'R';
+    buf[3] = 'G';
+    buf[4] = STEPPER_PROGRAM_VERSION;
+    buf[5] = axis_count;
+    buf[6] = 0;
+    buf[7] = 0;
+    return STEPPER_PROGRAM_HEADER_SIZE;
+}
+
+/**
+ * Записать запись программы.
+ *
+ * @param buf - буфер не меньше STEPPER_PROGRAM_RECORD_MAX байт
+ * @param record - запись
+ * @return количество записанных байт
+ */
+int stepper_program_write_record(unsigned char* buf, const stepper_program_record* record) {
+    int size = 0;
+    buf[size++] = record->type;
+
+    if(record->type == PROGRAM_MOVE || record->type == PROGRAM_ACCEL) {
+        buf[size++] = record->axis_mask;
+        for(int i = 0; i < STEPPER_PROGRAM_MAX_AXES; i++) {
+            if(!(record->axis_mask & (1 << i))) {
+                continue;
+            }
+            const stepper_program_axis* axis = &record->axes[i];
+            _write_u32(buf + size, axis->step_count);
+            buf[size + 4] = (unsigned char)(signed char)axis->dir;
+            if(record->type == PROGRAM_MOVE) {
+                _write_u32(buf + size + 5, axis->step_delay);
+                size += AXIS_MOVE_SIZE;
+            } else {
+                _write_u32(buf + size + 5, axis->start_delay);
+                _write_u32(buf + size + 9, axis->step_delay);
+                _write_u32(buf + size + 13, axis->ramp_steps);
+                size += AXIS_ACCEL_SIZE;
+            }
+        }
+    } else if(record->type == PROGRAM_DWELL) {
+        buf[size++] = 0;
+        _write_u32(buf + size, record->dwell_us);
+        size += 4;
+    } else {
+        buf[size++] = 0;
+    }
+    return size;
+}
+
+/**
+ * Подготовить декодер к чтению новой программы (с заголовка).
+ */
+void stepper_program_decoder_init(stepper_program_decoder* decoder) {
+    decoder->state = DECODE_HEADER;
+    decoder->pos = 0;
+    decoder->need = STEPPER_PROGRAM_HEADER_SIZE;
+    decoder->axis = 0;
+    decoder->axis_count = 0;
+}
+
+/**
+ * Передать декодеру очередной байт программы.
+ *
+ * @return PROGRAM_RECORD - запись готова (decoder->record), следующий байт
+ *     начинает новую запись;
+ *     PROGRAM_FINISHED, PROGRAM_ERROR - следующие байты не принимаются
+ *     до stepper_program_decoder_init
+ */
+stepper_program_status_t stepper_program_decode(stepper_program_decoder* decoder, unsigned char b) {
+    if(decoder->state == DECODE_DONE) {
+        return PROGRAM_ERROR;
+    }
+
+    decoder->buf[decoder->pos++] = b;
+    if(decoder->pos < decoder->need) {
+        return PROGRAM_NEED_MORE;
+    }
+    decoder->pos = 0;
+
+    const unsigned char* buf = decoder->buf;
+    stepper_program_record* record = &decoder->record;
+
+    if(decoder->state == DECODE_HEADER) {
+        if(buf[0] != 'S' || buf[1] != 'P' || buf[2] != 'R' || buf[3] != 'G' ||
+                buf[4] != STEPPER_PROGRAM_VERSION ||
+                buf[5] < 1 || buf[5] > STEPPER_PROGRAM_MAX_AXES) {
+            decoder->state = DECODE_DONE;
+            return PROGRAM_ERROR;
+        }
+        decoder->axis_count = buf[5];
+        decoder->state = DECODE_RECORD;
+        decoder->need = 2;
+        return PROGRAM_NEED_MORE;
+    } else if(decoder->state == DECODE_RECORD) {
+        record->type = buf[0];
+        record->axis_mask = buf[1];
+        record->dwell_us = 0;
+        decoder->axis = 0;
+
+        bool segment = record->type == PROGRAM_MOVE || record->type == PROGRAM_ACCEL;
+        if( (segment && (record->axis_mask == 0 || (record->axis_mask >> decoder->axis_count) != 0)) ||
+                (!segment && record->axis_mask != 0) || record->type > PROGRAM_DWELL ) {
+            decoder->state = DECODE_DONE;
+            return PROGRAM_ERROR;
+        }
+        if(record->type == PROGRAM_END) {
+            decoder->state = DECODE_DONE;
+            return PROGRAM_FINISHED;
+        }
+    } else if(decoder->state == DECODE_AXIS) {
+        stepper_program_axis* axis = &record->axes[decoder->axis];
+        axis->step_count = _read_u32(buf);
+        axis->dir = (signed char)buf[4];
+        if(record->type == PROGRAM_MOVE) {
+            axis->start_delay = _read_u32(buf + 5);
+            axis->step_delay = axis->start_delay;
+            axis->ramp_steps = 0;
+        } else {
+            axis->start_delay = _read_u32(buf + 5);
+            axis->step_delay = _read_u32(buf + 9);
+            axis->ramp_steps = _read_u32(buf + 13);
+        }
+        // 0 - максимальная скорость (prepare_steps), для разгона не подходит
+        if(axis->dir < -1 || axis->dir > 1 ||
+                (record->type == PROGRAM_ACCEL && (axis->start_delay == 0 || axis->step_delay == 0))) {
+            decoder->state = DECODE_DONE;
+            return PROGRAM_ERROR;
+        }
+        decoder->axis++;
+    } else { // DECODE_DWELL
+        record->dwell_us = _read_u32(buf);
+    }
+
+    decoder->need = _decode_next_part(decoder);
+    if(decoder->need == 0) {
+        // запись прочитана, дальше - новая запись
+        decoder->state = DECODE_RECORD;
+        decoder->need = 2;
+        return PROGRAM_RECORD;
+    }
+    return PROGRAM_NEED_MORE;
+}
+
+/**
+ * Подготовить моторы к выполнению сегмента (prepare_steps,
+ * prepare_dynamic_steps) - дальше stepper_start_cycle.
+ *
+ * Пауза PROGRAM_DWELL - цикл, в котором ось 0 стоит на месте (dir=0)
+ * dwell_us микросекунд (не меньше min_step_delay мотора оси 0).
+ *
+ * Разгон PROGRAM_ACCEL использует общие для модуля данные кривых,
+ * поэтому сегменты с разгоном не должны готовиться, пока выполняется
+ * предыдущий такой сегмент.
+ *
+ * @param record - запись PROGRAM_MOVE, PROGRAM_ACCEL или PROGRAM_DWELL
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @return true - моторы подготовлены
+ *     false - запись не сегмент, ось вне axes, ни у одной оси нет шагов
+ *     или уже идет цикл вращения
+ */
+bool stepper_program_prepare(const stepper_program_record* record, stepper** axes, int axis_count) {
+    if(stepper_cycle_running() || axis_count < 1) {
+        return false;
+    }
+
+    if(record->type == PROGRAM_DWELL) {
+        prepare_steps(axes[0], 1, 0, record->dwell_us);
+        return true;
+    } else if(record->type != PROGRAM_MOVE && record->type != PROGRAM_ACCEL) {
+        return false;
+    }
+
+    // сначала проверка, чтобы не оставить в цикле часть осей
+    bool has_steps = false;
+    for(int i = 0; i < STEPPER_PROGRAM_MAX_AXES; i++) {
+        if(record->axis_mask & (1 << i)) {
+            if(i >= axis_count) {
+                return false;
+            }
+            has_steps = has_steps || record->axes[i].step_count > 0;
+        }
+    }
+    if(!has_steps) {
+        return false;
+    }
+
+    for(int i = 0; i < axis_count && i < STEPPER_PROGRAM_MAX_AXES; i++) {
+        const stepper_program_axis* axis = &record->axes[i];
+        if(!(record->axis_mask & (1 << i)) || axis->step_count == 0) {
+            continue;
+        }
+        if(record->type == PROGRAM_MOVE || axis->ramp_steps == 0) {
+            prepare_steps(axes[i], axis->step_count, axis->dir, axis->step_delay);
+        } else {
+            _program_ramps[i] = *axis;
+            prepare_dynamic_steps(axes[i], axis->step_count, axis->dir,
+                &_program_ramps[i], _program_ramp_delay);
+        }
+    }
+    return true;
+}
+
+/**
+ * Положение осей после сегмента: current_pos моторов плюс шаги записи
+ * (для stepper_program_segment_done). Вызывать перед stepper_program_prepare.
+ *
+ * @param record - запись PROGRAM_MOVE, PROGRAM_ACCEL или PROGRAM_DWELL
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param target_pos - положение осей после сегмента (axis_count значений)
+ */
+void stepper_program_target(const stepper_program_record* record, stepper** axes, int axis_count,
+        long long* target_pos) {
+    for(int i = 0; i < axis_count; i++) {
+        target_pos[i] = axes[i]->current_pos;
+        if(record->type != PROGRAM_DWELL && i < STEPPER_PROGRAM_MAX_AXES &&
+                (record->axis_mask & (1 << i))) {
+            target_pos[i] += (long long)record->axes[i].dir *
+                (long long)record->axes[i].step_count * (long long)axes[i]->distance_per_step;
+        }
+    }
+}
+
+/**
+ * Сегмент выполнен: цикл завершился без ошибки или с ошибкой
+ * CYCLE_ERROR_HANDLER_TIMING_EXCEEDED, но все оси пришли в target_pos
+ * (стратегии IGNORE и FIX доводят цикл до конца).
+ *
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param target_pos - положение осей после сегмента (stepper_program_target)
+ * @return true - сегмент выполнен, можно запускать следующий
+ */
+bool stepper_program_segment_done(stepper** axes, int axis_count, const long long* target_pos) {
+    stepper_cycle_error_t error = stepper_cycle_error();
+    if(error == CYCLE_ERROR_HANDLER_TIMING_EXCEEDED) {
+        for(int i = 0; i < axis_count; i++) {
+            if(axes[i]->current_pos != target_pos[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return error == CYCLE_ERROR_NONE;
+}
+
+/**
+ * Запустить выполнение программы из потока байт (Serial, файл на SD
+ * и т.п.): сегменты выполняются по очереди, следующий сегмент читается,
+ * пока выполняется текущий.
+ *
+ * Дальше нужно вызывать stepper_program_handle из loop.
+ *
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param read_byte - функция чтения следующего байта из потока:
+ *     0..255 - байт, -1 - данных пока нет (например, Serial.read())
+ * @param source - параметр для read_byte
+ * @return true - выполнение запущено
+ *     false - уже идет цикл вращения или некорректные параметры
+ */
+bool stepper_program_start(stepper** axes, int axis_count,
+        int (*read_byte)(void* source), void* source) {
+    if(stepper_cycle_running() || axis_count < 1 || axis_count > STEPPER_PROGRAM_MAX_AXES ||
+            read_byte == NULL) {
+        return false;
+    }
+
+    for(int i = 0; i < axis_count; i++) {
+        _program_axes[i] = axes[i];
+    }
+    _program_axis_count = axis_count;
+    _program_read_byte = read_byte;
+    _program_source = source;
+
+    stepper_program_decoder_init(&_program_decoder);
+    _program_record_ready = false;
+    _program_end = false;
+    _program_segments = 0;
+    _program_status = PROGRAM_NEED_MORE;
+    _program_running = true;
+    return true;
+}
+
+/**
+ * Прочитать из потока доступные байты следующего сегмента и запустить
+ * его, если текущий цикл завершился. Вызывать из loop.
+ *
+ * @return true - программа выполняется
+ *     false - программа завершена (stepper_program_status: PROGRAM_FINISHED
+ *     или PROGRAM_ERROR) или не запускалась
+ */
+bool stepper_program_handle() {
+    if(!_program_running) {
+        return false;
+    }
+
+    // читаем следующий сегмент, пока выполняется текущий
+    while(!_program_record_ready && !_program_end) {
+        int b = _program_read_byte(_program_source);
+        if(b < 0) {
+            // данных пока нет
+            break;
+        }
+
+        stepper_program_status_t status = stepper_program_decode(&_program_decoder, b);
+        if(status == PROGRAM_RECORD) {
+            _program_record_ready = true;
+        } else if(status == PROGRAM_FINISHED) {
+            _program_end = true;
+        } else if(status == PROGRAM_ERROR) {
+            // поток испорчен - дальше не двигаемся
+            stepper_program_cancel();
+            return false;
+        }
+    }
+
+    if(stepper_cycle_running()) {
+        return true;
+    }
+    if(_program_segments > 0 &&
+            !stepper_program_segment_done(_program_axes, _program_axis_count, _program_target_pos)) {
+        _program_status = PROGRAM_ERROR;
+        _program_running = false;
+        return false;
+    }
+
+    if(_program_record_ready) {
+        _program_record_ready = false;
+        stepper_program_target(&_program_decoder.record, _program_axes, _program_axis_count,
+            _program_target_pos);
+        if(!stepper_program_prepare(&_program_decoder.record, _program_axes, _program_axis_count) ||
+                !stepper_start_cycle()) {
+            stepper_program_cancel();
+            return false;
+        }
+        _program_segments++;
+    } else if(_program_end) {
+        _program_status = PROGRAM_FINISHED;
+        _program_running = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Состояние выполнения программы: PROGRAM_NEED_MORE - выполняется,
+ * PROGRAM_FINISHED - выполнена до конца (или не запускалась),
+ * PROGRAM_ERROR - ошибка формата, ошибка цикла вращения или выполнение
+ * прервано.
+ */
+stepper_program_status_t stepper_program_status() {
+    return _program_status;
+}
+
+/**
+ * Количество запущенных сегментов программы (включая паузы).
+ */
+unsigned long stepper_program_segments() {
+    return _program_segments;
+}
+
+/**
+ * Прервать выполнение программы (PROGRAM_ERROR).
+ */
+void stepper_program_cancel() {
+    if(_program_running) {
+        stepper_finish_cycle();
+        _program_status = PROGRAM_ERROR;
+        _program_running = false;
+    }
+}
+
@@ -0,0 +1,273 @@
+/**
+ * stepper_program.h
+ *
+ * Программа движения в компактном двоичном формате: запись (кодирование)
+ * программы на хосте, потоковое чтение (декодирование) по одному байту
+ * на устройстве без выделения памяти и выполнение - каждый сегмент
+ * программы - отдельный цикл вращения.
+ *
+ * Формат (версия 1), все числа - little-endian, без выравнивания:
+ *
+ *   заголовок, 8 байт:
+ *     'S' 'P' 'R' 'G' - сигнатура
+ *     version (1 байт) - версия формата, STEPPER_PROGRAM_VERSION
+ *     axis_count (1 байт) - количество осей (моторов), 1..STEPPER_PROGRAM_MAX_AXES
+ *     2 байта - резерв (0)
+ *
+ *   записи, каждая начинается с 2 байт:
+ *     type (1 байт) - тип записи (stepper_program_record_type_t)
+ *     axis_mask (1 байт) - оси, которые участвуют в сегменте (бит 0 - ось 0),
+ *       для PROGRAM_DWELL и PROGRAM_END - 0
+ *
+ *   дальше для каждой оси из axis_mask (по возрастанию номера):
+ *     PROGRAM_MOVE, 9 байт: step_count (4), dir (1, со знаком), step_delay (4)
+ *     PROGRAM_ACCEL, 17 байт: step_count (4), dir (1, со знаком),
+ *       start_delay (4), step_delay (4), ramp_steps (4)
+ *   для PROGRAM_DWELL - 4 байта: dwell_us
+ *   для PROGRAM_END - ничего
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#ifndef STEPPER_PROGRAM_H
+#define STEPPER_PROGRAM_H
+
+#include "stepper.h"
+
+/** Версия формата */
+#define STEPPER_PROGRAM_VERSION 1
+
+/** Максимальное количество осей в программе (axis_mask - 1 байт) */
+#define STEPPER_PROGRAM_MAX_AXES 8
+
+/** Размер заголовка, байт */
+#define STEPPER_PROGRAM_HEADER_SIZE 8
+
+/** Максимальный размер записи, байт */
+#define STEPPER_PROGRAM_RECORD_MAX (2 + 17*STEPPER_PROGRAM_MAX_AXES)
+
+/**
+ * Тип записи
+ */
+typedef enum {
+    /** Конец программы */
+    PROGRAM_END = 0,
+
+    /** Сегмент: шаги с постоянной скоростью для каждой оси */
+    PROGRAM_MOVE = 1,
+
+    /**
+     * Сегмент с разгоном и торможением: скорость оси растет от
+     * 1/start_delay до 1/step_delay за ramp_steps шагов в начале сегмента
+     * и так же падает в конце
+     */
+    PROGRAM_ACCEL = 2,
+
+    /** Пауза между сегментами */
+    PROGRAM_DWELL = 3
+} stepper_program_record_type_t;
+
+/**
+ * Движение одной оси в сегменте
+ */
+typedef struct {
+    /** Количество шагов */
+    unsigned long step_count;
+
+    /** Направление: 1 - вперед, -1 - назад, 0 - стоять на месте */
+    int dir;
+
+    /** Задержка перед первым шагом (PROGRAM_ACCEL), микросекунды */
+    unsigned long start_delay;
+
+    /** Задержка между шагами (для PROGRAM_ACCEL - после разгона), микросекунды */
+    unsigned long step_delay;
+
+    /** Количество шагов разгона и торможения (PROGRAM_ACCEL) */
+    unsigned long ramp_steps;
+} stepper_program_axis;
+
+/**
+ * Запись программы
+ */
+typedef struct {
+    /** Тип записи (stepper_program_record_type_t) */
+    unsigned char type;
+
+    /** Оси, которые участвуют в сегменте (бит 0 - ось 0) */
+    unsigned char axis_mask;
+
+    /** Длительность паузы (PROGRAM_DWELL), микросекунды */
+    unsigned long dwell_us;
+
+    /** Движение осей из axis_mask */
+    stepper_program_axis axes[STEPPER_PROGRAM_MAX_AXES];
+} stepper_program_record;
+
+/**
+ * Результат декодирования очередного байта
+ */
+typedef enum {
+    /** Запись еще не готова, нужны следующие байты */
+    PROGRAM_NEED_MORE,
+
+    /** Запись готова (stepper_program_decoder.record) */
+    PROGRAM_RECORD,
+
+    /** Конец программы (PROGRAM_END) */
+    PROGRAM_FINISHED,
+
+    /** Ошибка формата: неверная сигнатура, версия, тип записи или значение */
+    PROGRAM_ERROR
+} stepper_program_status_t;
+
+/**
+ * Потоковый декодер программы: размер не зависит от длины программы,
+ * память не выделяется.
+ */
+typedef struct {
+    /** Текущая часть записи (заголовок, начало записи, ось, пауза) */
+    unsigned char state;
+
+    /** Байты текущей части (самая длинная - ось PROGRAM_ACCEL) */
+    unsigned char buf[17];
+    unsigned char pos;
+    unsigned char need;
+
+    /** Следующая ось текущей записи */
+    unsigned char axis;
+
+    /** Количество осей из заголовка */
+    unsigned char axis_count;
+
+    /** Текущая запись (готова после PROGRAM_RECORD) */
+    stepper_program_record record;
+} stepper_program_decoder;
+
+/**
+ * Записать заголовок программы.
+ *
+ * @param buf - буфер не меньше STEPPER_PROGRAM_HEADER_SIZE байт
+ * @param axis_count - количество осей, 1..STEPPER_PROGRAM_MAX_AXES
+ * @return количество записанных байт, 0 - некорректное количество осей
+ */
+int stepper_program_write_header(unsigned char* buf, int axis_count);
+
+/**
+ * Записать запись программы.
+ *
+ * @param buf - буфер не меньше STEPPER_PROGRAM_RECORD_MAX байт
+ * @param record - запись
+ * @return количество записанных байт
+ */
+int stepper_program_write_record(unsigned char* buf, const stepper_program_record* record);
+
+/**
+ * Подготовить декодер к чтению новой программы (с заголовка).
+ */
+void stepper_program_decoder_init(stepper_program_decoder* decoder);
+
+/**
+ * Передать декодеру очередной байт программы.
+ *
+ * @return PROGRAM_RECORD - запись готова (decoder->record), следующий байт
+ *     начинает новую запись;
+ *     PROGRAM_FINISHED, PROGRAM_ERROR - следующие байты не принимаются
+ *     до stepper_program_decoder_init
+ */
+stepper_program_status_t stepper_program_decode(stepper_program_decoder* decoder, unsigned char b);
+
+/**
+ * Подготовить моторы к выполнению сегмента (prepare_steps,
+ * prepare_dynamic_steps) - дальше stepper_start_cycle.
+ *
+ * Пауза PROGRAM_DWELL - цикл, в котором ось 0 стоит на месте (dir=0)
+ * dwell_us микросекунд (не меньше min_step_delay мотора оси 0).
+ *
+ * Разгон PROGRAM_ACCEL использует общие для модуля данные кривых,
+ * поэтому сегменты с разгоном не должны готовиться, пока выполняется
+ * предыдущий такой сегмент.
+ *
+ * @param record - запись PROGRAM_MOVE, PROGRAM_ACCEL или PROGRAM_DWELL
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @return true - моторы подготовлены
+ *     false - запись не сегмент, ось вне axes, ни у одной оси нет шагов
+ *     или уже идет цикл вращения
+ */
+bool stepper_program_prepare(const stepper_program_record* record, stepper** axes, int axis_count);
+
+/**
+ * Положение осей после сегмента: current_pos моторов плюс шаги записи
+ * (для stepper_program_segment_done). Вызывать перед stepper_program_prepare.
+ *
+ * @param record - запись PROGRAM_MOVE, PROGRAM_ACCEL или PROGRAM_DWELL
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param target_pos - положение осей после сегмента (axis_count значений)
+ */
+void stepper_program_target(const stepper_program_record* record, stepper** axes, int axis_count,
+        long long* target_pos);
+
+/**
+ * Сегмент выполнен: цикл завершился без ошибки или с ошибкой
+ * CYCLE_ERROR_HANDLER_TIMING_EXCEEDED, но все оси пришли в target_pos
+ * (стратегии IGNORE и FIX доводят цикл до конца).
+ *
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param target_pos - положение осей после сегмента (stepper_program_target)
+ * @return true - сегмент выполнен, можно запускать следующий
+ */
+bool stepper_program_segment_done(stepper** axes, int axis_count, const long long* target_pos);
+
+/**
+ * Запустить выполнение программы из потока байт (Serial, файл на SD
+ * и т.п.): сегменты выполняются по очереди, следующий сегмент читается,
+ * пока выполняется текущий.
+ *
+ * Дальше нужно вызывать stepper_program_handle из loop.
+ *
+ * @param axes - моторы для осей программы
+ * @param axis_count - количество моторов
+ * @param read_byte - функция чтения следующего байта из потока:
+ *     0..255 - байт, -1 - данных пока нет (например, Serial.read())
+ * @param source - параметр для read_byte
+ * @return true - выполнение запущено
+ *     false - уже идет цикл вращения или некорректные параметры
+ */
+bool stepper_program_start(stepper** axes, int axis_count,
+        int (*read_byte)(void* source), void* source);
+
+/**
+ * Прочитать из потока доступные байты следующего сегмента и запустить
+ * его, если текущий цикл завершился. Вызывать из loop.
+ *
+ * @return true - программа выполняется
+ *     false - программа завершена (stepper_program_status: PROGRAM_FINISHED
+ *     или PROGRAM_ERROR) или не запускалась
+ */
+bool stepper_program_handle();
+
+/**
+ * Состояние выполнения программы: PROGRAM_NEED_MORE - выполняется,
+ * PROGRAM_FINISHED - выполнена до конца (или не запускалась),
+ * PROGRAM_ERROR - ошибка формата, ошибка цикла вращения или выполнение
+ * прервано.
+ */
+stepper_program_status_t stepper_program_status();
+
+/**
+ * Количество запущенных сегментов программы (включая паузы).
+ */
+unsigned long stepper_program_segments();
+
+/**
+ * Прервать выполнение программы (PROGRAM_ERROR).
+ */
+void stepper_program_cancel();
+
+#endif // STEPPER_PROGRAM_H
+
@@ -0,0 +1,403 @@
+/**
+ * stepper_static.h
+ *
+ * Библиотека управления шаговыми моторами, подключенными через интерфейс
+ * драйвера "step-dir".
+ *
+ * Статическая конфигурация движка: моторы и период таймера известны
+ * на этапе компиляции и задаются параметрами шаблонов. Совместимость
+ * периода таймера и минимальных задержек между шагами моторов проверяется
+ * компилятором (static_assert), номера ножек и задержки в обработчике
+ * таймера - константы, цикл по моторам разворачивается компилятором.
+ *
+ * Возможности - подмножество основного движка (stepper_timer.cpp):
+ * шаги с постоянной скоростью, аппаратные концевые датчики (останавливают
+ * мотор), текущее положение. Шаг - 3 импульса таймера (проверка
+ * концевиков, HIGH, LOW).
+ *
+ * Пример:
+ *   typedef stepper_static_motor<8, 9, 10, false, 1000, 7500> motor_x;
+ *   typedef stepper_static_motor<5, 6, 7, false, 1000, 7500> motor_y;
+ *   typedef stepper_static<200, motor_x, motor_y> engine;
+ *
+ *   // обработчик таймера - статический движок
+ *   STEPPER_STATIC_ISR(engine)
+ *
+ *   void setup() {
+ *       engine::init();
+ *       engine::prepare_steps<0>(1000, 1, 1000);
+ *       engine::prepare_steps<1>(500, -1, 2000);
+ *       engine::start_cycle();
+ *   }
+ *
+ * LGPLv3, 2014-2024
+ *
+ * @author Антон Моисеев 1i7.livejournal.com
+ */
+
+#ifndef STEPPER_STATIC_H
+#define STEPPER_STATIC_H
+
+#include "Arduino.h"
+
+#include "stepper.h"
+#include "stepper_configure_timer.h"
+#include "stepper_lib_config.h"
+
+// из stepper_lib_config.h
+#ifndef MAX_STEPPERS
+#define MAX_STEPPERS 6
+#endif
+
+/**
+ * Мотор статического движка, параметры - как у init_stepper
+ * и init_stepper_ends (только аппаратные концевики).
+ *
+ * @param PIN_STEP - ножка шага
+ * @param PIN_DIR - ножка направления
+ * @param PIN_EN - ножка включения (NO_PIN - не подключена)
+ * @param INVERT_DIR - инвертировать направление вращения
+ * @param MIN_STEP_DELAY - минимальная задержка между шагами, микросекунды
+ * @param DISTANCE_PER_STEP - расстояние за один шаг
+ * @param PIN_MIN - левый концевой датчик (NO_PIN - не подключен)
+ * @param PIN_MAX - правый концевой датчик (NO_PIN - не подключен)
+ */
+template<int PIN_STEP, int PIN_DIR, int PIN_EN, bool INVERT_DIR,
+        unsigned long MIN_STEP_DELAY, unsigned long DISTANCE_PER_STEP,
+        int PIN_MIN = NO_PIN, int PIN_MAX = NO_PIN>
+struct stepper_static_motor {
+    static const int pin_step = PIN_STEP;
+    static const int pin_dir = PIN_DIR;
+    static const int pin_en = PIN_EN;
+    static const int dir_inv = INVERT_DIR ? -1 : 1;
+    static const unsigned long min_step_delay = MIN_STEP_DELAY;
+    static const unsigned long distance_per_step = DISTANCE_PER_STEP;
+    static const int pin_min = PIN_MIN;
+    static const int pin_max = PIN_MAX;
+};
+
+/**
+ * Мотор с номером I в списке моторов.
+ */
+template<int I, typename M, typename... Motors>
+struct _stepper_static_at {
+    typedef typename _stepper_static_at<I - 1, Motors...>::type type;
+};
+
+template<typename M, typename... Motors>
+struct _stepper_static_at<0, M, Motors...> {
+    typedef M type;
+};
+
+/**
+ * Минимальная задержка каждого мотора вмещает 3 периода таймера.
+ */
+template<unsigned long PERIOD_US, typename... Motors>
+struct _stepper_static_period_fits {
+    static const bool value = true;
+};
+
+template<unsigned long PERIOD_US, typename M, typename... Motors>
+struct _stepper_static_period_fits<PERIOD_US, M, Motors...> {
+    static const bool value = M::min_step_delay >= PERIOD_US*3 &&
+        _stepper_static_period_fits<PERIOD_US, Motors...>::value;
+};
+
+/**
+ * Период таймера кратен минимальной задержке каждого мотора.
+ */
+template<unsigned long PERIOD_US, typename... Motors>
+struct _stepper_static_period_aliquot {
+    static const bool value = true;
+};
+
+template<unsigned long PERIOD_US, typename M, typename... Motors>
+struct _stepper_static_period_aliquot<PERIOD_US, M, Motors...> {
+    static const bool value = M::min_step_delay % PERIOD_US == 0 &&
+        _stepper_static_period_aliquot<PERIOD_US, Motors...>::value;
+};
+
+/**
+ * Статический движок: период таймера PERIOD_US микросекунд, моторы Motors.
+ * Все состояние - статические члены класса, экземпляры не создаются.
+ *
+ * Номер мотора (I) - его место в списке Motors (с нуля).
+ */
+template<unsigned long PERIOD_US, typename... Motors>
+class stepper_static {
+public:
+    /** Количество моторов */
+    static const int motor_count = sizeof...(Motors);
+
+    static_assert(PERIOD_US > 0, "stepper_static: timer period must be > 0");
+    static_assert(sizeof...(Motors) > 0, "stepper_static: no motors");
+    static_assert(sizeof...(Motors) <= MAX_STEPPERS, "stepper_static: too many motors (MAX_STEPPERS)");
+    static_assert(_stepper_static_period_fits<PERIOD_US, Motors...>::value,
+        "stepper_static: min_step_delay must fit 3 timer periods (CYCLE_ERROR_TIMER_PERIOD_TOO_LONG)");
+    static_assert(_stepper_static_period_aliquot<PERIOD_US, Motors...>::value,
+        "stepper_static: timer period must be aliquot to min_step_delay (CYCLE_ERROR_TIMER_PERIOD_ALIQUANT_STEP_DELAY)");
+
+    /**
+     * Настроить ножки моторов, выключить моторы (EN->HIGH).
+     */
+    static void init() {
+        _init_from(_index<0>());
+    }
+
+    /**
+     * Подготовить мотор I к вращению с постоянной скоростью.
+     *
+     * @param step_count - количество шагов
+     * @param dir - направление: 1 - вперед, -1 - назад, 0 - стоять на месте
+     * @param step_delay - задержка между шагами, микросекунды
+     * @return false - цикл уже запущен или задержка меньше минимальной
+     */
+    template<int I>
+    static bool prepare_steps(unsigned long step_count, int dir, unsigned long step_delay) {
+        static_assert(I >= 0 && I < motor_count, "stepper_static: wrong motor index");
+        typedef typename _stepper_static_at<I, Motors...>::type M;
+
+        if(_cycle_running || step_delay < M::min_step_delay) {
+            return false;
+        }
+        _step_count[I] = step_count;
+        _dir[I] = dir;
+        _step_delay[I] = step_delay;
+        _step_timer[I] = step_delay;
+        _stopped[I] = false;
+
+        if(dir * M::dir_inv > 0) {
+            digitalWrite(M::pin_dir, HIGH);
+        } else if(dir * M::dir_inv < 0) {
+            digitalWrite(M::pin_dir, LOW);
+        }
+        return true;
+    }
+
+    /**
+     * Текущее положение мотора I.
+     */
+    template<int I>
+    static long long current_pos() {
+        static_assert(I >= 0 && I < motor_count, "stepper_static: wrong motor index");
+        return _current_pos[I];
+    }
+
+    /**
+     * Задать текущее положение мотора I (когда цикл не запущен).
+     */
+    template<int I>
+    static void set_current_pos(long long pos) {
+        static_assert(I >= 0 && I < motor_count, "stepper_static: wrong motor index");
+        if(!_cycle_running) {
+            _current_pos[I] = pos;
+        }
+    }
+
+    /**
+     * Мотор I остановлен концевым датчиком.
+     */
+    template<int I>
+    static bool stopped() {
+        static_assert(I >= 0 && I < motor_count, "stepper_static: wrong motor index");
+        return _stopped[I];
+    }
+
+    /**
+     * Запустить цикл шагов для подготовленных моторов.
+     *
+     * @param timer - аппаратный таймер
+     * @return false - цикл уже запущен или период таймера
+     *     не поддерживается на этой платформе
+     */
+    static bool start_cycle(int timer = TIMER_DEFAULT) {
+        int prescaler;
+        unsigned int adjustment;
+        if(_cycle_running || !stepper_timer_period_settings(PERIOD_US, timer, &prescaler, &adjustment)) {
+            return false;
+        }
+
+        _timer_id = timer;
+        _cycle_running = true;
+        _enable_from(_index<0>(), true);
+
+        // см. stepper_start_cycle
+        _timer_init_ISR(timer, prescaler, adjustment-1);
+        return true;
+    }
+
+    /**
+     * Завершить цикл: остановить таймер, выключить моторы.
+     */
+    static void finish_cycle() {
+        _timer_stop_ISR(_timer_id);
+        _enable_from(_index<0>(), false);
+        _cycle_running = false;
+    }
+
+    /**
+     * Цикл запущен.
+     */
+    static bool cycle_running() {
+        return _cycle_running;
+    }
+
+    /**
+     * Обработчик прерывания от таймера (см. STEPPER_STATIC_ISR).
+     */
+    static void handle_interrupts() {
+        if(!_cycle_running) {
+            return;
+        }
+
+        // у всех моторов закончились шаги - цикл завершился
+        if(!_tick_from(_index<0>())) {
+            finish_cycle();
+        }
+    }
+
+private:
+    template<int I>
+    struct _index {};
+
+    static volatile bool _cycle_running;
+    static volatile int _timer_id;
+
+    static volatile unsigned long _step_count[sizeof...(Motors)];
+    static volatile int _dir[sizeof...(Motors)];
+    static volatile unsigned long _step_delay[sizeof...(Motors)];
+    static volatile unsigned long _step_timer[sizeof...(Motors)];
+    static volatile bool _stopped[sizeof...(Motors)];
+    static volatile long long _current_pos[sizeof...(Motors)];
+
+    static void _init_from(_index<sizeof...(Motors)>) {
+    }
+
+    template<int I>
+    static void _init_from(_index<I>) {
+        typedef typename _stepper_static_at<I, Motors...>::type M;
+
+        pinMode(M::pin_step, OUTPUT);
+        pinMode(M::pin_dir, OUTPUT);
+        digitalWrite(M::pin_step, LOW);
+        if(M::pin_en != NO_PIN) {
+            pinMode(M::pin_en, OUTPUT);
+            digitalWrite(M::pin_en, HIGH);
+        }
+        if(M::pin_min != NO_PIN) {
+            pinMode(M::pin_min, INPUT);
+        }
+        if(M::pin_max != NO_PIN) {
+            pinMode(M::pin_max, INPUT);
+        }
+        _init_from(_index<I + 1>());
+    }
+
+    static void _enable_from(_index<sizeof...(Motors)>, bool) {
+    }
+
+    template<int I>
+    static void _enable_from(_index<I>, bool enable) {
+        typedef typename _stepper_static_at<I, Motors...>::type M;
+
+        // аппаратная ножка Enable: LOW - вкл, HIGH - выкл
+        if(M::pin_en != NO_PIN) {
+            digitalWrite(M::pin_en, enable ? LOW : HIGH);
+        }
+        _enable_from(_index<I + 1>(), enable);
+    }
+
+    static bool _tick_from(_index<sizeof...(Motors)>) {
+        return false;
+    }
+
+    /**
+     * Импульс таймера для моторов с I до последнего.
+     *
+     * @return true - хотя бы один мотор еще вращается
+     */
+    template<int I>
+    static bool _tick_from(_index<I>) {
+        bool active = _motor_tick<I>();
+        return _tick_from(_index<I + 1>()) || active;
+    }
+
+    /**
+     * Импульс таймера для мотора I (как в _step_motor_tick).
+     *
+     * @return true - мотор еще вращается
+     */
+    template<int I>
+    static bool _motor_tick() {
+        typedef typename _stepper_static_at<I, Motors...>::type M;
+
+        if(_step_count[I] == 0 || _stopped[I]) {
+            return false;
+        }
+
+        _step_timer[I] -= PERIOD_US;
+
+        if(_step_timer[I] < PERIOD_US*3 && _step_timer[I] >= PERIOD_US*2) {
+            // за 2 импульса до шага - концевые датчики
+            if( (M::pin_min != NO_PIN && _dir[I] < 0 && digitalRead(M::pin_min)) ||
+                    (M::pin_max != NO_PIN && _dir[I] > 0 && digitalRead(M::pin_max)) ) {
+                _stopped[I] = true;
+            }
+        } else if(_step_timer[I] < PERIOD_US*2 && _step_timer[I] >= PERIOD_US) {
+            // за 1 импульс до шага - HIGH
+            if(_dir[I] != 0) {
+                digitalWrite(M::pin_step, HIGH);
+            }
+        } else if(_step_timer[I] < PERIOD_US) {
+            // шаг по фронту HIGH>LOW
+            if(_dir[I] != 0) {
+                digitalWrite(M::pin_step, LOW);
+                _current_pos[I] += _dir[I] > 0 ?
+                    (long long)M::distance_per_step : -(long long)M::distance_per_step;
+            }
+            _step_count[I]--;
+
+            // взводим таймер на новый шаг с учетом погрешности
+            _step_timer[I] = _step_delay[I] + _step_timer[I];
+        }
+        return true;
+    }
+};
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile bool stepper_static<PERIOD_US, Motors...>::_cycle_running = false;
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile int stepper_static<PERIOD_US, Motors...>::_timer_id = TIMER_DEFAULT;
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile unsigned long stepper_static<PERIOD_US, Motors...>::_step_count[sizeof...(Motors)];
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile int stepper_static<PERIOD_US, Motors...>::_dir[sizeof...(Motors)];
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile unsigned long stepper_static<PERIOD_US, Motors...>::_step_delay[sizeof...(Motors)];
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile unsigned long stepper_static<PERIOD_US, Motors...>::_step_timer[sizeof...(Motors)];
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile bool stepper_static<PERIOD_US, Motors...>::_stopped[sizeof...(Motors)];
+
+template<unsigned long PERIOD_US, typename... Motors>
+volatile long long stepper_static<PERIOD_US, Motors...>::_current_pos[sizeof...(Motors)];
+
+/**
+ * Обработчик прерывания от таймера - статический движок engine вместо
+ * основного (stepper_timer.cpp). Вставить в скетч один раз, вне функций.
+ */
+#define STEPPER_STATIC_ISR(engine) \
+    void _timer_handle_interrupts(int timer) { \
+        /* один таймер на все моторы */ \
+        (void)timer; \
+        engine::handle_interrupts(); \
+    }
+
+#endif // STEPPER_STATIC_H
+
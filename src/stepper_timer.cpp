@@ -17,7 +17,12 @@ extern "C"{
     #include "timer_setup.h"
 }
 
+#ifdef STEPPER_LINUX
+#include "stepper_linux.h"
+#endif
+
 #include "stepper.h"
+#include "stepper_configure_timer.h"
 #include "stepper_lib_config.h"
 
 /**
@@ -34,6 +39,25 @@ typedef enum {
     DYNAMIC
 } delay_source_t;
 
+/**
+ * Результат подготовки данных для следующего шага (_step_refill), флаги
+ */
+// мотор закончил серию шагов
+#define REFILL_SERIES_FINISHED 1
+// мотор закончил последнюю серию
+#define REFILL_MOTOR_FINISHED 2
+// задержка до следующего шага меньше минимальной для мотора
+#define REFILL_STEP_DELAY_SMALL 4
+
+#ifdef STEPPER_DEFERRED_STEPS
+/**
+ * Отложенные вычисления: состояние данных для следующего шага
+ */
+#define REFILL_NONE 0
+#define REFILL_PENDING 1
+#define REFILL_READY 2
+#endif // STEPPER_DEFERRED_STEPS
+
 /**
  * Статус текущего цикла вращения мотора. Главный цикл вращения мотора состоит из
  * нескольких серий (подциклов). Каждая серия включает фиксированное количество шагов,
@@ -175,8 +199,8 @@ typedef struct {
     calibrate_mode_t calibrate_mode;
 
 //// Динамика
-    /** Счетчик серий (возрастает) */
-    unsigned int series_counter = 0;
+    /** Счетчик серий (возрастает, не больше series_count) */
+    int series_counter = 0;
     
     /** Мотор остановлен в процессе работы */
     bool stopped = false;
@@ -186,6 +210,68 @@ typedef struct {
     
     /** Счетчик микросекунд для текущего шага (убывает) */
     unsigned long step_timer = 0;
+    
+    /**
+     * Минимальная задержка между шагами, округленная вверх до целого
+     * количества периодов таймера, микросекунды: шаг делается на импульсе
+     * таймера, поэтому промежуток между шагами - целое количество периодов
+     */
+    unsigned long min_step_timer = 0;
+    
+    /**
+     * Количество шагов, которые будут сделаны подряд на импульсе
+     * текущего шага (stepper_set_step_multiplier_threshold): 1, 2, 4 или 8
+     */
+    unsigned int step_group = 1;
+    
+    /**
+     * Задержка до следующего шага без поправки скорости, микросекунды:
+     * общая поправка (stepper_set_speed_override) не растет выше той,
+     * при которой мотор шагает чаще min_step_delay
+     */
+    unsigned long override_delay = 0;
+    
+    /**
+     * Задержка до следующего шага, которую подготовил _step_refill,
+     * микросекунды (без поправки скорости, плавной остановки
+     * и группировки - их применяет _step_refill_apply)
+     */
+    unsigned long refill_delay = 0;
+    
+    /**
+     * Пропущенные импульсы таймера (cycle_timing_exceed_handle=FIX):
+     * время, на которое таймер до следующего шага еще нужно
+     * уменьшить, микросекунды
+     */
+    unsigned long catch_up_us = 0;
+    
+    /**
+     * Компенсация люфта (init_stepper_backlash): шаги, которые осталось
+     * сделать перед следующим шагом серии
+     */
+    unsigned long backlash_counter = 0;
+    
+    /**
+     * Таймер до следующего шага серии, отложенный на время
+     * компенсации люфта, микросекунды
+     */
+    unsigned long backlash_timer = 0;
+    
+#ifdef STEPPER_DEFERRED_STEPS
+    /**
+     * Отложенные вычисления: данные для следующего шага
+     * REFILL_NONE - не нужны (готовы), REFILL_PENDING - готовит
+     * stepper_handle_deferred, REFILL_READY - готовы, обработчик таймера
+     * должен их забрать
+     */
+    unsigned char refill = REFILL_NONE;
+    
+    /** Результат _step_refill (REFILL_SERIES_FINISHED и т.п.) */
+    unsigned char refill_result = 0;
+    
+    /** Время, прошедшее после шага, пока готовятся данные, микросекунды */
+    unsigned long refill_elapsed = 0;
+#endif // STEPPER_DEFERRED_STEPS
 } motor_cycle_info_t;
 
 // из stepper_lib_config.h
@@ -197,6 +283,277 @@ volatile static int _stepper_count = 0;
 volatile static stepper* _smotors[MAX_STEPPERS];
 volatile static motor_cycle_info_t _cstatuses[MAX_STEPPERS];
 
+// Моторы, которые еще вращаются в текущем цикле (индексы в _smotors
+// и _cstatuses): мотор, который сделал все шаги или остановлен, убираем
+// из списка, чтобы обработчик прерывания не тратил на него время
+volatile static int _active_motors[MAX_STEPPERS];
+volatile static int _active_count = 0;
+
+#ifdef STEPPER_DEFERRED_STEPS
+
+#ifdef STEPPER_TIMING_WHEEL
+#error "STEPPER_DEFERRED_STEPS and STEPPER_TIMING_WHEEL can't be used together"
+#endif
+
+// Отложенные вычисления: есть моторы, которым нужны данные
+// для следующего шага (stepper_deferred_request)
+volatile static bool _deferred_requested = false;
+// Количество шагов, задержанных из-за неготовых данных
+volatile static unsigned long _deferred_underruns = 0;
+
+#endif // STEPPER_DEFERRED_STEPS
+
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+
+#if MAX_STEPPERS > 32
+#error "STEPPER_ENDSTOP_INTERRUPTS: MAX_STEPPERS must be <= 32"
+#endif
+
+#ifdef STEPPER_ENDSTOP_DEBOUNCE
+#error "STEPPER_ENDSTOP_INTERRUPTS and STEPPER_ENDSTOP_DEBOUNCE can't be used together"
+#endif
+
+// Концевики на прерываниях (бит i - мотор i):
+// текущее состояние концевиков
+volatile static unsigned long _endstop_min_level = 0;
+volatile static unsigned long _endstop_max_level = 0;
+// концевик срабатывал после последней проверки
+volatile static unsigned long _endstop_min_latch = 0;
+volatile static unsigned long _endstop_max_latch = 0;
+
+/**
+ * Концевые датчики на прерываниях (STEPPER_ENDSTOP_INTERRUPTS): перечитать
+ * состояние концевиков моторов цикла. Срабатывание концевика запоминается
+ * до ближайшей проверки в обработчике таймера, поэтому короткий импульс
+ * между проверками не теряется.
+ * 
+ * Для ножек с внешним прерыванием (digitalPinToInterrupt) библиотека
+ * сама вызывает функцию по изменению уровня на время цикла; для остальных
+ * ножек вызывать из своего обработчика прерывания (например, pin change).
+ */
+void stepper_endstops_changed() {
+    for(int i = 0; i < _stepper_count; i++) {
+        unsigned long bit = 1UL << i;
+        if(_smotors[i]->pin_min != NO_PIN && digitalRead(_smotors[i]->pin_min)) {
+            _endstop_min_level |= bit;
+            _endstop_min_latch |= bit;
+        } else {
+            _endstop_min_level &= ~bit;
+        }
+        if(_smotors[i]->pin_max != NO_PIN && digitalRead(_smotors[i]->pin_max)) {
+            _endstop_max_level |= bit;
+            _endstop_max_latch |= bit;
+        } else {
+            _endstop_max_level &= ~bit;
+        }
+    }
+}
+
+/**
+ * Подключить (attach=true) или отключить обработчик изменения уровня
+ * на ножках концевиков, у которых есть внешнее прерывание.
+ */
+static void _endstop_interrupts_attach(bool attach) {
+#ifdef digitalPinToInterrupt
+    for(int i = 0; i < _stepper_count; i++) {
+        int pins[] = {_smotors[i]->pin_min, _smotors[i]->pin_max};
+        for(int p = 0; p < 2; p++) {
+            if(pins[p] != NO_PIN && digitalPinToInterrupt(pins[p]) != NOT_AN_INTERRUPT) {
+                if(attach) {
+                    attachInterrupt(digitalPinToInterrupt(pins[p]), stepper_endstops_changed, CHANGE);
+                } else {
+                    detachInterrupt(digitalPinToInterrupt(pins[p]));
+                }
+            }
+        }
+    }
+#endif // digitalPinToInterrupt
+}
+
+/**
+ * Концевик min мотора i срабатывал после прошлой проверки;
+ * флаг сбрасывается, если концевик уже отпущен.
+ */
+static inline bool _endstop_min(int i) {
+    unsigned long bit = 1UL << i;
+    bool hit = _endstop_min_latch & bit;
+    _endstop_min_latch = (_endstop_min_latch & ~bit) | (_endstop_min_level & bit);
+    return hit;
+}
+
+/**
+ * Концевик max мотора i срабатывал после прошлой проверки;
+ * флаг сбрасывается, если концевик уже отпущен.
+ */
+static inline bool _endstop_max(int i) {
+    unsigned long bit = 1UL << i;
+    bool hit = _endstop_max_latch & bit;
+    _endstop_max_latch = (_endstop_max_latch & ~bit) | (_endstop_max_level & bit);
+    return hit;
+}
+#elif defined(STEPPER_ENDSTOP_DEBOUNCE)
+
+#if MAX_STEPPERS > 32
+#error "STEPPER_ENDSTOP_DEBOUNCE: MAX_STEPPERS must be <= 32"
+#endif
+
+// Опрос концевиков раз в импульс таймера с фильтром помех
+// (бит i - мотор i): уровень концевиков после фильтра
+volatile static unsigned long _endstop_min_level = 0;
+volatile static unsigned long _endstop_max_level = 0;
+// сколько импульсов подряд ножка читается не так, как _endstop_xxx_level
+// (концевик мотора i: 2*i - min, 2*i+1 - max)
+volatile static unsigned char _endstop_debounce[MAX_STEPPERS*2];
+
+#ifdef portInputRegister
+// Чтение целыми портами: порты, к которым подключены концевики моторов цикла,
+// и значения, прочитанные на текущем импульсе
+typedef decltype(portInputRegister(digitalPinToPort(0))) _endstop_port_reg_t;
+volatile static _endstop_port_reg_t _endstop_ports[MAX_STEPPERS*2];
+volatile static unsigned long _endstop_port_values[MAX_STEPPERS*2];
+volatile static int _endstop_port_count = 0;
+// порт (индекс в _endstop_ports) и маска бита каждого концевика
+volatile static signed char _endstop_port_index[MAX_STEPPERS*2];
+volatile static unsigned long _endstop_bitmask[MAX_STEPPERS*2];
+#endif // portInputRegister
+
+/**
+ * Прочитать ножку концевика (2*i - min мотора i, 2*i+1 - max) на текущем
+ * импульсе: с portInputRegister - из значения порта, прочитанного в
+ * _endstops_sample.
+ */
+static inline bool _endstop_read(int e) {
+#ifdef portInputRegister
+    return _endstop_port_values[_endstop_port_index[e]] & _endstop_bitmask[e];
+#else
+    return digitalRead(e % 2 == 0 ? _smotors[e/2]->pin_min : _smotors[e/2]->pin_max);
+#endif // portInputRegister
+}
+
+/**
+ * Подготовить опрос концевиков моторов цикла (при запуске цикла):
+ * список портов, начальные уровни без фильтра.
+ */
+static void _endstops_setup() {
+#ifdef portInputRegister
+    _endstop_port_count = 0;
+#endif // portInputRegister
+    _endstop_min_level = 0;
+    _endstop_max_level = 0;
+    for(int e = 0; e < _stepper_count*2; e++) {
+        int pin = e % 2 == 0 ? _smotors[e/2]->pin_min : _smotors[e/2]->pin_max;
+        _endstop_debounce[e] = 0;
+        if(pin == NO_PIN) {
+            continue;
+        }
+#ifdef portInputRegister
+        _endstop_port_reg_t port = portInputRegister(digitalPinToPort(pin));
+        int p = 0;
+        while(p < _endstop_port_count && _endstop_ports[p] != port) {
+            p++;
+        }
+        if(p == _endstop_port_count) {
+            _endstop_ports[p] = port;
+            _endstop_port_count++;
+        }
+        _endstop_port_index[e] = p;
+        _endstop_bitmask[e] = digitalPinToBitMask(pin);
+        _endstop_port_values[p] = *port;
+#endif // portInputRegister
+        if(_endstop_read(e)) {
+            if(e % 2 == 0) {
+                _endstop_min_level |= 1UL << (e/2);
+            } else {
+                _endstop_max_level |= 1UL << (e/2);
+            }
+        }
+    }
+}
+
+/**
+ * Опросить концевики моторов цикла (один раз за импульс таймера):
+ * уровень концевика меняется после STEPPER_ENDSTOP_DEBOUNCE
+ * одинаковых чтений подряд.
+ */
+static void _endstops_sample() {
+#ifdef portInputRegister
+    for(int p = 0; p < _endstop_port_count; p++) {
+        _endstop_port_values[p] = *_endstop_ports[p];
+    }
+#endif // portInputRegister
+    for(int e = 0; e < _stepper_count*2; e++) {
+        if((e % 2 == 0 ? _smotors[e/2]->pin_min : _smotors[e/2]->pin_max) == NO_PIN) {
+            continue;
+        }
+        unsigned long bit = 1UL << (e/2);
+        bool level = (e % 2 == 0 ? _endstop_min_level : _endstop_max_level) & bit;
+        if(_endstop_read(e) == level) {
+            _endstop_debounce[e] = 0;
+        } else if(++_endstop_debounce[e] >= STEPPER_ENDSTOP_DEBOUNCE) {
+            _endstop_debounce[e] = 0;
+            if(e % 2 == 0) {
+                _endstop_min_level ^= bit;
+            } else {
+                _endstop_max_level ^= bit;
+            }
+        }
+    }
+}
+
+/**
+ * Сработал концевик min мотора i (после фильтра помех).
+ */
+static inline bool _endstop_min(int i) {
+    return _endstop_min_level & (1UL << i);
+}
+
+/**
+ * Сработал концевик max мотора i (после фильтра помех).
+ */
+static inline bool _endstop_max(int i) {
+    return _endstop_max_level & (1UL << i);
+}
+#else
+/**
+ * Сработал концевик min мотора i.
+ */
+static inline bool _endstop_min(int i) {
+    return digitalRead(_smotors[i]->pin_min);
+}
+
+/**
+ * Сработал концевик max мотора i.
+ */
+static inline bool _endstop_max(int i) {
+    return digitalRead(_smotors[i]->pin_max);
+}
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+
+#ifdef STEPPER_TIMING_WHEEL
+
+#ifndef STEPPER_TIMING_WHEEL_SIZE
+#define STEPPER_TIMING_WHEEL_SIZE 32
+#endif
+
+#if MAX_STEPPERS > 32
+#error "STEPPER_TIMING_WHEEL: MAX_STEPPERS must be <= 32"
+#endif
+
+// Колесо времени: ячейка - импульс таймера (номер импульса по модулю
+// размера колеса), в ячейке - битовая маска моторов, которые нужно
+// обработать на этом импульсе (проверка границ, HIGH или шаг)
+volatile static unsigned long _wheel[STEPPER_TIMING_WHEEL_SIZE];
+// моторы, которые сейчас в колесе
+volatile static unsigned long _wheel_motors = 0;
+// номер текущего импульса таймера в цикле
+volatile static unsigned long _wheel_tick = 0;
+// импульс, на котором нужно обработать мотор
+volatile static unsigned long _wheel_due[MAX_STEPPERS];
+// импульс, на котором последний раз обновляли step_timer мотора
+volatile static unsigned long _wheel_synced[MAX_STEPPERS];
+
+#endif // STEPPER_TIMING_WHEEL
+
 ///////////////////////////
 // Настройки таймера
 // значения по умолчанию для таймера будут отличаться для разных архитектур,
@@ -269,6 +626,26 @@ volatile static motor_cycle_info_t _cstatuses[MAX_STEPPERS];
 #endif
 
 //#endif // __PIC32__
+#elif defined( STEPPER_LINUX )
+// Linux (src/linux): виртуальная частота 1ГГц
+
+// для периода 20 микросекунд (50тыс вызовов в секунду == 50КГц)
+// to set timer clock period to 20us (50000 operations per second == 50KHz)
+// on 1GHz virtual CPU use prescaler 1:1 (TIMER_PRESCALER_1_1)
+// and adjustment=20000-1, minus 1 cause count from zero.
+#ifndef STEPPER_TIMER_DEFAULT_PRESCALER
+#define STEPPER_TIMER_DEFAULT_PRESCALER TIMER_PRESCALER_1_1
+#endif
+
+#ifndef STEPPER_TIMER_DEFAULT_ADJUSTMENT
+#define STEPPER_TIMER_DEFAULT_ADJUSTMENT 20000-1
+#endif
+
+#ifndef STEPPER_TIMER_DEFAULT_PERIOD_US
+#define STEPPER_TIMER_DEFAULT_PERIOD_US 20
+#endif
+
+//#endif // STEPPER_LINUX
 #else // unknown arch (most likely in test mode)
 
 // test mode: put some values looking like true
@@ -291,6 +668,85 @@ volatile static unsigned long _timer_period_us = STEPPER_TIMER_DEFAULT_PERIOD_US
 //(выключенный таймер может пригодиться для тестов и отладки)
 volatile bool _timer_enabled = true;
 
+///////////////////////////
+// Адаптивный период таймера (stepper_set_timer_period_adaptive)
+
+// из stepper_lib_config.h
+#ifndef STEPPER_TIMER_ADAPTIVE_MAX_SHIFT
+#define STEPPER_TIMER_ADAPTIVE_MAX_SHIFT 4
+#endif
+
+// Менять период таймера во время цикла
+volatile static bool _timer_period_adaptive = false;
+
+// Базовые настройки таймера (stepper_configure_timer): период
+// в цикле не бывает меньше базового, после завершения цикла
+// восстанавливаем базовые настройки
+volatile static unsigned long _timer_base_period_us = STEPPER_TIMER_DEFAULT_PERIOD_US;
+volatile static int _timer_base_prescaler = STEPPER_TIMER_DEFAULT_PRESCALER;
+volatile static unsigned int _timer_base_adjustment = STEPPER_TIMER_DEFAULT_ADJUSTMENT;
+
+// Настройки таймера для периодов _timer_base_period_us*2^shift
+// (подбираем при запуске цикла, чтобы не считать в обработчике прерывания)
+volatile static int _timer_shift_prescalers[STEPPER_TIMER_ADAPTIVE_MAX_SHIFT + 1];
+volatile static unsigned int _timer_shift_adjustments[STEPPER_TIMER_ADAPTIVE_MAX_SHIFT + 1];
+
+// Наибольший сдвиг, для которого период таймера получается точно
+volatile static int _timer_shift_max = 0;
+
+// Текущий сдвиг: _timer_period_us = _timer_base_period_us*2^_timer_shift
+volatile static int _timer_shift = 0;
+
+// Пересмотреть период таймера в конце текущего импульса
+volatile static bool _timer_period_check = false;
+
+// Шаг в 2 импульса таймера (stepper_set_two_tick_steps)
+volatile static bool _two_tick_steps = false;
+
+// Задержка между шагами, ниже которой шаги группируются
+// по 2, 4 или 8 на один импульс таймера (stepper_set_step_multiplier_threshold),
+// 0 - не группировать
+volatile static unsigned long _step_multiplier_threshold = 0;
+
+// Максимальное количество шагов в группе
+#define STEP_GROUP_MAX 8
+
+// из stepper_lib_config.h
+#ifndef STEPPER_SPEED_OVERRIDE_MAX
+#define STEPPER_SPEED_OVERRIDE_MAX 400
+#endif
+
+#ifndef STEPPER_SPEED_OVERRIDE_RAMP_US
+#define STEPPER_SPEED_OVERRIDE_RAMP_US 1000
+#endif
+
+// Поправка скорости для всех моторов, проценты (stepper_set_speed_override)
+volatile static unsigned int _speed_override = 100;
+// Поправка, с которой шагают моторы, проценты: плавно догоняет
+// _speed_override, одна на все моторы
+volatile static unsigned int _speed_override_current = 100;
+// Микросекунды, прошедшие с последнего изменения _speed_override_current
+volatile static unsigned long _speed_override_timer = 0;
+
+// из stepper_lib_config.h
+#ifndef STEPPER_HOLD_DECEL_US
+#define STEPPER_HOLD_DECEL_US 200000
+#endif
+
+#ifndef STEPPER_HOLD_MIN_PERCENT
+#define STEPPER_HOLD_MIN_PERCENT 10
+#endif
+
+// Плавная остановка (stepper_hold_cycle):
+// -1 - замедляемся, 1 - разгоняемся после паузы, 0 - нет
+volatile static int _hold_dir = 0;
+// Скорость всех моторов, проценты от запланированной
+volatile static unsigned int _hold_percent = 100;
+// Микросекунд на изменение скорости на 1%
+volatile static unsigned long _hold_us_per_percent = 1;
+// Микросекунды, прошедшие с последнего изменения скорости
+volatile static unsigned long _hold_timer = 0;
+
 ///////////////////////////
 // Текущий статус цикла
 volatile static bool _cycle_running = false;
@@ -301,6 +757,116 @@ volatile static stepper_cycle_error_t _cycle_error = CYCLE_ERROR_NONE;
 // Максимальное время выполнения обработчика прерывания
 // таймера в текущем цикле
 volatile static unsigned long _cycle_max_time = 0;
+// Количество смен периода таймера в текущем цикле
+// (адаптивный период)
+volatile static unsigned long _cycle_timer_period_changes = 0;
+// Количество пропущенных импульсов таймера в текущем цикле
+// (cycle_timing_exceed_handle=FIX)
+volatile static unsigned long _cycle_missed_ticks = 0;
+
+// Пропущенные импульсы (cycle_timing_exceed_handle=FIX):
+// время импульса таймера по расписанию, микросекунды (micros)
+volatile static unsigned long _timer_tick_us = 0;
+// начать расписание заново на следующем импульсе (старт цикла,
+// пауза, смена периода)
+volatile static bool _timer_tick_sync = true;
+
+// Счетчик версий для снимков состояния моторов (stepper_snapshot):
+// нечетный - обработчик таймера меняет моторы, четный - нет.
+// На AVR - 1 байт, чтобы чтение счетчика было атомарным.
+#ifdef ARDUINO_ARCH_AVR
+volatile static unsigned char _snapshot_seq = 0;
+#else
+volatile static unsigned int _snapshot_seq = 0;
+#endif
+
+// барьер компилятора: не переносить чтение и запись памяти через эту точку
+#define _compiler_barrier() __asm__ __volatile__("" ::: "memory")
+
+// барьер памяти для данных, которые обработчик таймера и loop() передают
+// друг другу без блокировки (снимок, очередь событий, обработчики событий,
+// отложенные вычисления): на одном ядре обработчик прерывания выполняется
+// между инструкциями loop(), хватает барьера компилятора; на бэкенде Linux
+// поток таймера работает параллельно с loop() на другом ядре (часто ARM
+// со слабым порядком доступа к памяти) - нужен барьер процессора
+#ifdef STEPPER_LINUX
+#define _memory_barrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define _memory_barrier() _compiler_barrier()
+#endif
+
+// блокировка обработчика таймера на время, пока loop() меняет настройки
+// моторов и цикла (prepare_xxx, stepper_start_cycle, stepper_finish_cycle,
+// пауза, поправка скорости и т.п.): на контроллере обработчик прерывания
+// видит такие изменения только целиком (он не прерывается loop(), а настройки
+// моторов до и после цикла не трогает), на бэкенде Linux поток таймера
+// ждет, пока loop() их закончит (stepper_linux_isr_lock)
+#ifdef STEPPER_LINUX
+class _isr_guard {
+public:
+    _isr_guard() { stepper_linux_isr_lock(); }
+    ~_isr_guard() { stepper_linux_isr_unlock(); }
+};
+#define _isr_lock() _isr_guard _isr_guard_lock
+#else
+#define _isr_lock()
+#endif
+
+///////////////////////////
+// События цикла
+
+// из stepper_lib_config.h
+#ifndef STEPPER_EVENT_QUEUE_SIZE
+#define STEPPER_EVENT_QUEUE_SIZE 16
+#endif
+
+// Обработчики событий и способ доставки
+volatile static stepper_event_handler_t _event_handlers[STEPPER_EVENT_COUNT];
+volatile static stepper_event_delivery_t _event_delivery[STEPPER_EVENT_COUNT];
+
+// Очередь событий для STEPPER_EVENT_DEFERRED: пишет обработчик прерывания
+// (_event_tail), читает stepper_handle_events (_event_head)
+volatile static stepper_event_t _event_queue_events[STEPPER_EVENT_QUEUE_SIZE];
+volatile static stepper* _event_queue_motors[STEPPER_EVENT_QUEUE_SIZE];
+volatile static unsigned char _event_head = 0;
+volatile static unsigned char _event_tail = 0;
+// Количество событий, которые не поместились в очередь
+volatile static unsigned long _events_lost = 0;
+
+// Работает обработчик прерывания таймера
+volatile static bool _timer_handler_running = false;
+// Цикл завершился внутри обработчика прерывания:
+// сообщим об этом в самом конце обработчика
+volatile static bool _cycle_finished_event = false;
+
+/**
+ * Сообщить о событии цикла: вызвать обработчик сразу или поставить
+ * событие в очередь для stepper_handle_events.
+ */
+static void _event(stepper_event_t event, volatile stepper* smotor) {
+    stepper_event_handler_t handler = _event_handlers[event];
+    if(handler == NULL) {
+        return;
+    }
+    
+    if(_event_delivery[event] == STEPPER_EVENT_IMMEDIATE) {
+        handler(event, (stepper*)smotor);
+    } else {
+        unsigned char next = (_event_tail + 1) % STEPPER_EVENT_QUEUE_SIZE;
+        if(next == _event_head) {
+            // очередь заполнена
+            _events_lost++;
+            return;
+        }
+        // место освободил stepper_handle_events - событие из него уже забрали
+        _memory_barrier();
+        _event_queue_events[_event_tail] = event;
+        _event_queue_motors[_event_tail] = smotor;
+        // событие целиком в очереди - только теперь сдвигаем хвост
+        _memory_barrier();
+        _event_tail = next;
+    }
+}
 
 // Стратегия реакции на ошибки
 // STOP_MOTOR/CANCEL_CYCLE
@@ -316,9 +882,12 @@ volatile static error_handle_strategy_t _soft_end_handle = CANCEL_CYCLE;
 //static error_handle_strategy_t _small_step_delay_handle = STOP_MOTOR;
 volatile static error_handle_strategy_t _small_step_delay_handle = CANCEL_CYCLE;
 
-// IGNORE/CANCEL_CYCLE
+// IGNORE/FIX/CANCEL_CYCLE
 volatile static error_handle_strategy_t _cycle_timing_exceed_handle = CANCEL_CYCLE;
 
+// FIX/CANCEL_CYCLE
+volatile static error_handle_strategy_t _aliquant_step_delay_handle = CANCEL_CYCLE;
+
 
 /**
  * Подготовить мотор к запуску ограниченной серии шагов - задать нужное количество
@@ -334,6 +903,8 @@ volatile static error_handle_strategy_t _cycle_timing_exceed_handle = CANCEL_CYC
  *     CALIBRATE_BOUNDS_MAX_POS: установка размеров рабочей области (сбрасывать max_pos в current_pos при каждом шаге)
  */
 void prepare_steps(stepper *smotor, unsigned long step_count, int dir, unsigned long step_delay, calibrate_mode_t calibrate_mode) {
+    _isr_lock();
+    
     // резерв нового места на мотор в списке
     int sm_i = _stepper_count;
     _stepper_count++;
@@ -397,6 +968,8 @@ void prepare_steps(stepper *smotor, unsigned long step_count, int dir, unsigned
  *     CALIBRATE_BOUNDS_MAX_POS: установка размеров рабочей области (сбрасывать max_pos в current_pos при каждом шаге)
  */
 void prepare_whirl(stepper *smotor, int dir, unsigned long step_delay, calibrate_mode_t calibrate_mode) {
+    _isr_lock();
+    
     // резерв нового места на мотор в списке
     int sm_i = _stepper_count;
     _stepper_count++;
@@ -495,6 +1068,8 @@ void prepare_whirl(stepper *smotor, int dir, unsigned long step_delay, calibrate
  *     Значение по умолчанию dir=1.
  */
 void prepare_simple_buffered_steps(stepper *smotor, int buf_size, unsigned long* delay_buffer, unsigned long step_count, int dir) {
+    _isr_lock();
+    
     // резерв нового места на мотор в списке
     int sm_i = _stepper_count;
     _stepper_count++;
@@ -527,8 +1102,9 @@ void prepare_simple_buffered_steps(stepper *smotor, int buf_size, unsigned long*
     
     // Взводим счетчики
     _cstatuses[sm_i].step_counter = _cstatuses[sm_i].step_count;
-    // задержка перед первым шагом
-    _cstatuses[sm_i].step_timer = _cstatuses[sm_i].delay_buffer[0];
+    // задержка перед первым шагом (stepper_start_cycle проверяет step_delay)
+    _cstatuses[sm_i].step_delay = _cstatuses[sm_i].delay_buffer[0];
+    _cstatuses[sm_i].step_timer = _cstatuses[sm_i].step_delay;
     
     // Динамический статус мотора в цикле вращения
     // ожидаем пуска
@@ -585,6 +1161,8 @@ void prepare_simple_buffered_steps(stepper *smotor, int buf_size, unsigned long*
  *     Должен содержать buf_size элементов.
  */
 void prepare_buffered_steps(stepper *smotor, int buf_size, unsigned long* step_buffer, int* dir_buffer, unsigned long* delay_buffer) {
+    _isr_lock();
+    
     // резерв нового места на мотор в списке
     int sm_i = _stepper_count;
     _stepper_count++;
@@ -636,6 +1214,60 @@ void prepare_buffered_steps(stepper *smotor, int buf_size, unsigned long* step_b
     _cstatuses[sm_i].stopped = false;
 }
 
+/**
+ * Привести массивы серий для prepare_buffered_steps к каноническому виду
+ * (на месте, до вызова prepare_buffered_steps):
+ * - задержка 0 (максимальная скорость) заменяется на min_step_delay мотора;
+ * - серии без шагов (step_buffer[i]=0) удаляются (prepare_buffered_steps
+ *   считает мотор завершившим вращение на первой же пустой серии);
+ * - соседние серии с одинаковыми направлением и задержкой объединяются
+ *   в одну (меньше элементов в массивах и переходов между сериями
+ *   в обработчике прерываний таймера).
+ * 
+ * Перед изменением массивов проверяет все серии: если хотя бы одна
+ * задержка (кроме 0) меньше min_step_delay или направление не -1, 0, 1,
+ * массивы не меняются.
+ * 
+ * Количество шагов, положение мотора в конце цикла и время цикла
+ * не меняются.
+ * 
+ * @param buf_size - количество серий (количество элементов в массивах step_buffer, dir_buffer, delay_buffer)
+ * @param step_buffer - массив с количеством шагов для каждой серии
+ * @param dir_buffer - массив с направлениями движения для каждой серии
+ * @param delay_buffer - массив задержек между шагами для каждой из серий, микросекунды
+ * @return новое количество серий (может быть 0 - шагов нет),
+ *     -1 - некорректная задержка или направление, массивы не изменены
+ */
+int normalize_buffered_steps(stepper *smotor, int buf_size, unsigned long* step_buffer, int* dir_buffer, unsigned long* delay_buffer) {
+    // сначала проверка, чтобы не оставить массивы наполовину измененными
+    for(int i = 0; i < buf_size; i++) {
+        if( (delay_buffer[i] != 0 && delay_buffer[i] < smotor->min_step_delay) ||
+                dir_buffer[i] < -1 || dir_buffer[i] > 1 ) {
+            return -1;
+        }
+    }
+    
+    int size = 0;
+    for(int i = 0; i < buf_size; i++) {
+        if(step_buffer[i] == 0) {
+            continue;
+        }
+        
+        unsigned long step_delay = delay_buffer[i] != 0 ? delay_buffer[i] : smotor->min_step_delay;
+        if(size > 0 && dir_buffer[size-1] == dir_buffer[i] && delay_buffer[size-1] == step_delay &&
+                step_buffer[size-1] <= 0xFFFFFFFFUL - step_buffer[i]) {
+            // продолжение предыдущей серии
+            step_buffer[size-1] += step_buffer[i];
+        } else {
+            step_buffer[size] = step_buffer[i];
+            dir_buffer[size] = dir_buffer[i];
+            delay_buffer[size] = step_delay;
+            size++;
+        }
+    }
+    return size;
+}
+
 /**
  * Подготовить мотор к запуску ограниченной серии шагов с переменной скоростью - задать нужное количество
  * шагов, направление и указатель на функцию, вычисляющую задержку перед каждым шагом для регулирования скорости.
@@ -648,6 +1280,8 @@ void prepare_buffered_steps(stepper *smotor, int buf_size, unsigned long* step_b
  */
 void prepare_dynamic_steps(stepper *smotor, unsigned long step_count, int dir,
         void* curve_context, unsigned long (*next_step_delay)(unsigned long curr_step, void* curve_context)) {
+    _isr_lock();
+    
     // резерв нового места на мотор в списке
     int sm_i = _stepper_count;
     _stepper_count++;
@@ -679,8 +1313,9 @@ void prepare_dynamic_steps(stepper *smotor, unsigned long step_count, int dir,
     
     // Взводим счетчики
     _cstatuses[sm_i].step_counter = _cstatuses[sm_i].step_count;
-    // задержка перед первым шагом
-    _cstatuses[sm_i].step_timer = _cstatuses[sm_i].next_step_delay(0, _cstatuses[sm_i].curve_context);
+    // задержка перед первым шагом (stepper_start_cycle проверяет step_delay)
+    _cstatuses[sm_i].step_delay = _cstatuses[sm_i].next_step_delay(0, _cstatuses[sm_i].curve_context);
+    _cstatuses[sm_i].step_timer = _cstatuses[sm_i].step_delay;
     
     // Динамический статус мотора в цикле вращения
     // ожидаем пуска
@@ -703,6 +1338,8 @@ void prepare_dynamic_steps(stepper *smotor, unsigned long step_count, int dir,
  */
 void prepare_dynamic_whirl(stepper *smotor, int dir,
         void* curve_context, unsigned long (*next_step_delay)(unsigned long curr_step, void* curve_context)) {
+    _isr_lock();
+    
     // резерв нового места на мотор в списке
     int sm_i = _stepper_count;
     _stepper_count++;
@@ -732,8 +1369,9 @@ void prepare_dynamic_whirl(stepper *smotor, int dir,
     _cstatuses[sm_i].calibrate_mode = NONE;
     
     // Взводим счетчики
-    // задержка перед первым шагом
-    _cstatuses[sm_i].step_timer = _cstatuses[sm_i].next_step_delay(0, _cstatuses[sm_i].curve_context);
+    // задержка перед первым шагом (stepper_start_cycle проверяет step_delay)
+    _cstatuses[sm_i].step_delay = _cstatuses[sm_i].next_step_delay(0, _cstatuses[sm_i].curve_context);
+    _cstatuses[sm_i].step_timer = _cstatuses[sm_i].step_delay;
     
     // на всякий случай обнулим
     _cstatuses[sm_i].step_count = 0;
@@ -812,6 +1450,8 @@ void prepare_dynamic_whirl(stepper *smotor, int dir,
  *     после того, как к ней применен предварительный масштаб (prescaler)
  */
 void stepper_configure_timer(unsigned long target_period_us, int timer, int prescaler, unsigned int adjustment) {
+    _isr_lock();
+    
     // не ломать настройки таймера, пока не отарботал старый цикл
     if(_cycle_running) {
         return;
@@ -825,73 +1465,596 @@ void stepper_configure_timer(unsigned long target_period_us, int timer, int pres
 }
 
 /**
- * Режим отладки: не включать аппаратный таймер при запуске цикла шагов,
- * шаги можно осуществлять вручную серией вызовов _stepper_handle_interrupts.
- * Может быть полезно при тестировании.
- * @param enabled
- *   false: не включать таймер
- *   true: таймер работает в обичном режиме
+ * Количество импульсов таймера на один шаг мотора i:
+ * проверка границ, HIGH, LOW; без отдельного импульса для проверки
+ * (stepper_set_two_tick_steps) и/или для HIGH (dual_edge) - меньше.
  */
-void stepper_set_timer_enabled(bool enabled) {
-    _timer_enabled = enabled;
+static unsigned long _step_ticks(int i) {
+    return (_smotors[i]->dual_edge ? 1 : 2) + (_two_tick_steps ? 0 : 1);
 }
 
 /**
- * Стратегия реакции на некоторые исключительные ситуации, которые
- * могут произойти во время вращения моторов.
- *
- * @param hard_end_handle - выход за границы по аппаратному концевику.
- *     допустимые значения: STOP_MOTOR/CANCEL_CYCLE
- *     по умолчанию: CANCEL_CYCLE
- * @param soft_end_handle - выход за виртуальные границы.
- *     допустимые значения: STOP_MOTOR/CANCEL_CYCLE
- *     по умолчанию: CANCEL_CYCLE
- * @param small_step_delay_handle - задержка между шагами меньше
- *       минимально допустимой для мотора.
- *     допустимые значения: FIX/STOP_MOTOR/CANCEL_CYCLE
- *     по умолчанию: CANCEL_CYCLE
- * @param cycle_timing_exceed_handle - обработчик прерывания выполняется дольше,
- *       чем период таймера.
- *     допустимые значения: IGNORE/CANCEL_CYCLE
- *     по умолчанию: CANCEL_CYCLE
+ * Сколько шагов мотора i делать подряд на одном импульсе таймера
+ * при задержке между шагами step_delay (stepper_set_step_multiplier_threshold):
+ * наименьшая группа (1, 2, 4 или 8 шагов), для которой задержка между
+ * группами не меньше порога и вмещает все импульсы одного шага.
+ * Группа не выходит за пределы текущей серии. Только для моторов
+ * с постоянной скоростью (CONSTANT).
  */
-void stepper_set_error_handle_strategy(
-        error_handle_strategy_t hard_end_handle,
-        error_handle_strategy_t soft_end_handle,
-        error_handle_strategy_t small_step_delay_handle,
-        error_handle_strategy_t cycle_timing_exceed_handle) {
-    // допустимые значения: STOP_MOTOR/CANCEL_CYCLE
-    if(hard_end_handle == STOP_MOTOR || hard_end_handle == CANCEL_CYCLE) {
-        _hard_end_handle = hard_end_handle;
+static unsigned int _step_group(int i, unsigned long step_delay) {
+    if(_step_multiplier_threshold == 0 || _cstatuses[i].delay_source != CONSTANT) {
+        return 1;
     }
     
-    // допустимые значения: STOP_MOTOR/CANCEL_CYCLE
-    if(soft_end_handle == STOP_MOTOR || soft_end_handle == CANCEL_CYCLE) {
-        _soft_end_handle = soft_end_handle;
+    unsigned long group_delay_min = _timer_period_us*_step_ticks(i);
+    if(group_delay_min < _step_multiplier_threshold) {
+        group_delay_min = _step_multiplier_threshold;
     }
     
-    // допустимые значения: FIX/STOP_MOTOR/CANCEL_CYCLE
-    if(small_step_delay_handle == FIX ||
-            small_step_delay_handle == STOP_MOTOR ||
-            small_step_delay_handle == CANCEL_CYCLE) {
-        _small_step_delay_handle = small_step_delay_handle;
+    unsigned int group = 1;
+    while(group < STEP_GROUP_MAX && step_delay*group < group_delay_min) {
+        group *= 2;
     }
     
-    // допустимые значения: IGNORE/CANCEL_CYCLE
-    if(cycle_timing_exceed_handle == IGNORE || cycle_timing_exceed_handle == CANCEL_CYCLE) {
-        _cycle_timing_exceed_handle = cycle_timing_exceed_handle;
+    // не заходим на следующую серию
+    while(!_cstatuses[i].non_stop && group > _cstatuses[i].step_counter && group > 1) {
+        group /= 2;
     }
+    return group;
 }
 
 /**
- * Запустить цикл шагов на выполнение - запускаем таймер с
- * обработчиком прерываний отрабатывать подготовленную программу.
+ * Минимальная задержка между шагами мотора i, округленная вверх до целого
+ * количества периодов таймера (пересчитывать при смене периода).
+ */
+static void _step_min_timer_update(int i) {
+    _cstatuses[i].min_step_timer = (_smotors[i]->min_step_delay + _timer_period_us - 1) /
+        _timer_period_us * _timer_period_us;
+}
+
+/**
+ * Задержка между шагами компенсации люфта мотора i: максимальная
+ * скорость мотора (целое количество периодов таймера), но не меньше
+ * импульсов таймера на один шаг.
+ */
+static unsigned long _step_backlash_delay(int i) {
+    unsigned long step_delay = _cstatuses[i].min_step_timer;
+    if(step_delay < _timer_period_us*_step_ticks(i)) {
+        step_delay = _timer_period_us*_step_ticks(i);
+    }
+    return step_delay;
+}
+
+/**
+ * Компенсация люфта (init_stepper_backlash): мотор i начинает серию
+ * шагов (step_timer - таймер до первого шага); если направление
+ * серии противоположно направлению, в котором выбран люфт, первый шаг
+ * серии откладываем на backlash_steps шагов компенсации.
+ * 
+ * backlash_dir меняется только после шага компенсации или серии,
+ * который мотор действительно сделал (мотор могут остановить раньше).
+ */
+static void _step_backlash_check(int i) {
+    int dir = _cstatuses[i].dir;
+    if(dir == 0 || !(_cstatuses[i].non_stop || _cstatuses[i].step_counter > 0)) {
+        // в серии нет движения - направление прежнее
+        return;
+    }
+    
+    if(_smotors[i]->backlash_steps > 0 && _smotors[i]->backlash_dir == -dir) {
+        _cstatuses[i].backlash_counter = _smotors[i]->backlash_steps;
+        _cstatuses[i].backlash_timer = _cstatuses[i].step_timer;
+        _cstatuses[i].step_timer = _step_backlash_delay(i);
+    }
+}
+
+/**
+ * Наибольший общий делитель
+ */
+static unsigned long _gcd(unsigned long a, unsigned long b) {
+    while(b != 0) {
+        unsigned long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * Подходит ли период для _timer_period_auto: exact - таймер timer
+ * получает его точно (stepper_timer_period_settings, настройки -
+ * в prescaler и adjustment).
+ */
+static bool _timer_period_exact(unsigned long period_us, bool exact, int timer,
+        int* prescaler, unsigned int* adjustment) {
+    return !exact || stepper_timer_period_settings(period_us, timer, prescaler, adjustment);
+}
+
+/**
+ * Максимальный период таймера для моторов, подготовленных к запуску
+ * (см. stepper_timer_period_auto); exact - только период, который таймер
+ * timer получает точно: делители НОД перебираются по убыванию до первого
+ * такого (настройки таймера - в prescaler и adjustment).
+ */
+static unsigned long _timer_period_auto(bool exact, int timer, int* prescaler, unsigned int* adjustment) {
+    if(_stepper_count == 0) {
+        return 0;
+    }
+    
+    // НОД минимальных задержек между шагами всех моторов и
+    // наибольший период, который вмещается в минимальную задержку
+    // каждого мотора нужное количество раз (3 или 2 импульса на шаг)
+    unsigned long delay_gcd = 0;
+    unsigned long period_max = 0;
+    for(int i = 0; i < _stepper_count; i++) {
+        delay_gcd = _gcd(_smotors[i]->min_step_delay, delay_gcd);
+        unsigned long motor_period_max = _smotors[i]->min_step_delay / _step_ticks(i);
+        if(i == 0 || motor_period_max < period_max) {
+            period_max = motor_period_max;
+        }
+    }
+    
+    if(period_max == 0) {
+        return 0;
+    }
+    if(_aliquant_step_delay_handle == FIX &&
+            _timer_period_exact(period_max, exact, timer, prescaler, adjustment)) {
+        // некратные задержки разрешены - делитель не нужен
+        return period_max;
+    }
+    
+    // ищем наибольший делитель НОД, не превышающий period_max
+    // (и который таймер получает точно)
+    
+    // делители перебираем парами (d, delay_gcd/d) до корня из delay_gcd:
+    // сначала большие (delay_gcd/d при возрастающем d), потом маленькие
+    // (d при убывающем d), так достаточно ~2*sqrt(delay_gcd) итераций
+    unsigned long d = 1;
+    for(; d * d <= delay_gcd; d++) {
+        if(delay_gcd % d == 0 && delay_gcd / d <= period_max &&
+                _timer_period_exact(delay_gcd / d, exact, timer, prescaler, adjustment)) {
+            return delay_gcd / d;
+        }
+    }
+    for(d--; d > 0; d--) {
+        if(delay_gcd % d == 0 && d <= period_max &&
+                _timer_period_exact(d, exact, timer, prescaler, adjustment)) {
+            return d;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Максимальный период таймера, при котором можно запустить цикл
+ * для моторов, подготовленных к запуску (prepare_xxx): минимальная задержка
+ * между шагами каждого мотора должна вмещать не меньше 3х периодов
+ * (2х для stepper_set_two_tick_steps) и делиться на период без остатка.
+ * Выбираем наибольший делитель НОД минимальных задержек всех моторов,
+ * который вмещается в самую маленькую из них 3 (2) раза.
+ * 
+ * Если разрешены некратные задержки (aliquant_step_delay_handle=FIX,
+ * см. stepper_set_error_handle_strategy), кратность не требуется:
+ * период - треть (половина) самой маленькой минимальной задержки
+ * (максимальная скорость моторов с некратной задержкой при этом
+ * округляется вниз до целого количества периодов на шаг).
+ * 
+ * Чем больше период, тем реже вызывается обработчик прерывания
+ * и тем меньше нагрузка на процессор.
+ * 
+ * Для настройки таймера с этим периодом см. stepper_configure_timer_auto
+ * (stepper_configure_timer.h).
+ * 
+ * @return период таймера, микросекунды; 0, если моторы не подготовлены
+ */
+unsigned long stepper_timer_period_auto() {
+    return _timer_period_auto(false, 0, NULL, NULL);
+}
+
+/**
+ * Настроить таймер на максимальный допустимый период для моторов,
+ * подготовленных к запуску в следующем цикле (см. stepper_timer_period_auto):
+ * вызывать после prepare_xxx, но перед stepper_start_cycle.
+ * Если таймер не может получить этот период точно (разрядность счетчика,
+ * нецелое число тиков), берется следующий по убыванию делитель НОД
+ * минимальных задержек, который таймер получает точно.
+ *
+ * @param timer - системный идентификатор таймера
+ * @return период таймера, микросекунды; 0 - подходящий период подобрать
+ *     не удалось, настройки таймера не изменились
+ */
+unsigned long stepper_configure_timer_auto(int timer) {
+    _isr_lock();
+    
+    // не ломать настройки таймера, пока не отарботал старый цикл
+    if(_cycle_running) {
+        return 0;
+    }
+    
+    int prescaler;
+    unsigned int adjustment;
+    unsigned long period_us = _timer_period_auto(true, timer, &prescaler, &adjustment);
+    if(period_us == 0) {
+        return 0;
+    }
+    
+    stepper_configure_timer(period_us, timer, prescaler, adjustment);
+    return period_us;
+}
+
+/**
+ * Режим отладки: не включать аппаратный таймер при запуске цикла шагов,
+ * шаги можно осуществлять вручную серией вызовов _stepper_handle_interrupts.
+ * Может быть полезно при тестировании.
+ * @param enabled
+ *   false: не включать таймер
+ *   true: таймер работает в обичном режиме
+ */
+void stepper_set_timer_enabled(bool enabled) {
+    _isr_lock();
+    
+    _timer_enabled = enabled;
+}
+
+/**
+ * Шаг мотора в 2 импульса таймера вместо 3х: проверка границ
+ * и концевиков выполняется на том же импульсе, что и HIGH на ножке step
+ * (непосредственно перед ним), шаг - на следующем импульсе по HIGH>LOW.
+ * Минимальная задержка между шагами мотора должна вмещать 2 периода
+ * таймера вместо 3х - при той же частоте таймера можно крутить моторы
+ * в 1.5 раза быстрее, но обработчик прерывания на импульсе HIGH
+ * выполняется дольше.
+ * 
+ * Менять только между циклами.
+ * 
+ * @param two_tick
+ *   false: шаг в 3 импульса (по умолчанию)
+ *   true: шаг в 2 импульса
+ */
+void stepper_set_two_tick_steps(bool two_tick) {
+    _isr_lock();
+    
+    // не менять, пока не отработал старый цикл
+    if(_cycle_running) {
+        return;
+    }
+    _two_tick_steps = two_tick;
+}
+
+/**
+ * Группировка шагов для очень высоких скоростей: если задержка между
+ * шагами мотора меньше порога, обработчик прерывания делает 2, 4 или 8
+ * шагов (импульсов на ножке step) подряд на одном импульсе таймера,
+ * а следующую группу планирует на соответствующее время позже.
+ * Частота шагов в среднем сохраняется, точность отдельного шага
+ * снижается до группы.
+ * 
+ * Минимальная задержка между шагами мотора может быть меньше 3х
+ * (2х, 1го) периодов таймера - достаточно, чтобы их вмещала группа
+ * из 8 шагов. Только для моторов с постоянной скоростью в серии
+ * (prepare_steps, prepare_whirl, prepare_buffered_steps).
+ * 
+ * Импульсы в группе идут друг за другом без задержки (ширина импульса -
+ * время пары вызовов digitalWrite), драйвер должен их успевать
+ * различать.
+ * 
+ * Менять только между циклами.
+ * 
+ * @param step_delay_us - задержка между шагами, микросекунды, ниже которой
+ *     шаги группируются; 0 - не группировать (по умолчанию)
+ */
+void stepper_set_step_multiplier_threshold(unsigned long step_delay_us) {
+    _isr_lock();
+    
+    // не менять, пока не отработал старый цикл
+    if(_cycle_running) {
+        return;
+    }
+    _step_multiplier_threshold = step_delay_us;
+}
+
+/**
+ * Адаптивный период таймера: во время цикла увеличивать период таймера
+ * (в 2, 4, ... 2^STEPPER_TIMER_ADAPTIVE_MAX_SHIFT раз относительно
+ * периода, заданного stepper_configure_timer), если все моторы в текущих
+ * сериях движутся медленно или стоят на месте (dir=0), и возвращать
+ * обратно, когда моторам нужен более частый таймер.
+ * 
+ * Период пересматривается на границах серий (prepare_buffered_steps)
+ * и при завершении вращения моторов. Увеличенный период подходит мотору,
+ * если задержка между шагами текущей серии вмещает 3 периода и делится
+ * на период без остатка (или погрешность в один период не делает
+ * промежуток между шагами меньше минимальной задержки). Моторы
+ * с переменной скоростью (prepare_simple_buffered_steps,
+ * prepare_dynamic_xxx) работают только с базовым периодом.
+ * 
+ * Применяется только к периодам, которые таймер получает точно
+ * (stepper_timer_period_settings). После завершения цикла
+ * восстанавливаются базовые настройки таймера.
+ * 
+ * Количество смен периода в цикле: stepper_cycle_timer_period_changes.
+ * 
+ * Менять только между циклами.
+ * 
+ * @param adaptive
+ *   false: период таймера не меняется во время цикла (по умолчанию)
+ *   true: адаптивный период
+ */
+void stepper_set_timer_period_adaptive(bool adaptive) {
+    _isr_lock();
+    
+    // не менять, пока не отработал старый цикл: увеличенный период
+    // остался бы до конца цикла без проверок на границах серий
+    if(_cycle_running) {
+        return;
+    }
+    _timer_period_adaptive = adaptive;
+}
+
+/**
+ * Подходит ли период таймера мотору, который делает шаги
+ * с постоянной задержкой.
+ */
+static bool _timer_period_fits(int i, unsigned long period_us) {
+    unsigned long step_delay = _cstatuses[i].step_delay;
+    unsigned long min_step_delay = _smotors[i]->min_step_delay;
+    
+    // поправка скорости: считаем по самой быстрой из текущей и новой
+    unsigned int speed_override = _speed_override_current > _speed_override ?
+        _speed_override_current : _speed_override;
+    if(speed_override != 100) {
+        step_delay = step_delay > 0xFFFFFFFFUL/100 ?
+            step_delay/speed_override*100 : step_delay*100/speed_override;
+        if(step_delay < min_step_delay) {
+            step_delay = min_step_delay;
+        }
+    }
+    
+    // 3 импульса на шаг: проверка границ, HIGH, LOW (или 2)
+    if(step_delay < period_us*_step_ticks(i)) {
+        return false;
+    }
+    // погрешность до одного периода на шаг (неиспользованные микросекунды
+    // переносятся на следующий шаг) не должна приводить к шагам
+    // чаще минимальной задержки (с aliquant_step_delay_handle=FIX такой
+    // шаг откладывается до следующего импульса и мотор замедляется -
+    // адаптивный период не должен менять скорость, такой период не берем)
+    return step_delay % period_us == 0 ||
+        step_delay - period_us >= min_step_delay;
+}
+
+/**
+ * Перенастроить таймер на период _timer_base_period_us*2^shift.
+ * 
+ * Значения step_timer пересчитывать не нужно: это микросекунды до
+ * "идеального" шага, они не зависят от периода. Следующие импульсы
+ * пройдут через все стадии шага (проверка, HIGH, LOW) при условии, что
+ * step_timer каждого мотора вмещает 3 (2) новых периода (это проверяем при
+ * увеличении периода). При уменьшении периода условие выполняется само:
+ * стадии, которые мотор уже прошел со старым периодом, в худшем случае
+ * выполнятся еще раз (повторная проверка концевиков и HIGH на ножке
+ * step шаг не добавляют).
+ */
+static void _timer_set_period_shift(int shift) {
+    _timer_shift = shift;
+    _timer_period_us = _timer_base_period_us << shift;
+    _timer_prescaler = _timer_shift_prescalers[shift];
+    _timer_adjustment = _timer_shift_adjustments[shift];
+    
+    for(int i = 0; i < _stepper_count; i++) {
+        _step_min_timer_update(i);
+    }
+    
+    _cycle_timer_period_changes++;
+}
+
+/**
+ * Выбрать самый длинный период таймера, который подходит всем
+ * моторам в текущих сериях.
+ * 
+ * Уменьшаем период сразу (мотор, которому он нужен, только что перешел
+ * на новую серию и до его шага еще не меньше 3х (2х) новых периодов).
+ * Увеличиваем, когда до ближайшего шага каждого мотора остается
+ * не меньше 3х (2х) новых периодов, иначе повторим на следующем импульсе
+ * (_timer_period_check).
+ * 
+ * @return true - период таймера изменился, таймер нужно перенастроить
+ */
+static bool _timer_period_update() {
+    int shift_prev = _timer_shift;
+    
+    // наибольший сдвиг, который подходит всем моторам
+    int shift = _timer_shift_max;
+    // наибольший сдвиг, на который можно перейти прямо сейчас
+    int shift_now = _timer_shift_max;
+    // моторы, которые еще не закончили вращение
+    bool active = false;
+    
+    for(int a = 0; a < _active_count && shift > 0; a++) {
+        int i = _active_motors[a];
+        if( !(_cstatuses[i].non_stop || _cstatuses[i].step_counter > 0) || _cstatuses[i].stopped) {
+            // мотор закончил вращение
+            continue;
+        }
+        active = true;
+        
+        if(_cstatuses[i].delay_source != CONSTANT) {
+            // переменная скорость - только базовый период
+            shift = 0;
+            break;
+        }
+        
+        while(shift > 0 && !_timer_period_fits(i, _timer_base_period_us << shift)) {
+            shift--;
+        }
+        while(shift_now > 0 && _cstatuses[i].step_timer < (_timer_base_period_us << shift_now)*_step_ticks(i)) {
+            shift_now--;
+        }
+    }
+    
+    _timer_period_check = false;
+    if(!active) {
+        // все моторы закончили (цикл завершится на следующем импульсе)
+        // или период менять некуда
+    } else if(shift < _timer_shift) {
+        _timer_set_period_shift(shift);
+    } else if(shift > _timer_shift) {
+        if(shift_now > shift) {
+            shift_now = shift;
+        }
+        if(shift_now > _timer_shift) {
+            _timer_set_period_shift(shift_now);
+        }
+        // до нужного периода не дотянули - попробуем на следующем импульсе
+        _timer_period_check = shift_now < shift;
+    }
+    return _timer_shift != shift_prev;
+}
+
+#ifdef STEPPER_TIMING_WHEEL
+
+/**
+ * Обновить step_timer мотора на текущий импульс: пока мотор ждет в колесе,
+ * step_timer не уменьшается на каждом импульсе.
+ */
+static void _wheel_sync(int i) {
+    _cstatuses[i].step_timer -= _timer_period_us*(_wheel_tick - _wheel_synced[i]);
+    _wheel_synced[i] = _wheel_tick;
+}
+
+/**
+ * Поставить мотор в колесо на импульс, когда step_timer попадет
+ * в окно проверки границ перед шагом. Мотор, который закончил вращение,
+ * ставим на следующий импульс - там он уйдет из колеса
+ * (цикл завершится на том же импульсе, что и без колеса).
+ */
+static void _wheel_schedule(int i) {
+    unsigned long ticks = 1;
+    if( (_cstatuses[i].non_stop || _cstatuses[i].step_counter > 0) && !_cstatuses[i].stopped) {
+        unsigned long check_timer = _timer_period_us*_step_ticks(i);
+        if(_cstatuses[i].step_timer >= check_timer) {
+            ticks = (_cstatuses[i].step_timer - check_timer) / _timer_period_us + 1;
+        }
+    }
+    _wheel_due[i] = _wheel_tick + ticks;
+    _wheel[_wheel_due[i] % STEPPER_TIMING_WHEEL_SIZE] |= 1UL << i;
+    _wheel_motors |= 1UL << i;
+}
+
+/**
+ * Заново разложить моторы по колесу (после смены периода таймера).
+ *
+ * @param motors - битовая маска моторов
+ */
+static void _wheel_rebuild(unsigned long motors) {
+    for(int j = 0; j < STEPPER_TIMING_WHEEL_SIZE; j++) {
+        _wheel[j] = 0;
+    }
+    _wheel_motors = 0;
+    while(motors != 0) {
+        int i = __builtin_ctzl(motors);
+        motors &= motors - 1;
+        
+        _wheel_sync(i);
+        _wheel_schedule(i);
+    }
+}
+
+#endif // STEPPER_TIMING_WHEEL
+
+/**
+ * Стратегия реакции на некоторые исключительные ситуации, которые
+ * могут произойти во время вращения моторов.
+ *
+ * @param hard_end_handle - выход за границы по аппаратному концевику.
+ *     допустимые значения: STOP_MOTOR/CANCEL_CYCLE
+ *     по умолчанию: CANCEL_CYCLE
+ * @param soft_end_handle - выход за виртуальные границы.
+ *     допустимые значения: STOP_MOTOR/CANCEL_CYCLE
+ *     по умолчанию: CANCEL_CYCLE
+ * @param small_step_delay_handle - задержка между шагами меньше
+ *       минимально допустимой для мотора.
+ *     допустимые значения: FIX/STOP_MOTOR/CANCEL_CYCLE
+ *     по умолчанию: CANCEL_CYCLE
+ * @param cycle_timing_exceed_handle - обработчик прерывания выполняется дольше,
+ *       чем период таймера.
+ *     допустимые значения: IGNORE/FIX/CANCEL_CYCLE
+ *     IGNORE: продолжать цикл, время пропущенных импульсов таймера теряется
+ *       (моторы отстают от расписания);
+ *     FIX: продолжать цикл, время пропущенных импульсов (по micros) вычитается
+ *       из таймеров моторов до следующего шага, но так, чтобы ни один шаг
+ *       не пропал - шаг сдвигается не больше, чем на несколько импульсов,
+ *       остаток догоняем на следующих шагах (stepper_cycle_missed_ticks);
+ *     CANCEL_CYCLE: завершить цикл.
+ *     по умолчанию: CANCEL_CYCLE
+ * @param aliquant_step_delay_handle - период таймера некратен минимальной
+ *       задержке между шагами мотора (CYCLE_ERROR_TIMER_PERIOD_ALIQUANT_STEP_DELAY).
+ *     допустимые значения: FIX/CANCEL_CYCLE
+ *     FIX: запускать цикл - неиспользованные микросекунды каждого шага
+ *       переносятся на следующий шаг, поэтому средняя скорость вращения
+ *       точно соответствует задержке, а отдельные промежутки между шагами
+ *       отличаются от нее не больше, чем на один период таймера; но
+ *       промежуток не бывает короче минимальной задержки мотора: шаги
+ *       идут только на импульсах, поэтому максимальная скорость мотора -
+ *       минимальная задержка, округленная вверх до целого количества
+ *       периодов (задержки короче этой выполняются с ней);
+ *     CANCEL_CYCLE: не запускать цикл.
+ *     по умолчанию: CANCEL_CYCLE
+ */
+void stepper_set_error_handle_strategy(
+        error_handle_strategy_t hard_end_handle,
+        error_handle_strategy_t soft_end_handle,
+        error_handle_strategy_t small_step_delay_handle,
+        error_handle_strategy_t cycle_timing_exceed_handle,
+        error_handle_strategy_t aliquant_step_delay_handle) {
+    // допустимые значения: STOP_MOTOR/CANCEL_CYCLE
+    if(hard_end_handle == STOP_MOTOR || hard_end_handle == CANCEL_CYCLE) {
+        _hard_end_handle = hard_end_handle;
+    }
+    
+    // допустимые значения: STOP_MOTOR/CANCEL_CYCLE
+    if(soft_end_handle == STOP_MOTOR || soft_end_handle == CANCEL_CYCLE) {
+        _soft_end_handle = soft_end_handle;
+    }
+    
+    // допустимые значения: FIX/STOP_MOTOR/CANCEL_CYCLE
+    if(small_step_delay_handle == FIX ||
+            small_step_delay_handle == STOP_MOTOR ||
+            small_step_delay_handle == CANCEL_CYCLE) {
+        _small_step_delay_handle = small_step_delay_handle;
+    }
+    
+    // допустимые значения: IGNORE/FIX/CANCEL_CYCLE
+    if(cycle_timing_exceed_handle == IGNORE || cycle_timing_exceed_handle == FIX ||
+            cycle_timing_exceed_handle == CANCEL_CYCLE) {
+        _cycle_timing_exceed_handle = cycle_timing_exceed_handle;
+    }
+    
+    // допустимые значения: FIX/CANCEL_CYCLE
+    if(aliquant_step_delay_handle == FIX || aliquant_step_delay_handle == CANCEL_CYCLE) {
+        _aliquant_step_delay_handle = aliquant_step_delay_handle;
+    }
+}
+
+/**
+ * Стратегия реакции на выход за границы по аппаратному концевику
+ * (stepper_set_error_handle_strategy): STOP_MOTOR или CANCEL_CYCLE.
+ */
+error_handle_strategy_t stepper_hard_end_handle() {
+    return _hard_end_handle;
+}
+
+/**
+ * Запустить цикл шагов на выполнение - запускаем таймер с
+ * обработчиком прерываний отрабатывать подготовленную программу.
  * 
  * @return
  *     true - цикл запущен
  *     false - цикл не запущен, т.к. предыдущий цикл еще не завершен
  */
 bool stepper_start_cycle() {
+    _isr_lock();
+    
     // Преварительные проверки перед запуском цикла
 
     // не запускать новый цикл, если старый не отработал,
@@ -907,6 +2070,9 @@ bool stepper_start_cycle() {
     _cycle_paused = false;
     _cycle_error = CYCLE_ERROR_NONE;
     _cycle_max_time = 0;
+    _cycle_timer_period_changes = 0;
+    _cycle_missed_ticks = 0;
+    _timer_tick_sync = true;
     
     // завершить ли цикл с ошибкой, не дожидаясь первого шага
     bool canceled = false;
@@ -915,16 +2081,24 @@ bool stepper_start_cycle() {
     // при некоторых комбинациях значений периода таймера
     // и минимальной задержки между шагами мотора
     for(int i = 0; i < _stepper_count && !canceled; i++) {
-        if(_smotors[i]->min_step_delay < _timer_period_us*3) {
+        if(_smotors[i]->min_step_delay < _timer_period_us*_step_ticks(i) &&
+                !(_step_multiplier_threshold > 0 && _cstatuses[i].delay_source == CONSTANT &&
+                    _smotors[i]->min_step_delay*STEP_GROUP_MAX >= _timer_period_us*_step_ticks(i))) {
             // не запускать цикл, если хотябы у одного из моторов
             // минимальная задержка между шагами не вмещает минимум 3
-            // периода таймера
+            // периода таймера (2 для stepper_set_two_tick_steps)
+            // (с группировкой шагов - если их не вмещает и группа из 8 шагов)
             _cycle_error = CYCLE_ERROR_TIMER_PERIOD_TOO_LONG;
             
             canceled = true;
-        } else if(_smotors[i]->min_step_delay % _timer_period_us != 0) {
+        } else if(_smotors[i]->min_step_delay % _timer_period_us != 0 &&
+                _aliquant_step_delay_handle != FIX) {
             // не запускать цикл, если период таймера не кратен
             // минимальной задержке между шагами хотябы одного из моторов
+            // (с FIX запускаем: неиспользованные микросекунды каждого шага
+            // переносятся на следующий в step_timer, погрешность отдельного
+            // шага - не больше периода, но промежуток между шагами не бывает
+            // короче минимальной задержки - см. _step_refill_apply)
             _cycle_error = CYCLE_ERROR_TIMER_PERIOD_ALIQUANT_STEP_DELAY;
             
             canceled = true;
@@ -952,6 +2126,9 @@ bool stepper_start_cycle() {
                 _cstatuses[i].stopped = true;
                 
                 _smotors[i]->status = STEPPER_STATUS_FINISHED;
+                
+                _event(STEPPER_EVENT_ERROR, _smotors[i]);
+                _event(STEPPER_EVENT_MOTOR_FINISHED, _smotors[i]);
             } else { //if(_small_step_delay_handle == CANCEL_CYCLE) {
                 // по умолчанию: завершаем весь цикл
                 _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
@@ -966,18 +2143,112 @@ bool stepper_start_cycle() {
     } else {
         _cycle_running = true;
         _cycle_paused = false;
+        _hold_dir = 0;
+        _hold_percent = 100;
+        // поправка скорости: каждый цикл начинаем без поправки
+        _speed_override_current = 100;
+        _speed_override_timer = 0;
+#ifdef STEPPER_DEFERRED_STEPS
+        _deferred_requested = false;
+        _deferred_underruns = 0;
+#endif // STEPPER_DEFERRED_STEPS
         
         // включить моторы
+        _active_count = 0;
         for(int i = 0; i < _stepper_count; i++) {
             // обновим статусы
             _smotors[i]->status = STEPPER_STATUS_RUNNING;
             
+            // вращаем все моторы, кроме остановленных при проверках выше
+            if(!_cstatuses[i].stopped) {
+                _active_motors[_active_count++] = i;
+            }
+            
+            // задержка перед первым шагом (без поправки скорости)
+            _cstatuses[i].override_delay = _cstatuses[i].step_delay;
+            
+            // пропущенных импульсов еще не было
+            _cstatuses[i].catch_up_us = 0;
+            
+#ifdef STEPPER_DEFERRED_STEPS
+            // данные для первого шага готовы
+            _cstatuses[i].refill = REFILL_NONE;
+#endif // STEPPER_DEFERRED_STEPS
+            
+            // группировка шагов: первая группа
+            _cstatuses[i].step_group = _step_group(i, _cstatuses[i].step_delay);
+            if(_cstatuses[i].step_group > 1) {
+                _cstatuses[i].step_timer = _cstatuses[i].step_delay*_cstatuses[i].step_group;
+            }
+            
+            // минимальный промежуток между шагами для текущего периода
+            _step_min_timer_update(i);
+            
+            // компенсация люфта перед первой серией
+            _cstatuses[i].backlash_counter = 0;
+            if(!_cstatuses[i].stopped) {
+                _step_backlash_check(i);
+            }
+            
             // аппаратная ножка Enable->LOW (вкл), если задана
             if(_smotors[i]->pin_en != NO_PIN) {
                 digitalWrite(_smotors[i]->pin_en, LOW);
             }
         }
         
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+        // концевики на прерываниях: начальное состояние
+        _endstop_min_level = 0;
+        _endstop_max_level = 0;
+        _endstop_min_latch = 0;
+        _endstop_max_latch = 0;
+        stepper_endstops_changed();
+        _endstop_interrupts_attach(true);
+#elif defined(STEPPER_ENDSTOP_DEBOUNCE)
+        // опрос концевиков: порты и начальное состояние
+        _endstops_setup();
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+        
+        // адаптивный период: запомним базовые настройки таймера,
+        // подберем настройки для увеличенных периодов и сразу
+        // выберем период под первые серии
+        _timer_base_period_us = _timer_period_us;
+        _timer_base_prescaler = _timer_prescaler;
+        _timer_base_adjustment = _timer_adjustment;
+        _timer_shift = 0;
+        _timer_shift_max = 0;
+        _timer_period_check = false;
+        if(_timer_period_adaptive) {
+            _timer_shift_prescalers[0] = _timer_prescaler;
+            _timer_shift_adjustments[0] = _timer_adjustment;
+            while(_timer_shift_max < STEPPER_TIMER_ADAPTIVE_MAX_SHIFT) {
+                int prescaler;
+                unsigned int adjustment;
+                if(!stepper_timer_period_settings(_timer_base_period_us << (_timer_shift_max + 1),
+                        _timer_id, &prescaler, &adjustment)) {
+                    break;
+                }
+                _timer_shift_max++;
+                _timer_shift_prescalers[_timer_shift_max] = prescaler;
+                _timer_shift_adjustments[_timer_shift_max] = adjustment;
+            }
+            
+            _timer_period_update();
+            // выбор начального периода - не смена
+            _cycle_timer_period_changes = 0;
+        }
+        
+#ifdef STEPPER_TIMING_WHEEL
+        // разложим моторы по колесу времени
+        _wheel_tick = 0;
+        unsigned long motors = 0;
+        for(int a = 0; a < _active_count; a++) {
+            _wheel_synced[_active_motors[a]] = 0;
+            motors |= 1UL << _active_motors[a];
+        }
+        _wheel_rebuild(motors);
+#endif // STEPPER_TIMING_WHEEL
+        
         // Запустим таймер с периодом _timer_period_us, для этого
         // должны быть заданы правильные _timer_prescaler и _timer_adjustment
         if(_timer_enabled) _timer_init_ISR(_timer_id, _timer_prescaler, _timer_adjustment-1);
@@ -989,9 +2260,17 @@ bool stepper_start_cycle() {
  * Завершить цикл шагов - остановить таймер, обнулить список моторов.
  */
 void stepper_finish_cycle() {
+    _isr_lock();
+    
     // остановим таймер
     _timer_stop_ISR(_timer_id);
     
+    bool was_running = _cycle_running;
+    
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+    _endstop_interrupts_attach(false);
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+    
     // выключим все моторы
     for(int i = 0; i < _stepper_count; i++) {
         // аппаратная ножка Enable->HIGH (выкл), если задана
@@ -1000,38 +2279,161 @@ void stepper_finish_cycle() {
         }
         
         // обновим статусы (на случай, если это уже не сделано заранее)
-        _smotors[i]->status = STEPPER_STATUS_FINISHED;
+        if(_smotors[i]->status == STEPPER_STATUS_RUNNING) {
+            _smotors[i]->status = STEPPER_STATUS_FINISHED;
+            
+            // мотор не закончил вращение сам - цикл отменен или остановлен
+            _event(STEPPER_EVENT_MOTOR_FINISHED, _smotors[i]);
+        } else {
+            _smotors[i]->status = STEPPER_STATUS_FINISHED;
+        }
     }
     
-    // цикл завершился
+    // цикл завершился: положение и статусы моторов должны быть
+    // видны loop() раньше признака завершения
+    _memory_barrier();
     _cycle_running = false;
     _cycle_paused = false;
+    _hold_dir = 0;
+    _hold_percent = 100;
+    
+    // адаптивный период: вернем базовые настройки таймера
+    if(_timer_shift != 0) {
+        _timer_period_us = _timer_base_period_us;
+        _timer_prescaler = _timer_base_prescaler;
+        _timer_adjustment = _timer_base_adjustment;
+        _timer_shift = 0;
+    }
+    _timer_period_check = false;
     
     // обнулим список моторов
     _stepper_count = 0;
+    _active_count = 0;
+#ifdef STEPPER_TIMING_WHEEL
+    // очистим колесо времени
+    _wheel_rebuild(0);
+#endif // STEPPER_TIMING_WHEEL
+    
+    // сообщим о завершении цикла; из обработчика прерывания - в самом
+    // конце обработчика, чтобы можно было сразу запустить новый цикл
+    if(was_running) {
+        if(_timer_handler_running) {
+            _cycle_finished_event = true;
+        } else {
+            _event(STEPPER_EVENT_CYCLE_FINISHED, NULL);
+        }
+    }
 }
 
 /**
  * Поставить вращение на паузу, не прерывая всего цикла
  */
 void stepper_pause_cycle() {
+    _isr_lock();
+    
     _cycle_paused = true;
 }
 
 /**
  * Продолжить вращение, если оно было поставлено на паузу
+ * (после stepper_hold_cycle - с плавным разгоном).
  */
 void stepper_resume_cycle() {
+    _isr_lock();
+    
+    if(_hold_percent != 100) {
+        // после плавной остановки (или во время нее) - плавный разгон
+        _hold_dir = 1;
+    }
     _cycle_paused = false;
 }
 
 /**
- * Текущий статус цикла:
- * true - в процессе выполнения,
- * false - ожидает запуска.
- */
-bool stepper_cycle_running() {
-    return _cycle_running;
+ * Плавная остановка (feed hold): все моторы замедляются вдоль
+ * траектории (задержки всех моторов растут в одинаковое количество раз)
+ * до STEPPER_HOLD_MIN_PERCENT процентов от запланированной скорости,
+ * после этого цикл встает на паузу (stepper_cycle_paused).
+ * 
+ * stepper_resume_cycle продолжает вращение с того же места (счетчики
+ * шагов и положение не теряются) и плавно разгоняет моторы до
+ * запланированной скорости за то же время.
+ * 
+ * В отличие от stepper_pause_cycle, моторы не останавливаются резко
+ * на полной скорости и не теряют шаги.
+ * 
+ * @param decel_time_us - время замедления, микросекунды
+ */
+void stepper_hold_cycle(unsigned long decel_time_us) {
+    _isr_lock();
+    
+    if(!_cycle_running || _cycle_paused) {
+        return;
+    }
+    _hold_us_per_percent = decel_time_us / (100 - STEPPER_HOLD_MIN_PERCENT);
+    if(_hold_us_per_percent == 0) {
+        _hold_us_per_percent = 1;
+    }
+    _hold_timer = 0;
+    _hold_dir = -1;
+}
+
+/**
+ * Идет плавная остановка (stepper_hold_cycle) или плавный разгон после нее.
+ */
+bool stepper_cycle_holding() {
+    return _hold_dir != 0;
+}
+
+/**
+ * Поправка скорости (feed rate override) для всех моторов прямо во время
+ * цикла, без перепланирования: задержки между шагами (постоянные, из буфера,
+ * из серий и вычисляемые динамически) делятся на percent/100.
+ * 
+ * Поправка одна на все моторы и применяется плавно: меняется на 1%
+ * за STEPPER_SPEED_OVERRIDE_RAMP_US микросекунд; каждый цикл начинается
+ * со 100%. Поправка не растет выше той, при которой хотя бы один мотор
+ * шагал бы чаще min_step_delay: моторы упираются в минимальную задержку
+ * одновременно, отношение скоростей (траектория) не меняется - ошибкой
+ * это не считается.
+ * 
+ * @param percent - скорость в процентах от запланированной:
+ *     от 1 до STEPPER_SPEED_OVERRIDE_MAX, 100 - без поправки (по умолчанию)
+ * @return false - значение вне допустимого диапазона, поправка не изменилась
+ */
+bool stepper_set_speed_override(unsigned int percent) {
+    _isr_lock();
+    
+    if(percent == 0 || percent > STEPPER_SPEED_OVERRIDE_MAX) {
+        return false;
+    }
+    _speed_override = percent;
+    
+    // адаптивный период: более частым шагам может понадобиться
+    // период покороче - пересмотрим на следующем импульсе
+    if(_cycle_running && _timer_period_adaptive) {
+        _timer_period_check = true;
+    }
+    return true;
+}
+
+/**
+ * Поправка скорости (stepper_set_speed_override), проценты.
+ */
+unsigned int stepper_speed_override() {
+    return _speed_override;
+}
+
+/**
+ * Текущий статус цикла:
+ * true - в процессе выполнения,
+ * false - ожидает запуска.
+ */
+bool stepper_cycle_running() {
+    bool running = _cycle_running;
+    // после завершения цикла - положение и статусы моторов
+    // не старше признака завершения
+    _memory_barrier();
+    return running;
 }
 
 /**
@@ -1062,6 +2464,785 @@ unsigned long stepper_cycle_max_time() {
     return _cycle_max_time;
 }
 
+/**
+ * Текущий период таймера, микросекунды. С адаптивным периодом
+ * (stepper_set_timer_period_adaptive) во время цикла может быть
+ * больше периода, заданного stepper_configure_timer.
+ */
+unsigned long stepper_cycle_timer_period() {
+    return _timer_period_us;
+}
+
+/**
+ * Количество смен периода таймера в текущем цикле
+ * (адаптивный период, см. stepper_set_timer_period_adaptive).
+ */
+unsigned long stepper_cycle_timer_period_changes() {
+    return _cycle_timer_period_changes;
+}
+
+/**
+ * Количество пропущенных импульсов таймера в текущем цикле, время которых
+ * моторы догоняли (cycle_timing_exceed_handle=FIX, см.
+ * stepper_set_error_handle_strategy).
+ */
+unsigned long stepper_cycle_missed_ticks() {
+    return _cycle_missed_ticks;
+}
+
+/**
+ * Согласованный снимок положения, статуса и ошибок моторов - можно
+ * часто вызывать из loop() во время цикла, прерывания не запрещаются.
+ *
+ * Обработчик таймера меняет current_pos (long long) и другие поля мотора,
+ * на AVR и PIC32 чтение таких значений из loop() не атомарно и может
+ * попасть на середину записи. Обработчик увеличивает счетчик версий
+ * в начале и в конце каждого импульса (seqlock), снимок копируется
+ * заново, если за время копирования счетчик изменился.
+ *
+ * На одноядерных платформах (AVR, PIC32, SAM) достаточно барьеров
+ * компилятора; на бэкенде Linux, где обработчик работает в отдельном
+ * потоке на другом ядре, счетчик и копирование разделены барьерами
+ * процессора (__atomic_thread_fence).
+ *
+ * @param smotors - моторы
+ * @param count - количество моторов
+ * @param snapshots - снимки, по одному на каждый мотор
+ */
+void stepper_snapshot(stepper** smotors, int count, stepper_snapshot_t* snapshots) {
+    unsigned int seq;
+    do {
+        // обработчик таймера прерывает loop() и отрабатывает до конца,
+        // нечетное значение можно увидеть только на многоядерной платформе
+        // (бэкенд Linux)
+        do {
+            seq = _snapshot_seq;
+        } while(seq & 1);
+        _memory_barrier();
+        
+        for(int i = 0; i < count; i++) {
+            snapshots[i].current_pos = smotors[i]->current_pos;
+            snapshots[i].status = smotors[i]->status;
+            snapshots[i].error = smotors[i]->error;
+        }
+        
+        _memory_barrier();
+        // если за время копирования обработчик успел поменять моторы,
+        // копируем заново
+    } while(seq != _snapshot_seq);
+}
+
+/**
+ * Назначить обработчик события цикла вместо опроса stepper_cycle_running.
+ *
+ * @param event - событие
+ * @param handler - обработчик, NULL - не сообщать о событии
+ * @param delivery - доставка события:
+ *     STEPPER_EVENT_IMMEDIATE - из обработчика прерывания таймера,
+ *     STEPPER_EVENT_DEFERRED - из stepper_handle_events
+ */
+void stepper_set_event_handler(stepper_event_t event, stepper_event_handler_t handler,
+        stepper_event_delivery_t delivery) {
+    if(event < 0 || event >= STEPPER_EVENT_COUNT) {
+        return;
+    }
+    // обработчик прерывания не должен увидеть новый обработчик
+    // со старым способом доставки
+    _event_handlers[event] = NULL;
+    _memory_barrier();
+    _event_delivery[event] = delivery;
+    _memory_barrier();
+    _event_handlers[event] = handler;
+}
+
+/**
+ * Вызвать обработчики событий из очереди (STEPPER_EVENT_DEFERRED).
+ * Вызывать из loop().
+ *
+ * @return количество обработанных событий
+ */
+int stepper_handle_events() {
+    int count = 0;
+    while(_event_head != _event_tail) {
+        // событие записано целиком до того, как сдвинулся хвост
+        _memory_barrier();
+        stepper_event_t event = _event_queue_events[_event_head];
+        stepper* smotor = (stepper*)_event_queue_motors[_event_head];
+        // событие забрали - место в очереди свободно
+        _memory_barrier();
+        _event_head = (_event_head + 1) % STEPPER_EVENT_QUEUE_SIZE;
+        
+        stepper_event_handler_t handler = _event_handlers[event];
+        if(handler != NULL) {
+            handler(event, smotor);
+        }
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Количество событий, которые не поместились в очередь
+ * (STEPPER_EVENT_QUEUE_SIZE) и были потеряны.
+ */
+unsigned long stepper_events_lost() {
+    return _events_lost;
+}
+
+/**
+ * Проверить пограничные значения координат и концевики непосредственно
+ * перед шагом мотора i (если все ок, то мотор может шагать, иначе
+ * мотор останавливается).
+ * 
+ * @return true - завершить весь цикл (CANCEL_CYCLE)
+ */
+static bool _step_check_ends(int i) {
+    // завершить ли цикл
+    bool canceled = false;
+    
+    // различать левый и правый концевой датчик:
+    // при срабатывании левого датчика запрещать движение влево, но разрешать движение вправо,
+    // при срабатывании правого датчика запрещать движение вправо, но разрешать движение влево
+    // запрет приоритетнее разрешения (если подключить оба датчика в один вход, мотор не будет крутиться вообще)
+    // Это важно, т.к. если мы в одном цикле, например, зажали левый концевой датчик и заблокировали
+    // мотор, при старте следующего цикла датчик все еще будет нажат и у нас должна быть возможность
+    // уйти вправо (влево блок, как и в прошлый раз).
+    
+    if(_smotors[i]->pin_min != NO_PIN && _endstop_min(i) && _cstatuses[i].dir < 0) {
+        // сработал левый аппаратный концевой датчик и мы движемся влево -
+        // завершаем вращение для этого мотора
+        _cstatuses[i].stopped = true;
+        
+        // обновим статус мотора
+        _smotors[i]->status = STEPPER_STATUS_FINISHED;
+        
+        // обозначим ошибку
+        _smotors[i]->error |= STEPPER_ERROR_HARD_END_MIN;
+        
+        // как себя вести - остановить только этот мотор (в любом случае) или
+        // сразу завершить весь цикл
+        if(_hard_end_handle == CANCEL_CYCLE) {
+            // завершаем весь цикл
+            _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
+            canceled = true;
+        } // иначе STOP_MOTOR - останавливается только этот мотор
+        
+    } else if(_smotors[i]->pin_max != NO_PIN &&
+            _endstop_max(i) && _cstatuses[i].dir > 0) {
+        // сработал правый аппаратный концевой датчик и мы движемся вправо -
+        // завершаем вращение для этого мотора
+        _cstatuses[i].stopped = true;
+        
+        
+        // обновим статус мотора
+        _smotors[i]->status = STEPPER_STATUS_FINISHED;
+            
+        // обозначим ошибку
+        _smotors[i]->error |= STEPPER_ERROR_HARD_END_MAX;
+        
+        // как себя вести - остановить только этот мотор (в любом случае) или
+        // сразу завершить весь цикл
+        if(_hard_end_handle == CANCEL_CYCLE) {
+            // завершаем весь цикл
+            _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
+            canceled = true;
+        } // иначе STOP_MOTOR - останавливается только этот мотор
+        
+    } else if( _cstatuses[i].calibrate_mode == NONE &&
+            (_cstatuses[i].dir > 0 ?
+                _smotors[i]->max_end_strategy != INF &&
+                    _smotors[i]->current_pos + (long long)_smotors[i]->distance_per_step*_cstatuses[i].step_group > _smotors[i]->max_pos :
+                _smotors[i]->min_end_strategy != INF &&
+                    _smotors[i]->current_pos - (long long)_smotors[i]->distance_per_step*_cstatuses[i].step_group < _smotors[i]->min_pos) ) {
+        // выход за пределы виртуальной границы:
+        // не в режиме калибровки, включены виртуальные границы координаты и
+        // собираемся выйти за виртуальные границы во время предстоящего шага -
+        // завершаем вращение для этого мотора
+        _cstatuses[i].stopped = true;
+        
+        // обновим статус мотора
+        _smotors[i]->status = STEPPER_STATUS_FINISHED;
+            
+        // обозначим ошибку
+        if(_cstatuses[i].dir < 0) {
+            _smotors[i]->error |= STEPPER_ERROR_SOFT_END_MIN;
+        } else {
+            _smotors[i]->error |= STEPPER_ERROR_SOFT_END_MAX;
+        }
+        
+        // как себя вести - остановить только этот мотор (в любом случае) или
+        // сразу завершить весь цикл
+        if(_soft_end_handle == CANCEL_CYCLE) {
+            // завершаем весь цикл
+            _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
+            canceled = true;
+        } // иначе STOP_MOTOR - останавливается только этот мотор
+        
+    } else if( _cstatuses[i].calibrate_mode == CALIBRATE_BOUNDS_MAX_POS &&
+            _cstatuses[i].dir < 0 &&
+            _smotors[i]->current_pos - (long long)_smotors[i]->distance_per_step*_cstatuses[i].step_group < _smotors[i]->min_pos ) {
+        // в режиме калибровки размера рабочей области при движении влево
+        // собираемся сместиться ниже нижней виртуальной границы
+        // во время предстоящего шага - завершаем вращение для этого мотора
+        _cstatuses[i].stopped = true;
+        
+        // обновим статус мотора
+        _smotors[i]->status = STEPPER_STATUS_FINISHED;
+        
+        // обозначим ошибку мотора
+        _smotors[i]->error |= STEPPER_ERROR_SOFT_END_MIN;
+        
+        // как себя вести - остановить только этот мотор (в любом случае) или
+        // сразу завершить весь цикл
+        if(_soft_end_handle == CANCEL_CYCLE) {
+            // завершаем весь цикл
+            _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
+            canceled = true;
+        } // иначе STOP_MOTOR - останавливается только этот мотор
+    }
+    
+    if(_cstatuses[i].stopped) {
+        _event(STEPPER_EVENT_ERROR, _smotors[i]);
+        _event(STEPPER_EVENT_MOTOR_FINISHED, _smotors[i]);
+    }
+    
+    return canceled;
+}
+
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+/**
+ * Концевик, к которому движется мотор i, сработал после прошлой проверки -
+ * проверить границы сразу, не дожидаясь проверки перед следующим шагом
+ * (если ступень HIGH для шага еще не выставлена).
+ *
+ * @return true - цикл нужно завершить с ошибкой
+ */
+static bool _step_check_endstops_early(int i) {
+    unsigned long bit = 1UL << i;
+    bool hit = _cstatuses[i].dir < 0 ? (_endstop_min_latch & bit) :
+        (_cstatuses[i].dir > 0 && (_endstop_max_latch & bit));
+    if(hit && _cstatuses[i].step_timer >= _timer_period_us*_step_ticks(i)) {
+        return _step_check_ends(i);
+    }
+    return false;
+}
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+
+/**
+ * Пропущенные импульсы таймера (cycle_timing_exceed_handle=FIX): уменьшить
+ * таймер мотора i до следующего шага на время пропущенных импульсов
+ * (catch_up_us), но не дальше окна проверки границ перед шагом, чтобы
+ * шаг не пропал; остаток догоняем после следующего шага.
+ */
+static void _step_catch_up(int i) {
+    unsigned long check_timer = _timer_period_us*_step_ticks(i);
+    if(_cstatuses[i].step_timer > check_timer) {
+        unsigned long us = _cstatuses[i].step_timer - check_timer;
+        if(us > _cstatuses[i].catch_up_us) {
+            us = _cstatuses[i].catch_up_us;
+        }
+        _cstatuses[i].step_timer -= us;
+        _cstatuses[i].catch_up_us -= us;
+    }
+}
+
+/**
+ * Не шагает ли мотор i с поправкой скорости percent чаще min_step_delay.
+ */
+static bool _speed_override_fits(int i, unsigned int percent) {
+    // step_delay*100/percent >= min_step_delay без деления
+    return _cstatuses[i].override_delay > 0xFFFFFFFFUL/100 ||
+        _cstatuses[i].override_delay*100 >= _smotors[i]->min_step_delay*percent;
+}
+
+/**
+ * Подготовить данные для следующего шага мотора i, который только что
+ * шагнул: переход на новую серию, задержка до следующего шага (с проверкой
+ * минимальной задержки) - в refill_delay.
+ * 
+ * Меняет только настройки серии мотора i, поэтому может работать вне
+ * обработчика прерывания (STEPPER_DEFERRED_STEPS), пока мотор ждет данных;
+ * статусы, ошибки и события применяет _step_refill_apply.
+ *
+ * @return флаги REFILL_SERIES_FINISHED, REFILL_MOTOR_FINISHED,
+ *     REFILL_STEP_DELAY_SMALL
+ */
+static unsigned char _step_refill(int i) {
+    unsigned char result = 0;
+    
+    // сделали последний шаг в серии
+    if(!_cstatuses[i].non_stop && _cstatuses[i].step_counter == 0) {
+        // увеличиваем счетчик серий
+        _cstatuses[i].series_counter++;
+        
+        result |= REFILL_SERIES_FINISHED;
+        
+        // загружаем настройки для новой серии
+        if (_cstatuses[i].series_counter < _cstatuses[i].series_count) {
+            // заходим на новую серию внутри текущего цикла
+            _cstatuses[i].step_count = _cstatuses[i].step_buffer[_cstatuses[i].series_counter];
+            
+            // задать направление
+            _cstatuses[i].dir = _cstatuses[i].dir_buffer[_cstatuses[i].series_counter];
+            if(_cstatuses[i].dir * _smotors[i]->dir_inv > 0) {
+                digitalWrite(_smotors[i]->pin_dir, HIGH); // туда
+            } else if(_cstatuses[i].dir * _smotors[i]->dir_inv < 0) {
+                digitalWrite(_smotors[i]->pin_dir, LOW); // обратно
+            } // else // _cstatuses[i].dir == 0
+                // здесь можно было бы дополнительно выключить мотор
+                // ножкой EN, но можно этого не делать, т.к. все равно
+                // не будем пускать импульсы на движение, плюс формально
+                // он все еще находится в рабочем состоянии, просто
+                // ожидает шаг, который может появиться, к примеру,
+                // в следующей серии
+            
+            // скорость вращения (задержка между шагами)
+            _cstatuses[i].step_delay = _cstatuses[i].delay_buffer[_cstatuses[i].series_counter];
+            
+            // взводим счетчик шагов в новой серии
+            _cstatuses[i].step_counter = _cstatuses[i].step_count;
+            
+            // задержку перед первым шагом ставим ниже
+        } else {
+            // сделали последний шаг в последней серии
+            result |= REFILL_MOTOR_FINISHED;
+        }
+    }
+    
+    // вычисляем задержку перед следующим шагом
+    unsigned long step_delay = _cstatuses[i].step_delay;
+    if(_cstatuses[i].delay_source == CONSTANT) {
+        // координата внутри серии движется с постоянной скоростью
+        step_delay = _cstatuses[i].step_delay;
+    } else if(_cstatuses[i].delay_source == BUFFER) {
+        // координата внутри серии движется с переменной скоростью,
+        // значения задержек получаем из буфера
+        
+        // вычислим время до следующего шага (step_counter уже уменьшили)
+        step_delay = _cstatuses[i].delay_buffer[
+            (_cstatuses[i].step_count - _cstatuses[i].step_counter) / _cstatuses[i].scale];
+    } else if(_cstatuses[i].delay_source == DYNAMIC) {
+        // координата движется с переменной скоростью (например, рисуем дугу),
+        // значения задержек вычисляем динамически
+        
+        // вычислим время до следующего шага (step_counter уже уменьшили)
+        step_delay = _cstatuses[i].next_step_delay(
+                _cstatuses[i].step_count - _cstatuses[i].step_counter,
+                _cstatuses[i].curve_context);
+    }
+    
+    // проверим, корректна ли задержка
+    if(step_delay < _smotors[i]->min_step_delay) {
+        // вычисленная задержка перед очередным шагом меньше,
+        // чем минимально допустимая для этого мотора
+        // (что делать с ошибкой, решает _step_refill_apply)
+        result |= REFILL_STEP_DELAY_SMALL;
+        
+        if(_small_step_delay_handle == FIX) {
+            // попробуем исправить:
+            // не будем делать шаги чаще, чем может мотор
+            // (следует понимать, что корректность вращения уже нарушена)
+            step_delay = _smotors[i]->min_step_delay;
+        }
+    }
+    
+    _cstatuses[i].refill_delay = step_delay;
+    return result;
+}
+
+/**
+ * Применить данные для следующего шага мотора i (_step_refill): статус
+ * мотора, ошибки, события, поправка скорости, плавная остановка,
+ * группировка шагов и таймер до следующего шага.
+ * Вызывается из обработчика прерывания (общую поправку скорости
+ * меняет только он).
+ *
+ * @param result - результат _step_refill
+ * @return true - цикл нужно завершить с ошибкой
+ */
+static bool _step_refill_apply(int i, unsigned char result) {
+    // завершить ли цикл
+    bool canceled = false;
+    
+    if(result & REFILL_SERIES_FINISHED) {
+        // новая серия или мотор закончил вращение -
+        // пересмотрим период таймера
+        _timer_period_check = _timer_period_adaptive;
+        
+        if(result & REFILL_MOTOR_FINISHED) {
+            // сделали последний шаг в последней серии
+            _smotors[i]->status = STEPPER_STATUS_FINISHED;
+            
+            _event(STEPPER_EVENT_SERIES_FINISHED, _smotors[i]);
+            _event(STEPPER_EVENT_MOTOR_FINISHED, _smotors[i]);
+        } else {
+            _event(STEPPER_EVENT_SERIES_FINISHED, _smotors[i]);
+        }
+    }
+    
+    if(result & REFILL_STEP_DELAY_SMALL) {
+        // задержка перед очередным шагом меньше минимальной
+        // (FIX - задержку уже исправили)
+        if(_small_step_delay_handle == STOP_MOTOR) {
+            // останавливаем мотор
+            _cstatuses[i].stopped = true;
+            
+            _smotors[i]->status = STEPPER_STATUS_FINISHED;
+        } else if(_small_step_delay_handle != FIX) { //if(_small_step_delay_handle == CANCEL_CYCLE) {
+            // по умолчанию: завершаем весь цикл
+            _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
+            canceled = true;
+        }
+        
+        // в любом случае, обозначим ошибку
+        _smotors[i]->error |= STEPPER_ERROR_STEP_DELAY_SMALL;
+        
+        _event(STEPPER_EVENT_ERROR, _smotors[i]);
+        if(_cstatuses[i].stopped) {
+            _event(STEPPER_EVENT_MOTOR_FINISHED, _smotors[i]);
+        }
+    }
+    
+    unsigned long step_delay = _cstatuses[i].refill_delay;
+    
+    // поправка скорости (stepper_set_speed_override): общая на все
+    // моторы; если с ней этот мотор шагал бы чаще min_step_delay,
+    // уменьшаем ее для всех - траектория сохраняется
+    _cstatuses[i].override_delay = step_delay;
+    if(_speed_override_current > 100 && !_speed_override_fits(i, _speed_override_current)) {
+        unsigned int speed_override = step_delay*100/_smotors[i]->min_step_delay;
+        _speed_override_current = speed_override > 100 ? speed_override : 100;
+    }
+    if(_speed_override_current != 100) {
+        step_delay = step_delay > 0xFFFFFFFFUL/100 ?
+            step_delay/_speed_override_current*100 : step_delay*100/_speed_override_current;
+    }
+    
+    // плавная остановка (stepper_hold_cycle): все моторы
+    // замедляются одинаково - траектория сохраняется
+    if(_hold_percent != 100) {
+        step_delay = step_delay > 0xFFFFFFFFUL/100 ?
+            step_delay/_hold_percent*100 : step_delay*100/_hold_percent;
+    }
+    
+    // группировка шагов: следующая группа - через step_delay
+    // на каждый шаг группы, но не раньше, чем пройдут все
+    // импульсы шага (укороченная группа в конце серии);
+    // мотор с группами не дает увеличить период таймера
+    // (адаптивный период), поэтому сравниваем с базовым
+    _cstatuses[i].step_group = _step_group(i, step_delay);
+    step_delay *= _cstatuses[i].step_group;
+    if(step_delay < _timer_base_period_us*_step_ticks(i)) {
+        step_delay = _timer_base_period_us*_step_ticks(i);
+    }
+    
+    // взводим таймер на новый шаг с учетом погрешности
+    // (неиспользованных микросекунд) предыдущего шага
+    _cstatuses[i].step_timer = step_delay + _cstatuses[i].step_timer;
+    
+    // шаг делается на импульсе таймера, поэтому промежуток до него -
+    // целое количество периодов; если период некратен минимальной задержке
+    // (aliquant_step_delay_handle=FIX), перенос микросекунд может сделать
+    // промежуток на период короче минимальной задержки - тогда шаг
+    // откладываем до первого импульса после нее (шаги группы идут на одном
+    // импульсе в любом случае, для них не проверяем)
+    if(_cstatuses[i].step_group == 1 && _cstatuses[i].step_timer < _cstatuses[i].min_step_timer) {
+        _cstatuses[i].step_timer = _cstatuses[i].min_step_timer;
+    }
+    
+    // новая серия могла сменить направление
+    if((result & REFILL_SERIES_FINISHED) && !(result & REFILL_MOTOR_FINISHED)) {
+        _step_backlash_check(i);
+    }
+    
+    return canceled;
+}
+
+/**
+ * Обработать мотор на очередном импульсе таймера: проверка границ
+ * перед шагом, ступень HIGH, шаг и задержка перед следующим шагом.
+ *
+ * @return true - цикл нужно завершить с ошибкой
+ */
+static bool _step_motor_tick(int i) {
+    // завершить ли цикл
+    bool canceled = false;
+    
+    // >>>За 2 импульса до обнуления таймера (шаг в 3 импульса),
+    // за 1 импульс (шаг в 2 импульса) или на импульсе шага (шаг в 1 импульс)
+    // проверим пограничные значения координат и концевики непосредственно перед шагом
+    // (если все ок, то на следующем импульсе пин мотора пойдет в HIGH, а еще на следующем - в LOW)
+    unsigned long check_timer = _timer_period_us*(_step_ticks(i) - 1);
+    if(_cstatuses[i].step_timer < check_timer + _timer_period_us && _cstatuses[i].step_timer >= check_timer) {
+        canceled = _step_check_ends(i);
+    }
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+    else {
+        canceled = _step_check_endstops_early(i);
+    }
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+    
+    if(_cstatuses[i].stopped) {
+        // мотор остановлен проверкой границ - шаг не делаем
+    } else if(_cstatuses[i].step_timer < _timer_period_us*2 && _cstatuses[i].step_timer >= _timer_period_us) {
+        // >>>За 1 импульс до обнуления таймера
+        // Шаг происходит по фронту сигнала HIGH>LOW, ширина ступени HIGH при этом не важна.
+        // Поэтому сформируем ступень HIGH за один цикл таймера до сброса в LOW
+        // (для dual_edge не нужно - шаг по любому фронту)
+        
+        // _cstatuses[i].step_timer ~ _timer_period_us с учетом погрешности таймера (_timer_period_us) =>
+        // импульс1 - готовим шаг
+        if(_cstatuses[i].dir != 0 && !_smotors[i]->dual_edge) {
+            digitalWrite(_smotors[i]->pin_step, HIGH);
+        }
+    } else if(_cstatuses[i].step_timer < _timer_period_us) {
+        // >>>Таймер обнулился
+        if(_cstatuses[i].backlash_counter > 0) {
+            // шаг компенсации люфта: ножка step - как для обычного шага,
+            // но шаг не считаем и координату не двигаем
+            if(_smotors[i]->dual_edge) {
+                _smotors[i]->step_level = _smotors[i]->step_level == LOW ? HIGH : LOW;
+                digitalWrite(_smotors[i]->pin_step, _smotors[i]->step_level);
+            } else {
+                digitalWrite(_smotors[i]->pin_step, LOW);
+            }
+            
+            // следующий шаг компенсации или отложенный шаг серии
+            _cstatuses[i].backlash_counter--;
+            if(_cstatuses[i].backlash_counter == 0) {
+                // люфт выбран
+                _smotors[i]->backlash_dir = _cstatuses[i].dir;
+            }
+            _cstatuses[i].step_timer += _cstatuses[i].backlash_counter > 0 ?
+                _step_backlash_delay(i) : _cstatuses[i].backlash_timer;
+            if(_cstatuses[i].catch_up_us != 0) {
+                _step_catch_up(i);
+            }
+            return canceled;
+        }
+        
+        // Шагаем
+        // _cstatuses[i].step_timer ~ 0 с учетом погрешности таймера (_timer_period_us) =>
+        // импульс2 (спустя _timer_period_us микросекунд после импульса1) - совершаем шаг
+        // шагов на этом импульсе (группировка шагов)
+        unsigned int step_group = _cstatuses[i].step_group;
+        if(_cstatuses[i].dir != 0) {
+            for(unsigned int g = 0; g < step_group; g++) {
+                if(_smotors[i]->dual_edge) {
+                    // шаг по любому фронту - переключаем ножку
+                    _smotors[i]->step_level = _smotors[i]->step_level == LOW ? HIGH : LOW;
+                    digitalWrite(_smotors[i]->pin_step, _smotors[i]->step_level);
+                } else {
+                    // HIGH для первого шага группы выставлен на прошлом импульсе
+                    if(g > 0) {
+                        digitalWrite(_smotors[i]->pin_step, HIGH);
+                    }
+                    digitalWrite(_smotors[i]->pin_step, LOW);
+                }
+            }
+            
+            // люфт выбран в сторону шага
+            _smotors[i]->backlash_dir = _cstatuses[i].dir;
+        }
+        
+        // шагнули, отметимся в разных местах и приготовимся к следующему шагу (если он будет)
+        // даже если dir=0, аппаратный шаг не делаем, координату не двигаем,
+        // но учитываем его в счетчике пройденных шагов
+        
+        // посчитаем шаг (или группу шагов)
+        if(!_cstatuses[i].non_stop) {
+            _cstatuses[i].step_counter -= step_group;
+        }
+        
+        // текущее положение координаты
+        if(_cstatuses[i].dir != 0) {
+            // если значение направвления dir=0, ничего не делаем с текущим положением
+            // иначе - в зависимости от обстоятельств
+            if(_cstatuses[i].calibrate_mode == NONE || _cstatuses[i].calibrate_mode == CALIBRATE_BOUNDS_MAX_POS) {
+                // не калибруем или калибруем ширину рабочего поля
+                
+                // обновим текущее положение координаты
+                if(_cstatuses[i].dir > 0) {
+                    _smotors[i]->current_pos += (long long)_smotors[i]->distance_per_step*step_group;
+                } else if(_cstatuses[i].dir < 0) {
+                    _smotors[i]->current_pos -= (long long)_smotors[i]->distance_per_step*step_group;
+                } // else // _cstatuses[i].dir == 0 // сюда все равно не попадаем
+                
+                // калибруем ширину рабочего поля - сдвинем правую границу в текущее положение
+                if(_cstatuses[i].calibrate_mode == CALIBRATE_BOUNDS_MAX_POS) {
+                    _smotors[i]->max_pos = _smotors[i]->current_pos;
+                }
+            } else if(_cstatuses[i].calibrate_mode == CALIBRATE_START_MIN_POS) {
+                // режим калибровки начального положения - сбрасываем current_pos в min_pos на каждом шаге
+                _smotors[i]->current_pos = _smotors[i]->min_pos;
+            }
+        }
+        
+#ifdef STEPPER_DEFERRED_STEPS
+        // данные для следующего шага подготовит stepper_handle_deferred,
+        // до тех пор мотор ждет (см. _step_deferred_apply)
+        _cstatuses[i].refill_elapsed = 0;
+        _memory_barrier();
+        _cstatuses[i].refill = REFILL_PENDING;
+        _deferred_requested = true;
+#else
+        // данные для следующего шага
+        if(_step_refill_apply(i, _step_refill(i))) {
+            canceled = true;
+        }
+        if(_cstatuses[i].catch_up_us != 0) {
+            _step_catch_up(i);
+        }
+#endif // STEPPER_DEFERRED_STEPS
+    }
+    
+    return canceled;
+}
+
+#ifdef STEPPER_DEFERRED_STEPS
+/**
+ * Отложенные вычисления: забрать данные для следующего шага мотора i,
+ * которые подготовил stepper_handle_deferred.
+ * 
+ * Пока данные готовились, мотор ждал (refill_elapsed): вычитаем это время
+ * из таймера до следующего шага. Если проверка границ перед шагом уже
+ * должна была пройти, шаг задерживается - проверка на ближайшем импульсе.
+ *
+ * @return true - цикл нужно завершить с ошибкой
+ */
+static bool _step_deferred_apply(int i) {
+    unsigned long elapsed = _cstatuses[i].refill_elapsed;
+    _cstatuses[i].refill = REFILL_NONE;
+    
+    bool canceled = _step_refill_apply(i, _cstatuses[i].refill_result);
+    
+    // таймер перед проверкой границ (на этом импульсе его еще уменьшим)
+    unsigned long check_timer = _timer_period_us*_step_ticks(i);
+    if(elapsed == 0) {
+        // данные готовы к первому импульсу после шага
+    } else if(_cstatuses[i].step_timer >= elapsed + check_timer) {
+        _cstatuses[i].step_timer -= elapsed;
+    } else {
+        // не успели
+        _cstatuses[i].step_timer = check_timer;
+        _deferred_underruns++;
+    }
+    if(_cstatuses[i].catch_up_us != 0) {
+        _step_catch_up(i);
+    }
+    
+    return canceled;
+}
+
+/**
+ * Отложенные вычисления (STEPPER_DEFERRED_STEPS): подготовить данные
+ * для следующего шага моторам, которые только что шагнули (переход
+ * на новую серию, задержка до следующего шага, ее проверка).
+ * 
+ * Обработчик таймера только выдает шаги, поэтому его время работы
+ * не зависит от сложности движения. Вызывать из loop() или из своего
+ * программного прерывания с приоритетом ниже, чем у таймера
+ * (см. stepper_deferred_request), но не из обоих мест сразу.
+ * Данные для шага должны быть готовы до проверки границ перед этим
+ * шагом, иначе шаг задерживается (stepper_deferred_underruns).
+ *
+ * @return количество моторов, для которых подготовлен следующий шаг
+ */
+int stepper_handle_deferred() {
+    int count = 0;
+    for(int i = 0; i < _stepper_count; i++) {
+        if(_cstatuses[i].refill == REFILL_PENDING) {
+            // пока данные не готовы, обработчик прерывания
+            // настройки мотора не трогает
+            _memory_barrier();
+            _cstatuses[i].refill_result = _step_refill(i);
+            _memory_barrier();
+            _cstatuses[i].refill = REFILL_READY;
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Отложенные вычисления (STEPPER_DEFERRED_STEPS): обработчик таймера
+ * вызывает эту функцию, когда есть работа для stepper_handle_deferred.
+ * 
+ * По умолчанию ничего не делает (stepper_handle_deferred вызывается
+ * из loop). Функция объявлена слабой (weak): ее можно заменить своей,
+ * которая запускает программное прерывание с низким приоритетом,
+ * а оно вызывает stepper_handle_deferred.
+ */
+__attribute__((weak)) void stepper_deferred_request() {
+}
+
+/**
+ * Отложенные вычисления (STEPPER_DEFERRED_STEPS): количество шагов
+ * в текущем (или последнем) цикле, которые пришлось задержать, потому что
+ * stepper_handle_deferred не успел подготовить для них данные.
+ */
+unsigned long stepper_deferred_underruns() {
+    return _deferred_underruns;
+}
+#endif // STEPPER_DEFERRED_STEPS
+
+/**
+ * Пропущенные импульсы таймера (cycle_timing_exceed_handle=FIX): сравнить
+ * время импульса с расписанием и, если импульсы пропущены (обработчик или
+ * другие прерывания работали дольше периода таймера), вычесть их время
+ * из таймеров моторов до следующего шага (_step_catch_up).
+ *
+ * Опоздание импульса меньше, чем на период (задержка входа в прерывание),
+ * пропуском не считается.
+ *
+ * @param now - время текущего импульса, микросекунды (micros)
+ */
+static void _timer_catch_up(unsigned long now) {
+    if(_timer_tick_sync) {
+        // новое расписание
+        _timer_tick_sync = false;
+        _timer_tick_us = now;
+        return;
+    }
+    
+    _timer_tick_us += _timer_period_us;
+    long late = (long)(now - _timer_tick_us);
+    if(late < 0) {
+        // импульс раньше расписания (погрешность micros или таймера) -
+        // подтянем расписание, иначе оно уползет
+        _timer_tick_us = now;
+        return;
+    } else if((unsigned long)late < _timer_period_us) {
+        return;
+    }
+    
+    // пропущенные импульсы
+    unsigned long missed = (unsigned long)late / _timer_period_us;
+    unsigned long missed_us = missed*_timer_period_us;
+    _timer_tick_us += missed_us;
+    _cycle_missed_ticks += missed;
+    
+#ifdef STEPPER_TIMING_WHEEL
+    unsigned long motors = _wheel_motors;
+    while(motors != 0) {
+        int i = __builtin_ctzl(motors);
+        motors &= motors - 1;
+        
+        _wheel_sync(i);
+        _cstatuses[i].catch_up_us += missed_us;
+        _step_catch_up(i);
+    }
+    // новые таймеры - новые импульсы
+    _wheel_rebuild(_wheel_motors);
+#else
+    for(int a = 0; a < _active_count; a++) {
+        int i = _active_motors[a];
+        _cstatuses[i].catch_up_us += missed_us;
+        _step_catch_up(i);
+    }
+#endif // STEPPER_TIMING_WHEEL
+}
+
 /**
  * Обработчик прерывания от таймера - дёргается каждые _timer_period_us микросекунд.
  *
@@ -1080,14 +3261,73 @@ unsigned long stepper_cycle_max_time() {
  * итерацию таймера, поэтому период следует выбирать исходя из суммы максимальных времен
  * для всех задействованных в цикле моторов (как вариант - раскидать вычисления
  * для разных моторов на разные итерации таймера, но для этого придется усложнить
- * алгоритм, сейчас не реализовано).
+ * алгоритм, сейчас не реализовано). С настройкой STEPPER_DEFERRED_STEPS
+ * "тяжелые" вычисления уходят из обработчика совсем: после шага данные для
+ * следующего шага готовит stepper_handle_deferred (из loop или программного
+ * прерывания с низким приоритетом), обработчик только выдает шаги.
+ *
+ * Обработчик объявлен слабым (weak): его можно заменить своим, например,
+ * статическим движком из stepper_static.h (STEPPER_STATIC_ISR).
  */
-void _timer_handle_interrupts(int timer) {
+__attribute__((weak)) void _timer_handle_interrupts(int timer) {
+    // один таймер на все моторы
+    (void)timer;
 
+    // плавная остановка или разгон после нее (stepper_hold_cycle)
+    if(_hold_dir != 0 && !_cycle_paused) {
+        _hold_timer += _timer_period_us;
+        while(_hold_timer >= _hold_us_per_percent) {
+            _hold_timer -= _hold_us_per_percent;
+            if(_hold_dir < 0 && _hold_percent > STEPPER_HOLD_MIN_PERCENT) {
+                _hold_percent--;
+            } else if(_hold_dir > 0 && _hold_percent < 100) {
+                _hold_percent++;
+            }
+        }
+        
+        if(_hold_dir < 0 && _hold_percent <= STEPPER_HOLD_MIN_PERCENT) {
+            // замедлились - встаем на паузу
+            _hold_dir = 0;
+            _cycle_paused = true;
+        } else if(_hold_dir > 0 && _hold_percent >= 100) {
+            // разогнались
+            _hold_dir = 0;
+        }
+    }
+    
+    // поправка скорости (stepper_set_speed_override): догоняем
+    // новое значение на 1% за STEPPER_SPEED_OVERRIDE_RAMP_US, но не выше,
+    // чем позволяет самый быстрый (относительно min_step_delay) мотор
+    if(_speed_override_current != _speed_override && !_cycle_paused) {
+        _speed_override_timer += _timer_period_us;
+        while(_speed_override_timer >= STEPPER_SPEED_OVERRIDE_RAMP_US) {
+            _speed_override_timer -= STEPPER_SPEED_OVERRIDE_RAMP_US;
+            if(_speed_override_current > _speed_override) {
+                _speed_override_current--;
+            } else if(_speed_override_current < _speed_override) {
+                bool fits = true;
+                for(int a = 0; a < _active_count && fits; a++) {
+                    fits = _speed_override_fits(_active_motors[a], _speed_override_current + 1);
+                }
+                if(fits) {
+                    _speed_override_current++;
+                }
+            }
+        }
+    }
+    
     // если на паузе, вообще ничего не трогаем
+    // (пропущенные импульсы считаем по новому расписанию после паузы)
     if(_cycle_paused) {
+        _timer_tick_sync = true;
         return;
     }
+    
+    // моторы меняются - снимки состояния (stepper_snapshot) будут ждать
+    _snapshot_seq++;
+    _memory_barrier();
+    
+    _timer_handler_running = true;
 
     // вращаем моторы - делаем шаги, как запланировали
     // способы обработки ошибок в процессе: останов с кодом ошибки, игнор, исправление по возможности,
@@ -1102,276 +3342,136 @@ void _timer_handle_interrupts(int timer) {
     // засечем время выполнения обработчика
     unsigned long cycle_start = micros();
     
+    // догоняем пропущенные импульсы таймера
+    if(_cycle_timing_exceed_handle == FIX) {
+        _timer_catch_up(cycle_start);
+    }
+    
     // завершился ли цикл - все моторы закончили движение
     bool finished = true;
     // завершился ли цикл - что-то пошло не так, сворачиваемся раньше времени
     bool canceled = false;
     
-    // цикл по всем моторам
-    for(int i = 0; i < _stepper_count && !canceled; i++) {
-        _cstatuses[i].step_timer -= _timer_period_us;
+#ifdef STEPPER_ENDSTOP_DEBOUNCE
+    // концевики читаем один раз за импульс для всех моторов
+    _endstops_sample();
+#endif // STEPPER_ENDSTOP_DEBOUNCE
+    
+#ifdef STEPPER_TIMING_WHEEL
+    // колесо времени: обрабатываем только моторы, у которых на этом
+    // импульсе проверка границ, ступень HIGH или шаг; пока мотор ждет
+    // своего импульса, его step_timer не трогаем (см. _wheel_sync)
+    _wheel_tick++;
+    int slot = _wheel_tick % STEPPER_TIMING_WHEEL_SIZE;
+    unsigned long due_motors = _wheel[slot];
+    while(due_motors != 0 && !canceled) {
+        int i = __builtin_ctzl(due_motors);
+        due_motors &= due_motors - 1;
         
-        if( (_cstatuses[i].non_stop || _cstatuses[i].step_counter > 0) && !_cstatuses[i].stopped) {
-            
-            // если хотя бы у одного мотора остались шаги или он запущен нон-стоп, при этом
-            // не остановлен по другой причине (например, из-за концевого датчика),
-            // то мы еще не закончили
+        if(_wheel_due[i] != _wheel_tick) {
+            // мотор ждет следующего оборота колеса
+            continue;
+        }
+        _wheel[slot] &= ~(1UL << i);
+        
+        if( !(_cstatuses[i].non_stop || _cstatuses[i].step_counter > 0) || _cstatuses[i].stopped) {
+            // мотор сделал все шаги или остановлен - убираем из колеса
+            _wheel_motors &= ~(1UL << i);
+            continue;
+        }
+        
+        _wheel_sync(i);
+        canceled = _step_motor_tick(i);
+        _wheel_schedule(i);
+    }
+    
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+    // сработал концевик - моторы, которые ждут своего импульса,
+    // проверяем сразу
+    unsigned long latched_motors = (_endstop_min_latch | _endstop_max_latch) & _wheel_motors;
+    while(latched_motors != 0 && !canceled) {
+        int i = __builtin_ctzl(latched_motors);
+        latched_motors &= latched_motors - 1;
+        
+        _wheel_sync(i);
+        canceled = _step_check_endstops_early(i);
+        if(_cstatuses[i].stopped) {
+            _wheel_motors &= ~(1UL << i);
+        }
+    }
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+    
+    // в колесе остались моторы, которые еще вращаются
+    finished = _wheel_motors == 0;
+#else
+    // цикл по моторам, которые еще вращаются; закончившие вращение
+    // моторы убираем из списка (сохраняя порядок остальных)
+    int active_count = 0;
+    for(int a = 0; a < _active_count && !canceled; a++) {
+        int i = _active_motors[a];
+        
+#ifdef STEPPER_DEFERRED_STEPS
+        if(_cstatuses[i].refill == REFILL_PENDING) {
+            // данные для следующего шага еще не готовы - мотор ждет
+            _active_motors[active_count++] = i;
             finished = false;
-            
-            
-            if(_cstatuses[i].step_timer < _timer_period_us*3 && _cstatuses[i].step_timer >= _timer_period_us*2) {
-                // >>>За 2 импульса до обнуления таймера
-                // проверим пограничные значения координат и концевики непосредственно перед шагом
-                // (если все ок, то на следующем импульсе пин мотора пойдет в HIGH, а еще на следующем - в LOW)
-                
-                
-                // различать левый и правый концевой датчик:
-                // при срабатывании левого датчика запрещать движение влево, но разрешать движение вправо,
-                // при срабатывании правого датчика запрещать движение вправо, но разрешать движение влево
-                // запрет приоритетнее разрешения (если подключить оба датчика в один вход, мотор не будет крутиться вообще)
-                // Это важно, т.к. если мы в одном цикле, например, зажали левый концевой датчик и заблокировали
-                // мотор, при старте следующего цикла датчик все еще будет нажат и у нас должна быть возможность
-                // уйти вправо (влево блок, как и в прошлый раз).
-                
-                if(_smotors[i]->pin_min != NO_PIN && digitalRead(_smotors[i]->pin_min) && _cstatuses[i].dir < 0) {
-                    // сработал левый аппаратный концевой датчик и мы движемся влево -
-                    // завершаем вращение для этого мотора
-                    _cstatuses[i].stopped = true;
-                    
-                    // обновим статус мотора
-                    _smotors[i]->status = STEPPER_STATUS_FINISHED;
-                    
-                    // обозначим ошибку
-                    _smotors[i]->error |= STEPPER_ERROR_HARD_END_MIN;
-                    
-                    // как себя вести - остановить только этот мотор (в любом случае) или
-                    // сразу завершить весь цикл
-                    if(_hard_end_handle == CANCEL_CYCLE) {
-                        // завершаем весь цикл
-                        _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
-                        canceled = true;
-                    } // иначе STOP_MOTOR - останавливается только этот мотор
-                    
-                } else if(_smotors[i]->pin_max != NO_PIN &&
-                        digitalRead(_smotors[i]->pin_max) && _cstatuses[i].dir > 0) {
-                    // сработал правый аппаратный концевой датчик и мы движемся вправо -
-                    // завершаем вращение для этого мотора
-                    _cstatuses[i].stopped = true;
-                    
-                    
-                    // обновим статус мотора
-                    _smotors[i]->status = STEPPER_STATUS_FINISHED;
-                        
-                    // обозначим ошибку
-                    _smotors[i]->error |= STEPPER_ERROR_HARD_END_MAX;
-                    
-                    // как себя вести - остановить только этот мотор (в любом случае) или
-                    // сразу завершить весь цикл
-                    if(_hard_end_handle == CANCEL_CYCLE) {
-                        // завершаем весь цикл
-                        _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
-                        canceled = true;
-                    } // иначе STOP_MOTOR - останавливается только этот мотор
-                    
-                } else if( _cstatuses[i].calibrate_mode == NONE &&
-                        (_cstatuses[i].dir > 0 ?
-                            _smotors[i]->max_end_strategy != INF &&
-                                _smotors[i]->current_pos + (long long)_smotors[i]->distance_per_step > _smotors[i]->max_pos :
-                            _smotors[i]->min_end_strategy != INF &&
-                                _smotors[i]->current_pos - (long long)_smotors[i]->distance_per_step < _smotors[i]->min_pos) ) {
-                    // выход за пределы виртуальной границы:
-                    // не в режиме калибровки, включены виртуальные границы координаты и
-                    // собираемся выйти за виртуальные границы во время предстоящего шага -
-                    // завершаем вращение для этого мотора
-                    _cstatuses[i].stopped = true;
-                    
-                    // обновим статус мотора
-                    _smotors[i]->status = STEPPER_STATUS_FINISHED;
-                        
-                    // обозначим ошибку
-                    if(_cstatuses[i].dir < 0) {
-                        _smotors[i]->error |= STEPPER_ERROR_SOFT_END_MIN;
-                    } else {
-                        _smotors[i]->error |= STEPPER_ERROR_SOFT_END_MAX;
-                    }
-                    
-                    // как себя вести - остановить только этот мотор (в любом случае) или
-                    // сразу завершить весь цикл
-                    if(_soft_end_handle == CANCEL_CYCLE) {
-                        // завершаем весь цикл
-                        _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
-                        canceled = true;
-                    } // иначе STOP_MOTOR - останавливается только этот мотор
-                    
-                } else if( _cstatuses[i].calibrate_mode == CALIBRATE_BOUNDS_MAX_POS &&
-                        _cstatuses[i].dir < 0 &&
-                        _smotors[i]->current_pos - (long long)_smotors[i]->distance_per_step < _smotors[i]->min_pos ) {
-                    // в режиме калибровки размера рабочей области при движении влево
-                    // собираемся сместиться ниже нижней виртуальной границы
-                    // во время предстоящего шага - завершаем вращение для этого мотора
-                    _cstatuses[i].stopped = true;
-                    
-                    // обновим статус мотора
-                    _smotors[i]->status = STEPPER_STATUS_FINISHED;
-                    
-                    // обозначим ошибку мотора
-                    _smotors[i]->error |= STEPPER_ERROR_SOFT_END_MIN;
-                    
-                    // как себя вести - остановить только этот мотор (в любом случае) или
-                    // сразу завершить весь цикл
-                    if(_soft_end_handle == CANCEL_CYCLE) {
-                        // завершаем весь цикл
-                        _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
-                        canceled = true;
-                    } // иначе STOP_MOTOR - останавливается только этот мотор
-                }
-            } else if(_cstatuses[i].step_timer < _timer_period_us*2 && _cstatuses[i].step_timer >= _timer_period_us) {
-                // >>>За 1 импульс до обнуления таймера
-                // Шаг происходит по фронту сигнала HIGH>LOW, ширина ступени HIGH при этом не важна.
-                // Поэтому сформируем ступень HIGH за один цикл таймера до сброса в LOW
-                
-                // _cstatuses[i].step_timer ~ _timer_period_us с учетом погрешности таймера (_timer_period_us) =>
-                // импульс1 - готовим шаг
-                if(_cstatuses[i].dir != 0) {
-                    digitalWrite(_smotors[i]->pin_step, HIGH);
-                }
-            } else if(_cstatuses[i].step_timer < _timer_period_us) {
-                // >>>Таймер обнулился
-                // Шагаем
-                // _cstatuses[i].step_timer ~ 0 с учетом погрешности таймера (_timer_period_us) =>
-                // импульс2 (спустя _timer_period_us микросекунд после импульса1) - совершаем шаг
-                if(_cstatuses[i].dir != 0) {
-                    digitalWrite(_smotors[i]->pin_step, LOW);
-                }
-                
-                // шагнули, отметимся в разных местах и приготовимся к следующему шагу (если он будет)
-                // даже если dir=0, аппаратный шаг не делаем, координату не двигаем,
-                // но учитываем его в счетчике пройденных шагов
-                
-                // посчитаем шаг
-                if(!_cstatuses[i].non_stop) {
-                    _cstatuses[i].step_counter--;
-                }
-                
-                // текущее положение координаты
-                if(_cstatuses[i].dir != 0) {
-                    // если значение направвления dir=0, ничего не делаем с текущим положением
-                    // иначе - в зависимости от обстоятельств
-                    if(_cstatuses[i].calibrate_mode == NONE || _cstatuses[i].calibrate_mode == CALIBRATE_BOUNDS_MAX_POS) {
-                        // не калибруем или калибруем ширину рабочего поля
-                        
-                        // обновим текущее положение координаты
-                        if(_cstatuses[i].dir > 0) {
-                            _smotors[i]->current_pos += _smotors[i]->distance_per_step;
-                        } else if(_cstatuses[i].dir < 0) {
-                            _smotors[i]->current_pos -= _smotors[i]->distance_per_step;
-                        } // else // _cstatuses[i].dir == 0 // сюда все равно не попадаем
-                        
-                        // калибруем ширину рабочего поля - сдвинем правую границу в текущее положение
-                        if(_cstatuses[i].calibrate_mode == CALIBRATE_BOUNDS_MAX_POS) {
-                            _smotors[i]->max_pos = _smotors[i]->current_pos;
-                        }
-                    } else if(_cstatuses[i].calibrate_mode == CALIBRATE_START_MIN_POS) {
-                        // режим калибровки начального положения - сбрасываем current_pos в min_pos на каждом шаге
-                        _smotors[i]->current_pos = _smotors[i]->min_pos;
-                    }
-                }
-                
-                // сделали последний шаг в серии
-                if(!_cstatuses[i].non_stop && _cstatuses[i].step_counter == 0) {
-                    // увеличиваем счетчик серий
-                    _cstatuses[i].series_counter++;
-                    
-                    // загружаем настройки для новой серии
-                    if (_cstatuses[i].series_counter < _cstatuses[i].series_count) {
-                        // заходим на новую серию внутри текущего цикла
-                        _cstatuses[i].step_count = _cstatuses[i].step_buffer[_cstatuses[i].series_counter];
-                        
-                        // задать направление
-                        _cstatuses[i].dir = _cstatuses[i].dir_buffer[_cstatuses[i].series_counter];
-                        if(_cstatuses[i].dir * _smotors[i]->dir_inv > 0) {
-                            digitalWrite(_smotors[i]->pin_dir, HIGH); // туда
-                        } else if(_cstatuses[i].dir * _smotors[i]->dir_inv < 0) {
-                            digitalWrite(_smotors[i]->pin_dir, LOW); // обратно
-                        } // else // _cstatuses[i].dir == 0
-                            // здесь можно было бы дополнительно выключить мотор
-                            // ножкой EN, но можно этого не делать, т.к. все равно
-                            // не будем пускать импульсы на движение, плюс формально
-                            // он все еще находится в рабочем состоянии, просто
-                            // ожидает шаг, который может появиться, к примеру,
-                            // в следующей серии
-                        
-                        // скорость вращения (задержка между шагами)
-                        _cstatuses[i].step_delay = _cstatuses[i].delay_buffer[_cstatuses[i].series_counter];
-                        
-                        // взводим счетчик шагов в новой серии
-                        _cstatuses[i].step_counter = _cstatuses[i].step_count;
-                        
-                        // задержку перед первым шагом ставим ниже
-                    } else {
-                        // сделали последний шаг в последней серии
-                        _smotors[i]->status = STEPPER_STATUS_FINISHED;
-                    }
-                }
-                
-                // вычисляем задержку перед следующим шагом
-                unsigned long step_delay;
-                if(_cstatuses[i].delay_source == CONSTANT) {
-                    // координата внутри серии движется с постоянной скоростью
-                    step_delay = _cstatuses[i].step_delay;
-                } if(_cstatuses[i].delay_source == BUFFER) {
-                    // координата внутри серии движется с переменной скоростью,
-                    // значения задержек получаем из буфера
-                    
-                    // вычислим время до следующего шага (step_counter уже уменьшили)
-                    step_delay = _cstatuses[i].delay_buffer[
-                        (_cstatuses[i].step_count - _cstatuses[i].step_counter) / _cstatuses[i].scale];
-                } else if(_cstatuses[i].delay_source == DYNAMIC) {
-                    // координата движется с переменной скоростью (например, рисуем дугу),
-                    // значения задержек вычисляем динамически
-                    
-                    // вычислим время до следующего шага (step_counter уже уменьшили)
-                    step_delay = _cstatuses[i].next_step_delay(
-                            _cstatuses[i].step_count - _cstatuses[i].step_counter,
-                            _cstatuses[i].curve_context);
-                }
-                
-                // проверим, корректна ли задержка
-                if(step_delay < _smotors[i]->min_step_delay) {
-                    // вычисленная задержка перед очередным шагом меньше,
-                    // чем минимально допустимая для этого мотора
-                    
-                    // посмотрим, что делать с ошибкой
-                    if(_small_step_delay_handle == FIX) {
-                        // попробуем исправить:
-                        // не будем делать шаги чаще, чем может мотор
-                        // (следует понимать, что корректность вращения уже нарушена)
-                        step_delay = _smotors[i]->min_step_delay;
-                    } else if(_small_step_delay_handle == STOP_MOTOR) {
-                        // останавливаем мотор
-                        _cstatuses[i].stopped = true;
-                        
-                        _smotors[i]->status = STEPPER_STATUS_FINISHED;
-                    } else { //if(_small_step_delay_handle == CANCEL_CYCLE) {
-                        // по умолчанию: завершаем весь цикл
-                        _cycle_error = CYCLE_ERROR_MOTOR_ERROR;
-                        canceled = true;
-                    }
-                    
-                    // в любом случае, обозначим ошибку
-                    _smotors[i]->error |= STEPPER_ERROR_STEP_DELAY_SMALL;
-                }
-                
-                // взводим таймер на новый шаг с учетом погрешности
-                // (неиспользованных микросекунд) предыдущего шага
-                _cstatuses[i].step_timer = step_delay + _cstatuses[i].step_timer;
+            _cstatuses[i].refill_elapsed += _timer_period_us;
+            continue;
+        } else if(_cstatuses[i].refill == REFILL_READY) {
+            // данные готовы (и видны полностью - см. stepper_handle_deferred)
+            _memory_barrier();
+            if(_step_deferred_apply(i)) {
+                canceled = true;
+                continue;
             }
         }
+#endif // STEPPER_DEFERRED_STEPS
+        
+        if( !(_cstatuses[i].non_stop || _cstatuses[i].step_counter > 0) || _cstatuses[i].stopped) {
+            // мотор сделал все шаги или остановлен по другой причине
+            // (например, из-за концевого датчика) - больше его не трогаем
+            continue;
+        }
+        _active_motors[active_count++] = i;
+        
+        // если хотя бы у одного мотора остались шаги или он запущен нон-стоп,
+        // то мы еще не закончили
+        finished = false;
+        
+        _cstatuses[i].step_timer -= _timer_period_us;
+        
+        canceled = _step_motor_tick(i);
     }
+    // (если цикл отменен, список уже не нужен)
+    _active_count = active_count;
+#endif // STEPPER_TIMING_WHEEL
     
     if(finished || canceled) {
         // все моторы сделали все шаги, цикл завершился
         stepper_finish_cycle();
+    } else if(_timer_period_check) {
+        // адаптивный период
+#ifdef STEPPER_TIMING_WHEEL
+        // для выбора периода нужны step_timer на текущий импульс
+        unsigned long motors = _wheel_motors;
+        while(motors != 0) {
+            int i = __builtin_ctzl(motors);
+            motors &= motors - 1;
+            _wheel_sync(i);
+        }
+#endif // STEPPER_TIMING_WHEEL
+        if(_timer_period_update()) {
+#ifdef STEPPER_TIMING_WHEEL
+            // новый период - новые импульсы для всех моторов
+            _wheel_rebuild(_wheel_motors);
+#endif // STEPPER_TIMING_WHEEL
+            if(_timer_enabled) {
+                // см. stepper_start_cycle
+                _timer_init_ISR(_timer_id, _timer_prescaler, _timer_adjustment-1);
+            }
+            // новый период - новое расписание
+            _timer_tick_sync = true;
+        }
     }
     
     // проверим, уложились ли в желаемое время
@@ -1383,14 +3483,36 @@ void _timer_handle_interrupts(int timer) {
         // обработчик работает дольше, чем таймер генерирует импульсы,
         // тайминг может быть нарушен
         
-        // фиксируем ошибку
-        _cycle_error = CYCLE_ERROR_HANDLER_TIMING_EXCEEDED;
+        // фиксируем ошибку (сообщаем о ней один раз за цикл)
+        if(_cycle_error != CYCLE_ERROR_HANDLER_TIMING_EXCEEDED) {
+            _cycle_error = CYCLE_ERROR_HANDLER_TIMING_EXCEEDED;
+            _event(STEPPER_EVENT_ERROR, NULL);
+        }
         
         // что с этим делать
         if(_cycle_timing_exceed_handle == CANCEL_CYCLE) {
             // ничего хорошего - все завершаем
             stepper_finish_cycle();
-        } // иначе игнорируем
+        } // иначе игнорируем (FIX - пропущенные импульсы догоним
+          // на следующем импульсе, см. _timer_catch_up)
+    }
+    
+#ifdef STEPPER_DEFERRED_STEPS
+    // есть работа для stepper_handle_deferred
+    if(_deferred_requested) {
+        _deferred_requested = false;
+        stepper_deferred_request();
+    }
+#endif // STEPPER_DEFERRED_STEPS
+    
+    // моторы больше не меняются
+    _memory_barrier();
+    _snapshot_seq++;
+    
+    _timer_handler_running = false;
+    if(_cycle_finished_event) {
+        _cycle_finished_event = false;
+        _event(STEPPER_EVENT_CYCLE_FINISHED, NULL);
     }
 }
 
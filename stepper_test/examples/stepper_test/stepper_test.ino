@@ -114,6 +114,72 @@ void run_test_suite() {
     // sam: ok
     // pic32: ok
     //stepper_test_suite_square_sig_issue16();
+    
+    // Automatic timer period for prepared motors
+    //stepper_test_suite_timer_period_auto();
+    
+    // Aliquant step delay with FIX handle
+    //stepper_test_suite_aliquant_step_delay_fix();
+    
+    // Adaptive timer period
+    //stepper_test_suite_timer_period_adaptive();
+    
+    // Two tick steps
+    //stepper_test_suite_two_tick_steps();
+    
+    // Dual edge steps
+    //stepper_test_suite_dual_edge();
+    
+    // Step multiplier
+    //stepper_test_suite_step_multiplier();
+    
+    // Active motors
+    //stepper_test_suite_active_motors();
+    
+    // Many motors
+    //stepper_test_suite_many_motors();
+    
+    // Static engine
+    //stepper_test_suite_static_engine();
+    
+    // Snapshot
+    //stepper_test_suite_snapshot();
+    
+    // Events
+    //stepper_test_suite_events();
+    
+    // Speed override
+    //stepper_test_suite_speed_override();
+    
+    // Feed hold: decelerate, pause, resume
+    //stepper_test_suite_feed_hold();
+    
+    // Homing: fast approach, back off, slow approach
+    //stepper_test_suite_homing();
+    
+    // Hardware end switches
+    //stepper_test_suite_endstops();
+    
+    // Deferred step data
+    //stepper_test_suite_deferred();
+    
+    // Missed timer ticks catch-up
+    //stepper_test_suite_missed_ticks();
+    
+    // Buffered steps normalization
+    //stepper_test_suite_normalize_buffered_steps();
+    
+    // Binary motion program
+    //stepper_test_suite_program();
+    
+    // G-code
+    //stepper_test_suite_gcode();
+    
+    // Host link protocol
+    //stepper_test_suite_link();
+    
+    // Backlash compensation
+    //stepper_test_suite_backlash();
 }
 
 void setup() {
@@ -11,6 +11,13 @@
 
 
 #include "stepper.h"
+#include "stepper_configure_timer.h"
+#include "stepper_lib_config.h"
+#include "stepper_static.h"
+#include "stepper_homing.h"
+#include "stepper_program.h"
+#include "stepper_gcode.h"
+#include "stepper_link.h"
 
 extern "C"{
     #include "timer_setup.h"
@@ -44,6 +51,22 @@ void timer_tick(unsigned long count) {
     }
 }
 
+#ifdef STEPPER_DEFERRED_STEPS
+/**
+ * Отложенные вычисления: по умолчанию данные для следующего шага готовим
+ * сразу в конце обработчика таймера (как программное прерывание, которое
+ * срабатывает сразу после таймера), тогда остальные тесты проходят
+ * без изменений.
+ */
+static bool deferred_immediate = true;
+
+void stepper_deferred_request() {
+    if(deferred_immediate) {
+        stepper_handle_deferred();
+    }
+}
+#endif // STEPPER_DEFERRED_STEPS
+
 
 static void test_lifecycle() {
     // проверим жизненный цикл серии шагов:
@@ -2128,240 +2151,2577 @@ static void test_issue16_square_sig() {
     //if(!ok) cout<<"square sig failed at "<<i-1<<endl;
 }
 
+// наибольший период, который тестовый таймер получает точно
+// (stepper_configure_timer_stub.cpp); 0 - без ограничения
+extern unsigned long dbg_timer_period_max;
 
-
-/////////////////////////////////////////////////////////
-// test suites
-
-/** Stepper cycle lifecycle */
-int stepper_test_suite_lifecycle() {
-    sput_start_testing();
-
-    sput_enter_suite("Stepper cycle lifecycle");
-    sput_run_test(test_lifecycle);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Stepper cycle timer period settings */
-int stepper_test_suite_timer_period() {
-    sput_start_testing();
-
-    sput_enter_suite("Stepper cycle timer period settings");
-    sput_run_test(test_timer_period);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Stepper cycle timer period is aliquant part of motor step pulse delay */
-int stepper_test_suite_timer_period_aliquant_step_delay() {
-    sput_start_testing();
+static void test_timer_period_auto() {
+    // автоматический подбор периода таймера: наибольший делитель НОД
+    // минимальных задержек всех моторов, который вмещается
+    // в самую маленькую из них 3 раза
     
-    sput_enter_suite("Stepper cycle timer period is aliquant part of motor step pulse delay");
-    sput_run_test(test_timer_period_aliquant_step_delay);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Exit bounds */
-int stepper_test_suite_exit_bounds() {
-    sput_start_testing();
+    stepper sm_x, sm_y, sm_z;
+    // X
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    // Y
+    init_stepper(&sm_y, 'y', 5, 6, 7, true, 1500, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 216000000);
+    // Z
+    init_stepper(&sm_z, 'z', 2, 3, 4, true, 10, 7500);
+    init_stepper_ends(&sm_z, NO_PIN, NO_PIN, INF, INF, 0, 100000000);
     
-    sput_enter_suite("Exit bounds");
-    sput_run_test(test_exit_bounds);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Single motor: 3 steps tick by tick on max speed */
-int stepper_test_suite_max_speed_tick_by_tick() {
-    sput_start_testing();
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
     
-    sput_enter_suite("Single motor: 3 steps tick by tick on max speed");
-    sput_run_test(test_max_speed_tick_by_tick);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Single motor: 30000 steps on max speed */
-int stepper_test_suite_max_speed_30000steps() {
-    sput_start_testing();
+    // моторы не подготовлены - подбирать не из чего
+    sput_fail_unless(stepper_timer_period_auto() == 0, "no motors: stepper_timer_period_auto() == 0");
+    sput_fail_unless(stepper_configure_timer_auto(TIMER_DEFAULT) == 0,
+        "no motors: stepper_configure_timer_auto() == 0");
     
-    sput_enter_suite("Single motor: 30000 steps on max speed");
-    sput_run_test(test_max_speed_30000steps);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Single motor: 5 steps tick by tick on aliquant speed */
-int stepper_test_suite_aliquant_speed_tick_by_tick() {
-    sput_start_testing();
+    // #1
+    // один мотор: 1000/3=333, наибольший делитель 1000, не больше 333 - 250
+    prepare_steps(&sm_x, 10, 1, 1000);
+    sput_fail_unless(stepper_timer_period_auto() == 250, "x: stepper_timer_period_auto() == 250");
+    stepper_finish_cycle();
     
-    sput_enter_suite("Single motor: 5 steps tick by tick on aliquant speed");
-    sput_run_test(test_aliquant_speed_tick_by_tick);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** 3 motors: draw triangle */
-int stepper_test_suite_draw_triangle() {
-    sput_start_testing();
+    // #2
+    // НОД(1000, 1500)=500, наибольший делитель 500, не больше 333 - 250
+    prepare_steps(&sm_x, 10, 1, 1000);
+    prepare_steps(&sm_y, 10, 1, 1500);
+    sput_fail_unless(stepper_timer_period_auto() == 250, "x+y: stepper_timer_period_auto() == 250");
+    
+    // настроим таймер и запустим цикл: 1000/250=4 импульса на шаг X,
+    // 1500/250=6 импульсов на шаг Y
+    sput_fail_unless(stepper_configure_timer_auto(TIMER_DEFAULT) == 250,
+        "x+y: stepper_configure_timer_auto() == 250");
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "x+y: stepper_cycle_running() == true");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "x+y: stepper_cycle_error() == CYCLE_ERROR_NONE");
     
-    sput_enter_suite("3 motors: draw triangle");
-    sput_run_test(test_draw_triangle);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Small step delay error handlers */
-int stepper_test_suite_small_step_delay_handlers() {
-    sput_start_testing();
+    // 10 шагов Y: 6*10=60 импульсов + 1 финальный
+    timer_tick(60);
+    sput_fail_unless(sm_x.current_pos == 7500*10, "x+y: x.pos == 7500*10");
+    sput_fail_unless(sm_y.current_pos == 7500*10, "x+y: y.pos == 7500*10");
+    sput_fail_unless(stepper_cycle_running(), "x+y: stepper_cycle_running() == true");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "x+y: stepper_cycle_running() == false");
     
-    sput_enter_suite("Small step delay error handlers");
-    sput_run_test(test_small_step_delay_handlers);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Moving with variable speed: buffered steps tick by tick */
-int stepper_test_suite_buffered_steps_tick_by_tick() {
-    sput_start_testing();
+    // #3
+    // быстрый мотор: НОД(1000, 1500, 10)=10, 10/3=3, наибольший делитель 10, не больше 3 - 2
+    prepare_steps(&sm_x, 10, 1, 1000);
+    prepare_steps(&sm_y, 10, 1, 1500);
+    prepare_steps(&sm_z, 10, 1, 10);
+    sput_fail_unless(stepper_timer_period_auto() == 2, "x+y+z: stepper_timer_period_auto() == 2");
+    stepper_finish_cycle();
     
-    sput_enter_suite("Moving with variable speed: buffered steps tick by tick");
-    sput_run_test(test_buffered_steps_tick_by_tick);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Moving with variable speed: buffered steps */
-int stepper_test_suite_buffered_steps() {
-    sput_start_testing();
+    // #4
+    // НОД - простое число: 1009/3=336, делители 1009 - только 1 и 1009
+    stepper sm_p;
+    init_stepper(&sm_p, 'p', 11, 12, 13, false, 1009, 7500);
+    prepare_steps(&sm_p, 10, 1, 1009);
+    sput_fail_unless(stepper_timer_period_auto() == 1, "prime: stepper_timer_period_auto() == 1");
+    stepper_finish_cycle();
     
-    sput_enter_suite("Moving with variable speed: buffered steps");
-    sput_run_test(test_buffered_steps);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Buffered steps skip steps with dir=0 */
-int stepper_test_suite_skip_steps_dir_zero() {
-    sput_start_testing();
+    // #5
+    // таймер не может получить 250 точно (короткий счетчик, не больше 200):
+    // берем следующий по убыванию делитель НОД(1000, 1500)=500 - 125
+    dbg_timer_period_max = 200;
+    prepare_steps(&sm_x, 10, 1, 1000);
+    prepare_steps(&sm_y, 10, 1, 1500);
+    sput_fail_unless(stepper_timer_period_auto() == 250, "short timer: stepper_timer_period_auto() == 250");
+    sput_fail_unless(stepper_configure_timer_auto(TIMER_DEFAULT) == 125,
+        "short timer: stepper_configure_timer_auto() == 125");
+    stepper_finish_cycle();
     
-    sput_enter_suite("Buffered steps skip steps with dir=0");
-    sput_run_test(test_skip_steps_dir_zero);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Step-dir driver std divider modes: 1/1, 1/18, 1/16, 1/32 */
-int stepper_test_suite_driver_std_modes() {
-    sput_start_testing();
+    // #6
+    // FIX: 1000/3=333 таймеру не подходит - ищем делитель 1000 (200)
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, FIX);
+    prepare_steps(&sm_x, 10, 1, 1000);
+    sput_fail_unless(stepper_timer_period_auto() == 333, "short timer fix: stepper_timer_period_auto() == 333");
+    sput_fail_unless(stepper_configure_timer_auto(TIMER_DEFAULT) == 200,
+        "short timer fix: stepper_configure_timer_auto() == 200");
+    stepper_finish_cycle();
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, CANCEL_CYCLE);
+    dbg_timer_period_max = 0;
     
-    sput_enter_suite("Step-dir driver std divider modes: 1/1, 1/18, 1/16, 1/32");
-    sput_run_test(test_driver_std_modes);
-
-    sput_finish_testing();
-    return sput_get_return_value();
+    // вернем период таймера, с которым работают остальные тесты
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
 }
 
-/** Step-dir driver std divider modes for 2 motors at a time */
-int stepper_test_suite_driver_std_modes_2motors() {
-    sput_start_testing();
+static void test_aliquant_step_delay_fix() {
+    // период таймера некратен минимальной задержке между шагами:
+    // по умолчанию цикл не запускается, с FIX - запускается,
+    // неиспользованные микросекунды переносятся на следующий шаг
     
-    sput_enter_suite("Step-dir driver std divider modes for 2 motors at a time");
-    sput_run_test(test_driver_std_modes_2motors);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Single motor: exit bounds (issue #1) - whirl */
-int stepper_test_suite_issue1_exit_bounds_whirl() {
-    sput_start_testing();
+    // мотор - минимальная задержка между шагами 1000 мкс
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
     
-    sput_enter_suite("Single motor: exit bounds (issue #1) - whirl");
-    sput_run_test(test_issue1_exit_bounds_whirl);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Single motor: exit bounds (issue #1) - steps */
-int stepper_test_suite_issue1_exit_bounds_steps() {
-    sput_start_testing();
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
     
-    sput_enter_suite("Single motor: exit bounds (issue #1) - steps");
-    sput_run_test(test_issue1_exit_bounds_steps);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Single motor: exit bounds (issue #9) - steps */
-int stepper_test_suite_issue9_exit_bounds_steps() {
-    sput_start_testing();
+    // 1000 не делится на 300
+    stepper_configure_timer(300, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 3000);
     
-    sput_enter_suite("Single motor: exit bounds (issue #9) - steps");
-    sput_run_test(test_issue9_exit_bounds_steps);
-
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-/** Single motor: test square signal (issue #16) */
-int stepper_test_suite_issue16_square_sig() {
-    sput_start_testing();
+    // #1
+    // по умолчанию - CANCEL_CYCLE
+    prepare_steps(&sm_x, 300, 1, 1000);
+    stepper_start_cycle();
+    sput_fail_unless(!stepper_cycle_running(), "cancel: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_TIMER_PERIOD_ALIQUANT_STEP_DELAY,
+        "cancel: stepper_cycle_error() == CYCLE_ERROR_TIMER_PERIOD_ALIQUANT_STEP_DELAY");
+    stepper_finish_cycle();
     
-    sput_enter_suite("Single motor: test square signal (issue #16)");
-    sput_run_test(test_issue16_square_sig);
+    // #2
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, FIX);
     
-    sput_finish_testing();
-    return sput_get_return_value();
-}
-
-
-/** All tests in one bundle */
-int stepper_test_suite() {
-    sput_start_testing();
-
-    sput_enter_suite("Stepper cycle lifecycle");
-    sput_run_test(test_lifecycle);
+    // кратность не нужна: 1000/3=333
+    prepare_steps(&sm_x, 300, 1, 1000);
+    sput_fail_unless(stepper_timer_period_auto() == 333, "fix: stepper_timer_period_auto() == 333");
     
-    sput_enter_suite("Stepper cycle timer period settings");
-    sput_run_test(test_timer_period);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "fix: stepper_cycle_running() == true");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "fix: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // первый шаг - на импульсе 3 (900 мкс от запуска), дальше шаги
+    // не чаще минимальной задержки: 1000 мкс, округленные вверх
+    // до целого количества периодов, - 4 импульса (1200 мкс),
+    // шаги на импульсах 3, 7, 11, ...
+    int prev_tick = 0;
+    bool intervals_ok = true;
+    for(int tick = 1; tick <= 30; tick++) {
+        long pos = sm_x.current_pos;
+        timer_tick(1);
+        if(sm_x.current_pos != pos) {
+            if(prev_tick > 0 && tick - prev_tick != 4) {
+                intervals_ok = false;
+            }
+            prev_tick = tick;
+        }
+    }
+    sput_fail_unless(intervals_ok, "fix: step interval is 4 ticks");
+    sput_fail_unless(sm_x.current_pos == 7500*7, "fix: 30 ticks: x.pos == 7500*7");
     
-    sput_enter_suite("Stepper cycle timer period is aliquant part of motor step pulse delay");
-    sput_run_test(test_timer_period_aliquant_step_delay);
+    // 300 шагов - 3+4*299=1199 импульсов
+    timer_tick(1168);
+    sput_fail_unless(sm_x.current_pos == 7500*299, "fix: 1198 ticks: x.pos == 7500*299");
+    timer_tick(1);
+    sput_fail_unless(sm_x.current_pos == 7500*300, "fix: 1199 ticks: x.pos == 7500*300");
+    sput_fail_unless(stepper_cycle_running(), "fix: stepper_cycle_running() == true");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "fix: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "fix: stepper_cycle_error() == CYCLE_ERROR_NONE");
     
-    sput_enter_suite("Exit bounds");
-    sput_run_test(test_exit_bounds);
+    // #3
+    // задержка 1300 мкс (больше минимальной): шаги на импульсах
+    // 4, 8, 13, 17, 21, 26, ...: промежутки 4 или 5 импульсов
+    // (1200 или 1500 мкс, не короче минимальной задержки), но каждые
+    // 13 импульсов (3900 мкс) - ровно 3 шага
+    prepare_steps(&sm_x, 300, 1, 1300);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "fix 1300: stepper_cycle_running() == true");
     
-    sput_enter_suite("Single motor: 3 steps tick by tick on max speed");
-    sput_run_test(test_max_speed_tick_by_tick);
+    prev_tick = 0;
+    intervals_ok = true;
+    for(int tick = 1; tick <= 26; tick++) {
+        long pos = sm_x.current_pos;
+        timer_tick(1);
+        if(sm_x.current_pos != pos) {
+            int interval = tick - prev_tick;
+            if(interval != 4 && interval != 5) {
+                intervals_ok = false;
+            }
+            prev_tick = tick;
+        }
+    }
+    sput_fail_unless(intervals_ok, "fix 1300: step interval is 4 or 5 ticks");
+    sput_fail_unless(sm_x.current_pos == 7500*6, "fix 1300: 26 ticks: x.pos == 7500*6");
     
-    sput_enter_suite("Single motor: 30000 steps on max speed");
-    sput_run_test(test_max_speed_30000steps);
+    // 300 шагов - 1300 импульсов (390000 мкс)
+    timer_tick(1269);
+    sput_fail_unless(sm_x.current_pos == 7500*299, "fix 1300: 1295 ticks: x.pos == 7500*299");
+    timer_tick(5);
+    sput_fail_unless(sm_x.current_pos == 7500*300, "fix 1300: 1300 ticks: x.pos == 7500*300");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "fix 1300: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "fix 1300: stepper_cycle_error() == CYCLE_ERROR_NONE");
     
-    sput_enter_suite("Single motor: 5 steps tick by tick on aliquant speed");
-    sput_run_test(test_aliquant_speed_tick_by_tick);
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, CANCEL_CYCLE);
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_timer_period_adaptive() {
+    // адаптивный период таймера: увеличиваем период, когда моторы
+    // движутся медленно, и уменьшаем обратно, когда нужно быстрее
+    
+    // минимальная задержка между шагами моторов - 300 мкс
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 300, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    init_stepper(&sm_y, 'y', 5, 6, 7, false, 300, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    // базовый период 100 мкс
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    stepper_set_timer_period_adaptive(true);
+    
+    // X: 3 быстрых шага, 2 медленных, 3 быстрых
+    unsigned long step_buffer[] = {3, 2, 3};
+    int dir_buffer[] = {1, 1, 1};
+    unsigned long delay_buffer[] = {300, 1600, 300};
+    prepare_buffered_steps(&sm_x, 3, step_buffer, dir_buffer, delay_buffer);
+    // Y: 6 шагов с задержкой 1200 мкс (подходит период до 400 мкс)
+    prepare_steps(&sm_y, 6, 1, 1200);
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "stepper_cycle_running() == true");
+    
+    // X быстрый - начинаем с базового периода
+    sput_fail_unless(stepper_cycle_timer_period() == 100, "start: period == 100");
+    
+    // X: шаги на импульсах 3, 6, 9 - дальше серия с задержкой 1600 мкс
+    timer_tick(9);
+    sput_fail_unless(sm_x.current_pos == 7500*3, "9 ticks: x.pos == 7500*3");
+    // обоим моторам подходит 400 мкс, но Y до шага 300 мкс - ждем
+    sput_fail_unless(stepper_cycle_timer_period() == 100, "9 ticks: period == 100");
+    sput_fail_unless(stepper_cycle_timer_period_changes() == 0, "9 ticks: period changes == 0");
+    
+    // Y: шаг на импульсе 12 (1200 мкс) - теперь можно
+    timer_tick(3);
+    sput_fail_unless(sm_y.current_pos == 7500*1, "12 ticks: y.pos == 7500*1");
+    sput_fail_unless(stepper_cycle_timer_period() == 400, "12 ticks: period == 400");
+    sput_fail_unless(stepper_cycle_timer_period_changes() == 1, "12 ticks: period changes == 1");
+    
+    // X: медленные шаги на импульсах 15 и 19 (2400 и 4000 мкс),
+    // дальше опять быстрая серия - сразу возвращаемся к 100 мкс
+    timer_tick(3);
+    sput_fail_unless(sm_x.current_pos == 7500*4, "15 ticks: x.pos == 7500*4");
+    sput_fail_unless(sm_y.current_pos == 7500*2, "15 ticks: y.pos == 7500*2");
+    timer_tick(4);
+    sput_fail_unless(sm_x.current_pos == 7500*5, "19 ticks: x.pos == 7500*5");
+    sput_fail_unless(stepper_cycle_timer_period() == 100, "19 ticks: period == 100");
+    sput_fail_unless(stepper_cycle_timer_period_changes() == 2, "19 ticks: period changes == 2");
+    
+    // X: быстрые шаги на импульсах 23, 26, 29 (4400, 4700, 5000 мкс) -
+    // остался Y, до шага 1000 мкс: пока хватает на 200 мкс
+    timer_tick(10);
+    sput_fail_unless(sm_x.current_pos == 7500*8, "29 ticks: x.pos == 7500*8");
+    sput_fail_unless(sm_y.current_pos == 7500*4, "29 ticks: y.pos == 7500*4");
+    sput_fail_unless(stepper_cycle_timer_period() == 200, "29 ticks: period == 200");
+    sput_fail_unless(stepper_cycle_timer_period_changes() == 3, "29 ticks: period changes == 3");
+    
+    // во время цикла режим не меняется
+    stepper_set_timer_period_adaptive(false);
+    
+    // Y: шаг на импульсе 34 (6000 мкс) - дальше 400 мкс
+    timer_tick(5);
+    sput_fail_unless(sm_y.current_pos == 7500*5, "34 ticks: y.pos == 7500*5");
+    sput_fail_unless(stepper_cycle_timer_period() == 400, "34 ticks: period == 400");
+    sput_fail_unless(stepper_cycle_timer_period_changes() == 4, "34 ticks: period changes == 4");
+    
+    // Y: последний шаг на импульсе 37 (7200 мкс) + финальный импульс
+    timer_tick(3);
+    sput_fail_unless(sm_y.current_pos == 7500*6, "37 ticks: y.pos == 7500*6");
+    sput_fail_unless(stepper_cycle_running(), "37 ticks: stepper_cycle_running() == true");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "38 ticks: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // после цикла - базовый период
+    sput_fail_unless(stepper_cycle_timer_period() == 100, "finished: period == 100");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_set_timer_period_adaptive(false);
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_two_tick_steps() {
+    // шаг в 2 импульса таймера: проверка границ вместе с HIGH
+    
+    // минимальная задержка между шагами 200 мкс - 2 периода таймера
+    int x_step = 8;
+    int x_max = 11;
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', x_step, 9, 10, false, 200, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, x_max, CONST, CONST, 0, 300000000);
+    digitalWrite(x_max, LOW);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    // #1
+    // по умолчанию шаг в 3 импульса - в 200 мкс не влезает
+    prepare_steps(&sm_x, 5, 1, 200);
+    sput_fail_unless(stepper_timer_period_auto() == 50, "3 ticks: stepper_timer_period_auto() == 50");
+    stepper_start_cycle();
+    sput_fail_unless(!stepper_cycle_running(), "3 ticks: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_TIMER_PERIOD_TOO_LONG,
+        "3 ticks: stepper_cycle_error() == CYCLE_ERROR_TIMER_PERIOD_TOO_LONG");
+    
+    // #2
+    stepper_set_two_tick_steps(true);
+    
+    prepare_steps(&sm_x, 5, 1, 200);
+    sput_fail_unless(stepper_timer_period_auto() == 100, "2 ticks: stepper_timer_period_auto() == 100");
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "2 ticks: stepper_cycle_running() == true");
+    
+    // каждый шаг: проверка+HIGH, LOW
+    bool ok = true;
+    for(int step = 1; step <= 5 && ok; step++) {
+        timer_tick(1);
+        ok = digitalRead(x_step) == 1 && sm_x.current_pos == 7500*(step-1);
+        timer_tick(1);
+        if(ok) ok = digitalRead(x_step) == 0 && sm_x.current_pos == 7500*step;
+    }
+    sput_fail_unless(ok, "2 ticks: HIGH, LOW on each step");
+    sput_fail_unless(sm_x.current_pos == 7500*5, "2 ticks: x.pos == 7500*5");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "2 ticks: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "2 ticks: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // #3
+    // концевик проверяется перед HIGH
+    prepare_steps(&sm_x, 5, 1, 200);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    timer_tick(2);
+    sput_fail_unless(sm_x.current_pos == 7500, "end: x.pos == 7500");
+    digitalWrite(x_max, HIGH);
+    timer_tick(1);
+    sput_fail_unless(digitalRead(x_step) == 0, "end: pin_val == LOW");
+    sput_fail_unless(!stepper_cycle_running(), "end: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_MOTOR_ERROR,
+        "end: stepper_cycle_error() == CYCLE_ERROR_MOTOR_ERROR");
+    sput_fail_unless(sm_x.error & STEPPER_ERROR_HARD_END_MAX, "end: x.error & STEPPER_ERROR_HARD_END_MAX");
+    digitalWrite(x_max, LOW);
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_set_two_tick_steps(false);
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_dual_edge() {
+    // шаг по обоим фронтам сигнала step (dual_edge):
+    // одно переключение ножки step на шаг
+    
+    int x_step = 8;
+    int y_step = 5;
+    stepper sm_x, sm_y;
+    // X - dual_edge, минимальная задержка 200 мкс - 2 периода таймера
+    init_stepper(&sm_x, 'x', x_step, 9, 10, false, 200, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    init_stepper_dual_edge(&sm_x, true);
+    // Y - обычный шаг по HIGH>LOW
+    init_stepper(&sm_y, 'y', y_step, 6, 7, false, 300, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    digitalWrite(y_step, LOW);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    sput_fail_unless(digitalRead(x_step) == 0, "init: x.pin_step == LOW");
+    
+    // #1
+    // X: 7 шагов по 2 импульса, Y: 4 шага по 3 импульса
+    prepare_steps(&sm_x, 7, 1, 200);
+    prepare_steps(&sm_y, 4, 1, 300);
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    sput_fail_unless(stepper_timer_period_auto() == 100, "stepper_timer_period_auto() == 100");
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "stepper_cycle_running() == true");
+    
+    int x_toggles = 0;
+    int y_falls = 0;
+    bool x_ok = true;
+    int x_prev = digitalRead(x_step);
+    int y_prev = digitalRead(y_step);
+    for(int tick = 1; tick <= 14; tick++) {
+        timer_tick(1);
+        if(digitalRead(x_step) != x_prev) {
+            x_toggles++;
+            // переключение - только на импульсе шага
+            if(tick % 2 != 0) {
+                x_ok = false;
+            }
+        }
+        if(y_prev == 1 && digitalRead(y_step) == 0) {
+            y_falls++;
+        }
+        x_prev = digitalRead(x_step);
+        y_prev = digitalRead(y_step);
+    }
+    sput_fail_unless(x_ok, "x: toggle on step tick only");
+    sput_fail_unless(x_toggles == 7, "x: toggles == step_count == 7");
+    sput_fail_unless(sm_x.current_pos == 7500*7, "x: x.pos == 7500*7");
+    // нечетное количество переключений
+    sput_fail_unless(digitalRead(x_step) == 1, "x: pin_step == HIGH");
+    sput_fail_unless(y_falls == 4, "y: HIGH>LOW == step_count == 4");
+    sput_fail_unless(sm_y.current_pos == 7500*4, "y: y.pos == 7500*4");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "stepper_cycle_running() == false");
+    
+    // #2
+    // вместе с шагом в 2 импульса - шаг в 1 импульс
+    stepper_set_two_tick_steps(true);
+    init_stepper(&sm_x, 'x', x_step, 9, 10, false, 100, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    init_stepper_dual_edge(&sm_x, true);
+    
+    prepare_steps(&sm_x, 5, 1, 100);
+    sput_fail_unless(stepper_timer_period_auto() == 100, "1 tick: stepper_timer_period_auto() == 100");
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "1 tick: stepper_cycle_running() == true");
+    x_toggles = 0;
+    x_prev = digitalRead(x_step);
+    for(int tick = 1; tick <= 5; tick++) {
+        timer_tick(1);
+        if(digitalRead(x_step) != x_prev) {
+            x_toggles++;
+        }
+        x_prev = digitalRead(x_step);
+    }
+    sput_fail_unless(x_toggles == 5, "1 tick: toggles == step_count == 5");
+    sput_fail_unless(sm_x.current_pos == 7500*5, "1 tick: x.pos == 7500*5");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "1 tick: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "1 tick: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_set_two_tick_steps(false);
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_step_multiplier() {
+    // группировка шагов: несколько шагов подряд на одном импульсе таймера
+    
+    int x_step = 8;
+    stepper sm_x;
+    // минимальная задержка между шагами 100 мкс - меньше 3х периодов таймера
+    init_stepper(&sm_x, 'x', x_step, 9, 10, false, 100, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    // #1
+    // без группировки шаги в 3 импульса по 100 мкс не влезают
+    prepare_steps(&sm_x, 22, 1, 100);
+    stepper_start_cycle();
+    sput_fail_unless(!stepper_cycle_running(), "no groups: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_TIMER_PERIOD_TOO_LONG,
+        "no groups: stepper_cycle_error() == CYCLE_ERROR_TIMER_PERIOD_TOO_LONG");
+    
+    // #2
+    // группируем шаги чаще, чем раз в 400 мкс: по 4 шага раз в 400 мкс
+    stepper_set_step_multiplier_threshold(400);
+    
+    prepare_steps(&sm_x, 22, 1, 100);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "groups: stepper_cycle_running() == true");
+    
+    timer_tick(3);
+    sput_fail_unless(digitalRead(x_step) == 1, "groups: 3 ticks: pin_step == HIGH");
+    sput_fail_unless(sm_x.current_pos == 0, "groups: 3 ticks: x.pos == 0");
+    timer_tick(1);
+    sput_fail_unless(digitalRead(x_step) == 0, "groups: 4 ticks: pin_step == LOW");
+    sput_fail_unless(sm_x.current_pos == 7500*4, "groups: 4 ticks: x.pos == 7500*4");
+    
+    // группы на импульсах 8, 12, 16, 20
+    timer_tick(16);
+    sput_fail_unless(sm_x.current_pos == 7500*20, "groups: 20 ticks: x.pos == 7500*20");
+    
+    // остались 2 шага - короткая группа, но не раньше, чем через 3 импульса
+    timer_tick(2);
+    sput_fail_unless(sm_x.current_pos == 7500*20, "groups: 22 ticks: x.pos == 7500*20");
+    timer_tick(1);
+    sput_fail_unless(sm_x.current_pos == 7500*22, "groups: 23 ticks: x.pos == 7500*22");
+    sput_fail_unless(stepper_cycle_running(), "groups: stepper_cycle_running() == true");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "groups: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "groups: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // #3
+    // виртуальная граница проверяется для всей группы
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, CONST, CONST, 0, 7500*10);
+    prepare_steps(&sm_x, 22, 1, 100);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    timer_tick(12);
+    sput_fail_unless(sm_x.current_pos == 7500*8, "bounds: x.pos == 7500*8");
+    sput_fail_unless(!stepper_cycle_running(), "bounds: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.error & STEPPER_ERROR_SOFT_END_MAX, "bounds: x.error & STEPPER_ERROR_SOFT_END_MAX");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_set_step_multiplier_threshold(0);
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_active_motors() {
+    // моторы, которые закончили вращение, убираются из обработки,
+    // остальные продолжают шагать без изменения тайминга
+    
+    int x_step = 8;
+    int y_step = 5;
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', x_step, 9, 10, false, 300, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    init_stepper(&sm_y, 'y', y_step, 6, 7, false, 300, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    // #1
+    // X: 2 шага, Y: 5 шагов, шаг - 3 импульса
+    prepare_steps(&sm_x, 2, 1, 300);
+    prepare_steps(&sm_y, 5, 1, 300);
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    stepper_start_cycle();
+    
+    timer_tick(6);
+    sput_fail_unless(sm_x.current_pos == 7500*2, "#1: x.pos == 7500*2");
+    sput_fail_unless(sm_y.current_pos == 7500*2, "#1: y.pos == 7500*2");
+    
+    // X больше не шагает, Y шагает каждые 3 импульса
+    bool ok = true;
+    for(int step = 3; step <= 5 && ok; step++) {
+        timer_tick(2);
+        ok = digitalRead(y_step) == 1 && sm_y.current_pos == 7500*(step-1);
+        timer_tick(1);
+        if(ok) ok = digitalRead(y_step) == 0 && sm_y.current_pos == 7500*step &&
+            digitalRead(x_step) == 0 && sm_x.current_pos == 7500*2;
+    }
+    sput_fail_unless(ok, "#1: y steps, x stays");
+    sput_fail_unless(stepper_cycle_running(), "#1: stepper_cycle_running() == true");
+    
+    // цикл завершается на следующем импульсе после последнего шага
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "#1: stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "#1: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // #2
+    // в следующем цикле список моторов собирается заново
+    prepare_steps(&sm_x, 3, 1, 300);
+    prepare_steps(&sm_y, 1, -1, 300);
+    stepper_start_cycle();
+    timer_tick(9);
+    sput_fail_unless(sm_x.current_pos == 7500*5, "#2: x.pos == 7500*5");
+    sput_fail_unless(sm_y.current_pos == 7500*4, "#2: y.pos == 7500*4");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "#2: stepper_cycle_running() == false");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_many_motors() {
+    // все MAX_STEPPERS моторов в одном цикле:
+    // мотор i делает 3 шага с задержкой 300*(i+1) мкс
+    
+    // все моторы на одних ножках - положение считаем программно
+    int x_step = 8;
+    stepper sm[MAX_STEPPERS];
+    for(int i = 0; i < MAX_STEPPERS; i++) {
+        init_stepper(&sm[i], 'a' + i, x_step, 9, 10, false, 300, 7500);
+        init_stepper_ends(&sm[i], NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    }
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    for(int i = 0; i < MAX_STEPPERS; i++) {
+        prepare_steps(&sm[i], 3, 1, 300*(i+1));
+        sm[i].current_pos = 0;
+    }
+    stepper_start_cycle();
+    sput_fail_unless(stepper_cycle_running(), "stepper_cycle_running() == true");
+    
+    // шаг мотора i - каждые 3*(i+1) импульса
+    bool ok = true;
+    int tick;
+    for(tick = 1; tick <= 9*MAX_STEPPERS && ok; tick++) {
+        timer_tick(1);
+        for(int i = 0; i < MAX_STEPPERS && ok; i++) {
+            int steps = tick / (3*(i+1));
+            ok = sm[i].current_pos == 7500*(steps < 3 ? steps : 3);
+        }
+    }
+    sput_fail_unless(ok, "each motor steps on its ticks");
+    sput_fail_unless(stepper_cycle_running(), "last step: stepper_cycle_running() == true");
+    
+    // цикл завершается на следующем импульсе после последнего шага
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "stepper_cycle_running() == false");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_static_engine() {
+    // статический движок: моторы и период таймера - параметры шаблонов
+    // (обработчик таймера вызываем напрямую, основной движок не трогаем)
+    typedef stepper_static_motor<8, 9, 10, false, 300, 7500> motor_x;
+    typedef stepper_static_motor<5, 6, 7, true, 300, 7500, NO_PIN, 11> motor_y;
+    typedef stepper_static<100, motor_x, motor_y> engine;
+    
+    sput_fail_unless(engine::motor_count == 2, "motor_count == 2");
+    
+    digitalWrite(11, LOW);
+    engine::init();
+    engine::set_current_pos<0>(0);
+    engine::set_current_pos<1>(0);
+    
+    // #1
+    // X: 3 шага по 3 импульса, Y: 2 шага по 6 импульсов
+    sput_fail_unless(engine::prepare_steps<0>(3, 1, 300), "prepare x: true");
+    sput_fail_unless(!engine::prepare_steps<1>(2, -1, 200), "prepare y, small delay: false");
+    sput_fail_unless(engine::prepare_steps<1>(2, -1, 600), "prepare y: true");
+    sput_fail_unless(digitalRead(9) == HIGH, "x: pin_dir == HIGH");
+    sput_fail_unless(digitalRead(6) == HIGH, "y (inverted): pin_dir == HIGH");
+    
+    sput_fail_unless(engine::start_cycle(), "start_cycle() == true");
+    sput_fail_unless(engine::cycle_running(), "cycle_running() == true");
+    sput_fail_unless(digitalRead(10) == LOW, "x: pin_en == LOW");
+    sput_fail_unless(!engine::start_cycle(), "start again: start_cycle() == false");
+    
+    bool ok = true;
+    for(int tick = 1; tick <= 12 && ok; tick++) {
+        engine::handle_interrupts();
+        long long x_steps = tick / 3 < 3 ? tick / 3 : 3;
+        ok = engine::current_pos<0>() == 7500*x_steps &&
+            engine::current_pos<1>() == -7500*(tick / 6) &&
+            digitalRead(8) == (tick % 3 == 2 && tick < 9 ? HIGH : LOW);
+    }
+    sput_fail_unless(ok, "x and y step on their ticks");
+    sput_fail_unless(engine::cycle_running(), "last step: cycle_running() == true");
+    
+    engine::handle_interrupts();
+    sput_fail_unless(!engine::cycle_running(), "cycle_running() == false");
+    sput_fail_unless(digitalRead(10) == HIGH, "x: pin_en == HIGH");
+    
+    // #2
+    // концевик останавливает мотор перед шагом
+    engine::prepare_steps<1>(5, 1, 300);
+    engine::start_cycle();
+    engine::handle_interrupts();
+    engine::handle_interrupts();
+    engine::handle_interrupts();
+    sput_fail_unless(engine::current_pos<1>() == -7500, "end: y.pos == -7500");
+    digitalWrite(11, HIGH);
+    engine::handle_interrupts();
+    sput_fail_unless(engine::stopped<1>(), "end: y stopped");
+    engine::handle_interrupts();
+    engine::handle_interrupts();
+    sput_fail_unless(engine::current_pos<1>() == -7500, "end: y.pos == -7500");
+    sput_fail_unless(!engine::cycle_running(), "end: cycle_running() == false");
+    digitalWrite(11, LOW);
+}
+
+static void test_snapshot() {
+    // снимок положения, статуса и ошибок моторов
+    
+    int x_max = 11;
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 600, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, x_max, CONST, CONST, 0, 300000000);
+    init_stepper(&sm_y, 'y', 5, 6, 7, false, 600, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    digitalWrite(x_max, LOW);
+    
+    stepper* smotors[] = {&sm_x, &sm_y};
+    stepper_snapshot_t snapshots[2];
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_set_error_handle_strategy(STOP_MOTOR, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE);
+    
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    prepare_steps(&sm_x, 5, 1, 600);
+    prepare_steps(&sm_y, 5, -1, 600);
+    
+    stepper_snapshot(smotors, 2, snapshots);
+    sput_fail_unless(snapshots[0].status == STEPPER_STATUS_IDLE, "prepared: x.status == STEPPER_STATUS_IDLE");
+    
+    stepper_start_cycle();
+    timer_tick(6);
+    stepper_snapshot(smotors, 2, snapshots);
+    sput_fail_unless(snapshots[0].current_pos == 7500*2, "tick6: x.pos == 7500*2");
+    sput_fail_unless(snapshots[1].current_pos == -7500*2, "tick6: y.pos == -7500*2");
+    sput_fail_unless(snapshots[0].status == STEPPER_STATUS_RUNNING, "tick6: x.status == STEPPER_STATUS_RUNNING");
+    sput_fail_unless(snapshots[0].error == STEPPER_ERROR_NONE, "tick6: x.error == STEPPER_ERROR_NONE");
+    
+    // X останавливается концевиком, Y доходит до конца
+    digitalWrite(x_max, HIGH);
+    timer_tick(6);
+    stepper_snapshot(smotors, 2, snapshots);
+    sput_fail_unless(snapshots[0].current_pos == 7500*2, "end: x.pos == 7500*2");
+    sput_fail_unless(snapshots[0].status == STEPPER_STATUS_FINISHED, "end: x.status == STEPPER_STATUS_FINISHED");
+    sput_fail_unless(snapshots[0].error & STEPPER_ERROR_HARD_END_MAX, "end: x.error & STEPPER_ERROR_HARD_END_MAX");
+    sput_fail_unless(snapshots[1].current_pos == -7500*4, "end: y.pos == -7500*4");
+    sput_fail_unless(snapshots[1].status == STEPPER_STATUS_RUNNING, "end: y.status == STEPPER_STATUS_RUNNING");
+    digitalWrite(x_max, LOW);
+    
+    timer_tick(7);
+    stepper_snapshot(smotors, 2, snapshots);
+    sput_fail_unless(snapshots[1].current_pos == -7500*5, "finish: y.pos == -7500*5");
+    sput_fail_unless(snapshots[1].status == STEPPER_STATUS_FINISHED, "finish: y.status == STEPPER_STATUS_FINISHED");
+    sput_fail_unless(!stepper_cycle_running(), "finish: stepper_cycle_running() == false");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_set_error_handle_strategy(CANCEL_CYCLE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE);
+}
+
+// счетчики событий для test_events
+static int _test_events[STEPPER_EVENT_COUNT];
+static stepper* _test_event_motor = NULL;
+// для запуска следующего цикла прямо из обработчика прерывания
+static stepper* _test_chain_motor = NULL;
+
+static void _test_count_event(stepper_event_t event, stepper* smotor) {
+    _test_events[event]++;
+    if(smotor != NULL) {
+        _test_event_motor = smotor;
+    }
+}
+
+static void _test_chain_cycle(stepper_event_t event, stepper* smotor) {
+    _test_events[event]++;
+    if(_test_chain_motor != NULL) {
+        // следующий цикл - сразу после завершения предыдущего
+        prepare_steps(_test_chain_motor, 2, 1, 300);
+        stepper_start_cycle();
+        _test_chain_motor = NULL;
+    }
+}
+
+static void test_events() {
+    // события цикла: сразу из обработчика прерывания и через очередь
+    
+    int x_max = 11;
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 300, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, x_max, CONST, CONST, 0, 300000000);
+    digitalWrite(x_max, LOW);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    stepper_handle_events();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    for(int i = 0; i < STEPPER_EVENT_COUNT; i++) {
+        _test_events[i] = 0;
+        stepper_set_event_handler((stepper_event_t)i, _test_count_event, STEPPER_EVENT_DEFERRED);
+    }
+    
+    // #1: через очередь
+    // 2 серии по 2 шага
+    unsigned long step_buffer[] = {2, 2};
+    int dir_buffer[] = {1, 1};
+    unsigned long delay_buffer[] = {300, 300};
+    sm_x.current_pos = 0;
+    prepare_buffered_steps(&sm_x, 2, step_buffer, dir_buffer, delay_buffer);
+    stepper_start_cycle();
+    
+    timer_tick(13);
+    sput_fail_unless(!stepper_cycle_running(), "deferred: stepper_cycle_running() == false");
+    sput_fail_unless(_test_events[STEPPER_EVENT_CYCLE_FINISHED] == 0,
+        "deferred: no events before stepper_handle_events");
+    
+    sput_fail_unless(stepper_handle_events() == 4, "deferred: stepper_handle_events() == 4");
+    sput_fail_unless(_test_events[STEPPER_EVENT_SERIES_FINISHED] == 2, "deferred: SERIES_FINISHED == 2");
+    sput_fail_unless(_test_events[STEPPER_EVENT_MOTOR_FINISHED] == 1, "deferred: MOTOR_FINISHED == 1");
+    sput_fail_unless(_test_events[STEPPER_EVENT_CYCLE_FINISHED] == 1, "deferred: CYCLE_FINISHED == 1");
+    sput_fail_unless(_test_events[STEPPER_EVENT_ERROR] == 0, "deferred: ERROR == 0");
+    sput_fail_unless(_test_event_motor == &sm_x, "deferred: smotor == &sm_x");
+    sput_fail_unless(stepper_handle_events() == 0, "deferred: queue is empty");
+    
+    // #2: ошибка - концевик
+    _test_events[STEPPER_EVENT_ERROR] = 0;
+    _test_events[STEPPER_EVENT_MOTOR_FINISHED] = 0;
+    _test_event_motor = NULL;
+    prepare_steps(&sm_x, 5, 1, 300);
+    stepper_start_cycle();
+    digitalWrite(x_max, HIGH);
+    timer_tick(2);
+    digitalWrite(x_max, LOW);
+    stepper_handle_events();
+    sput_fail_unless(_test_events[STEPPER_EVENT_ERROR] == 1, "error: ERROR == 1");
+    sput_fail_unless(_test_events[STEPPER_EVENT_MOTOR_FINISHED] == 1, "error: MOTOR_FINISHED == 1");
+    sput_fail_unless(_test_event_motor == &sm_x, "error: smotor == &sm_x");
+    
+    // #3: сразу из обработчика прерывания - следующий цикл
+    // запускается на том же импульсе, на котором завершился предыдущий
+    stepper_set_event_handler(STEPPER_EVENT_CYCLE_FINISHED, _test_chain_cycle, STEPPER_EVENT_IMMEDIATE);
+    _test_events[STEPPER_EVENT_CYCLE_FINISHED] = 0;
+    _test_chain_motor = &sm_x;
+    sm_x.current_pos = 0;
+    prepare_steps(&sm_x, 2, 1, 300);
+    stepper_start_cycle();
+    timer_tick(7);
+    sput_fail_unless(_test_events[STEPPER_EVENT_CYCLE_FINISHED] == 1, "immediate: CYCLE_FINISHED == 1");
+    sput_fail_unless(stepper_cycle_running(), "immediate: next cycle is running");
+    timer_tick(6);
+    sput_fail_unless(sm_x.current_pos == 7500*4, "immediate: x.pos == 7500*4");
+    timer_tick(1);
+    sput_fail_unless(_test_events[STEPPER_EVENT_CYCLE_FINISHED] == 2, "immediate: CYCLE_FINISHED == 2");
+    sput_fail_unless(!stepper_cycle_running(), "immediate: stepper_cycle_running() == false");
+    
+    // уберем обработчики
+    for(int i = 0; i < STEPPER_EVENT_COUNT; i++) {
+        stepper_set_event_handler((stepper_event_t)i, NULL);
+    }
+    stepper_handle_events();
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_speed_override() {
+    // поправка скорости во время цикла: одна на все моторы, меняется
+    // плавно, моторы не шагают чаще min_step_delay и упираются
+    // в нее одновременно
+    
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 600, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    sput_fail_unless(!stepper_set_speed_override(0), "stepper_set_speed_override(0) == false");
+    sput_fail_unless(!stepper_set_speed_override(STEPPER_SPEED_OVERRIDE_MAX + 1),
+        "stepper_set_speed_override(MAX+1) == false");
+    sput_fail_unless(stepper_speed_override() == 100, "stepper_speed_override() == 100");
+    
+    // #1
+    // 200 шагов по 1000 мкс (10 импульсов), после 2го шага - 200%:
+    // поправка растет на 1% за STEPPER_SPEED_OVERRIDE_RAMP_US и упирается
+    // в 166% - задержка 602 мкс (6 импульсов, min_step_delay=600)
+    prepare_steps(&sm_x, 200, 1, 1000);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    timer_tick(20);
+    sput_fail_unless(sm_x.current_pos == 7500*2, "200%: x.pos == 7500*2");
+    sput_fail_unless(stepper_set_speed_override(200), "stepper_set_speed_override(200) == true");
+    
+    bool ok = true;
+    int interval = 0;
+    int last_interval = 0;
+    int ticks = 0;
+    long long prev_pos = sm_x.current_pos;
+    while(stepper_cycle_running() && ticks < 5000) {
+        timer_tick(1);
+        ticks++;
+        interval++;
+        if(sm_x.current_pos != prev_pos) {
+            // не чаще минимальной задержки
+            ok = ok && interval >= 6;
+            last_interval = interval;
+            interval = 0;
+            prev_pos = sm_x.current_pos;
+        }
+    }
+    sput_fail_unless(ok, "200%: step interval >= min_step_delay");
+    sput_fail_unless(last_interval == 6, "200%: last interval == min_step_delay");
+    // без поправки - 198*10 импульсов, с минимальной задержкой - 198*6,
+    // на разгон до 166% - 66*STEPPER_SPEED_OVERRIDE_RAMP_US
+    sput_fail_unless(ticks > 198*6 && ticks < 198*10 - 200, "200%: faster than planned");
+    sput_fail_unless(sm_x.current_pos == 7500*200, "200%: x.pos == 7500*200");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "200%: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // #2
+    // 50% с начала цикла: первый шаг без поправки, дальше медленнее
+    sput_fail_unless(stepper_set_speed_override(50), "stepper_set_speed_override(50) == true");
+    prepare_steps(&sm_x, 30, 1, 1000);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    timer_tick(10);
+    sput_fail_unless(sm_x.current_pos == 7500, "50%: x.pos == 7500");
+    // без поправки - 29*10 импульсов, с поправкой 50% - до 29*20
+    timer_tick(29*10);
+    sput_fail_unless(stepper_cycle_running(), "50%: stepper_cycle_running() == true");
+    timer_tick(29*10 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "50%: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.current_pos == 7500*30, "50%: x.pos == 7500*30");
+    
+    // #3
+    // линия: x - 200 шагов по 1000 мкс, y - 100 шагов по 2000 мкс, 400%:
+    // y мог бы ускориться до 333%, но поправка упирается в 166% для обоих
+    // моторов - отношение скоростей не меняется, моторы заканчивают вместе
+    init_stepper(&sm_y, 'y', 5, 6, 7, true, 600, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    sput_fail_unless(stepper_set_speed_override(400), "stepper_set_speed_override(400) == true");
+    prepare_steps(&sm_x, 200, 1, 1000);
+    prepare_steps(&sm_y, 100, 1, 2000);
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    stepper_start_cycle();
+    
+    ok = true;
+    interval = 0;
+    ticks = 0;
+    int y_finished = 0;
+    prev_pos = 0;
+    while(stepper_cycle_running() && ticks < 5000) {
+        timer_tick(1);
+        ticks++;
+        interval++;
+        if(sm_x.current_pos != prev_pos) {
+            ok = ok && interval >= 6;
+            interval = 0;
+            prev_pos = sm_x.current_pos;
+        }
+        if(y_finished == 0 && sm_y.current_pos == 7500*100) {
+            y_finished = ticks;
+        }
+        // y отстает от x не больше, чем на шаг
+        long long x_steps = sm_x.current_pos/7500;
+        long long y_steps = sm_y.current_pos/7500;
+        ok = ok && x_steps - 2*y_steps >= -2 && x_steps - 2*y_steps <= 2;
+    }
+    sput_fail_unless(ok, "400%: x:y == 2:1, x step interval >= min_step_delay");
+    sput_fail_unless(y_finished > ticks - 12, "400%: y finished together with x");
+    sput_fail_unless(sm_x.current_pos == 7500*200, "400%: x.pos == 7500*200");
+    sput_fail_unless(sm_y.current_pos == 7500*100, "400%: y.pos == 7500*100");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "400%: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_set_speed_override(100);
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+static void test_feed_hold() {
+    // плавная остановка: мотор замедляется, цикл встает на паузу,
+    // после продолжения - разгон, шаги не теряются
+    
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 600, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(100, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 1000);
+    
+    // 100 шагов по 1000 мкс (10 импульсов), после 10го шага - плавная
+    // остановка за 9000 мкс (100 мкс = 1 импульс на 1%)
+    prepare_steps(&sm_x, 100, 1, 1000);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    timer_tick(100);
+    sput_fail_unless(sm_x.current_pos == 7500*10, "hold: x.pos == 7500*10");
+    sput_fail_unless(!stepper_cycle_holding(), "hold: stepper_cycle_holding() == false");
+    
+    stepper_hold_cycle(9000);
+    sput_fail_unless(stepper_cycle_holding(), "hold: stepper_cycle_holding() == true");
+    
+    int interval = 0;
+    int last_interval = 0;
+    int ticks = 0;
+    long long prev_pos = sm_x.current_pos;
+    while(!stepper_cycle_paused() && ticks < 1000) {
+        timer_tick(1);
+        ticks++;
+        interval++;
+        if(sm_x.current_pos != prev_pos) {
+            last_interval = interval;
+            interval = 0;
+            prev_pos = sm_x.current_pos;
+        }
+    }
+    sput_fail_unless(stepper_cycle_paused(), "hold: stepper_cycle_paused() == true");
+    sput_fail_unless(!stepper_cycle_holding(), "hold: stepper_cycle_holding() == false");
+    sput_fail_unless(ticks >= 90 && ticks <= 91, "hold: paused after decel time");
+    // замедлились: шаги реже запланированных
+    sput_fail_unless(last_interval > 10, "hold: step interval grows");
+    // на полной скорости прошли бы 9 шагов
+    sput_fail_unless(sm_x.current_pos < 7500*19, "hold: x.pos < 7500*19");
+    
+    // на паузе положение не меняется
+    long long hold_pos = sm_x.current_pos;
+    timer_tick(500);
+    sput_fail_unless(sm_x.current_pos == hold_pos, "hold: x.pos frozen");
+    sput_fail_unless(stepper_cycle_running(), "hold: stepper_cycle_running() == true");
+    
+    // продолжаем: разгон и завершение цикла без потери шагов
+    stepper_resume_cycle();
+    sput_fail_unless(!stepper_cycle_paused(), "resume: stepper_cycle_paused() == false");
+    sput_fail_unless(stepper_cycle_holding(), "resume: stepper_cycle_holding() == true");
+    ticks = 0;
+    while(stepper_cycle_running() && ticks < 10000) {
+        timer_tick(1);
+        ticks++;
+    }
+    sput_fail_unless(!stepper_cycle_running(), "resume: stepper_cycle_running() == false");
+    sput_fail_unless(!stepper_cycle_holding(), "resume: stepper_cycle_holding() == false");
+    sput_fail_unless(sm_x.current_pos == 7500*100, "resume: x.pos == 7500*100");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE,
+        "resume: stepper_cycle_error() == CYCLE_ERROR_NONE");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+}
+
+/**
+ * Физическое положение мотора для симуляции концевиков: считаем шаги
+ * по ножкам step (фронт HIGH>LOW) и dir.
+ */
+static void homing_track_steps(stepper* smotor, int* step_val, long* phys_pos) {
+    int val = digitalRead(smotor->pin_step);
+    if(*step_val == HIGH && val == LOW) {
+        *phys_pos += digitalRead(smotor->pin_dir) == HIGH ? 1 : -1;
+    }
+    *step_val = val;
+}
+
+static void test_homing() {
+    // поиск нуля для двух моторов одновременно: X - к концевику min,
+    // Y - к концевику max
+    
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, 20, NO_PIN, CONST, CONST, 0, 300000000);
+    init_stepper(&sm_y, 'y', 5, 6, 7, false, 1000, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, 21, CONST, CONST, 0, 200000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_homing homing_x, homing_y;
+    init_stepper_homing(&homing_x, &sm_x, -1, 1000, 2000, 5, 100);
+    init_stepper_homing(&homing_y, &sm_y, 1, 1000, 2000, 5, 100);
+    stepper_homing* homings[] = {&homing_x, &homing_y};
+    
+    // концевик X срабатывает на 30 шагов левее старта, Y - на 20 правее
+    long phys_x = 0, phys_y = 0;
+    int step_x = LOW, step_y = LOW;
+    digitalWrite(20, LOW);
+    digitalWrite(21, LOW);
+    sm_x.current_pos = 100000;
+    sm_y.current_pos = 100000;
+    
+    sput_fail_unless(stepper_homing_start(homings, 2), "stepper_homing_start == true");
+    sput_fail_unless(stepper_homing_phase() == HOMING_FAST_APPROACH, "phase == HOMING_FAST_APPROACH");
+    
+    bool back_off = false;
+    bool slow_approach = false;
+    long back_off_x = 0;
+    int ticks = 0;
+    while(stepper_homing_handle() && ticks < 10000) {
+        timer_tick(1);
+        ticks++;
+        homing_track_steps(&sm_x, &step_x, &phys_x);
+        homing_track_steps(&sm_y, &step_y, &phys_y);
+        digitalWrite(20, phys_x <= -30 ? HIGH : LOW);
+        digitalWrite(21, phys_y >= 20 ? HIGH : LOW);
+        
+        if(stepper_homing_phase() == HOMING_BACK_OFF) {
+            back_off = true;
+        } else if(stepper_homing_phase() == HOMING_SLOW_APPROACH && !slow_approach) {
+            slow_approach = true;
+            back_off_x = phys_x;
+        }
+    }
+    sput_fail_unless(stepper_homing_phase() == HOMING_DONE, "phase == HOMING_DONE");
+    sput_fail_unless(stepper_hard_end_handle() == CANCEL_CYCLE, "hard_end_handle restored");
+    sput_fail_unless(back_off && slow_approach, "back off, slow approach");
+    sput_fail_unless(back_off_x == -25, "x: backed off 5 steps");
+    sput_fail_unless(phys_x == -30, "x: stopped on switch");
+    sput_fail_unless(phys_y == 20, "y: stopped on switch");
+    sput_fail_unless(homing_x.homed && homing_y.homed, "homed == true");
+    sput_fail_unless(sm_x.current_pos == 0, "x.pos == min_pos");
+    sput_fail_unless(sm_y.current_pos == 200000000, "y.pos == max_pos");
+    
+    // концевик X не срабатывает: после max_steps - ошибка
+    digitalWrite(20, LOW);
+    digitalWrite(21, LOW);
+    sput_fail_unless(stepper_homing_start(homings, 1), "no switch: stepper_homing_start == true");
+    ticks = 0;
+    while(stepper_homing_handle() && ticks < 10000) {
+        timer_tick(1);
+        ticks++;
+    }
+    sput_fail_unless(stepper_homing_phase() == HOMING_FAILED, "no switch: phase == HOMING_FAILED");
+    sput_fail_unless(!homing_x.homed, "no switch: x.homed == false");
+    sput_fail_unless(stepper_hard_end_handle() == CANCEL_CYCLE, "no switch: hard_end_handle restored");
+    
+    // прервали поиск: стратегия STOP_MOTOR, заданная до поиска, остается
+    stepper_set_error_handle_strategy(STOP_MOTOR, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE);
+    sput_fail_unless(stepper_homing_start(homings, 1), "cancel: stepper_homing_start == true");
+    timer_tick(10);
+    stepper_homing_cancel();
+    sput_fail_unless(stepper_homing_phase() == HOMING_FAILED, "cancel: phase == HOMING_FAILED");
+    sput_fail_unless(stepper_hard_end_handle() == STOP_MOTOR, "cancel: hard_end_handle restored");
+    stepper_set_error_handle_strategy(CANCEL_CYCLE, DONT_CHANGE, DONT_CHANGE, DONT_CHANGE);
+    
+    // концевик не подключен
+    init_stepper_homing(&homing_x, &sm_x, 1, 1000, 2000, 5, 100);
+    sput_fail_unless(!stepper_homing_start(homings, 1), "no pin_max: stepper_homing_start == false");
+}
+
+static void test_endstops() {
+    // аппаратный концевик останавливает мотор; с концевиками на прерываниях
+    // (STEPPER_ENDSTOP_INTERRUPTS) - на ближайшем импульсе таймера, короткое
+    // срабатывание между проверками не теряется; с фильтром помех
+    // (STEPPER_ENDSTOP_DEBOUNCE) короткое срабатывание игнорируется
+    
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, 20, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+    digitalWrite(20, LOW);
+    
+    // #1
+    // 10 шагов влево по 10000 мкс (50 импульсов), концевик срабатывает
+    // после первого шага
+    prepare_steps(&sm_x, 10, -1, 10000);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    timer_tick(60);
+    sput_fail_unless(sm_x.current_pos == -7500, "hit: x.pos == -7500");
+    digitalWrite(20, HIGH);
+    timer_tick(1);
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+    sput_fail_unless(sm_x.status == STEPPER_STATUS_FINISHED, "hit.tick1: x.status == FINISHED");
+#else
+    sput_fail_unless(sm_x.status == STEPPER_STATUS_RUNNING, "hit.tick1: x.status == RUNNING");
+#endif
+    timer_tick(50);
+    sput_fail_unless(!stepper_cycle_running(), "hit: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.error & STEPPER_ERROR_HARD_END_MIN, "hit: x.error & HARD_END_MIN");
+    sput_fail_unless(sm_x.current_pos == -7500, "hit: x.pos == -7500");
+    
+    // #2
+    // от нажатого концевика вправо можно
+    prepare_steps(&sm_x, 10, 1, 10000);
+    stepper_start_cycle();
+    timer_tick(10*50 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "away: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.error == STEPPER_ERROR_NONE, "away: x.error == NONE");
+    sput_fail_unless(sm_x.current_pos == 7500*9, "away: x.pos == 7500*9");
+    digitalWrite(20, LOW);
+    
+#ifdef STEPPER_ENDSTOP_INTERRUPTS
+    // #3
+    // короткое срабатывание между проверками
+    prepare_steps(&sm_x, 10, -1, 10000);
+    stepper_start_cycle();
+    timer_tick(60);
+    digitalWrite(20, HIGH);
+    digitalWrite(20, LOW);
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "pulse: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.error & STEPPER_ERROR_HARD_END_MIN, "pulse: x.error & HARD_END_MIN");
+    sput_fail_unless(sm_x.current_pos == 7500*8, "pulse: x.pos == 7500*8");
+    
+    // #4
+    // концевик отпущен - следующий цикл не останавливается
+    prepare_steps(&sm_x, 2, -1, 10000);
+    stepper_start_cycle();
+    timer_tick(2*50 + 1);
+    sput_fail_unless(sm_x.error == STEPPER_ERROR_NONE, "released: x.error == NONE");
+    sput_fail_unless(sm_x.current_pos == 7500*6, "released: x.pos == 7500*6");
+#elif defined(STEPPER_ENDSTOP_DEBOUNCE)
+    // #3
+    // помеха короче STEPPER_ENDSTOP_DEBOUNCE импульсов - мотор не останавливается
+    prepare_steps(&sm_x, 4, -1, 10000);
+    stepper_start_cycle();
+    timer_tick(47);
+    digitalWrite(20, HIGH);
+    timer_tick(STEPPER_ENDSTOP_DEBOUNCE - 1);
+    digitalWrite(20, LOW);
+    timer_tick(4*50 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "noise: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.error == STEPPER_ERROR_NONE, "noise: x.error == NONE");
+    sput_fail_unless(sm_x.current_pos == 7500*5, "noise: x.pos == 7500*5");
+    
+    // #4
+    // концевик нажат дольше - мотор останавливается (проверка перед
+    // первым шагом - на 48-м импульсе)
+    prepare_steps(&sm_x, 4, -1, 10000);
+    stepper_start_cycle();
+    timer_tick(40);
+    digitalWrite(20, HIGH);
+    timer_tick(4*50 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "hit: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.error & STEPPER_ERROR_HARD_END_MIN, "hit: x.error & HARD_END_MIN");
+    sput_fail_unless(sm_x.current_pos == 7500*5, "hit: x.pos == 7500*5");
+    digitalWrite(20, LOW);
+#endif // STEPPER_ENDSTOP_INTERRUPTS
+}
+
+#ifdef STEPPER_DEFERRED_STEPS
+static void test_deferred() {
+    // отложенные вычисления (STEPPER_DEFERRED_STEPS): после шага мотор
+    // ждет, пока stepper_handle_deferred подготовит данные для следующего
+    // шага; успели до проверки границ - шаг вовремя, не успели - шаг
+    // задерживается
+    
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+    deferred_immediate = false;
+    
+    // 3 шага по 1000 мкс (5 импульсов): проверка границ на 3м импульсе
+    // шага, HIGH на 4м, шаг на 5м
+    prepare_steps(&sm_x, 3, 1, 1000);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    sput_fail_unless(stepper_handle_deferred() == 0, "start: nothing to prepare");
+    timer_tick(5);
+    sput_fail_unless(sm_x.current_pos == 7500, "step1: x.pos == 7500");
+    
+    // данные готовы через импульс после шага - следующий шаг вовремя
+    timer_tick(1);
+    sput_fail_unless(stepper_handle_deferred() == 1, "step1+1: prepared 1 motor");
+    sput_fail_unless(stepper_handle_deferred() == 0, "step1+1: nothing more to prepare");
+    timer_tick(3);
+    sput_fail_unless(sm_x.current_pos == 7500, "step1+4: x.pos == 7500");
+    timer_tick(1);
+    sput_fail_unless(sm_x.current_pos == 7500*2, "step2: x.pos == 7500*2");
+    sput_fail_unless(stepper_deferred_underruns() == 0, "step2: underruns == 0");
+    
+    // данные готовы через 4 импульса - проверка границ пропущена,
+    // шаг задерживается на 2 импульса
+    timer_tick(4);
+    sput_fail_unless(stepper_handle_deferred() == 1, "step2+4: prepared 1 motor");
+    timer_tick(2);
+    sput_fail_unless(sm_x.current_pos == 7500*2, "step2+6: x.pos == 7500*2");
+    timer_tick(1);
+    sput_fail_unless(sm_x.current_pos == 7500*3, "step3: x.pos == 7500*3");
+    sput_fail_unless(stepper_deferred_underruns() == 1, "step3: underruns == 1");
+    
+    // мотор закончил вращение, только когда данные готовы
+    timer_tick(5);
+    sput_fail_unless(stepper_cycle_running(), "step3+5: stepper_cycle_running() == true");
+    sput_fail_unless(sm_x.status == STEPPER_STATUS_RUNNING, "step3+5: x.status == RUNNING");
+    sput_fail_unless(stepper_handle_deferred() == 1, "step3+5: prepared 1 motor");
+    timer_tick(1);
+    sput_fail_unless(!stepper_cycle_running(), "finish: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.status == STEPPER_STATUS_FINISHED, "finish: x.status == FINISHED");
+    sput_fail_unless(sm_x.current_pos == 7500*3, "finish: x.pos == 7500*3");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    deferred_immediate = true;
+}
+#endif // STEPPER_DEFERRED_STEPS
+
+static void test_missed_ticks() {
+    // пропущенные импульсы таймера (cycle_timing_exceed_handle=FIX):
+    // время пропущенных импульсов вычитается из таймеров моторов,
+    // шаги возвращаются к расписанию
+    
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    stepper_configure_timer(200, TIMER_DEFAULT, TIMER_PRESCALER_1_8, 2000);
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, FIX);
+    
+    // 10 шагов по 1000 мкс (5 импульсов), шаг n - в момент n*1000 мкс
+    dbg_micros = 0;
+    prepare_steps(&sm_x, 10, 1, 1000);
+    sm_x.current_pos = 0;
+    stepper_start_cycle();
+    for(int t = 0; t < 10; t++) {
+        dbg_micros += 200;
+        timer_tick(1);
+    }
+    sput_fail_unless(sm_x.current_pos == 7500*2, "2000us: x.pos == 7500*2");
+    
+    // пропустили 3 импульса: проверка границ перед шагом 3 уже
+    // прошла бы, поэтому шаг 3 - на импульс позже (3200 мкс)
+    dbg_micros += 600;
+    for(int t = 0; t < 2; t++) {
+        dbg_micros += 200;
+        timer_tick(1);
+    }
+    sput_fail_unless(sm_x.current_pos == 7500*2, "3000us: x.pos == 7500*2");
+    dbg_micros += 200;
+    timer_tick(1);
+    sput_fail_unless(sm_x.current_pos == 7500*3, "3200us: x.pos == 7500*3");
+    sput_fail_unless(stepper_cycle_missed_ticks() == 3, "3200us: missed ticks == 3");
+    
+    // шаг 4 - снова по расписанию
+    for(int t = 0; t < 3; t++) {
+        dbg_micros += 200;
+        timer_tick(1);
+    }
+    sput_fail_unless(sm_x.current_pos == 7500*3, "3800us: x.pos == 7500*3");
+    dbg_micros += 200;
+    timer_tick(1);
+    sput_fail_unless(sm_x.current_pos == 7500*4, "4000us: x.pos == 7500*4");
+    
+    // опоздание импульса меньше периода - не пропуск
+    dbg_micros += 350;
+    timer_tick(1);
+    dbg_micros += 50;
+    timer_tick(1);
+    for(int t = 0; t < 3; t++) {
+        dbg_micros += 200;
+        timer_tick(1);
+    }
+    sput_fail_unless(sm_x.current_pos == 7500*5, "5000us: x.pos == 7500*5");
+    sput_fail_unless(stepper_cycle_missed_ticks() == 3, "5000us: missed ticks == 3");
+    
+    // остальные шаги - по расписанию
+    while(stepper_cycle_running()) {
+        dbg_micros += 200;
+        timer_tick(1);
+    }
+    sput_fail_unless(dbg_micros == 10200, "finish: time == 10200us");
+    sput_fail_unless(sm_x.current_pos == 7500*10, "finish: x.pos == 7500*10");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE, "finish: error == NONE");
+    
+    // вернем настройки, с которыми работают остальные тесты
+    dbg_micros = 0;
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, CANCEL_CYCLE);
+}
+
+static void test_normalize_buffered_steps() {
+    // normalize_buffered_steps: объединение соседних серий с одинаковыми
+    // направлением и задержкой, удаление пустых серий, проверка задержек
+    
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    // #1: задержка меньше min_step_delay - массивы не меняются
+    unsigned long step_buffer[] = {3, 0, 2, 4, 1};
+    int dir_buffer[] = {1, 1, 1, -1, -1};
+    unsigned long delay_buffer[] = {1000, 5000, 0, 2000, 500};
+    sput_fail_unless(normalize_buffered_steps(&sm_x, 5, step_buffer, dir_buffer, delay_buffer) == -1,
+        "small delay: normalize_buffered_steps() == -1");
+    sput_fail_unless(step_buffer[1] == 0 && delay_buffer[2] == 0,
+        "small delay: buffers are not changed");
+    
+    // #2: 0 - максимальная скорость (min_step_delay), пустая серия
+    // удаляется, соседние серии объединяются
+    delay_buffer[4] = 2000;
+    sput_fail_unless(normalize_buffered_steps(&sm_x, 5, step_buffer, dir_buffer, delay_buffer) == 2,
+        "normalize_buffered_steps() == 2");
+    sput_fail_unless(step_buffer[0] == 5 && dir_buffer[0] == 1 && delay_buffer[0] == 1000,
+        "series 0: 5 steps forward, 1000us");
+    sput_fail_unless(step_buffer[1] == 5 && dir_buffer[1] == -1 && delay_buffer[1] == 2000,
+        "series 1: 5 steps back, 2000us");
+    
+    // цикл: 5*1000+5*2000=15000мкс
+    sm_x.current_pos = 0;
+    prepare_buffered_steps(&sm_x, 2, step_buffer, dir_buffer, delay_buffer);
+    stepper_start_cycle();
+    timer_tick(15000/200 - 1);
+    sput_fail_unless(stepper_cycle_running(), "cycle: stepper_cycle_running() == true");
+    sput_fail_unless(sm_x.current_pos == 7500, "cycle: x.pos == 7500");
+    timer_tick(2);
+    sput_fail_unless(!stepper_cycle_running(), "cycle: stepper_cycle_running() == false");
+    sput_fail_unless(sm_x.current_pos == 0, "cycle: x.pos == 0");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE, "cycle: CYCLE_ERROR_NONE");
+    
+    // #3: нет шагов
+    step_buffer[0] = 0;
+    sput_fail_unless(normalize_buffered_steps(&sm_x, 1, step_buffer, dir_buffer, delay_buffer) == 0,
+        "empty: normalize_buffered_steps() == 0");
+}
+
+// Поток байт для stepper_program_start: available байт уже "пришли"
+typedef struct {
+    const unsigned char* buf;
+    int size;
+    int pos;
+    int available;
+} _test_program_source;
+
+static int _test_program_read_byte(void* source) {
+    _test_program_source* src = (_test_program_source*)source;
+    if(src->pos >= src->size || src->pos >= src->available) {
+        return -1;
+    }
+    return src->buf[src->pos++];
+}
+
+// Шаг мотора x "занимает" у обработчика таймера больше периода
+// (CYCLE_ERROR_HANDLER_TIMING_EXCEEDED)
+static void _test_program_slow_step() {
+    dbg_micros += 1000;
+}
+
+static void test_program() {
+    // двоичная программа движения: запись, потоковое чтение, выполнение
+    
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    init_stepper(&sm_y, 'y', 2, 3, 4, false, 1000, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    stepper* axes[] = {&sm_x, &sm_y};
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    // запись: x и y с постоянной скоростью, пауза, x с разгоном
+    unsigned char program[128];
+    int size = stepper_program_write_header(program, 2);
+    sput_fail_unless(size == STEPPER_PROGRAM_HEADER_SIZE, "write: header size == 8");
+    
+    stepper_program_record record;
+    record.type = PROGRAM_MOVE;
+    record.axis_mask = 3;
+    record.axes[0].step_count = 3;
+    record.axes[0].dir = 1;
+    record.axes[0].step_delay = 1000;
+    record.axes[1].step_count = 2;
+    record.axes[1].dir = -1;
+    record.axes[1].step_delay = 1500;
+    int move_size = stepper_program_write_record(program + size, &record);
+    sput_fail_unless(move_size == 2 + 9*2, "write: move size == 20");
+    size += move_size;
+    
+    record.type = PROGRAM_DWELL;
+    record.axis_mask = 0;
+    record.dwell_us = 2000;
+    size += stepper_program_write_record(program + size, &record);
+    
+    record.type = PROGRAM_ACCEL;
+    record.axis_mask = 1;
+    record.axes[0].step_count = 10;
+    record.axes[0].dir = 1;
+    record.axes[0].start_delay = 4000;
+    record.axes[0].step_delay = 1000;
+    record.axes[0].ramp_steps = 3;
+    size += stepper_program_write_record(program + size, &record);
+    
+    record.type = PROGRAM_END;
+    size += stepper_program_write_record(program + size, &record);
+    sput_fail_unless(size == 8 + 20 + 6 + 19 + 2, "write: program size == 55");
+    
+    // чтение по одному байту
+    stepper_program_decoder decoder;
+    stepper_program_decoder_init(&decoder);
+    int records = 0;
+    stepper_program_status_t status = PROGRAM_NEED_MORE;
+    for(int i = 0; i < size && status != PROGRAM_FINISHED && status != PROGRAM_ERROR; i++) {
+        status = stepper_program_decode(&decoder, program[i]);
+        if(status == PROGRAM_RECORD) {
+            records++;
+            if(records == 1) {
+                sput_fail_unless(decoder.record.type == PROGRAM_MOVE && decoder.record.axis_mask == 3,
+                    "decode: move x, y");
+                sput_fail_unless(decoder.record.axes[1].step_count == 2 &&
+                    decoder.record.axes[1].dir == -1 && decoder.record.axes[1].step_delay == 1500,
+                    "decode: y: 2 steps back, 1500us");
+            } else if(records == 3) {
+                sput_fail_unless(decoder.record.axes[0].start_delay == 4000 &&
+                    decoder.record.axes[0].ramp_steps == 3, "decode: accel x");
+            }
+        }
+    }
+    sput_fail_unless(records == 3, "decode: 3 records");
+    sput_fail_unless(status == PROGRAM_FINISHED, "decode: PROGRAM_FINISHED");
+    
+    // неверная версия формата
+    program[4] = STEPPER_PROGRAM_VERSION + 1;
+    stepper_program_decoder_init(&decoder);
+    for(int i = 0; i < STEPPER_PROGRAM_HEADER_SIZE; i++) {
+        status = stepper_program_decode(&decoder, program[i]);
+    }
+    sput_fail_unless(status == PROGRAM_ERROR, "bad version: PROGRAM_ERROR");
+    program[4] = STEPPER_PROGRAM_VERSION;
+    
+    // выполнение: байты приходят по 4 за проход loop
+    _test_program_source source = {program, size, 0, 0};
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    sput_fail_unless(stepper_program_start(axes, 2, _test_program_read_byte, &source),
+        "stepper_program_start == true");
+    
+    int loops = 0;
+    while(stepper_program_handle() && loops < 1000) {
+        source.available += 4;
+        timer_tick(1);
+        loops++;
+    }
+    sput_fail_unless(stepper_program_status() == PROGRAM_FINISHED, "play: PROGRAM_FINISHED");
+    sput_fail_unless(stepper_program_segments() == 3, "play: 3 segments");
+    sput_fail_unless(sm_x.current_pos == 7500*13, "play: x.pos == 7500*13");
+    sput_fail_unless(sm_y.current_pos == -7500*2, "play: y.pos == -7500*2");
+    
+    // обработчик таймера не уложился в период (IGNORE): сегменты
+    // доведены до конца - программа продолжается
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, IGNORE);
+    attachInterrupt(8, _test_program_slow_step, CHANGE);
+    source.pos = 0;
+    source.available = size;
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    stepper_program_start(axes, 2, _test_program_read_byte, &source);
+    loops = 0;
+    while(stepper_program_handle() && loops < 1000) {
+        timer_tick(1);
+        loops++;
+    }
+    detachInterrupt(8);
+    dbg_micros = 0;
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, CANCEL_CYCLE);
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_HANDLER_TIMING_EXCEEDED,
+        "timing exceeded: error == HANDLER_TIMING_EXCEEDED");
+    sput_fail_unless(stepper_program_status() == PROGRAM_FINISHED, "timing exceeded: PROGRAM_FINISHED");
+    sput_fail_unless(sm_x.current_pos == 7500*13, "timing exceeded: x.pos == 7500*13");
+    
+    // испорченный поток - выполнение прерывается
+    program[8] = 7; // неизвестный тип записи
+    source.pos = 0;
+    source.available = size;
+    stepper_program_start(axes, 2, _test_program_read_byte, &source);
+    sput_fail_unless(!stepper_program_handle(), "bad record: stepper_program_handle() == false");
+    sput_fail_unless(stepper_program_status() == PROGRAM_ERROR, "bad record: PROGRAM_ERROR");
+}
+
+// Файл для stepper_gcode_start: после последнего символа - конец потока
+static int _test_gcode_read_file(void* source) {
+    _test_program_source* src = (_test_program_source*)source;
+    if(src->pos >= src->size) {
+        return STEPPER_GCODE_EOF;
+    }
+    return src->buf[src->pos++];
+}
+
+static void test_gcode() {
+    // G-код: разбор строк, сегменты, выполнение из потока символов
+    
+    // 100 шагов на миллиметр
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 10000);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    init_stepper(&sm_y, 'y', 2, 3, 4, false, 1000, 10000);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    stepper* axes[] = {&sm_x, &sm_y};
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    stepper_gcode_init(axes, 2);
+    stepper_program_record record;
+    
+    // #1: скорость подачи не задана
+    sput_fail_unless(!stepper_gcode_parse("G1 X1 Y0.5"), "no feed: parse == false");
+    
+    // #2: линия со скоростью подачи 600мм/мин: длина 1.118мм - 111803мкс
+    sput_fail_unless(stepper_gcode_parse("G21 G90 G1 X1 Y0.5 F600"), "G1: parse == true");
+    sput_fail_unless(stepper_gcode_next_segment(&record), "G1: segment");
+    sput_fail_unless(record.type == PROGRAM_MOVE && record.axis_mask == 3, "G1: move x, y");
+    sput_fail_unless(record.axes[0].step_count == 100 && record.axes[0].dir == 1 &&
+        record.axes[0].step_delay == 1118, "G1: x: 100 steps, 1118us");
+    sput_fail_unless(record.axes[1].step_count == 50 && record.axes[1].step_delay == 2236,
+        "G1: y: 50 steps, 2236us");
+    sput_fail_unless(!stepper_gcode_next_segment(&record), "G1: no more segments");
+    
+    // #3: относительные координаты, максимальная скорость
+    sput_fail_unless(stepper_gcode_parse("G91 G0 X-2"), "G0: parse == true");
+    sput_fail_unless(stepper_gcode_next_segment(&record), "G0: segment");
+    sput_fail_unless(record.axis_mask == 1 && record.axes[0].step_count == 200 &&
+        record.axes[0].dir == -1 && record.axes[0].step_delay == 1000, "G0: x: 200 steps back, 1000us");
+    stepper_gcode_next_segment(&record);
+    
+    // #4: полуокружность по часовой стрелке (-1,0.5) -> (1,0.5) через (0,1.5)
+    sput_fail_unless(stepper_gcode_parse("G90 G2 X1 Y0.5 I1 J0"), "G2: parse == true");
+    long x = -100, y = 50, y_max = 50;
+    int segments = 0;
+    while(stepper_gcode_next_segment(&record) && segments < 100) {
+        if(record.axis_mask & 1) {
+            x += record.axes[0].dir*(long)record.axes[0].step_count;
+        }
+        if(record.axis_mask & 2) {
+            y += record.axes[1].dir*(long)record.axes[1].step_count;
+        }
+        y_max = y > y_max ? y : y_max;
+        segments++;
+    }
+    // 3.14мм по 0.2мм
+    sput_fail_unless(segments == 16, "G2: 16 segments");
+    sput_fail_unless(x == 100 && y == 50, "G2: x == 100, y == 50");
+    sput_fail_unless(y_max == 150, "G2: y max == 150");
+    
+    // #5: пауза
+    sput_fail_unless(stepper_gcode_parse("G4 P250"), "G4: parse == true");
+    sput_fail_unless(stepper_gcode_next_segment(&record) && record.type == PROGRAM_DWELL &&
+        record.dwell_us == 250000, "G4: dwell 250000us");
+    
+    // #6: в 0 только по X
+    sput_fail_unless(stepper_gcode_parse("G28 X0"), "G28: parse == true");
+    sput_fail_unless(stepper_gcode_next_segment(&record) && record.axis_mask == 1 &&
+        record.axes[0].step_count == 100 && record.axes[0].dir == -1, "G28: x: 100 steps back");
+    stepper_gcode_next_segment(&record);
+    
+    // #7: дюймы: 0.1" = 2.54мм
+    sput_fail_unless(stepper_gcode_parse("G20 G1 X0.1 (inches)"), "G20: parse == true");
+    sput_fail_unless(stepper_gcode_next_segment(&record) && record.axes[0].step_count == 254,
+        "G20: x: 254 steps");
+    stepper_gcode_parse("G21");
+    
+    // #8: ошибки
+    sput_fail_unless(!stepper_gcode_parse("G99"), "G99: parse == false");
+    sput_fail_unless(!stepper_gcode_parse("G1 X1 E5"), "unknown word: parse == false");
+    sput_fail_unless(!stepper_gcode_parse("G1 X1.2.3"), "bad number: parse == false");
+    // число в нанометрах (x25.4 для дюймов) не помещается в long long
+    sput_fail_unless(!stepper_gcode_parse("G20 G1 X10000000000000 F100"), "overflow: parse == false");
+    
+    // #9: выполнение из потока
+    const char* gcode =
+        "G21 G90 F6000\n"
+        "G1 X0.5 ; comment\n"
+        "(back) G0 X0\n"
+        "G4 P1\n"
+        "M2\n";
+    _test_program_source source = {(const unsigned char*)gcode, (int)strlen(gcode), 0, (int)strlen(gcode)};
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    sput_fail_unless(stepper_gcode_start(axes, 2, _test_program_read_byte, &source),
+        "stream: stepper_gcode_start == true");
+    int loops = 0;
+    long x_max = 0;
+    while(stepper_gcode_handle() && loops < 10000) {
+        timer_tick(1);
+        x_max = sm_x.current_pos > x_max ? sm_x.current_pos : x_max;
+        loops++;
+    }
+    sput_fail_unless(stepper_gcode_status() == GCODE_FINISHED, "stream: GCODE_FINISHED");
+    sput_fail_unless(stepper_gcode_lines() == 5, "stream: 5 lines");
+    sput_fail_unless(x_max == 500000, "stream: x max == 0.5mm");
+    sput_fail_unless(sm_x.current_pos == 0, "stream: x.pos == 0");
+    
+    // #10: ошибка в строке - выполнение прерывается
+    const char* bad_gcode = "G1 X1 F100\nG5\n";
+    _test_program_source bad_source = {(const unsigned char*)bad_gcode, (int)strlen(bad_gcode), 0, (int)strlen(bad_gcode)};
+    stepper_gcode_start(axes, 2, _test_program_read_byte, &bad_source);
+    loops = 0;
+    while(stepper_gcode_handle() && loops < 100000) {
+        timer_tick(1);
+        loops++;
+    }
+    sput_fail_unless(stepper_gcode_status() == GCODE_ERROR, "bad line: GCODE_ERROR");
+    sput_fail_unless(stepper_gcode_lines() == 2, "bad line: line 2");
+    
+    // #11: дуга из потока - все 16 отрезков одним циклом (серии осей)
+    const char* arc_gcode =
+        "G21 G90 F6000\n"
+        "G2 X1 Y0.5 I1 J0\n"
+        "M2\n";
+    _test_program_source arc_source = {(const unsigned char*)arc_gcode, (int)strlen(arc_gcode), 0, (int)strlen(arc_gcode)};
+    sm_x.current_pos = -1000000;
+    sm_y.current_pos = 500000;
+    stepper_gcode_start(axes, 2, _test_program_read_byte, &arc_source);
+    loops = 0;
+    int cycles = 0;
+    bool running = false;
+    long arc_y_max = 0;
+    while(stepper_gcode_handle() && loops < 100000) {
+        if(stepper_cycle_running() && !running) {
+            cycles++;
+        }
+        running = stepper_cycle_running();
+        timer_tick(1);
+        arc_y_max = sm_y.current_pos > arc_y_max ? sm_y.current_pos : arc_y_max;
+        loops++;
+    }
+    sput_fail_unless(stepper_gcode_status() == GCODE_FINISHED, "arc stream: GCODE_FINISHED");
+    sput_fail_unless(cycles == 1, "arc stream: 1 cycle");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE, "arc stream: CYCLE_ERROR_NONE");
+    sput_fail_unless(arc_y_max == 1500000, "arc stream: y max == 1.5mm");
+    sput_fail_unless(sm_x.current_pos == 1000000 && sm_y.current_pos == 500000,
+        "arc stream: x == 1mm, y == 0.5mm");
+    
+    // #12: обработчик таймера не уложился в период (IGNORE): сегменты
+    // доведены до конца - G-код выполняется дальше
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, IGNORE);
+    attachInterrupt(8, _test_program_slow_step, CHANGE);
+    source.pos = 0;
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    stepper_gcode_start(axes, 2, _test_program_read_byte, &source);
+    loops = 0;
+    while(stepper_gcode_handle() && loops < 10000) {
+        timer_tick(1);
+        loops++;
+    }
+    detachInterrupt(8);
+    dbg_micros = 0;
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, CANCEL_CYCLE);
+    sput_fail_unless(stepper_gcode_status() == GCODE_FINISHED, "timing exceeded: GCODE_FINISHED");
+    sput_fail_unless(stepper_gcode_lines() == 5, "timing exceeded: 5 lines");
+    sput_fail_unless(sm_x.current_pos == 0, "timing exceeded: x.pos == 0");
+    
+    // #13: линии подряд - одним циклом, ось, которая стоит в сегменте,
+    // ждет (dir=0) и начинает вместе со своим сегментом
+    const char* lines_gcode =
+        "G21 G90 F6000\n"
+        "G1 X0.5\n"
+        "G1 Y0.5\n"
+        "G1 X0 Y1\n"
+        "G1 X0.01\n"
+        "M2\n";
+    _test_program_source lines_source = {(const unsigned char*)lines_gcode, (int)strlen(lines_gcode), 0,
+        (int)strlen(lines_gcode)};
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    stepper_gcode_start(axes, 2, _test_program_read_byte, &lines_source);
+    loops = 0;
+    cycles = 0;
+    running = false;
+    long y_at_x_max = -1;
+    while(stepper_gcode_handle() && loops < 100000) {
+        if(stepper_cycle_running() && !running) {
+            cycles++;
+        }
+        running = stepper_cycle_running();
+        timer_tick(1);
+        if(sm_x.current_pos == 500000 && y_at_x_max < 0) {
+            y_at_x_max = sm_y.current_pos;
+        }
+        loops++;
+    }
+    sput_fail_unless(stepper_gcode_status() == GCODE_FINISHED, "lines: GCODE_FINISHED");
+    sput_fail_unless(cycles == 1, "lines: 1 cycle");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE, "lines: CYCLE_ERROR_NONE");
+    sput_fail_unless(y_at_x_max == 0, "lines: y waits for x");
+    sput_fail_unless(sm_x.current_pos == 10000 && sm_y.current_pos == 1000000,
+        "lines: x == 0.01mm, y == 1mm");
+    
+    // #14: конец потока без M2, последняя строка без '\n'
+    const char* file_gcode =
+        "G21 G90 F6000\n"
+        "G1 X0.5";
+    _test_program_source file_source = {(const unsigned char*)file_gcode, (int)strlen(file_gcode), 0,
+        (int)strlen(file_gcode)};
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    stepper_gcode_start(axes, 2, _test_gcode_read_file, &file_source);
+    loops = 0;
+    while(stepper_gcode_handle() && loops < 100000) {
+        timer_tick(1);
+        loops++;
+    }
+    sput_fail_unless(stepper_gcode_status() == GCODE_FINISHED, "eof: GCODE_FINISHED");
+    sput_fail_unless(stepper_gcode_lines() == 2, "eof: 2 lines");
+    sput_fail_unless(sm_x.current_pos == 500000, "eof: x.pos == 0.5mm");
+}
+
+// Канал связи с хостом для stepper_link_start: in - от хоста,
+// out - ответы устройства
+typedef struct {
+    unsigned char in[512];
+    int in_size;
+    int in_pos;
+    unsigned char out[256];
+    int out_size;
+    int out_pos;
+} _test_link_channel;
+
+static int _test_link_read_byte(void* source) {
+    _test_link_channel* ch = (_test_link_channel*)source;
+    if(ch->in_pos >= ch->in_size) {
+        return -1;
+    }
+    return ch->in[ch->in_pos++];
+}
+
+static void _test_link_write_byte(unsigned char b, void* source) {
+    _test_link_channel* ch = (_test_link_channel*)source;
+    if(ch->out_size < (int)sizeof(ch->out)) {
+        ch->out[ch->out_size++] = b;
+    }
+}
+
+// Отправить кадр с записью программы
+static void _test_link_send_record(_test_link_channel* ch, unsigned char seq, const stepper_program_record* record) {
+    unsigned char payload[STEPPER_PROGRAM_RECORD_MAX];
+    int len = stepper_program_write_record(payload, record);
+    ch->in_size += stepper_link_write_frame(ch->in + ch->in_size, LINK_SEGMENT, seq, payload, len);
+}
+
+// Следующий ответ устройства: тип, номер, кредиты
+static bool _test_link_reply(_test_link_channel* ch, unsigned char type, unsigned char seq, unsigned char credits) {
+    stepper_link_parser parser;
+    stepper_link_parser_init(&parser);
+    while(ch->out_pos < ch->out_size) {
+        if(stepper_link_parse(&parser, ch->out[ch->out_pos++]) == LINK_PARSE_FRAME) {
+            return parser.frame.type == type && parser.frame.seq == seq &&
+                parser.frame.len == 1 && parser.frame.payload[0] == credits;
+        }
+    }
+    return false;
+}
+
+static void test_link() {
+    // протокол связи с хостом: кадры, CRC, кредиты, повторы
+    
+    stepper sm_x, sm_y;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    init_stepper(&sm_y, 'y', 2, 3, 4, false, 1000, 7500);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 300000000);
+    stepper* axes[] = {&sm_x, &sm_y};
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    // #1: CRC-16/CCITT: контрольное значение для "123456789"
+    unsigned int crc = 0xFFFF;
+    for(const char* c = "123456789"; *c; c++) {
+        crc = stepper_link_crc16(crc, *c);
+    }
+    sput_fail_unless(crc == 0x29B1, "crc16(\"123456789\") == 0x29B1");
+    
+    // #2: кадр: запись и разбор, испорченный кадр, разбор со следующего кадра
+    unsigned char frame[2*STEPPER_LINK_FRAME_MAX];
+    unsigned char payload[] = {1, 2, 3};
+    int size = stepper_link_write_frame(frame, LINK_SEGMENT, 7, payload, 3);
+    sput_fail_unless(size == 4 + 3 + 2, "write: frame size == 9");
+    size += stepper_link_write_frame(frame + size, LINK_SYNC, 8, NULL, 0);
+    frame[5] ^= 0x10;
+    
+    stepper_link_parser parser;
+    stepper_link_parser_init(&parser);
+    int frames = 0;
+    int bad_frames = 0;
+    for(int i = 0; i < size; i++) {
+        stepper_link_parse_status_t status = stepper_link_parse(&parser, frame[i]);
+        if(status == LINK_PARSE_FRAME) {
+            frames++;
+        } else if(status == LINK_PARSE_BAD) {
+            bad_frames++;
+        }
+    }
+    sput_fail_unless(bad_frames == 1, "parse: 1 bad frame");
+    sput_fail_unless(frames == 1 && parser.frame.type == LINK_SYNC && parser.frame.seq == 8,
+        "parse: LINK_SYNC seq 8");
+    
+    // #3: устройство: запрос состояния - все места в очереди свободны
+    _test_link_channel ch;
+    memset(&ch, 0, sizeof(ch));
+    sm_x.current_pos = 0;
+    sm_y.current_pos = 0;
+    sput_fail_unless(stepper_link_start(axes, 2, _test_link_read_byte, _test_link_write_byte, &ch),
+        "stepper_link_start == true");
+    ch.in_size += stepper_link_write_frame(ch.in + ch.in_size, LINK_SYNC, 0, NULL, 0);
+    stepper_link_handle();
+    sput_fail_unless(_test_link_reply(&ch, LINK_ACK, 255, STEPPER_LINK_QUEUE_SIZE),
+        "sync: ACK 255, all credits");
+    
+    // #4: два сегмента подряд: x вперед, y назад;
+    // первый запускается сразу и освобождает место в очереди
+    stepper_program_record record;
+    record.type = PROGRAM_MOVE;
+    record.axis_mask = 1;
+    record.axes[0].step_count = 3;
+    record.axes[0].dir = 1;
+    record.axes[0].step_delay = 1000;
+    _test_link_send_record(&ch, 0, &record);
+    record.axis_mask = 2;
+    record.axes[1].step_count = 2;
+    record.axes[1].dir = -1;
+    record.axes[1].step_delay = 1000;
+    _test_link_send_record(&ch, 1, &record);
+    sput_fail_unless(stepper_link_handle(), "segments: stepper_link_handle() == true");
+    sput_fail_unless(_test_link_reply(&ch, LINK_ACK, 0, STEPPER_LINK_QUEUE_SIZE - 1), "segments: ACK 0");
+    sput_fail_unless(_test_link_reply(&ch, LINK_ACK, 1, STEPPER_LINK_QUEUE_SIZE - 2), "segments: ACK 1");
+    sput_fail_unless(_test_link_reply(&ch, LINK_ACK, 1, STEPPER_LINK_QUEUE_SIZE - 1),
+        "segments: ACK 1, credit returned");
+    
+    // #5: повтор (ответ потерялся) и кадр не по порядку
+    _test_link_send_record(&ch, 1, &record);
+    _test_link_send_record(&ch, 5, &record);
+    stepper_link_handle();
+    sput_fail_unless(_test_link_reply(&ch, LINK_ACK, 1, STEPPER_LINK_QUEUE_SIZE - 1), "repeat: ACK 1");
+    sput_fail_unless(_test_link_reply(&ch, LINK_NAK, 2, STEPPER_LINK_QUEUE_SIZE - 1), "gap: NAK 2");
+    
+    // #6: испорченный кадр
+    record.type = PROGRAM_END;
+    _test_link_send_record(&ch, 2, &record);
+    ch.in[ch.in_size - 1] ^= 0x01;
+    stepper_link_handle();
+    sput_fail_unless(_test_link_reply(&ch, LINK_NAK, 2, STEPPER_LINK_QUEUE_SIZE - 1), "bad crc: NAK 2");
+    
+    // #7: конец программы, выполнение до конца
+    _test_link_send_record(&ch, 2, &record);
+    int loops = 0;
+    while(stepper_link_handle() && loops < 1000) {
+        timer_tick(1);
+        loops++;
+    }
+    sput_fail_unless(_test_link_reply(&ch, LINK_ACK, 2, 0), "end: ACK 2");
+    sput_fail_unless(stepper_link_status() == LINK_FINISHED, "end: LINK_FINISHED");
+    sput_fail_unless(sm_x.current_pos == 7500*3, "end: x.pos == 7500*3");
+    sput_fail_unless(sm_y.current_pos == -7500*2, "end: y.pos == -7500*2");
+    stepper_link_stats_t stats;
+    stepper_link_stats(&stats);
+    sput_fail_unless(stats.frames == 3 && stats.segments == 2, "stats: 3 frames, 2 segments");
+    sput_fail_unless(stats.bad_frames == 1 && stats.seq_errors == 2, "stats: 1 bad frame, 2 seq errors");
+    
+    // #8: хост не дождался кредитов - очередь полна
+    memset(&ch, 0, sizeof(ch));
+    stepper_link_start(axes, 2, _test_link_read_byte, _test_link_write_byte, &ch);
+    record.type = PROGRAM_MOVE;
+    for(int i = 0; i <= STEPPER_LINK_QUEUE_SIZE; i++) {
+        _test_link_send_record(&ch, i, &record);
+    }
+    stepper_link_handle();
+    stepper_link_stats(&stats);
+    sput_fail_unless(stats.overflows == 1 && stats.frames == STEPPER_LINK_QUEUE_SIZE,
+        "overflow: 1 frame over credits");
+    stepper_link_cancel();
+    sput_fail_unless(stepper_link_status() == LINK_ERROR, "cancel: LINK_ERROR");
+    
+    // #9: CRC верна, запись некорректна - передача прерывается
+    memset(&ch, 0, sizeof(ch));
+    stepper_link_start(axes, 2, _test_link_read_byte, _test_link_write_byte, &ch);
+    unsigned char bad_record[] = {7, 0};
+    ch.in_size += stepper_link_write_frame(ch.in, LINK_SEGMENT, 0, bad_record, 2);
+    sput_fail_unless(!stepper_link_handle(), "bad record: stepper_link_handle() == false");
+    sput_fail_unless(stepper_link_status() == LINK_ERROR, "bad record: LINK_ERROR");
+}
+
+// Шаги на ножке step мотора (переход HIGH->LOW) для test_backlash
+static int _test_backlash_pulses = 0;
+
+static void _test_backlash_step_changed() {
+    if(digitalRead(8) == LOW) {
+        _test_backlash_pulses++;
+    }
+}
+
+static void test_backlash() {
+    // компенсация люфта: шаги при смене направления,
+    // которые не меняют current_pos
+    
+    stepper sm_x;
+    init_stepper(&sm_x, 'x', 8, 9, 10, false, 1000, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 0);
+    init_stepper_backlash(&sm_x, 3);
+    
+    // на всякий случай завершим цикл, если он остался от предыдущих тестов
+    stepper_finish_cycle();
+    
+    digitalWrite(8, LOW);
+    attachInterrupt(8, _test_backlash_step_changed, CHANGE);
+    
+    // #1: первое движение - направление неизвестно, без компенсации
+    sm_x.current_pos = 0;
+    _test_backlash_pulses = 0;
+    prepare_steps(&sm_x, 5, 1, 1000);
+    stepper_start_cycle();
+    timer_tick(5000/200 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "forward: cycle finished");
+    sput_fail_unless(_test_backlash_pulses == 5, "forward: 5 pulses");
+    sput_fail_unless(sm_x.current_pos == 7500*5, "forward: x.pos == 7500*5");
+    
+    // #2: назад: 3 шага компенсации по 1000мкс, потом 5 шагов по 2000мкс
+    _test_backlash_pulses = 0;
+    prepare_steps(&sm_x, 5, -1, 2000);
+    stepper_start_cycle();
+    timer_tick(3000/200);
+    sput_fail_unless(_test_backlash_pulses == 3, "back: 3 backlash pulses");
+    sput_fail_unless(sm_x.current_pos == 7500*5, "back: backlash: x.pos == 7500*5");
+    timer_tick(2000/200);
+    sput_fail_unless(_test_backlash_pulses == 4 && sm_x.current_pos == 7500*4,
+        "back: first step after 2000us");
+    timer_tick(8000/200 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "back: cycle finished");
+    sput_fail_unless(_test_backlash_pulses == 3 + 5, "back: 8 pulses");
+    sput_fail_unless(sm_x.current_pos == 0, "back: x.pos == 0");
+    
+    // #3: снова назад - без компенсации
+    _test_backlash_pulses = 0;
+    prepare_steps(&sm_x, 2, -1, 1000);
+    stepper_start_cycle();
+    timer_tick(2000/200 + 1);
+    sput_fail_unless(_test_backlash_pulses == 2, "same dir: 2 pulses");
+    sput_fail_unless(sm_x.current_pos == -7500*2, "same dir: x.pos == -7500*2");
+    
+    // #4: смена направления между сериями dir_buffer (и пауза dir=0
+    // направление не меняет): +2, стоим 1, +1, -2
+    unsigned long step_buffer[] = {2, 1, 1, 2};
+    int dir_buffer[] = {1, 0, 1, -1};
+    unsigned long delay_buffer[] = {1000, 1000, 1000, 1000};
+    _test_backlash_pulses = 0;
+    prepare_buffered_steps(&sm_x, 4, step_buffer, dir_buffer, delay_buffer);
+    stepper_start_cycle();
+    timer_tick((3 + 6 + 3)*1000/200 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "buffered: cycle finished");
+    sput_fail_unless(stepper_cycle_error() == CYCLE_ERROR_NONE, "buffered: CYCLE_ERROR_NONE");
+    sput_fail_unless(_test_backlash_pulses == 3 + 3 + 3 + 2, "buffered: 11 pulses");
+    sput_fail_unless(sm_x.current_pos == -7500*1, "buffered: x.pos == -7500");
+    
+    // #5: цикл прерван во время компенсации - люфт не выбран,
+    // в следующем цикле компенсация полностью
+    _test_backlash_pulses = 0;
+    prepare_steps(&sm_x, 2, 1, 1000);
+    stepper_start_cycle();
+    timer_tick(1000/200);
+    sput_fail_unless(_test_backlash_pulses == 1, "canceled: 1 backlash pulse");
+    stepper_finish_cycle();
+    sput_fail_unless(sm_x.backlash_dir == -1, "canceled: backlash_dir == -1");
+    _test_backlash_pulses = 0;
+    prepare_steps(&sm_x, 2, 1, 1000);
+    stepper_start_cycle();
+    timer_tick((3 + 2)*1000/200 + 1);
+    sput_fail_unless(!stepper_cycle_running(), "after cancel: cycle finished");
+    sput_fail_unless(_test_backlash_pulses == 3 + 2, "after cancel: 5 pulses");
+    sput_fail_unless(sm_x.backlash_dir == 1, "after cancel: backlash_dir == 1");
+    sput_fail_unless(sm_x.current_pos == 7500*1, "after cancel: x.pos == 7500");
+    
+    // #6: без люфта - без компенсации
+    init_stepper_backlash(&sm_x, 0);
+    _test_backlash_pulses = 0;
+    prepare_steps(&sm_x, 2, 1, 1000);
+    stepper_start_cycle();
+    timer_tick(2000/200 + 1);
+    sput_fail_unless(_test_backlash_pulses == 2, "no backlash: 2 pulses");
+    
+    detachInterrupt(8);
+}
+
+
+
+/////////////////////////////////////////////////////////
+// test suites
+
+/** Stepper cycle lifecycle */
+int stepper_test_suite_lifecycle() {
+    sput_start_testing();
+
+    sput_enter_suite("Stepper cycle lifecycle");
+    sput_run_test(test_lifecycle);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Stepper cycle timer period settings */
+int stepper_test_suite_timer_period() {
+    sput_start_testing();
+
+    sput_enter_suite("Stepper cycle timer period settings");
+    sput_run_test(test_timer_period);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Stepper cycle timer period is aliquant part of motor step pulse delay */
+int stepper_test_suite_timer_period_aliquant_step_delay() {
+    sput_start_testing();
+    
+    sput_enter_suite("Stepper cycle timer period is aliquant part of motor step pulse delay");
+    sput_run_test(test_timer_period_aliquant_step_delay);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Exit bounds */
+int stepper_test_suite_exit_bounds() {
+    sput_start_testing();
+    
+    sput_enter_suite("Exit bounds");
+    sput_run_test(test_exit_bounds);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Single motor: 3 steps tick by tick on max speed */
+int stepper_test_suite_max_speed_tick_by_tick() {
+    sput_start_testing();
+    
+    sput_enter_suite("Single motor: 3 steps tick by tick on max speed");
+    sput_run_test(test_max_speed_tick_by_tick);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Single motor: 30000 steps on max speed */
+int stepper_test_suite_max_speed_30000steps() {
+    sput_start_testing();
+    
+    sput_enter_suite("Single motor: 30000 steps on max speed");
+    sput_run_test(test_max_speed_30000steps);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Single motor: 5 steps tick by tick on aliquant speed */
+int stepper_test_suite_aliquant_speed_tick_by_tick() {
+    sput_start_testing();
+    
+    sput_enter_suite("Single motor: 5 steps tick by tick on aliquant speed");
+    sput_run_test(test_aliquant_speed_tick_by_tick);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** 3 motors: draw triangle */
+int stepper_test_suite_draw_triangle() {
+    sput_start_testing();
+    
+    sput_enter_suite("3 motors: draw triangle");
+    sput_run_test(test_draw_triangle);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Small step delay error handlers */
+int stepper_test_suite_small_step_delay_handlers() {
+    sput_start_testing();
+    
+    sput_enter_suite("Small step delay error handlers");
+    sput_run_test(test_small_step_delay_handlers);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Moving with variable speed: buffered steps tick by tick */
+int stepper_test_suite_buffered_steps_tick_by_tick() {
+    sput_start_testing();
+    
+    sput_enter_suite("Moving with variable speed: buffered steps tick by tick");
+    sput_run_test(test_buffered_steps_tick_by_tick);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Moving with variable speed: buffered steps */
+int stepper_test_suite_buffered_steps() {
+    sput_start_testing();
+    
+    sput_enter_suite("Moving with variable speed: buffered steps");
+    sput_run_test(test_buffered_steps);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Buffered steps skip steps with dir=0 */
+int stepper_test_suite_skip_steps_dir_zero() {
+    sput_start_testing();
+    
+    sput_enter_suite("Buffered steps skip steps with dir=0");
+    sput_run_test(test_skip_steps_dir_zero);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Step-dir driver std divider modes: 1/1, 1/18, 1/16, 1/32 */
+int stepper_test_suite_driver_std_modes() {
+    sput_start_testing();
+    
+    sput_enter_suite("Step-dir driver std divider modes: 1/1, 1/18, 1/16, 1/32");
+    sput_run_test(test_driver_std_modes);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Step-dir driver std divider modes for 2 motors at a time */
+int stepper_test_suite_driver_std_modes_2motors() {
+    sput_start_testing();
+    
+    sput_enter_suite("Step-dir driver std divider modes for 2 motors at a time");
+    sput_run_test(test_driver_std_modes_2motors);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Single motor: exit bounds (issue #1) - whirl */
+int stepper_test_suite_issue1_exit_bounds_whirl() {
+    sput_start_testing();
+    
+    sput_enter_suite("Single motor: exit bounds (issue #1) - whirl");
+    sput_run_test(test_issue1_exit_bounds_whirl);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Single motor: exit bounds (issue #1) - steps */
+int stepper_test_suite_issue1_exit_bounds_steps() {
+    sput_start_testing();
+    
+    sput_enter_suite("Single motor: exit bounds (issue #1) - steps");
+    sput_run_test(test_issue1_exit_bounds_steps);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Single motor: exit bounds (issue #9) - steps */
+int stepper_test_suite_issue9_exit_bounds_steps() {
+    sput_start_testing();
+    
+    sput_enter_suite("Single motor: exit bounds (issue #9) - steps");
+    sput_run_test(test_issue9_exit_bounds_steps);
+
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Single motor: test square signal (issue #16) */
+int stepper_test_suite_issue16_square_sig() {
+    sput_start_testing();
+    
+    sput_enter_suite("Single motor: test square signal (issue #16)");
+    sput_run_test(test_issue16_square_sig);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Automatic timer period for prepared motors */
+int stepper_test_suite_timer_period_auto() {
+    sput_start_testing();
+    
+    sput_enter_suite("Automatic timer period for prepared motors");
+    sput_run_test(test_timer_period_auto);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Aliquant step delay with FIX handle */
+int stepper_test_suite_aliquant_step_delay_fix() {
+    sput_start_testing();
+    
+    sput_enter_suite("Aliquant step delay with FIX handle");
+    sput_run_test(test_aliquant_step_delay_fix);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Adaptive timer period */
+int stepper_test_suite_timer_period_adaptive() {
+    sput_start_testing();
+    
+    sput_enter_suite("Adaptive timer period");
+    sput_run_test(test_timer_period_adaptive);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Two tick steps */
+int stepper_test_suite_two_tick_steps() {
+    sput_start_testing();
+    
+    sput_enter_suite("Two tick steps");
+    sput_run_test(test_two_tick_steps);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Dual edge steps */
+int stepper_test_suite_dual_edge() {
+    sput_start_testing();
+    
+    sput_enter_suite("Dual edge steps");
+    sput_run_test(test_dual_edge);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Step multiplier */
+int stepper_test_suite_step_multiplier() {
+    sput_start_testing();
+    
+    sput_enter_suite("Step multiplier");
+    sput_run_test(test_step_multiplier);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Active motors */
+int stepper_test_suite_active_motors() {
+    sput_start_testing();
+    
+    sput_enter_suite("Active motors");
+    sput_run_test(test_active_motors);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Many motors */
+int stepper_test_suite_many_motors() {
+    sput_start_testing();
+    
+    sput_enter_suite("Many motors");
+    sput_run_test(test_many_motors);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Static engine */
+int stepper_test_suite_static_engine() {
+    sput_start_testing();
+    
+    sput_enter_suite("Static engine");
+    sput_run_test(test_static_engine);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Snapshot */
+int stepper_test_suite_snapshot() {
+    sput_start_testing();
+    
+    sput_enter_suite("Snapshot");
+    sput_run_test(test_snapshot);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Events */
+int stepper_test_suite_events() {
+    sput_start_testing();
+    
+    sput_enter_suite("Events");
+    sput_run_test(test_events);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Speed override */
+int stepper_test_suite_speed_override() {
+    sput_start_testing();
+    
+    sput_enter_suite("Speed override");
+    sput_run_test(test_speed_override);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Feed hold: decelerate, pause, resume */
+int stepper_test_suite_feed_hold() {
+    sput_start_testing();
+    
+    sput_enter_suite("Feed hold: decelerate, pause, resume");
+    sput_run_test(test_feed_hold);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Homing: fast approach, back off, slow approach */
+int stepper_test_suite_homing() {
+    sput_start_testing();
+    
+    sput_enter_suite("Homing: fast approach, back off, slow approach");
+    sput_run_test(test_homing);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Hardware end switches */
+int stepper_test_suite_endstops() {
+    sput_start_testing();
+    
+    sput_enter_suite("Hardware end switches");
+    sput_run_test(test_endstops);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+#ifdef STEPPER_DEFERRED_STEPS
+/** Deferred step data */
+int stepper_test_suite_deferred() {
+    sput_start_testing();
+    
+    sput_enter_suite("Deferred step data");
+    sput_run_test(test_deferred);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+#endif // STEPPER_DEFERRED_STEPS
+
+/** Missed timer ticks catch-up */
+int stepper_test_suite_missed_ticks() {
+    sput_start_testing();
+    
+    sput_enter_suite("Missed timer ticks catch-up");
+    sput_run_test(test_missed_ticks);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Buffered steps normalization */
+int stepper_test_suite_normalize_buffered_steps() {
+    sput_start_testing();
+    
+    sput_enter_suite("Buffered steps normalization");
+    sput_run_test(test_normalize_buffered_steps);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Binary motion program */
+int stepper_test_suite_program() {
+    sput_start_testing();
+    
+    sput_enter_suite("Binary motion program");
+    sput_run_test(test_program);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** G-code */
+int stepper_test_suite_gcode() {
+    sput_start_testing();
+    
+    sput_enter_suite("G-code");
+    sput_run_test(test_gcode);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Host link protocol */
+int stepper_test_suite_link() {
+    sput_start_testing();
+    
+    sput_enter_suite("Host link protocol");
+    sput_run_test(test_link);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+/** Backlash compensation */
+int stepper_test_suite_backlash() {
+    sput_start_testing();
+    
+    sput_enter_suite("Backlash compensation");
+    sput_run_test(test_backlash);
+    
+    sput_finish_testing();
+    return sput_get_return_value();
+}
+
+
+/** All tests in one bundle */
+int stepper_test_suite() {
+    sput_start_testing();
+
+    sput_enter_suite("Stepper cycle lifecycle");
+    sput_run_test(test_lifecycle);
+    
+    sput_enter_suite("Stepper cycle timer period settings");
+    sput_run_test(test_timer_period);
+    
+    sput_enter_suite("Stepper cycle timer period is aliquant part of motor step pulse delay");
+    sput_run_test(test_timer_period_aliquant_step_delay);
+    
+    sput_enter_suite("Exit bounds");
+    sput_run_test(test_exit_bounds);
+    
+    sput_enter_suite("Single motor: 3 steps tick by tick on max speed");
+    sput_run_test(test_max_speed_tick_by_tick);
+    
+    sput_enter_suite("Single motor: 30000 steps on max speed");
+    sput_run_test(test_max_speed_30000steps);
+    
+    sput_enter_suite("Single motor: 5 steps tick by tick on aliquant speed");
+    sput_run_test(test_aliquant_speed_tick_by_tick);
     
     sput_enter_suite("3 motors: draw triangle");
     sput_run_test(test_draw_triangle);
     
+    // с отложенными вычислениями статусы, ошибки и смена периода
+    // таймера после шага - на один импульс позже
+#ifndef STEPPER_DEFERRED_STEPS
     sput_enter_suite("Small step delay error handlers");
     sput_run_test(test_small_step_delay_handlers);
+#endif // STEPPER_DEFERRED_STEPS
     
     sput_enter_suite("Moving with variable speed: buffered steps tick by tick");
     sput_run_test(test_buffered_steps_tick_by_tick);
@@ -2369,8 +4729,10 @@ int stepper_test_suite() {
     sput_enter_suite("Moving with variable speed: buffered steps");
     sput_run_test(test_buffered_steps);
     
+#ifndef STEPPER_DEFERRED_STEPS
     sput_enter_suite("Buffered steps skip steps with dir=0");
     sput_run_test(test_skip_steps_dir_zero);
+#endif // STEPPER_DEFERRED_STEPS
     
     sput_enter_suite("Step-dir driver std divider modes: 1/1, 1/18, 1/16, 1/32");
     sput_run_test(test_driver_std_modes);
@@ -2391,6 +4753,76 @@ int stepper_test_suite() {
     sput_enter_suite("Single motor: test square signal (issue #16)");
     sput_run_test(test_issue16_square_sig);
     
+    sput_enter_suite("Automatic timer period for prepared motors");
+    sput_run_test(test_timer_period_auto);
+    
+    sput_enter_suite("Aliquant step delay with FIX handle");
+    sput_run_test(test_aliquant_step_delay_fix);
+    
+#ifndef STEPPER_DEFERRED_STEPS
+    sput_enter_suite("Adaptive timer period");
+    sput_run_test(test_timer_period_adaptive);
+    
+    sput_enter_suite("Two tick steps");
+    sput_run_test(test_two_tick_steps);
+    
+    sput_enter_suite("Dual edge steps");
+    sput_run_test(test_dual_edge);
+#endif // STEPPER_DEFERRED_STEPS
+    
+    sput_enter_suite("Step multiplier");
+    sput_run_test(test_step_multiplier);
+    
+    sput_enter_suite("Active motors");
+    sput_run_test(test_active_motors);
+    
+    sput_enter_suite("Many motors");
+    sput_run_test(test_many_motors);
+    
+    sput_enter_suite("Static engine");
+    sput_run_test(test_static_engine);
+    
+    sput_enter_suite("Snapshot");
+    sput_run_test(test_snapshot);
+    
+    sput_enter_suite("Events");
+    sput_run_test(test_events);
+    
+    sput_enter_suite("Speed override");
+    sput_run_test(test_speed_override);
+    
+    sput_enter_suite("Feed hold: decelerate, pause, resume");
+    sput_run_test(test_feed_hold);
+    
+    sput_enter_suite("Homing: fast approach, back off, slow approach");
+    sput_run_test(test_homing);
+    
+    sput_enter_suite("Hardware end switches");
+    sput_run_test(test_endstops);
+    
+#ifdef STEPPER_DEFERRED_STEPS
+    sput_enter_suite("Deferred step data");
+    sput_run_test(test_deferred);
+#endif // STEPPER_DEFERRED_STEPS
+    
+    sput_enter_suite("Missed timer ticks catch-up");
+    sput_run_test(test_missed_ticks);
+    
+    sput_enter_suite("Buffered steps normalization");
+    sput_run_test(test_normalize_buffered_steps);
+    
+    sput_enter_suite("Binary motion program");
+    sput_run_test(test_program);
+    
+    sput_enter_suite("G-code");
+    sput_run_test(test_gcode);
+    
+    sput_enter_suite("Host link protocol");
+    sput_run_test(test_link);
+    
+    sput_enter_suite("Backlash compensation");
+    sput_run_test(test_backlash);
+    
     
     sput_finish_testing();
     return sput_get_return_value();
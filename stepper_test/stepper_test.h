@@ -47,6 +47,74 @@ int stepper_test_suite_exit_bounds_issue9_steps();
 /** Single motor: test square signal (issue #16) */
 int stepper_test_suite_square_sig_issue16();
 
+/** Automatic timer period for prepared motors */
+int stepper_test_suite_timer_period_auto();
+
+/** Aliquant step delay with FIX handle */
+int stepper_test_suite_aliquant_step_delay_fix();
+
+/** Adaptive timer period */
+int stepper_test_suite_timer_period_adaptive();
+
+/** Two tick steps */
+int stepper_test_suite_two_tick_steps();
+
+/** Dual edge steps */
+int stepper_test_suite_dual_edge();
+
+/** Step multiplier */
+int stepper_test_suite_step_multiplier();
+
+/** Active motors */
+int stepper_test_suite_active_motors();
+
+/** Many motors */
+int stepper_test_suite_many_motors();
+
+/** Static engine */
+int stepper_test_suite_static_engine();
+
+/** Snapshot */
+int stepper_test_suite_snapshot();
+
+/** Events */
+int stepper_test_suite_events();
+
+/** Speed override */
+int stepper_test_suite_speed_override();
+
+/** Feed hold: decelerate, pause, resume */
+int stepper_test_suite_feed_hold();
+
+/** Homing: fast approach, back off, slow approach */
+int stepper_test_suite_homing();
+
+/** Hardware end switches */
+int stepper_test_suite_endstops();
+
+#ifdef STEPPER_DEFERRED_STEPS
+/** Deferred step data */
+int stepper_test_suite_deferred();
+#endif // STEPPER_DEFERRED_STEPS
+
+/** Missed timer ticks catch-up */
+int stepper_test_suite_missed_ticks();
+
+/** Buffered steps normalization */
+int stepper_test_suite_normalize_buffered_steps();
+
+/** Binary motion program */
+int stepper_test_suite_program();
+
+/** G-code */
+int stepper_test_suite_gcode();
+
+/** Host link protocol */
+int stepper_test_suite_link();
+
+/** Backlash compensation */
+int stepper_test_suite_backlash();
+
 ///////
 
 /** All tests in one bundle */
@@ -2,8 +2,15 @@
 // для digitalWrite
 int dbg_pin_values[64];
 
+// обработчики прерываний по изменению уровня
+// для attachInterrupt
+static void (*dbg_pin_handlers[64])(void);
+
+// значение для micros (время идет, только когда его двигает тест)
+unsigned long dbg_micros = 0;
+
 unsigned long micros() {
-    return 0;
+    return dbg_micros;
 }
 
 void pinMode(int pin, int mode) {
@@ -13,7 +20,11 @@ void pinMode(int pin, int mode) {
  * Сохранить значение пина
  */
 void digitalWrite(int pin, int val) {
+    bool changed = dbg_pin_values[pin] != val;
     dbg_pin_values[pin] = val;
+    if(changed && dbg_pin_handlers[pin] != 0) {
+        dbg_pin_handlers[pin]();
+    }
 }
 
 /**
@@ -24,3 +35,15 @@ int digitalRead(int pin) {
     return dbg_pin_values[pin];
 }
 
+/**
+ * Вызывать handler при изменении значения пина
+ * (digitalWrite)
+ */
+void attachInterrupt(int interrupt, void (*handler)(void), int mode) {
+    dbg_pin_handlers[interrupt] = handler;
+}
+
+void detachInterrupt(int interrupt) {
+    dbg_pin_handlers[interrupt] = 0;
+}
+
@@ -7,13 +7,26 @@
 #define HIGH 1
 #define LOW 0
 
+#define CHANGE 1
+#define NOT_AN_INTERRUPT -1
+
+// номер прерывания совпадает с номером ножки
+#define digitalPinToInterrupt(pin) (pin)
+
 unsigned long micros();
 
+// значение для micros (время идет, только когда его двигает тест)
+extern unsigned long dbg_micros;
+
 void pinMode(int pin, int mode);
 
 void digitalWrite(int pin, int val);
 
 int digitalRead(int pin);
 
+void attachInterrupt(int interrupt, void (*handler)(void), int mode);
+
+void detachInterrupt(int interrupt);
+
 #endif // WPROGRAM_H
 
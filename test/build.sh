@@ -5,6 +5,11 @@ g++ -std=c++11 -c \
     Arduino.cpp \
     ../src/stepper.cpp \
     ../src/stepper_timer.cpp \
+    ../src/stepper_homing.cpp \
+    ../src/stepper_program.cpp \
+    ../src/stepper_gcode.cpp \
+    ../src/stepper_link.cpp \
+    stepper_configure_timer_stub.cpp \
     ../stepper_test/stepper_test.cpp \
     stepper_test_main.cpp
 g++ *.o -o stepper_test
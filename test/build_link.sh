@@ -0,0 +1,17 @@
+#!/bin/sh
+# протокол связи с хостом (stepper_link.h) через pty на бэкенде Linux
+# (для SCHED_FIFO запускать от root или с CAP_SYS_NICE)
+mkdir -p link
+cd link
+gcc -c -DSTEPPER_LINUX -I../../src/linux -I../../src/ ../../src/linux/timer_setup.c
+g++ -std=c++11 -c \
+    -DSTEPPER_LINUX \
+    -I../../src/linux -I../../src/ \
+    ../../src/linux/Arduino.cpp \
+    ../../src/linux/stepper_configure_timer.cpp \
+    ../../src/stepper.cpp \
+    ../../src/stepper_timer.cpp \
+    ../../src/stepper_program.cpp \
+    ../../src/stepper_link.cpp \
+    ../stepper_link_main.cpp
+g++ *.o -pthread -o ../stepper_link
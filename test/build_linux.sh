@@ -0,0 +1,15 @@
+#!/bin/sh
+# бэкенд Linux: движок на потоке таймера реального времени
+# (для SCHED_FIFO запускать от root или с CAP_SYS_NICE)
+mkdir -p linux
+cd linux
+gcc -c -DSTEPPER_LINUX -I../../src/linux -I../../src/ ../../src/linux/timer_setup.c
+g++ -std=c++11 -c \
+    -DSTEPPER_LINUX \
+    -I../../src/linux -I../../src/ \
+    ../../src/linux/Arduino.cpp \
+    ../../src/linux/stepper_configure_timer.cpp \
+    ../../src/stepper.cpp \
+    ../../src/stepper_timer.cpp \
+    ../stepper_linux_main.cpp
+g++ *.o -pthread -o ../stepper_linux
@@ -0,0 +1,20 @@
+#!/bin/sh
+# тесты с планировщиком на колесе времени, 32 моторами
+# и концевиками на прерываниях
+mkdir -p wheel
+cd wheel
+gcc -c ../timer_setup_stub.c
+g++ -std=c++11 -c \
+    -DMAX_STEPPERS=32 -DSTEPPER_TIMING_WHEEL -DSTEPPER_ENDSTOP_INTERRUPTS \
+    -I.. -I../../src/ -I../../stepper_test/ -I../../stepper_test/sput-1.4.0 \
+    ../Arduino.cpp \
+    ../../src/stepper.cpp \
+    ../../src/stepper_timer.cpp \
+    ../../src/stepper_homing.cpp \
+    ../../src/stepper_program.cpp \
+    ../../src/stepper_gcode.cpp \
+    ../../src/stepper_link.cpp \
+    ../stepper_configure_timer_stub.cpp \
+    ../../stepper_test/stepper_test.cpp \
+    ../stepper_test_main.cpp
+g++ *.o -o ../stepper_test_wheel
@@ -0,0 +1,26 @@
+extern "C"{
+    #include "timer_setup.h"
+}
+
+#include "stepper_configure_timer.h"
+
+/**
+ * Наибольший период, который тестовый таймер получает точно
+ * (имитация короткого счетчика); 0 - без ограничения.
+ */
+unsigned long dbg_timer_period_max = 0;
+
+/**
+ * Тестовый режим: таймер условно считает 1 тик в микросекунду
+ * с масштабом 1:8, счетчик 32 бит (до dbg_timer_period_max).
+ */
+bool stepper_timer_period_settings(unsigned long period_us, int timer, int* prescaler, unsigned int* adjustment) {
+    (void)timer;
+    if(period_us == 0 || (dbg_timer_period_max != 0 && period_us > dbg_timer_period_max)) {
+        return false;
+    }
+    *prescaler = TIMER_PRESCALER_1_8;
+    *adjustment = period_us - 1;
+    return true;
+}
+
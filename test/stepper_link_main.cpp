@@ -0,0 +1,244 @@
+/**
+ * stepper_link_main.cpp
+ *
+ * Проверка протокола связи с хостом (stepper_link.h) через псевдотерминал
+ * на бэкенде Linux (STEPPER_LINUX): хост в отдельном потоке пишет кадры
+ * с сегментами в ведущую сторону pty, держит очередь устройства
+ * заполненной по кредитам и повторяет кадры по LINK_NAK и по таймауту;
+ * устройство (основной поток) читает ведомую сторону и выполняет
+ * сегменты на потоке таймера. Один кадр хост портит нарочно.
+ *
+ * ./stepper_link [количество сегментов]
+ */
+
+#include "Arduino.h"
+#include "stepper.h"
+#include "stepper_configure_timer.h"
+#include "stepper_link.h"
+#include "stepper_linux.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// Шагов в сегменте
+#define SEGMENT_STEPS 40
+
+// Таймаут хоста без ответа устройства, мс
+#define HOST_TIMEOUT_MS 200
+
+// Номер кадра, который хост портит при первой отправке
+#define CORRUPT_FRAME 10
+
+static stepper sm_x, sm_y;
+
+// Ведущая (хост) и ведомая (устройство) стороны pty
+static int _host_fd = -1;
+static int _device_fd = -1;
+
+// Сегментов без конца программы
+static int _segment_count = 40;
+
+// Результат хоста
+static bool _host_ok = false;
+static unsigned long _host_resent = 0;
+
+static unsigned long long now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+static void write_all(int fd, const unsigned char* buf, int size) {
+    while(size > 0) {
+        ssize_t n = write(fd, buf, size);
+        if(n > 0) {
+            buf += n;
+            size -= n;
+        } else {
+            usleep(100);
+        }
+    }
+}
+
+/**
+ * Кадр с записью программы номер i: сегменты по очереди двигают
+ * x вперед и y назад или наоборот, последний - конец программы.
+ */
+static int build_frame(int i, unsigned char* buf) {
+    stepper_program_record record;
+    if(i < _segment_count) {
+        int dir = i % 2 == 0 ? 1 : -1;
+        record.type = PROGRAM_MOVE;
+        record.axis_mask = 3;
+        record.axes[0].step_count = SEGMENT_STEPS;
+        record.axes[0].dir = dir;
+        record.axes[0].step_delay = 500;
+        record.axes[1].step_count = SEGMENT_STEPS/2;
+        record.axes[1].dir = -dir;
+        record.axes[1].step_delay = 1000;
+    } else {
+        record.type = PROGRAM_END;
+        record.axis_mask = 0;
+    }
+    unsigned char payload[STEPPER_PROGRAM_RECORD_MAX];
+    int len = stepper_program_write_record(payload, &record);
+    return stepper_link_write_frame(buf, LINK_SEGMENT, i & 0xFF, payload, len);
+}
+
+/**
+ * Хост: отправляет кадры в пределах кредитов, двигает окно по LINK_ACK,
+ * возвращается к неподтвержденному кадру по LINK_NAK и по таймауту.
+ */
+static void* host_thread(void* arg) {
+    int total = _segment_count + 1;
+    int acked = 0;
+    int next = 0;
+    int credits = 0;
+    bool corrupted = false;
+    unsigned long long last_reply = now_ms();
+    unsigned long long last_rewind = 0;
+
+    stepper_link_parser parser;
+    stepper_link_parser_init(&parser);
+
+    // кредиты пока неизвестны - запрос состояния
+    unsigned char buf[STEPPER_LINK_FRAME_MAX];
+    write_all(_host_fd, buf, stepper_link_write_frame(buf, LINK_SYNC, 0, NULL, 0));
+
+    unsigned long long deadline = now_ms() + 30000;
+    while(acked < total && now_ms() < deadline) {
+        while(next < total && next < acked + credits) {
+            int size = build_frame(next, buf);
+            if(next == CORRUPT_FRAME && !corrupted) {
+                buf[size - 3] ^= 0x55;
+                corrupted = true;
+            }
+            write_all(_host_fd, buf, size);
+            next++;
+        }
+
+        struct pollfd pfd = {_host_fd, POLLIN, 0};
+        if(poll(&pfd, 1, 10) > 0) {
+            unsigned char in[64];
+            ssize_t n = read(_host_fd, in, sizeof(in));
+            for(ssize_t i = 0; i < n; i++) {
+                if(stepper_link_parse(&parser, in[i]) != LINK_PARSE_FRAME ||
+                        parser.frame.len != 1) {
+                    continue;
+                }
+                last_reply = now_ms();
+
+                // номер кадра, который ожидает устройство
+                unsigned char expected = parser.frame.type == LINK_ACK ?
+                    parser.frame.seq + 1 : parser.frame.seq;
+                int diff = (unsigned char)(expected - (acked & 0xFF));
+                if(diff <= next - acked) {
+                    acked += diff;
+                }
+                credits = parser.frame.payload[0];
+
+                // на каждый кадр после испорченного тоже придет LINK_NAK -
+                // повторяем один раз
+                if(parser.frame.type == LINK_NAK && next > acked &&
+                        now_ms() - last_rewind > HOST_TIMEOUT_MS) {
+                    _host_resent += next - acked;
+                    next = acked;
+                    last_rewind = now_ms();
+                }
+            }
+        }
+
+        if(now_ms() - last_reply > HOST_TIMEOUT_MS) {
+            // ответов нет - повторяем неподтвержденные кадры и спрашиваем кредиты
+            _host_resent += next - acked;
+            next = acked;
+            write_all(_host_fd, buf, stepper_link_write_frame(buf, LINK_SYNC, 0, NULL, 0));
+            last_reply = now_ms();
+        }
+    }
+    _host_ok = acked == total;
+    return NULL;
+}
+
+static int device_read_byte(void* source) {
+    unsigned char b;
+    return read(_device_fd, &b, 1) == 1 ? b : -1;
+}
+
+static void device_write_byte(unsigned char b, void* source) {
+    write_all(_device_fd, &b, 1);
+}
+
+int main(int argc, char** argv) {
+    if(argc > 1) {
+        _segment_count = atoi(argv[1]);
+    }
+
+    // pty в сыром режиме: байты без обработки
+    _host_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(_host_fd < 0 || grantpt(_host_fd) != 0 || unlockpt(_host_fd) != 0) {
+        printf("Can't open pty\n");
+        return 1;
+    }
+    _device_fd = open(ptsname(_host_fd), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(_device_fd < 0) {
+        printf("Can't open pty slave\n");
+        return 1;
+    }
+    struct termios tio;
+    tcgetattr(_device_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(_device_fd, TCSANOW, &tio);
+
+    // init_stepper(smotor, name, pin_step, pin_dir, pin_en,
+    //     invert_dir, step_delay, distance_per_step)
+    init_stepper(&sm_x, 'x', 1, 2, 3, false, 500, 7500);
+    init_stepper(&sm_y, 'y', 4, 5, 6, false, 500, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 0);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 0);
+
+    int prescaler;
+    unsigned int adjustment;
+    stepper_timer_period_settings(20, TIMER_DEFAULT, &prescaler, &adjustment);
+    stepper_configure_timer(20, TIMER_DEFAULT, prescaler, adjustment);
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, FIX);
+
+    stepper* axes[] = {&sm_x, &sm_y};
+    stepper_link_start(axes, 2, device_read_byte, device_write_byte, NULL);
+
+    pthread_t host;
+    pthread_create(&host, NULL, host_thread, NULL);
+    while(stepper_link_handle()) {
+        usleep(200);
+    }
+    pthread_join(host, NULL);
+
+    stepper_link_stats_t stats;
+    stepper_link_stats(&stats);
+    printf("Segments: %lu, frames: %lu, bad frames: %lu, seq errors: %lu, "
+        "overflows: %lu, resent by host: %lu\n",
+        stats.segments, stats.frames, stats.bad_frames, stats.seq_errors,
+        stats.overflows, _host_resent);
+    printf("Positions: x=%lld, y=%lld\n", sm_x.current_pos, sm_y.current_pos);
+
+    // четное количество сегментов возвращает оси в 0
+    long long x_pos = _segment_count % 2 ? SEGMENT_STEPS*7500LL : 0;
+    long long y_pos = _segment_count % 2 ? -SEGMENT_STEPS/2*7500LL : 0;
+    bool ok = _host_ok && stepper_link_status() == LINK_FINISHED &&
+        stats.segments == (unsigned long)_segment_count &&
+        (_segment_count <= CORRUPT_FRAME || stats.bad_frames > 0) &&
+        stats.overflows == 0 && sm_x.current_pos == x_pos && sm_y.current_pos == y_pos;
+    if(!ok) {
+        printf("FAILED: link status=%d, cycle error=%d\n", stepper_link_status(), stepper_cycle_error());
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
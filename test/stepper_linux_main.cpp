@@ -0,0 +1,123 @@
+/**
+ * stepper_linux_main.cpp
+ *
+ * Проверка бэкенда Linux (STEPPER_LINUX): цикл вращения 3 моторов
+ * на потоке таймера, подсчет шагов через свой приемник для ножек,
+ * статистика опозданий таймера.
+ *
+ * ./stepper_linux [период таймера, мкс]
+ */
+
+#include "Arduino.h"
+#include "stepper.h"
+#include "stepper_configure_timer.h"
+#include "stepper_linux.h"
+
+extern "C"{
+    #include "timer_setup.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Количество ножек приемника
+#define PINS 16
+
+// Значения ножек
+static volatile int _pin_values[PINS];
+
+// Количество шагов (переход step HIGH->LOW) по ножкам
+static volatile unsigned long _pin_steps[PINS];
+
+static void counting_pin_mode(int pin, int mode) {
+}
+
+static void counting_digital_write(int pin, int val) {
+    if(pin >= 0 && pin < PINS) {
+        if(_pin_values[pin] == HIGH && val == LOW) {
+            _pin_steps[pin]++;
+        }
+        _pin_values[pin] = val;
+    }
+}
+
+static int counting_digital_read(int pin) {
+    if(pin >= 0 && pin < PINS) {
+        return _pin_values[pin];
+    }
+    return LOW;
+}
+
+static const stepper_linux_gpio_t counting_gpio = {
+    counting_pin_mode, counting_digital_write, counting_digital_read
+};
+
+static stepper sm_x, sm_y, sm_z;
+
+int main(int argc, char** argv) {
+    unsigned long period_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 20;
+
+    stepper_linux_set_gpio(&counting_gpio);
+
+    // init_stepper(smotor, name, pin_step, pin_dir, pin_en,
+    //     invert_dir, step_delay, distance_per_step)
+    init_stepper(&sm_x, 'x', 1, 2, 3, false, 500, 7500);
+    init_stepper(&sm_y, 'y', 4, 5, 6, false, 500, 7500);
+    init_stepper(&sm_z, 'z', 7, 8, 9, false, 500, 7500);
+    init_stepper_ends(&sm_x, NO_PIN, NO_PIN, INF, INF, 0, 0);
+    init_stepper_ends(&sm_y, NO_PIN, NO_PIN, INF, INF, 0, 0);
+    init_stepper_ends(&sm_z, NO_PIN, NO_PIN, INF, INF, 0, 0);
+
+    int prescaler;
+    unsigned int adjustment;
+    if(!stepper_timer_period_settings(period_us, TIMER_DEFAULT, &prescaler, &adjustment)) {
+        printf("Can't set timer period %luus\n", period_us);
+        return 1;
+    }
+    stepper_configure_timer(period_us, TIMER_DEFAULT, prescaler, adjustment);
+    
+    // поток таймера может вытеснить другой процесс - пропущенные
+    // импульсы догоняем, а не завершаем цикл
+    stepper_set_error_handle_strategy(DONT_CHANGE, DONT_CHANGE, DONT_CHANGE, FIX);
+
+    // полсекунды вращения: 1000 шагов x, 500 шагов y, 250 шагов z назад
+    prepare_steps(&sm_x, 1000, 1, 500);
+    prepare_steps(&sm_y, 500, 1, 1000);
+    prepare_steps(&sm_z, 250, -1, 2000);
+
+    stepper_linux_reset_timer_stats();
+    if(!stepper_start_cycle()) {
+        printf("Can't start cycle\n");
+        return 1;
+    }
+    while(stepper_cycle_running()) {
+        usleep(10000);
+    }
+
+    stepper_linux_timer_stats_t stats;
+    stepper_linux_timer_stats(&stats);
+
+    printf("Timer period: %luus, realtime (SCHED_FIFO): %s\n",
+        period_us, stats.realtime ? "yes" : "no");
+    printf("Ticks: %llu, late avg: %lluns, late max: %lluns, missed: %lu\n",
+        stats.ticks, stats.ticks ? stats.total_late_ns / stats.ticks : 0,
+        stats.max_late_ns, stepper_cycle_missed_ticks());
+    printf("Steps: x=%lu, y=%lu, z=%lu\n",
+        _pin_steps[1], _pin_steps[4], _pin_steps[7]);
+    printf("Positions: x=%lld, y=%lld, z=%lld\n",
+        sm_x.current_pos, sm_y.current_pos, sm_z.current_pos);
+
+    // обработчик мог не уложиться в период (его вытеснили) - это не ошибка
+    bool ok = (stepper_cycle_error() == CYCLE_ERROR_NONE ||
+            stepper_cycle_error() == CYCLE_ERROR_HANDLER_TIMING_EXCEEDED) &&
+        _pin_steps[1] == 1000 && _pin_steps[4] == 500 && _pin_steps[7] == 250 &&
+        sm_x.current_pos == 1000*7500LL && sm_y.current_pos == 500*7500LL &&
+        sm_z.current_pos == -250*7500LL;
+    if(!ok) {
+        printf("FAILED: cycle error=%d\n", stepper_cycle_error());
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -1,6 +1,10 @@
 #include "stepper_test.h"
 
 int main() {
+#ifdef STEPPER_TEST_SUITE
+    // только один набор тестов (для сборок с другими настройками библиотеки)
+    return STEPPER_TEST_SUITE();
+#else
     return stepper_test_suite();
+#endif
 }
-